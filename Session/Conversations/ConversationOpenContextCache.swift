@@ -0,0 +1,594 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionMessagingKit
+import SessionUtilitiesKit
+
+/// This type caches the values the `ConversationViewModel` needs in order to open a conversation (and speculatively the first
+/// page of messages for the threads at the top of the home screen) so that opening a conversation doesn't need to hit the database
+/// or derive the blinded key on the main thread
+///
+/// **Note:** Entries are kept current by observing the tables they are derived from, when a relevant change is committed the
+/// affected entries are removed (changes to the first page of messages are resolved to their threads on a reader first) and
+/// prewarmed entries are refreshed on a background queue
+public class ConversationOpenContextCache: TransactionObserver {
+    public struct Context {
+        let threadVariant: SessionThread.Variant
+        let firstUnreadInteractionId: Int64?
+        let currentUserIsClosedGroupMember: Bool?
+        let openGroupPermissions: OpenGroup.Permissions?
+        let currentUserBlindedPublicKey: String?
+        let initialPage: InitialPage?
+        
+        func with(initialPage: InitialPage?) -> Context {
+            return Context(
+                threadVariant: threadVariant,
+                firstUnreadInteractionId: firstUnreadInteractionId,
+                currentUserIsClosedGroupMember: currentUserIsClosedGroupMember,
+                openGroupPermissions: openGroupPermissions,
+                currentUserBlindedPublicKey: currentUserBlindedPublicKey,
+                initialPage: initialPage
+            )
+        }
+    }
+    
+    public struct InitialPage {
+        let data: [MessageViewModel]
+        let pageInfo: PagedData.PageInfo
+    }
+    
+    /// The cached contexts along with the order they were used in (so the least recently used contexts can be evicted)
+    private struct CachedContexts {
+        var contexts: [String: Context] = [:]
+        
+        /// The ids of the cached threads ordered from least to most recently used
+        var threadIds: [String] = []
+        
+        mutating func set(_ context: Context, for threadId: String) {
+            contexts[threadId] = context
+            markUsed(threadId)
+        }
+        
+        mutating func markUsed(_ threadId: String) {
+            threadIds.removeAll { $0 == threadId }
+            threadIds.append(threadId)
+        }
+        
+        mutating func remove(threadIds threadIdsToRemove: Set<String>) {
+            threadIdsToRemove.forEach { contexts.removeValue(forKey: $0) }
+            threadIds.removeAll { threadIdsToRemove.contains($0) }
+        }
+        
+        /// Remove the least recently used contexts (other than the ones for the retained threads) until there are no more than
+        /// `maxCount` contexts
+        mutating func trim(to maxCount: Int, retaining retainedThreadIds: Set<String>) {
+            let evictedThreadIds: Set<String> = Set(threadIds
+                .filter { !retainedThreadIds.contains($0) }
+                .prefix(max(0, contexts.count - maxCount)))
+            
+            remove(threadIds: evictedThreadIds)
+        }
+    }
+    
+    public static let shared: ConversationOpenContextCache = ConversationOpenContextCache()
+    
+    /// The number of threads from the top of the home screen to prewarm
+    public static let numPrewarmedThreads: Int = 5
+    
+    /// The maximum number of contexts to keep (the prewarmed threads are always kept so this only limits the contexts for
+    /// conversations which have been opened)
+    internal static let maxCachedContexts: Int = 20
+    
+    /// Changes are coalesced for this duration before refreshing so a burst of incoming messages only results in a single refresh
+    private static let refreshDebounceInterval: DispatchTimeInterval = .milliseconds(500)
+    
+    private let storage: Storage
+    private let queue: DispatchQueue = DispatchQueue(label: "ConversationOpenContextCache.queue", qos: .utility)
+    private let cachedContexts: Atomic<CachedContexts> = Atomic(CachedContexts())
+    private let prewarmedThreads: Atomic<[String: SessionThread.Variant]> = Atomic([:])
+    private let generations: Atomic<[String: Int]> = Atomic([:])
+    private let pendingPageLoads: Atomic<[String: PagedDatabaseObserver<Interaction, MessageViewModel>]> = Atomic([:])
+    private let staleThreadIds: Atomic<Set<String>> = Atomic([])
+    private let isRefreshScheduled: Atomic<Bool> = Atomic(false)
+    private let isObserving: Atomic<Bool> = Atomic(false)
+    
+    // Values tracked within the current transaction
+    private let changedRowIds: Atomic<[String: Set<Int64>]> = Atomic([:])
+    private let deletedTableNames: Atomic<Set<String>> = Atomic([])
+    
+    // MARK: - Initialization
+    
+    init(storage: Storage = Storage.shared) {
+        self.storage = storage
+    }
+    
+    // MARK: - Functions
+    
+    /// Returns the cached context for the thread if there is one
+    ///
+    /// **Note:** This never reads from the database so is safe to call on the main thread, if there is no cached context then
+    /// `loadContext` should be called on a background thread instead
+    ///
+    /// **Note:** When a `focusedInteractionId` is provided the cached first page won't be returned as it would be centered
+    /// around the wrong message
+    public func cachedContext(
+        for threadId: String,
+        threadVariant: SessionThread.Variant,
+        focusedInteractionId: Int64?
+    ) -> Context? {
+        let maybeContext: Context? = cachedContexts.mutate { cachedContexts in
+            guard
+                let context: Context = cachedContexts.contexts[threadId],
+                context.threadVariant == threadVariant
+            else { return nil }
+            
+            cachedContexts.markUsed(threadId)
+            return context
+        }
+        
+        guard focusedInteractionId == nil else { return maybeContext?.with(initialPage: nil) }
+        
+        return maybeContext
+    }
+    
+    /// Fetches the context for the thread and caches it for subsequent calls to `cachedContext`
+    ///
+    /// **Note:** This reads from the database so shouldn't be called on the main thread
+    public func loadContext(for threadId: String, threadVariant: SessionThread.Variant) -> Context? {
+        startObservingIfNeeded()
+        
+        let generation: Int = (generations.wrappedValue[threadId] ?? 0)
+        let maybeContext: Context? = storage.read { db -> Context in
+            try ConversationOpenContextCache.fetchContext(db, threadId: threadId, threadVariant: threadVariant)
+        }
+        
+        if let context: Context = maybeContext {
+            store(context, for: threadId, generation: generation)
+        }
+        
+        return maybeContext
+    }
+    
+    /// Prewarm the context and first page of messages for the provided threads, any previously prewarmed threads which aren't
+    /// included will be evicted
+    public func prewarm(threads: [(threadId: String, threadVariant: SessionThread.Variant)]) {
+        startObservingIfNeeded()
+        
+        let targetThreads: [String: SessionThread.Variant] = threads
+            .prefix(ConversationOpenContextCache.numPrewarmedThreads)
+            .reduce(into: [:]) { result, next in result[next.threadId] = next.threadVariant }
+        let previousThreads: [String: SessionThread.Variant] = prewarmedThreads.mutate { prewarmedThreads in
+            let previousThreads: [String: SessionThread.Variant] = prewarmedThreads
+            prewarmedThreads = targetThreads
+            
+            return previousThreads
+        }
+        let evictedThreadIds: Set<String> = Set(previousThreads.keys).subtracting(targetThreads.keys)
+        let newThreadIds: Set<String> = Set(targetThreads.keys)
+            .subtracting(cachedContexts.wrappedValue.contexts.keys)
+        
+        if !evictedThreadIds.isEmpty {
+            cachedContexts.mutate { $0.remove(threadIds: evictedThreadIds) }
+        }
+        
+        guard !newThreadIds.isEmpty else { return }
+        
+        staleThreadIds.mutate { $0.formUnion(newThreadIds) }
+        scheduleRefresh(immediately: true)
+    }
+    
+    public func clearAll() {
+        cachedContexts.mutate { $0 = CachedContexts() }
+        prewarmedThreads.mutate { $0 = [:] }
+        staleThreadIds.mutate { $0 = [] }
+        generations.mutate { generations in
+            generations = generations.mapValues { $0 + 1 }
+        }
+    }
+    
+    // MARK: - Internal Functions
+    
+    private func startObservingIfNeeded() {
+        let wasObserving: Bool = isObserving.mutate { isObserving in
+            let wasObserving: Bool = isObserving
+            isObserving = true
+            
+            return wasObserving
+        }
+        
+        guard !wasObserving else { return }
+        
+        storage.addObserver(self)
+    }
+    
+    private func store(_ context: Context, for threadId: String, generation: Int) {
+        // If the thread was invalidated while we were fetching then the context is already stale so don't store it
+        guard generations.wrappedValue[threadId, default: 0] == generation else { return }
+        
+        let prewarmedThreadIds: Set<String> = Set(prewarmedThreads.wrappedValue.keys)
+        
+        cachedContexts.mutate { cachedContexts in
+            cachedContexts.set(context, for: threadId)
+            cachedContexts.trim(to: ConversationOpenContextCache.maxCachedContexts, retaining: prewarmedThreadIds)
+        }
+    }
+    
+    private func invalidate(threadIds: Set<String>) {
+        guard !threadIds.isEmpty else { return }
+        
+        generations.mutate { generations in
+            threadIds.forEach { generations[$0, default: 0] += 1 }
+        }
+        
+        // Remove the stale entries immediately (opening one of these threads before the refresh completes will fall back to
+        // fetching the context directly)
+        cachedContexts.mutate { $0.remove(threadIds: threadIds) }
+        
+        let prewarmedThreadIds: Set<String> = Set(prewarmedThreads.wrappedValue.keys)
+        let threadIdsToRefresh: Set<String> = threadIds.intersection(prewarmedThreadIds)
+        
+        guard !threadIdsToRefresh.isEmpty else { return }
+        
+        staleThreadIds.mutate { $0.formUnion(threadIdsToRefresh) }
+        scheduleRefresh(immediately: false)
+    }
+    
+    private func scheduleRefresh(immediately: Bool) {
+        let wasScheduled: Bool = isRefreshScheduled.mutate { isRefreshScheduled in
+            let wasScheduled: Bool = isRefreshScheduled
+            isRefreshScheduled = true
+            
+            return wasScheduled
+        }
+        
+        guard !wasScheduled else { return }
+        
+        queue.asyncAfter(
+            deadline: .now() + (immediately ? .milliseconds(0) : ConversationOpenContextCache.refreshDebounceInterval)
+        ) { [weak self] in
+            self?.isRefreshScheduled.mutate { $0 = false }
+            self?.refreshStaleContexts()
+        }
+    }
+    
+    private func refreshStaleContexts() {
+        let threadIds: Set<String> = staleThreadIds.mutate { staleThreadIds in
+            let threadIds: Set<String> = staleThreadIds
+            staleThreadIds = []
+            
+            return threadIds
+        }
+        let prewarmedThreads: [String: SessionThread.Variant] = self.prewarmedThreads.wrappedValue
+        let targetThreads: [String: SessionThread.Variant] = prewarmedThreads
+            .filter { threadIds.contains($0.key) }
+        let generations: [String: Int] = self.generations.wrappedValue
+        
+        guard !targetThreads.isEmpty else { return }
+        
+        // Fetch all of the contexts in a single read
+        let updatedContexts: [String: Context] = storage
+            .read { db -> [String: Context] in
+                try targetThreads.reduce(into: [:]) { result, next in
+                    result[next.key] = try ConversationOpenContextCache.fetchContext(
+                        db,
+                        threadId: next.key,
+                        threadVariant: next.value
+                    )
+                }
+            }
+            .defaulting(to: [:])
+        
+        updatedContexts.forEach { threadId, context in
+            let generation: Int = generations[threadId, default: 0]
+            
+            store(context, for: threadId, generation: generation)
+            loadInitialPage(for: threadId, context: context, generation: generation)
+        }
+    }
+    
+    private func loadInitialPage(for threadId: String, context: Context, generation: Int) {
+        let userPublicKey: String = getUserHexEncodedPublicKey()
+        
+        // Note: We use the same observer config as the 'ConversationViewModel' so the data matches exactly what
+        // it would have loaded, this observer is never added to the database so it won't receive updates
+        let observer: PagedDatabaseObserver<Interaction, MessageViewModel> = ConversationViewModel.pagedObserver(
+            for: threadId,
+            userPublicKey: userPublicKey,
+            onChangeUnsorted: { [weak self] data, pageInfo in
+                self?.pendingPageLoads.mutate { $0[threadId] = nil }
+                
+                guard self?.generations.wrappedValue[threadId, default: 0] == generation else { return }
+                
+                // Note: Typing indicators change too frequently to be worth caching (they are only shown while the
+                // other party is typing) so we exclude them, the initial query when opening the conversation will add
+                // it if it's still needed
+                let initialPage: InitialPage = InitialPage(
+                    data: data.filter { $0.isTypingIndicator != true },
+                    pageInfo: pageInfo
+                )
+                
+                self?.cachedContexts.mutate { cachedContexts in
+                    guard let context: Context = cachedContexts.contexts[threadId] else { return }
+                    
+                    cachedContexts.contexts[threadId] = context.with(initialPage: initialPage)
+                }
+            }
+        )
+        pendingPageLoads.mutate { $0[threadId] = observer }
+        
+        switch context.firstUnreadInteractionId {
+            case .some(let targetInteractionId): observer.load(.initialPageAround(id: targetInteractionId))
+            case .none: observer.load(.pageBefore)
+        }
+    }
+    
+    private static func fetchContext(
+        _ db: Database,
+        threadId: String,
+        threadVariant: SessionThread.Variant
+    ) throws -> Context {
+        let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
+        let groupMember: TypedTableAlias<GroupMember> = TypedTableAlias()
+        
+        let firstUnreadInteractionId: Int64? = try Interaction
+            .select(.id)
+            .filter(interaction[.wasRead] == false)
+            .filter(interaction[.threadId] == threadId)
+            .order(interaction[.timestampMs].asc)
+            .asRequest(of: Int64.self)
+            .fetchOne(db)
+        let currentUserIsClosedGroupMember: Bool? = (threadVariant != .closedGroup ? nil :
+            try GroupMember
+                .filter(groupMember[.groupId] == threadId)
+                .filter(groupMember[.profileId] == getUserHexEncodedPublicKey(db))
+                .filter(groupMember[.role] == GroupMember.Role.standard)
+                .isNotEmpty(db)
+        )
+        let openGroupPermissions: OpenGroup.Permissions? = (threadVariant != .openGroup ? nil :
+            try OpenGroup
+                .filter(id: threadId)
+                .select(.permissions)
+                .asRequest(of: OpenGroup.Permissions.self)
+                .fetchOne(db)
+        )
+        let blindedKey: String? = SessionThread.getUserHexEncodedBlindedKey(
+            db,
+            threadId: threadId,
+            threadVariant: threadVariant
+        )
+        
+        return Context(
+            threadVariant: threadVariant,
+            firstUnreadInteractionId: firstUnreadInteractionId,
+            currentUserIsClosedGroupMember: currentUserIsClosedGroupMember,
+            openGroupPermissions: openGroupPermissions,
+            currentUserBlindedPublicKey: blindedKey,
+            initialPage: nil
+        )
+    }
+    
+    /// Determine which of the cached threads are affected by the inserted or updated rows in the tables the first page of
+    /// messages is derived from
+    private static func pageThreadIds(
+        _ db: Database,
+        changedRowIds: [String: Set<Int64>],
+        cachedThreadIds: Set<String>
+    ) throws -> Set<String> {
+        var interactionIds: Set<Int64> = (changedRowIds[Interaction.databaseTableName] ?? [])
+        var threadIds: Set<String> = []
+        
+        if let rowIds: Set<Int64> = changedRowIds[Reaction.databaseTableName] {
+            interactionIds.formUnion(
+                try Reaction
+                    .select(.interactionId)
+                    .filter(rowIds.contains(Column.rowID))
+                    .asRequest(of: Int64.self)
+                    .fetchSet(db)
+            )
+        }
+        
+        if let rowIds: Set<Int64> = changedRowIds[RecipientState.databaseTableName] {
+            interactionIds.formUnion(
+                try RecipientState
+                    .select(.interactionId)
+                    .filter(rowIds.contains(Column.rowID))
+                    .asRequest(of: Int64.self)
+                    .fetchSet(db)
+            )
+        }
+        
+        if let rowIds: Set<Int64> = changedRowIds[Attachment.databaseTableName] {
+            let attachmentIds: Set<String> = try Attachment
+                .select(.id)
+                .filter(rowIds.contains(Column.rowID))
+                .asRequest(of: String.self)
+                .fetchSet(db)
+            
+            interactionIds.formUnion(
+                try InteractionAttachment
+                    .select(.interactionId)
+                    .filter(attachmentIds.contains(InteractionAttachment.Columns.attachmentId))
+                    .asRequest(of: Int64.self)
+                    .fetchSet(db)
+            )
+            interactionIds.formUnion(
+                try Quote
+                    .select(.interactionId)
+                    .filter(attachmentIds.contains(Quote.Columns.attachmentId))
+                    .asRequest(of: Int64.self)
+                    .fetchSet(db)
+            )
+        }
+        
+        // The contact is joined using the thread id
+        if let rowIds: Set<Int64> = changedRowIds[Contact.databaseTableName] {
+            threadIds.formUnion(
+                try Contact
+                    .select(.id)
+                    .filter(rowIds.contains(Column.rowID))
+                    .asRequest(of: String.self)
+                    .fetchSet(db)
+            )
+        }
+        
+        // The profile is joined using the author of each interaction
+        if let rowIds: Set<Int64> = changedRowIds[Profile.databaseTableName] {
+            let profileIds: Set<String> = try Profile
+                .select(.id)
+                .filter(rowIds.contains(Column.rowID))
+                .asRequest(of: String.self)
+                .fetchSet(db)
+            
+            threadIds.formUnion(
+                try Interaction
+                    .select(.threadId)
+                    .filter(cachedThreadIds.contains(Interaction.Columns.threadId))
+                    .filter(profileIds.contains(Interaction.Columns.authorId))
+                    .distinct()
+                    .asRequest(of: String.self)
+                    .fetchSet(db)
+            )
+        }
+        
+        if !interactionIds.isEmpty {
+            threadIds.formUnion(
+                try Interaction
+                    .select(.threadId)
+                    .filter(ids: interactionIds)
+                    .asRequest(of: String.self)
+                    .fetchSet(db)
+            )
+        }
+        
+        return threadIds.intersection(cachedThreadIds)
+    }
+    
+    // MARK: - TransactionObserver
+    
+    /// The tables which affect the data in the first page of messages (but not the rest of the context)
+    private static let pageOnlyTableNames: Set<String> = [
+        Attachment.databaseTableName,
+        Reaction.databaseTableName,
+        RecipientState.databaseTableName,
+        Contact.databaseTableName,
+        Profile.databaseTableName
+    ]
+    
+    public func observes(eventsOfKind eventKind: DatabaseEventKind) -> Bool {
+        // Don't bother tracking anything if nothing has been cached
+        guard
+            !cachedContexts.wrappedValue.contexts.isEmpty ||
+            !prewarmedThreads.wrappedValue.isEmpty
+        else { return false }
+        
+        switch eventKind.tableName {
+            case Interaction.databaseTableName, GroupMember.databaseTableName,
+                OpenGroup.databaseTableName, Capability.databaseTableName:
+                return true
+            
+            default: return ConversationOpenContextCache.pageOnlyTableNames.contains(eventKind.tableName)
+        }
+    }
+    
+    public func databaseDidChange(with event: DatabaseEvent) {
+        // We can only determine the thread for inserts and updates (deleted rows no longer exist by the time the
+        // commit finishes) so deletions invalidate every cached thread
+        switch event.kind {
+            case .delete: deletedTableNames.mutate { $0.insert(event.tableName) }
+            default: changedRowIds.mutate { $0[event.tableName, default: []].insert(event.rowID) }
+        }
+    }
+    
+    public func databaseDidCommit(_ db: Database) {
+        let changedRowIds: [String: Set<Int64>] = self.changedRowIds.mutate { changedRowIds in
+            let result: [String: Set<Int64>] = changedRowIds
+            changedRowIds = [:]
+            
+            return result
+        }
+        let deletedTableNames: Set<String> = self.deletedTableNames.mutate { deletedTableNames in
+            let result: Set<String> = deletedTableNames
+            deletedTableNames = []
+            
+            return result
+        }
+        let changedTableNames: Set<String> = deletedTableNames.union(changedRowIds.keys)
+        // Note: We include the prewarmed threads as their contexts may currently be being fetched
+        let prewarmedThreadIds: Set<String> = Set(prewarmedThreads.wrappedValue.keys)
+        let cachedThreads: [String: SessionThread.Variant] = cachedContexts.wrappedValue.contexts
+            .mapValues { $0.threadVariant }
+            .merging(prewarmedThreads.wrappedValue) { current, _ in current }
+        
+        guard !changedTableNames.isEmpty, !cachedThreads.isEmpty else { return }
+        
+        var threadIdsToInvalidate: Set<String> = []
+        
+        if changedTableNames.contains(GroupMember.databaseTableName) {
+            threadIdsToInvalidate.formUnion(cachedThreads.filter { $0.value == .closedGroup }.keys)
+        }
+        
+        if
+            changedTableNames.contains(OpenGroup.databaseTableName) ||
+            changedTableNames.contains(Capability.databaseTableName)
+        {
+            threadIdsToInvalidate.formUnion(cachedThreads.filter { $0.value == .openGroup }.keys)
+        }
+        
+        let pageTableNames: Set<String> = ConversationOpenContextCache.pageOnlyTableNames
+            .union([Interaction.databaseTableName])
+        let changedPageTableNames: Set<String> = changedTableNames.intersection(pageTableNames)
+        
+        invalidate(threadIds: threadIdsToInvalidate)
+        
+        guard !changedPageTableNames.isEmpty else { return }
+        
+        // Deleted rows no longer exist so we can't determine which threads they belonged to
+        guard deletedTableNames.isDisjoint(with: pageTableNames) else {
+            invalidatePageChanges(
+                affecting: Set(cachedThreads.keys),
+                changedPageTableNames: changedPageTableNames,
+                prewarmedThreadIds: prewarmedThreadIds
+            )
+            return
+        }
+        
+        // Resolving the row ids to threads requires querying the page tables, this is done on a reader (rather than on the
+        // writer while it's blocking the next write) as the rows are committed at this point
+        queue.async { [weak self, storage] in
+            let affectedThreadIds: Set<String> = storage
+                .read { db in
+                    try ConversationOpenContextCache.pageThreadIds(
+                        db,
+                        changedRowIds: changedRowIds,
+                        cachedThreadIds: Set(cachedThreads.keys)
+                    )
+                }
+                .defaulting(to: Set(cachedThreads.keys))
+            
+            self?.invalidatePageChanges(
+                affecting: affectedThreadIds,
+                changedPageTableNames: changedPageTableNames,
+                prewarmedThreadIds: prewarmedThreadIds
+            )
+        }
+    }
+    
+    private func invalidatePageChanges(
+        affecting affectedThreadIds: Set<String>,
+        changedPageTableNames: Set<String>,
+        prewarmedThreadIds: Set<String>
+    ) {
+        // Changes to the tables which are only displayed in the first page only need to drop the prewarmed threads (the
+        // other cached contexts don't contain a page)
+        switch changedPageTableNames.contains(Interaction.databaseTableName) {
+            case true: invalidate(threadIds: affectedThreadIds)
+            case false: invalidate(threadIds: affectedThreadIds.intersection(prewarmedThreadIds))
+        }
+    }
+    
+    public func databaseDidRollback(_ db: Database) {
+        changedRowIds.mutate { $0 = [:] }
+        deletedTableNames.mutate { $0 = [] }
+    }
+}
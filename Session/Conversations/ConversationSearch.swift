@@ -88,7 +88,8 @@ extension ConversationSearchController: UISearchResultsUpdating {
                 
                 return try Interaction.idsForTermWithin(
                     threadId: threadId,
-                    pattern: try SessionThreadViewModel.pattern(db, searchTerm: searchText)
+                    pattern: try SessionThreadViewModel.pattern(db, searchTerm: searchText),
+                    searchTerm: searchText
                 )
                 .fetchAll(db)
             }
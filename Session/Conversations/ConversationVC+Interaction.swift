@@ -510,7 +510,14 @@ extension ConversationVC:
                         authorId: quoteModel.authorId,
                         timestampMs: quoteModel.timestampMs,
                         body: quoteModel.body,
-                        attachmentId: quoteModel.generateAttachmentThumbnailIfNeeded(db)
+                        attachmentId: quoteModel.generateAttachmentThumbnailIfNeeded(db),
+                        originalInteractionId: Quote.originalInteractionId(
+                            db,
+                            timestampMs: quoteModel.timestampMs,
+                            authorId: quoteModel.authorId,
+                            threadId: thread.id,
+                            threadVariant: thread.variant
+                        )
                     ).insert(db)
                 }
                 
@@ -1339,134 +1346,22 @@ extension ConversationVC:
                     Emoji.addRecent(db, emoji: emoji)
                 }
                 
-                if let openGroup: OpenGroup = try? OpenGroup.fetchOne(db, id: cellViewModel.threadId),
-                   OpenGroupManager.isOpenGroupSupport(.reactions, on: openGroup.server)
-                {
-                    // Send reaction to open groups
-                    guard
-                        let openGroupServerMessageId: Int64 = try? Interaction
-                            .select(.openGroupServerMessageId)
-                            .filter(id: cellViewModel.id)
-                            .asRequest(of: Int64.self)
-                            .fetchOne(db)
-                    else { return }
-                    
-                    if remove {
-                        let pendingChange = OpenGroupManager
-                            .addPendingReaction(
-                                emoji: emoji,
-                                id: openGroupServerMessageId,
-                                in: openGroup.roomToken,
-                                on: openGroup.server,
-                                type: .remove
-                            )
-                        OpenGroupAPI
-                            .reactionDelete(
-                                db,
-                                emoji: emoji,
-                                id: openGroupServerMessageId,
-                                in: openGroup.roomToken,
-                                on: openGroup.server
-                            )
-                            .map { _, response in
-                                OpenGroupManager
-                                    .updatePendingChange(
-                                        pendingChange,
-                                        seqNo: response.seqNo
-                                    )
-                            }
-                            .catch { [weak self] _ in
-                                OpenGroupManager.removePendingChange(pendingChange)
-
-                                self?.handleReactionSentFailure(
-                                    pendingReaction,
-                                    remove: remove
-                                )
-
-                            }
-                            .retainUntilComplete()
-                    }
-                    else {
-                        let pendingChange = OpenGroupManager
-                            .addPendingReaction(
-                                emoji: emoji,
-                                id: openGroupServerMessageId,
-                                in: openGroup.roomToken,
-                                on: openGroup.server,
-                                type: .add
-                            )
-
-                        OpenGroupAPI
-                            .reactionAdd(
-                                db,
-                                emoji: emoji,
-                                id: openGroupServerMessageId,
-                                in: openGroup.roomToken,
-                                on: openGroup.server
-                            )
-                            .map { _, response in
-                                OpenGroupManager
-                                    .updatePendingChange(
-                                        pendingChange,
-                                        seqNo: response.seqNo
-                                    )
-                            }
-                            .catch { [weak self] _ in
-                                OpenGroupManager.removePendingChange(pendingChange)
-                                
-                                self?.handleReactionSentFailure(
-                                    pendingReaction,
-                                    remove: remove
-                                )
-                            }
-                            .retainUntilComplete()
-                    }
-                }
-                else {
-                    // Send the actual message
-                    try MessageSender.send(
-                        db,
-                        message: VisibleMessage(
-                            sentTimestamp: UInt64(sentTimestamp),
-                            text: nil,
-                            reaction: VisibleMessage.VMReaction(
-                                timestamp: UInt64(cellViewModel.timestampMs),
-                                publicKey: {
-                                    guard cellViewModel.variant == .standardIncoming else {
-                                        return cellViewModel.currentUserPublicKey
-                                    }
-                                    
-                                    return cellViewModel.authorId
-                                }(),
-                                emoji: emoji,
-                                kind: (remove ? .remove : .react)
-                            )
-                        ),
+                // Send the change (rapid open group changes get collapsed and sent together)
+                try ReactionSender.enqueue(
+                    db,
+                    ReactionSender.Change(
+                        threadId: cellViewModel.threadId,
                         interactionId: cellViewModel.id,
-                        in: thread
+                        emoji: emoji,
+                        remove: remove,
+                        sentTimestampMs: sentTimestamp,
+                        reaction: pendingReaction
                     )
-                }
+                )
             }
         )
     }
     
-    func handleReactionSentFailure(_ pendingReaction: Reaction?, remove: Bool) {
-        guard let pendingReaction = pendingReaction else { return }
-        Storage.shared.writeAsync { db in
-            // Reverse the database
-            if remove {
-                try pendingReaction.insert(db)
-            }
-            else {
-                try Reaction
-                    .filter(Reaction.Columns.interactionId == pendingReaction.interactionId)
-                    .filter(Reaction.Columns.authorId == pendingReaction.authorId)
-                    .filter(Reaction.Columns.emoji == pendingReaction.emoji)
-                    .deleteAll(db)
-            }
-        }
-    }
-    
     func showFullEmojiKeyboard(_ cellViewModel: MessageViewModel) {
         hideInputAccessoryView()
         
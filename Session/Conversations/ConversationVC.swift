@@ -2,6 +2,7 @@
 
 import UIKit
 import AVKit
+import Combine
 import GRDB
 import DifferenceKit
 import SessionUIKit
@@ -11,9 +12,10 @@ import SignalUtilitiesKit
 
 final class ConversationVC: BaseVC, ConversationSearchControllerDelegate, UITableViewDataSource, UITableViewDelegate {
     private static let loadingHeaderHeight: CGFloat = 40
+    private static let attachmentPrefetchInterval: TimeInterval = 0.25
     
     internal let viewModel: ConversationViewModel
-    private var dataChangeObservable: DatabaseCancellable?
+    private var dataChangeCancellable: AnyCancellable?
     private var hasLoadedInitialThreadData: Bool = false
     private var hasLoadedInitialInteractionData: Bool = false
     private var currentTargetOffset: CGPoint?
@@ -56,6 +58,7 @@ final class ConversationVC: BaseVC, ConversationSearchControllerDelegate, UITabl
     var didFinishInitialLayout = false
     var scrollDistanceToBottomBeforeUpdate: CGFloat?
     var baselineKeyboardHeight: CGFloat = 0
+    var lastAttachmentPrefetch: (offset: CGFloat, timestamp: TimeInterval)?
     
     /// These flags are true between `viewDid/Will Appear/Disappear` and is used to prevent keyboard changes
     /// from trying to animate (as the animations can cause buggy transitions)
@@ -347,6 +350,7 @@ final class ConversationVC: BaseVC, ConversationSearchControllerDelegate, UITabl
         
         // Constraints
         view.addSubview(tableView)
+        viewModel.cellLayoutCache.update(tableWidth: view.bounds.width)
         tableView.pin(to: view)
 
         // Message requests view & scroll to bottom
@@ -458,6 +462,7 @@ final class ConversationVC: BaseVC, ConversationSearchControllerDelegate, UITabl
             // of different behaviours)
             self?.didFinishInitialLayout = true
             self?.viewIsAppearing = false
+            self?.prefetchAttachmentsIfNeeded(force: true)
         }
     }
 
@@ -466,6 +471,9 @@ final class ConversationVC: BaseVC, ConversationSearchControllerDelegate, UITabl
         
         viewIsDisappearing = true
         
+        // Send any reaction changes which are waiting for the user to stop reacting
+        ReactionSender.flush()
+        
         // Don't set the draft or resign the first responder if we are replacing the thread (want the keyboard
         // to appear to remain focussed)
         guard !isReplacingThread else { return }
@@ -503,77 +511,99 @@ final class ConversationVC: BaseVC, ConversationSearchControllerDelegate, UITabl
     
     @objc func applicationDidResignActive(_ notification: Notification) {
         stopObservingChanges()
+        ReactionSender.flush()
     }
     
     override func viewWillTransition(to size: CGSize, with coordinator: UIViewControllerTransitionCoordinator) {
         super.viewWillTransition(to: size, with: coordinator)
         searchBarWidth?.constant = size.width - 32
+        updateCellLayouts(tableWidth: size.width)
         tableView.reloadData()
     }
     
+    override func traitCollectionDidChange(_ previousTraitCollection: UITraitCollection?) {
+        super.traitCollectionDidChange(previousTraitCollection)
+        
+        // The text size affects the height of the cells so the cached layouts are no longer valid
+        guard previousTraitCollection?.preferredContentSizeCategory != traitCollection.preferredContentSizeCategory else {
+            return
+        }
+        
+        viewModel.cellLayoutCache.removeAll()
+        updateCellLayouts(tableWidth: tableView.bounds.width)
+    }
+    
+    private func updateCellLayouts(tableWidth: CGFloat) {
+        viewModel.cellLayoutCache.update(tableWidth: tableWidth)
+        viewModel.cellLayoutCache.prepareLayouts(
+            for: (viewModel.interactionData.first(where: { $0.model == .messages })?.elements ?? []),
+            expandedReactionInteractionIds: viewModel.reactionExpandedInteractionIds
+        )
+    }
+    
     // MARK: - Updating
     
     private func startObservingChanges(didReturnFromBackground: Bool = false) {
         // Start observing for data changes
-        dataChangeObservable = Storage.shared.start(
-            viewModel.observableThreadData,
-            onError:  { _ in },
-            onChange: { [weak self] maybeThreadData in
-                guard let threadData: SessionThreadViewModel = maybeThreadData else {
-                    // If the thread data is null and the id was blinded then we just unblinded the thread
-                    // and need to swap over to the new one
-                    guard
-                        let sessionId: String = self?.viewModel.threadData.threadId,
-                        SessionId.Prefix(from: sessionId) == .blinded,
-                        let blindedLookup: BlindedIdLookup = Storage.shared.read({ db in
-                            try BlindedIdLookup
-                                .filter(id: sessionId)
-                                .fetchOne(db)
-                        }),
-                        let unblindedId: String = blindedLookup.sessionId
-                    else {
-                        // If we don't have an unblinded id then something has gone very wrong so pop to the HomeVC
-                        self?.navigationController?.popToRootViewController(animated: true)
+        dataChangeCancellable = viewModel.observableThreadData
+            .sink(
+                receiveCompletion: { _ in },
+                receiveValue: { [weak self] maybeThreadData in
+                    guard let threadData: SessionThreadViewModel = maybeThreadData else {
+                        // If the thread data is null and the id was blinded then we just unblinded the thread
+                        // and need to swap over to the new one
+                        guard
+                            let sessionId: String = self?.viewModel.threadData.threadId,
+                            SessionId.Prefix(from: sessionId) == .blinded,
+                            let blindedLookup: BlindedIdLookup = Storage.shared.read({ db in
+                                try BlindedIdLookup
+                                    .filter(id: sessionId)
+                                    .fetchOne(db)
+                            }),
+                            let unblindedId: String = blindedLookup.sessionId
+                        else {
+                            // If we don't have an unblinded id then something has gone very wrong so pop to the HomeVC
+                            self?.navigationController?.popToRootViewController(animated: true)
+                            return
+                        }
+                        
+                        // Stop observing changes
+                        self?.stopObservingChanges()
+                        Storage.shared.removeObserver(self?.viewModel.pagedDataObserver)
+                        
+                        // Swap the observing to the updated thread
+                        self?.viewModel.swapToThread(updatedThreadId: unblindedId)
+                        
+                        // Start observing changes again
+                        Storage.shared.addObserver(self?.viewModel.pagedDataObserver)
+                        self?.startObservingChanges()
                         return
                     }
                     
-                    // Stop observing changes
-                    self?.stopObservingChanges()
-                    Storage.shared.removeObserver(self?.viewModel.pagedDataObserver)
+                    // The default scheduler emits changes on the main thread
+                    self?.handleThreadUpdates(threadData)
                     
-                    // Swap the observing to the updated thread
-                    self?.viewModel.swapToThread(updatedThreadId: unblindedId)
-                    
-                    // Start observing changes again
-                    Storage.shared.addObserver(self?.viewModel.pagedDataObserver)
-                    self?.startObservingChanges()
-                    return
-                }
-                
-                // The default scheduler emits changes on the main thread
-                self?.handleThreadUpdates(threadData)
-                
-                // Note: We want to load the interaction data into the UI after the initial thread data
-                // has loaded to prevent an issue where the conversation loads with the wrong offset
-                if self?.viewModel.onInteractionChange == nil {
-                    self?.viewModel.onInteractionChange = { [weak self] updatedInteractionData, changeset in
-                        self?.handleInteractionUpdates(updatedInteractionData, changeset: changeset)
-                    }
-                    
-                    // Note: When returning from the background we could have received notifications but the
-                    // PagedDatabaseObserver won't have them so we need to force a re-fetch of the current
-                    // data to ensure everything is up to date
-                    if didReturnFromBackground {
-                        self?.viewModel.pagedDataObserver?.reload()
+                    // Note: We want to load the interaction data into the UI after the initial thread data
+                    // has loaded to prevent an issue where the conversation loads with the wrong offset
+                    if self?.viewModel.onInteractionChange == nil {
+                        self?.viewModel.onInteractionChange = { [weak self] updatedInteractionData, changeset in
+                            self?.handleInteractionUpdates(updatedInteractionData, changeset: changeset)
+                        }
+                        
+                        // Note: When returning from the background we could have received notifications but the
+                        // PagedDatabaseObserver won't have them so we need to force a re-fetch of the current
+                        // data to ensure everything is up to date
+                        if didReturnFromBackground {
+                            self?.viewModel.pagedDataObserver?.reload()
+                        }
                     }
                 }
-            }
-        )
+            )
     }
     
     private func stopObservingChanges() {
         // Stop observing database changes
-        dataChangeObservable?.cancel()
+        dataChangeCancellable?.cancel()
         self.viewModel.onInteractionChange = nil
     }
     
@@ -1351,11 +1381,44 @@ final class ConversationVC: BaseVC, ConversationSearchControllerDelegate, UITabl
     // MARK: - UITableViewDelegate
 
     func tableView(_ tableView: UITableView, estimatedHeightForRowAt indexPath: IndexPath) -> CGFloat {
-        return UITableView.automaticDimension
+        let section: ConversationViewModel.SectionModel = viewModel.interactionData[indexPath.section]
+        
+        guard section.model == .messages else { return UITableView.automaticDimension }
+        
+        return viewModel.cellLayoutCache
+            .estimatedHeight(for: section.elements[indexPath.row].id)
+            .defaulting(to: UITableView.automaticDimension)
     }
-
+    
     func tableView(_ tableView: UITableView, heightForRowAt indexPath: IndexPath) -> CGFloat {
-        return UITableView.automaticDimension
+        let section: ConversationViewModel.SectionModel = viewModel.interactionData[indexPath.section]
+        
+        guard section.model == .messages else { return UITableView.automaticDimension }
+        
+        let cellViewModel: MessageViewModel = section.elements[indexPath.row]
+        
+        // Only cells which have already been displayed with their current content at the current width will have a height,
+        // the rest are self-sized
+        return viewModel.cellLayoutCache
+            .height(
+                for: cellViewModel,
+                showExpandedReactions: viewModel.reactionExpandedInteractionIds.contains(cellViewModel.id)
+            )
+            .defaulting(to: UITableView.automaticDimension)
+    }
+    
+    func tableView(_ tableView: UITableView, willDisplay cell: UITableViewCell, forRowAt indexPath: IndexPath) {
+        let section: ConversationViewModel.SectionModel = viewModel.interactionData[indexPath.section]
+        
+        guard section.model == .messages else { return }
+        
+        let cellViewModel: MessageViewModel = section.elements[indexPath.row]
+        
+        viewModel.cellLayoutCache.store(
+            measuredHeight: cell.frame.height,
+            for: cellViewModel,
+            showExpandedReactions: viewModel.reactionExpandedInteractionIds.contains(cellViewModel.id)
+        )
     }
     
     func tableView(_ tableView: UITableView, heightForHeaderInSection section: Int) -> CGFloat {
@@ -1483,6 +1546,51 @@ final class ConversationVC: BaseVC, ConversationSearchControllerDelegate, UITabl
         {
             self.viewModel.markAsRead(beforeInclusive: newestCellViewModel.id)
         }
+        
+        self.prefetchAttachmentsIfNeeded()
+    }
+    
+    /// Prefetch the attachments around the visible messages based on the direction and speed of the scroll
+    ///
+    /// **Note:** This is throttled as it gets called for every scroll event
+    private func prefetchAttachmentsIfNeeded(force: Bool = false) {
+        let timestamp: TimeInterval = CACurrentMediaTime()
+        let offset: CGFloat = tableView.contentOffset.y
+        let timeSinceLastPrefetch: TimeInterval = (timestamp - (lastAttachmentPrefetch?.timestamp ?? 0))
+        
+        guard
+            force || timeSinceLastPrefetch >= ConversationVC.attachmentPrefetchInterval,
+            let messagesSectionIndex: Int = self.viewModel.interactionData
+                .firstIndex(where: { $0.model == .messages }),
+            let visibleRows: [Int] = tableView.indexPathsForVisibleRows?
+                .filter({ $0.section == messagesSectionIndex })
+                .map({ $0.row }),
+            let firstVisibleRow: Int = visibleRows.min(),
+            let lastVisibleRow: Int = visibleRows.max()
+        else { return }
+        
+        let cellViewModels: [MessageViewModel] = self.viewModel.interactionData[messagesSectionIndex].elements
+        let averageRowHeight: CGFloat = (tableView.contentSize.height / CGFloat(max(1, cellViewModels.count)))
+        
+        // Convert the scroll speed into rows (if the last prefetch was a while ago then the scroll has
+        // likely only just started so the speed would be inaccurate)
+        let rowsPerSecond: Double = {
+            guard
+                let lastAttachmentPrefetch = lastAttachmentPrefetch,
+                timeSinceLastPrefetch > 0,
+                timeSinceLastPrefetch < 1,
+                averageRowHeight > 0
+            else { return 0 }
+            
+            return (Double((offset - lastAttachmentPrefetch.offset) / averageRowHeight) / timeSinceLastPrefetch)
+        }()
+        lastAttachmentPrefetch = (offset, timestamp)
+        
+        AttachmentPrefetcher.shared.prefetch(
+            for: cellViewModels,
+            visibleRows: firstVisibleRow...lastVisibleRow,
+            rowsPerSecond: rowsPerSecond
+        )
     }
     
     func scrollViewDidEndScrollingAnimation(_ scrollView: UIScrollView) {
@@ -1,6 +1,7 @@
 // Copyright © 2022 Rangeproof Pty Ltd. All rights reserved.
 
 import Foundation
+import Combine
 import GRDB
 import DifferenceKit
 import SessionMessagingKit
@@ -34,7 +35,7 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
     public let initialThreadVariant: SessionThread.Variant
     public var sentMessageBeforeUpdate: Bool = false
     public var lastSearchedText: String?
-    public let focusedInteractionId: Int64?    // Note: This is used for global search
+    public private(set) var focusedInteractionId: Int64?    // Note: This is used for global search
     
     public lazy var blockedBannerMessage: String = {
         switch self.threadData.threadVariant {
@@ -53,65 +54,28 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
     // MARK: - Initialization
     
     init(threadId: String, threadVariant: SessionThread.Variant, focusedInteractionId: Int64?) {
-        typealias InitialData = (
-            targetInteractionId: Int64?,
-            currentUserIsClosedGroupMember: Bool?,
-            openGroupPermissions: OpenGroup.Permissions?,
-            blindedKey: String?
+        // Note: The open context will generally already be cached (the home screen prewarms the top threads) in which
+        // case this won't hit the database or need to derive the blinded key, otherwise it gets loaded on a background
+        // thread below
+        let openContext: ConversationOpenContextCache.Context? = ConversationOpenContextCache.shared.cachedContext(
+            for: threadId,
+            threadVariant: threadVariant,
+            focusedInteractionId: focusedInteractionId
         )
         
-        let initialData: InitialData? = Storage.shared.read { db -> InitialData in
-            let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
-            let groupMember: TypedTableAlias<GroupMember> = TypedTableAlias()
-            
-            // If we have a specified 'focusedInteractionId' then use that, otherwise retrieve the oldest
-            // unread interaction and start focused around that one
-            let targetInteractionId: Int64? = (focusedInteractionId != nil ? focusedInteractionId :
-                try Interaction
-                    .select(.id)
-                    .filter(interaction[.wasRead] == false)
-                    .filter(interaction[.threadId] == threadId)
-                    .order(interaction[.timestampMs].asc)
-                    .asRequest(of: Int64.self)
-                    .fetchOne(db)
-            )
-            let currentUserIsClosedGroupMember: Bool? = (threadVariant != .closedGroup ? nil :
-                try GroupMember
-                    .filter(groupMember[.groupId] == threadId)
-                    .filter(groupMember[.profileId] == getUserHexEncodedPublicKey(db))
-                    .filter(groupMember[.role] == GroupMember.Role.standard)
-                    .isNotEmpty(db)
-            )
-            let openGroupPermissions: OpenGroup.Permissions? = (threadVariant != .openGroup ? nil :
-                try OpenGroup
-                    .filter(id: threadId)
-                    .select(.permissions)
-                    .asRequest(of: OpenGroup.Permissions.self)
-                    .fetchOne(db)
-            )
-            let blindedKey: String? = SessionThread.getUserHexEncodedBlindedKey(
-                db,
-                threadId: threadId,
-                threadVariant: threadVariant
-            )
-            
-            return (
-                targetInteractionId,
-                currentUserIsClosedGroupMember,
-                openGroupPermissions,
-                blindedKey
-            )
-        }
+        // If we have a specified 'focusedInteractionId' then use that, otherwise use the oldest unread interaction and
+        // start focused around that one
+        let targetInteractionId: Int64? = (focusedInteractionId ?? openContext?.firstUnreadInteractionId)
         
         self.threadId = threadId
         self.initialThreadVariant = threadVariant
-        self.focusedInteractionId = initialData?.targetInteractionId
+        self.focusedInteractionId = targetInteractionId
         self.threadData = SessionThreadViewModel(
             threadId: threadId,
             threadVariant: threadVariant,
-            currentUserIsClosedGroupMember: initialData?.currentUserIsClosedGroupMember,
-            openGroupPermissions: initialData?.openGroupPermissions
-        ).populatingCurrentUserBlindedKey(currentUserBlindedPublicKeyForThisThread: initialData?.blindedKey)
+            currentUserIsClosedGroupMember: openContext?.currentUserIsClosedGroupMember,
+            openGroupPermissions: openContext?.openGroupPermissions
+        ).populatingCurrentUserBlindedKey(currentUserBlindedPublicKeyForThisThread: openContext?.currentUserBlindedPublicKey)
         self.pagedDataObserver = nil
         
         // Note: Since this references self we need to finish initializing before setting it, we
@@ -120,18 +84,42 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
         // distinct stutter)
         self.pagedDataObserver = self.setupPagedObserver(
             for: threadId,
-            userPublicKey: getUserHexEncodedPublicKey(),
-            blindedPublicKey: SessionThread.getUserHexEncodedBlindedKey(
-                threadId: threadId,
-                threadVariant: threadVariant
-            )
+            userPublicKey: getUserHexEncodedPublicKey()
         )
         
+        // If the first page was prewarmed then we can provide it to the UI immediately (the initial query below will
+        // still run and replace it if anything has changed)
+        if let initialPage: ConversationOpenContextCache.InitialPage = openContext?.initialPage {
+            let initialData: [SectionModel] = self.process(data: initialPage.data, for: initialPage.pageInfo)
+            
+            self.unobservedInteractionDataChanges = (
+                initialData,
+                StagedChangeset(source: [], target: initialData)
+            )
+        }
+        
         // Run the initial query on a background thread so we don't block the push transition
         DispatchQueue.global(qos: .userInitiated).async { [weak self] in
+            // If the context wasn't cached then we need to load it in order to focus on the oldest unread interaction
+            let initialFocusedId: Int64? = {
+                guard openContext == nil && focusedInteractionId == nil else { return targetInteractionId }
+                
+                return ConversationOpenContextCache.shared
+                    .loadContext(for: threadId, threadVariant: threadVariant)?
+                    .firstUnreadInteractionId
+            }()
+            
+            // The 'focusedInteractionId' is read on the main thread so it needs to be updated there (this is
+            // queued before the data is loaded so it'll be set before the initial scroll)
+            if initialFocusedId != targetInteractionId {
+                DispatchQueue.main.async {
+                    self?.focusedInteractionId = initialFocusedId
+                }
+            }
+            
             // If we don't have a `initialFocusedId` then default to `.pageBefore` (it'll query
             // from a `0` offset)
-            guard let initialFocusedId: Int64 = initialData?.targetInteractionId else {
+            guard let initialFocusedId: Int64 = initialFocusedId else {
                 self?.pagedDataObserver?.load(.pageBefore)
                 return
             }
@@ -148,6 +136,10 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
     /// This is all the data the screen needs to populate itself, please see the following link for tips to help optimise
     /// performance https://github.com/groue/GRDB.swift#valueobservation-performance
     ///
+    /// **Note:** The header data is split into separate observations (the thread info, the `Interaction` derived values and the
+    /// recent reaction emoji) which each track only the columns they select, this means that an incoming message only results
+    /// in the cheap `Interaction` aggregate being re-run rather than the entire `conversationQuery`
+    ///
     /// **Note:** The 'trackingConstantRegion' is optimised in such a way that the request needs to be static
     /// otherwise there may be situations where it doesn't get updates, this means we can't have conditional queries
     ///
@@ -155,29 +147,65 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
     /// this is due to the behaviour of `ValueConcurrentObserver.asyncStartObservation` which triggers it's own
     /// fetch (after the ones in `ValueConcurrentObserver.asyncStart`/`ValueConcurrentObserver.syncStart`)
     /// just in case the database has changed between the two reads - unfortunately it doesn't look like there is a way to prevent this
-    public lazy var observableThreadData: ValueObservation<ValueReducers.RemoveDuplicates<ValueReducers.Fetch<SessionThreadViewModel?>>> = setupObservableThreadData(for: self.threadId)
-    
-    private func setupObservableThreadData(for threadId: String) -> ValueObservation<ValueReducers.RemoveDuplicates<ValueReducers.Fetch<SessionThreadViewModel?>>> {
-        return ValueObservation
-            .trackingConstantRegion { [weak self] db -> SessionThreadViewModel? in
-                let userPublicKey: String = getUserHexEncodedPublicKey(db)
-                let recentReactionEmoji: [String] = try Emoji.getRecent(db, withDefaultEmoji: true)
-                let threadViewModel: SessionThreadViewModel? = try SessionThreadViewModel
+    public lazy var observableThreadData: AnyPublisher<SessionThreadViewModel?, Error> = setupObservableThreadData(for: self.threadId)
+    
+    private func setupObservableThreadData(for threadId: String) -> AnyPublisher<SessionThreadViewModel?, Error> {
+        let userPublicKey: String = getUserHexEncodedPublicKey()
+        let threadVariant: SessionThread.Variant = self.initialThreadVariant
+        let observableThreadInfo = ValueObservation
+            .trackingConstantRegion { db -> SessionThreadViewModel? in
+                try SessionThreadViewModel
                     .conversationQuery(threadId: threadId, userPublicKey: userPublicKey)
                     .fetchOne(db)
+            }
+            .removeDuplicates()
+        let observableInteractionState = ValueObservation
+            .trackingConstantRegion { db -> SessionThreadViewModel.InteractionState? in
+                try SessionThreadViewModel
+                    .conversationInteractionStateQuery(threadId: threadId)
+                    .fetchOne(db)
+            }
+            .removeDuplicates()
+        let observableRecentReactionEmoji = ValueObservation
+            .trackingConstantRegion { db -> [String] in try Emoji.getRecent(db, withDefaultEmoji: true) }
+            .removeDuplicates()
+        
+        // Note: The blinded key will generally have been retrieved when opening the conversation but it won't be
+        // if the open context wasn't cached or the capabilities for the open group haven't been retrieved yet, so
+        // derive it whenever the capabilities change (the derivation itself is cached by 'SessionThread')
+        let observableBlindedKey = ValueObservation
+            .tracking(region: Capability.all()) { db -> String? in
+                guard threadVariant == .openGroup else { return nil }
                 
-                return threadViewModel
-                    .map { $0.with(recentReactionEmoji: recentReactionEmoji) }
+                return SessionThread.getUserHexEncodedBlindedKey(
+                    db,
+                    threadId: threadId,
+                    threadVariant: threadVariant
+                )
+            }
+            .removeDuplicates()
+        
+        return observableThreadInfo.publisher(in: Storage.shared)
+            .combineLatest(
+                observableInteractionState.publisher(in: Storage.shared),
+                observableRecentReactionEmoji.publisher(in: Storage.shared),
+                observableBlindedKey.publisher(in: Storage.shared)
+            )
+            .map { threadViewModel, interactionState, recentReactionEmoji, blindedKey -> SessionThreadViewModel? in
+                threadViewModel
+                    .map { $0.with(interactionState: interactionState, recentReactionEmoji: recentReactionEmoji) }
                     .map { viewModel -> SessionThreadViewModel in
-                        viewModel.populatingCurrentUserBlindedKey(
-                            db,
-                            currentUserBlindedPublicKeyForThisThread: self?.threadData.currentUserBlindedPublicKey
+                        guard let blindedKey: String = blindedKey else { return viewModel }
+                        
+                        return viewModel.populatingCurrentUserBlindedKey(
+                            currentUserBlindedPublicKeyForThisThread: blindedKey
                         )
                     }
             }
             .removeDuplicates()
+            .eraseToAnyPublisher()
     }
-
+    
     public func updateThreadData(_ updatedData: SessionThreadViewModel) {
         self.threadData = updatedData
     }
@@ -190,6 +218,10 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
     public private(set) var reactionExpandedInteractionIds: Set<Int64> = []
     public private(set) var pagedDataObserver: PagedDatabaseObserver<Interaction, MessageViewModel>?
     
+    /// The layouts of the message cells are calculated as part of processing the data so they are available before the table
+    /// gets updated
+    let cellLayoutCache: MessageCellLayoutCache = MessageCellLayoutCache()
+    
     public var onInteractionChange: (([SectionModel], StagedChangeset<[SectionModel]>) -> ())? {
         didSet {
             // When starting to observe interaction changes we want to trigger a UI update just in case the
@@ -201,7 +233,30 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
         }
     }
     
-    private func setupPagedObserver(for threadId: String, userPublicKey: String, blindedPublicKey: String?) -> PagedDatabaseObserver<Interaction, MessageViewModel> {
+    private func setupPagedObserver(for threadId: String, userPublicKey: String) -> PagedDatabaseObserver<Interaction, MessageViewModel> {
+        return ConversationViewModel.pagedObserver(
+            for: threadId,
+            userPublicKey: userPublicKey,
+            onChangeUnsorted: { [weak self] updatedData, updatedPageInfo in
+                PagedData.processAndTriggerUpdates(
+                    updatedData: self?.process(data: updatedData, for: updatedPageInfo),
+                    currentDataRetriever: { self?.interactionData },
+                    onDataChange: self?.onInteractionChange,
+                    onUnobservedDataChange: { updatedData, changeset in
+                        self?.unobservedInteractionDataChanges = (updatedData, changeset)
+                    }
+                )
+            }
+        )
+    }
+    
+    /// This function creates the observer for the messages in a conversation, it's static so that the exact same observer
+    /// configuration can be used to prewarm the first page of messages (see `ConversationOpenContextCache`)
+    static func pagedObserver(
+        for threadId: String,
+        userPublicKey: String,
+        onChangeUnsorted: @escaping ([MessageViewModel], PagedData.PageInfo) -> ()
+    ) -> PagedDatabaseObserver<Interaction, MessageViewModel> {
         return PagedDatabaseObserver(
             pagedTable: Interaction.self,
             pageSize: ConversationViewModel.pageSize,
@@ -243,13 +298,22 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
                         return SQL("LEFT JOIN \(RecipientState.self) ON \(recipientState[.interactionId]) = \(interaction[.id])")
                     }()
                 ),
+                PagedData.ObservedChanges(
+                    table: Quote.self,
+                    columns: [.originalInteractionId],
+                    joinToPagedType: {
+                        let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
+                        let quote: TypedTableAlias<Quote> = TypedTableAlias()
+                        
+                        return SQL("LEFT JOIN \(Quote.self) ON \(quote[.interactionId]) = \(interaction[.id])")
+                    }()
+                ),
             ],
             filterSQL: MessageViewModel.filterSQL(threadId: threadId),
             groupSQL: MessageViewModel.groupSQL,
             orderSQL: MessageViewModel.orderSQL,
             dataQuery: MessageViewModel.baseQuery(
                 userPublicKey: userPublicKey,
-                blindedPublicKey: blindedPublicKey,
                 orderSQL: MessageViewModel.orderSQL,
                 groupSQL: MessageViewModel.groupSQL
             ),
@@ -266,6 +330,30 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
                     joinToPagedType: MessageViewModel.AttachmentInteractionInfo.joinToViewModelQuerySQL,
                     associateData: MessageViewModel.AttachmentInteractionInfo.createAssociateDataClosure()
                 ),
+                AssociatedRecord<MessageViewModel.QuoteAttachmentInfo, MessageViewModel>(
+                    trackedAgainst: Quote.self,
+                    observedChanges: [
+                        PagedData.ObservedChanges(
+                            table: Quote.self,
+                            columns: [.originalInteractionId]
+                        ),
+                        PagedData.ObservedChanges(
+                            table: InteractionAttachment.self,
+                            events: [.insert],
+                            columns: [],
+                            joinToPagedType: MessageViewModel.QuoteAttachmentInfo.joinInteractionAttachmentToViewModelQuerySQL
+                        ),
+                        PagedData.ObservedChanges(
+                            table: Attachment.self,
+                            columns: [.state, .localRelativeFilePath],
+                            joinToPagedType: MessageViewModel.QuoteAttachmentInfo.joinAttachmentToViewModelQuerySQL
+                        )
+                    ],
+                    dataQuery: MessageViewModel.QuoteAttachmentInfo.baseQuery,
+                    joinToPagedType: MessageViewModel.QuoteAttachmentInfo.joinToViewModelQuerySQL,
+                    removesUnmatchedRows: true,
+                    associateData: MessageViewModel.QuoteAttachmentInfo.createAssociateDataClosure()
+                ),
                 AssociatedRecord<MessageViewModel.ReactionInfo, MessageViewModel>(
                     trackedAgainst: Reaction.self,
                     observedChanges: [
@@ -292,16 +380,7 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
                     associateData: MessageViewModel.TypingIndicatorInfo.createAssociateDataClosure()
                 )
             ],
-            onChangeUnsorted: { [weak self] updatedData, updatedPageInfo in
-                PagedData.processAndTriggerUpdates(
-                    updatedData: self?.process(data: updatedData, for: updatedPageInfo),
-                    currentDataRetriever: { self?.interactionData },
-                    onDataChange: self?.onInteractionChange,
-                    onUnobservedDataChange: { updatedData, changeset in
-                        self?.unobservedInteractionDataChanges = (updatedData, changeset)
-                    }
-                )
-            }
+            onChangeUnsorted: onChangeUnsorted
         )
     }
     
@@ -313,7 +392,7 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
         
         // We load messages from newest to oldest so having a pageOffset larger than zero means
         // there are newer pages to load
-        return [
+        let result: [SectionModel] = [
             (!data.isEmpty && (pageInfo.pageOffset + pageInfo.currentCount) < pageInfo.totalCount ?
                 [SectionModel(section: .loadOlder)] :
                 []
@@ -368,6 +447,13 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
                 []
             )
         ].flatMap { $0 }
+        
+        cellLayoutCache.prepareLayouts(
+            for: (result.first(where: { $0.model == .messages })?.elements ?? []),
+            expandedReactionInteractionIds: reactionExpandedInteractionIds
+        )
+        
+        return result
     }
     
     public func updateInteractionData(_ updatedData: [SectionModel]) {
@@ -488,8 +574,7 @@ public class ConversationViewModel: OWSAudioPlayerDelegate {
         self.observableThreadData = self.setupObservableThreadData(for: updatedThreadId)
         self.pagedDataObserver = self.setupPagedObserver(
             for: updatedThreadId,
-            userPublicKey: getUserHexEncodedPublicKey(),
-            blindedPublicKey: nil
+            userPublicKey: getUserHexEncodedPublicKey()
         )
         
         // Try load everything up to the initial visible message, fallback to just the initial page of messages
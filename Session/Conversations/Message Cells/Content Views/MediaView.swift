@@ -3,6 +3,7 @@
 import UIKit
 import YYImage
 import SessionUIKit
+import SessionUtilitiesKit
 import SessionMessagingKit
 
 public class MediaView: UIView {
@@ -21,6 +22,8 @@ public class MediaView: UIView {
     private let isOutgoing: Bool
     private var loadBlock: (() -> Void)?
     private var unloadBlock: (() -> Void)?
+    private var blurHashImageView: UIImageView?
+    private weak var viewHiddenByBlurHashPreview: UIView?
 
     // MARK: - LoadState
 
@@ -118,6 +121,8 @@ public class MediaView: UIView {
         }
         
         themeBackgroundColor = .backgroundSecondary
+        addBlurHashPreviewIfPossible()
+        
         let loader = MediaLoaderView()
         addSubview(loader)
         loader.pin([ UIView.HorizontalEdge.left, UIView.VerticalEdge.bottom, UIView.HorizontalEdge.right ], to: self)
@@ -209,6 +214,13 @@ public class MediaView: UIView {
         stillImageView.layer.magnificationFilter = .trilinear
         stillImageView.themeBackgroundColor = .backgroundSecondary
         stillImageView.isHidden = !attachment.isValid
+        
+        // If the image needs to be loaded then show the preview until it's ready
+        if addBlurHashPreviewIfPossible() {
+            stillImageView.alpha = 0
+            viewHiddenByBlurHashPreview = stillImageView
+        }
+        
         addSubview(stillImageView)
         stillImageView.autoPinEdgesToSuperviewEdges()
         _ = addUploadProgressIfNecessary(stillImageView)
@@ -246,6 +258,7 @@ public class MediaView: UIView {
                     }
                     
                     stillImageView.image = image
+                    self?.crossFadeFromBlurHashPreview(to: stillImageView)
                 },
                 cacheKey: attachment.id
             )
@@ -268,6 +281,12 @@ public class MediaView: UIView {
         stillImageView.layer.magnificationFilter = .trilinear
         stillImageView.themeBackgroundColor = .backgroundSecondary
         stillImageView.isHidden = !attachment.isValid
+        
+        // If the thumbnail needs to be loaded then show the preview until it's ready
+        if addBlurHashPreviewIfPossible() {
+            stillImageView.alpha = 0
+            viewHiddenByBlurHashPreview = stillImageView
+        }
 
         addSubview(stillImageView)
         stillImageView.autoPinEdgesToSuperviewEdges()
@@ -314,6 +333,7 @@ public class MediaView: UIView {
                     }
                     
                     stillImageView.image = image
+                    self?.crossFadeFromBlurHashPreview(to: stillImageView)
                 },
                 cacheKey: attachment.id
             )
@@ -325,6 +345,76 @@ public class MediaView: UIView {
         }
     }
 
+    // MARK: - BlurHash
+
+    // Adds the sender-generated preview (if there is one) for attachments whose content isn't in the
+    // media cache, returns whether a preview was added
+    //
+    // Note: The preview is decoded at a tiny size (the image view scales it up) off the main thread and
+    // cached so reloading the cell doesn't need to decode it again
+    @discardableResult private func addBlurHashPreviewIfPossible() -> Bool {
+        guard
+            let blurHash: String = attachment.blurHash,
+            mediaCache?.object(forKey: attachment.id as NSString) == nil
+        else { return false }
+        
+        let blurHashImageView: UIImageView = UIImageView()
+        blurHashImageView.contentMode = MediaView.contentMode
+        addSubview(blurHashImageView)
+        blurHashImageView.autoPinEdgesToSuperviewEdges()
+        self.blurHashImageView = blurHashImageView
+        
+        let cacheKey: NSString = "\(attachment.id)-blurHash" as NSString
+        
+        if let image: UIImage = mediaCache?.object(forKey: cacheKey) as? UIImage {
+            blurHashImageView.image = image
+            return true
+        }
+        
+        let decodeSize: CGSize = BlurHash.decodeSize(
+            for: attachment.width
+                .map { width in CGSize(width: Int(width), height: Int(attachment.height ?? width)) }
+        )
+        
+        MediaView.blurHashQueue.async { [weak self, weak blurHashImageView] in
+            guard let image: UIImage = BlurHash.decode(blurHash, size: decodeSize) else { return }
+            
+            self?.mediaCache?.setObject(image, forKey: cacheKey)
+            
+            DispatchQueue.main.async {
+                blurHashImageView?.image = image
+            }
+        }
+        
+        return true
+    }
+    
+    private func crossFadeFromBlurHashPreview(to imageView: UIImageView) {
+        guard let blurHashImageView: UIImageView = blurHashImageView else { return }
+        
+        self.blurHashImageView = nil
+        self.viewHiddenByBlurHashPreview = nil
+        
+        UIView.animate(
+            withDuration: 0.2,
+            animations: { imageView.alpha = 1 },
+            completion: { _ in blurHashImageView.removeFromSuperview() }
+        )
+    }
+
+    // If the media fails to load then the view hidden behind the preview needs to be shown again (otherwise it
+    // would remain invisible)
+    private func removeBlurHashPreviewAfterFailure() {
+        viewHiddenByBlurHashPreview?.alpha = 1
+        viewHiddenByBlurHashPreview = nil
+        blurHashImageView?.removeFromSuperview()
+        blurHashImageView = nil
+    }
+    
+    private static let blurHashQueue = DispatchQueue(label: "MediaView.blurHashQueue", qos: .userInitiated)
+
+    // MARK: - Errors
+
     private func configure(forError error: MediaError) {
         // When there is a failure in the 'loadMediaBlock' closure this can be called
         // on a background thread - rather than dispatching in every 'loadMediaBlock'
@@ -356,6 +446,7 @@ public class MediaView: UIView {
             case .missing: return
         }
         
+        removeBlurHashPreviewAfterFailure()
         themeBackgroundColor = .backgroundSecondary
         
         // For failed ougoing messages add an overlay to make the icon more visible
@@ -387,6 +478,7 @@ public class MediaView: UIView {
             }
             guard let media: AnyObject = possibleMedia else {
                 self?.loadState.mutate { $0 = .failed }
+                self?.removeBlurHashPreviewAfterFailure()
                 // TODO:
                 //            [self showAttachmentErrorViewWithMediaView:mediaView];
                 return
@@ -0,0 +1,341 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import UIKit
+import SessionUIKit
+import SessionUtilitiesKit
+import SessionMessagingKit
+
+/// The `MessageCellLayoutCache` stores the heights of the message cells in a conversation so the `ConversationVC` doesn't need
+/// to run Auto Layout on the main thread for every cell which scrolls into view or gets reloaded after an observer change
+///
+/// Entries are keyed by the interaction id, a hash of the content which affects the layout of the cell and the width of the table; when
+/// new data is received the layout of any new or changed messages is estimated on a background thread (the body text is measured
+/// with TextKit and the remaining content uses the same sizing logic as `VisibleMessageCell`) and once a cell has been displayed
+/// it's actual height replaces the estimate
+///
+/// **Note:** A measured height is used as the actual height of the cell (so Auto Layout doesn't need to size it again) as long as the
+/// cell still has the content it was measured with, otherwise the height is only used as an estimate; the content hash is never
+/// calculated on the main thread (the content is validated by comparing the `MessageViewModel` which is cheap when it's unchanged
+/// as the values share their storage) and entries are only replaced when their content hash or width changes so unchanged messages
+/// keep their measured height across reloads
+final class MessageCellLayoutCache {
+    struct Key: Equatable {
+        let interactionId: Int64
+        let contentHash: Int
+        let width: CGFloat
+    }
+    
+    struct Layout {
+        let key: Key
+        let cellViewModel: MessageViewModel
+        let showExpandedReactions: Bool
+        let estimatedHeight: CGFloat
+        let measuredHeight: CGFloat?
+        
+        var height: CGFloat { (measuredHeight ?? estimatedHeight) }
+    }
+    
+    private static let bubbleInset: CGFloat = 12
+    private static let quoteHeight: CGFloat = 64
+    private static let linkPreviewHeight: CGFloat = 160
+    private static let openGroupInvitationHeight: CGFloat = 88
+    private static let voiceMessageHeight: CGFloat = 56
+    private static let documentHeight: CGFloat = 64
+    private static let reactionRowHeight: CGFloat = 32
+    private static let underBubbleHeight: CGFloat = 20
+    
+    private let queue: DispatchQueue = DispatchQueue(label: "MessageCellLayoutCache.queue", qos: .userInitiated)
+    private let layouts: Atomic<[Int64: Layout]> = Atomic([:])
+    private let widths: Atomic<(table: CGFloat, content: CGFloat)> = Atomic((0, 0))
+    
+    // MARK: - Configuration
+    
+    /// Update the width the layouts should be calculated for, this needs to be called on the main thread whenever the size of the
+    /// table changes
+    ///
+    /// **Note:** Changing the width removes all of the existing layouts (as none of them will be valid anymore)
+    func update(tableWidth: CGFloat) {
+        let didChangeWidth: Bool = widths.mutate { widths in
+            let didChangeWidth: Bool = (widths.table != tableWidth)
+            widths = (tableWidth, VisibleMessageCell.maxContentWidth)
+            
+            return didChangeWidth
+        }
+        
+        guard didChangeWidth else { return }
+        
+        removeAll()
+    }
+    
+    // MARK: - Lookup
+    
+    /// The best known height for a cell, this will be the measured height if the cell has been displayed or the height estimated on a
+    /// background thread otherwise
+    ///
+    /// **Note:** This is only an estimate for the cell, the layout for the current content may still be getting calculated so
+    /// `height(for:showExpandedReactions:)` should be used for the actual height
+    func estimatedHeight(for interactionId: Int64) -> CGFloat? {
+        return layout(for: interactionId)?.height
+    }
+    
+    /// The height a cell was measured with when it was last displayed with the same content at the current width
+    ///
+    /// **Note:** When this returns `nil` the cell should be sized using Auto Layout
+    func height(for cellViewModel: MessageViewModel, showExpandedReactions: Bool) -> CGFloat? {
+        guard
+            let layout: Layout = layout(for: cellViewModel.id),
+            layout.showExpandedReactions == showExpandedReactions,
+            layout.cellViewModel == cellViewModel
+        else { return nil }
+        
+        return layout.measuredHeight
+    }
+    
+    private func layout(for interactionId: Int64) -> Layout? {
+        guard
+            let layout: Layout = layouts.wrappedValue[interactionId],
+            layout.key.width == widths.wrappedValue.table
+        else { return nil }
+        
+        return layout
+    }
+    
+    // MARK: - Updating
+    
+    /// Store the height a cell was actually displayed with
+    ///
+    /// **Note:** The height is only stored if the most recently prepared layout is for the content the cell was displayed with (if the
+    /// content has since changed then the height will be measured again when the updated cell is displayed)
+    func store(measuredHeight: CGFloat, for cellViewModel: MessageViewModel, showExpandedReactions: Bool) {
+        guard measuredHeight > 0 else { return }
+        
+        let tableWidth: CGFloat = widths.wrappedValue.table
+        
+        layouts.mutate { layouts in
+            guard
+                let layout: Layout = layouts[cellViewModel.id],
+                layout.key.width == tableWidth,
+                layout.showExpandedReactions == showExpandedReactions,
+                layout.cellViewModel == cellViewModel
+            else { return }
+            
+            layouts[cellViewModel.id] = Layout(
+                key: layout.key,
+                cellViewModel: layout.cellViewModel,
+                showExpandedReactions: layout.showExpandedReactions,
+                estimatedHeight: layout.estimatedHeight,
+                measuredHeight: measuredHeight
+            )
+        }
+    }
+    
+    /// Calculate the layouts for any messages which aren't in the cache (or whose content has changed) and remove entries for
+    /// messages which are no longer in the data
+    ///
+    /// **Note:** When called on the main thread the calculation will be dispatched to a background queue
+    func prepareLayouts(for cellViewModels: [MessageViewModel], expandedReactionInteractionIds: Set<Int64>) {
+        guard !Thread.isMainThread else {
+            queue.async { [weak self] in
+                self?.prepareLayouts(
+                    for: cellViewModels,
+                    expandedReactionInteractionIds: expandedReactionInteractionIds
+                )
+            }
+            return
+        }
+        
+        let widths: (table: CGFloat, content: CGFloat) = self.widths.wrappedValue
+        
+        guard widths.table > 0 else { return }
+        
+        let currentLayouts: [Int64: Layout] = layouts.wrappedValue
+        let updatedLayouts: [Int64: Layout] = cellViewModels
+            .filter { MessageCellLayoutCache.isCacheable($0) }
+            .reduce(into: [:]) { result, cellViewModel in
+                let key: Key = Key(
+                    interactionId: cellViewModel.id,
+                    contentHash: MessageCellLayoutCache.contentHash(
+                        for: cellViewModel,
+                        showExpandedReactions: expandedReactionInteractionIds.contains(cellViewModel.id)
+                    ),
+                    width: widths.table
+                )
+                
+                // Only calculate layouts for new or changed content (the view model is still replaced as values which don't
+                // affect the layout may have changed and the main thread validates against it)
+                if let existingLayout: Layout = currentLayouts[cellViewModel.id], existingLayout.key == key {
+                    result[cellViewModel.id] = Layout(
+                        key: key,
+                        cellViewModel: cellViewModel,
+                        showExpandedReactions: existingLayout.showExpandedReactions,
+                        estimatedHeight: existingLayout.estimatedHeight,
+                        measuredHeight: existingLayout.measuredHeight
+                    )
+                    return
+                }
+                
+                result[cellViewModel.id] = Layout(
+                    key: key,
+                    cellViewModel: cellViewModel,
+                    showExpandedReactions: expandedReactionInteractionIds.contains(cellViewModel.id),
+                    estimatedHeight: MessageCellLayoutCache.estimateHeight(
+                        for: cellViewModel,
+                        contentWidth: widths.content,
+                        showExpandedReactions: expandedReactionInteractionIds.contains(cellViewModel.id)
+                    ),
+                    measuredHeight: nil
+                )
+            }
+        
+        layouts.mutate { layouts in
+            // A cell may have been displayed while we were calculating so don't replace any measured heights
+            layouts = updatedLayouts.reduce(into: [:]) { result, next in
+                guard let currentLayout: Layout = layouts[next.key], currentLayout.key == next.value.key else {
+                    result[next.key] = next.value
+                    return
+                }
+                
+                result[next.key] = Layout(
+                    key: next.value.key,
+                    cellViewModel: next.value.cellViewModel,
+                    showExpandedReactions: next.value.showExpandedReactions,
+                    estimatedHeight: next.value.estimatedHeight,
+                    measuredHeight: (currentLayout.measuredHeight ?? next.value.measuredHeight)
+                )
+            }
+        }
+    }
+    
+    func removeAll() {
+        layouts.mutate { $0 = [:] }
+    }
+    
+    // MARK: - Internal Functions
+    
+    private static func isCacheable(_ cellViewModel: MessageViewModel) -> Bool {
+        switch cellViewModel.cellType {
+            case .textOnlyMessage, .mediaMessage, .audio, .genericAttachment: return true
+            case .typingIndicator, .dateHeader: return false
+        }
+    }
+    
+    /// A hash of the values which affect the layout of a `VisibleMessageCell`
+    private static func contentHash(for cellViewModel: MessageViewModel, showExpandedReactions: Bool) -> Int {
+        var hasher: Hasher = Hasher()
+        hasher.combine(cellViewModel.cellType)
+        hasher.combine(cellViewModel.variant)
+        hasher.combine(cellViewModel.threadIsTrusted)
+        hasher.combine(cellViewModel.body)
+        hasher.combine(cellViewModel.quote)
+        hasher.combine(cellViewModel.quoteAttachment)
+        hasher.combine(cellViewModel.linkPreview)
+        hasher.combine(cellViewModel.linkPreviewAttachment)
+        hasher.combine(cellViewModel.attachments)
+        hasher.combine(cellViewModel.reactionInfo)
+        hasher.combine(showExpandedReactions)
+        hasher.combine(cellViewModel.senderName)
+        hasher.combine(cellViewModel.shouldShowProfile)
+        hasher.combine(cellViewModel.shouldShowDateHeader)
+        hasher.combine(cellViewModel.previousVariant)
+        hasher.combine(cellViewModel.positionInCluster)
+        hasher.combine(cellViewModel.isOnlyMessageInCluster)
+        hasher.combine(cellViewModel.isLast)
+        hasher.combine(cellViewModel.isLastOutgoing)
+        hasher.combine(cellViewModel.state)
+        hasher.combine(cellViewModel.mostRecentFailureText)
+        hasher.combine(cellViewModel.expiresInSeconds)
+        
+        return hasher.finalize()
+    }
+    
+    private static func estimateHeight(
+        for cellViewModel: MessageViewModel,
+        contentWidth: CGFloat,
+        showExpandedReactions: Bool
+    ) -> CGFloat {
+        let maxMessageWidth: CGFloat = VisibleMessageCell.getMaxWidth(for: cellViewModel, contentWidth: contentWidth)
+        let maxTextWidth: CGFloat = (maxMessageWidth - (2 * bubbleInset))
+        let bodyHeight: CGFloat = {
+            guard let body: String = cellViewModel.body, !body.isEmpty else { return 0 }
+            
+            return ceil(
+                NSAttributedString(
+                    string: body,
+                    attributes: [.font: UIFont.systemFont(ofSize: VisibleMessageCell.getFontSize(for: cellViewModel))]
+                )
+                .boundingRect(
+                    with: CGSize(width: maxTextWidth, height: .greatestFiniteMagnitude),
+                    options: [.usesLineFragmentOrigin, .usesFontLeading],
+                    context: nil
+                )
+                .height
+            )
+        }()
+        let contentHeight: CGFloat = {
+            // Deleted messages and untrusted media are displayed as a single line of text
+            guard
+                cellViewModel.variant != .standardIncomingDeleted && (
+                    cellViewModel.cellType == .textOnlyMessage ||
+                    cellViewModel.variant != .standardIncoming ||
+                    cellViewModel.threadIsTrusted
+                )
+            else { return (Values.mediumFontSize + (2 * bubbleInset)) }
+            
+            switch cellViewModel.cellType {
+                case .typingIndicator, .dateHeader: return 0
+                
+                case .textOnlyMessage:
+                    switch cellViewModel.linkPreview?.variant {
+                        case .standard: return (linkPreviewHeight + bodyHeight + (2 * bubbleInset))
+                        case .openGroupInvitation: return openGroupInvitationHeight
+                        case .none:
+                            return (
+                                bodyHeight +
+                                (2 * bubbleInset) +
+                                (cellViewModel.quote != nil ? (quoteHeight + 2) : 0)
+                            )
+                    }
+                
+                case .mediaMessage:
+                    return (
+                        VisibleMessageCell.getSize(for: cellViewModel, maxMessageWidth: maxMessageWidth).height +
+                        (bodyHeight > 0 ? (bodyHeight + (2 * bubbleInset)) : 0)
+                    )
+                
+                case .audio: return voiceMessageHeight
+                case .genericAttachment:
+                    return (documentHeight + (bodyHeight > 0 ? (bodyHeight + Values.smallSpacing + bubbleInset) : 0))
+            }
+        }()
+        let authorHeight: CGFloat = (cellViewModel.senderName != nil ?
+            (ceil(UIFont.boldSystemFont(ofSize: Values.smallFontSize).lineHeight) + Values.verySmallSpacing) :
+            0
+        )
+        let topInset: CGFloat = (
+            !cellViewModel.shouldShowDateHeader &&
+            cellViewModel.previousVariant?.isInfoMessage != true && (
+                cellViewModel.positionInCluster == .top ||
+                cellViewModel.isOnlyMessageInCluster
+            ) ? Values.mediumSpacing : 0
+        )
+        let reactionCount: Int = Set((cellViewModel.reactionInfo ?? []).map { $0.reaction.emoji }).count
+        let reactionsHeight: CGFloat = {
+            guard reactionCount > 0 else { return 0 }
+            
+            // Collapsed reactions are limited to a single row
+            let reactionsPerRow: Int = max(1, Int(maxMessageWidth / (reactionRowHeight * 2)))
+            let numRows: Int = (showExpandedReactions ?
+                Int(ceil(Double(reactionCount) / Double(reactionsPerRow))) :
+                1
+            )
+            
+            return (CGFloat(numRows) * (reactionRowHeight + Values.verySmallSpacing))
+        }()
+        let underBubbleHeight: CGFloat = (cellViewModel.isLast || cellViewModel.state == .failed ?
+            (underBubbleHeight + Values.verySmallSpacing) :
+            0
+        )
+        
+        return (topInset + authorHeight + contentHeight + reactionsHeight + underBubbleHeight + 1)
+    }
+}
@@ -610,7 +610,7 @@ final class VisibleMessageCell: MessageCell, TappableLabelDelegate {
                     maxMessageWidth: maxMessageWidth
                 )
                 self.albumView = albumView
-                let size = getSize(for: cellViewModel)
+                let size = VisibleMessageCell.getSize(for: cellViewModel, maxMessageWidth: maxMessageWidth)
                 albumView.set(.width, to: size.width)
                 albumView.set(.height, to: size.height)
                 albumView.loadMedia()
@@ -1011,7 +1011,7 @@ final class VisibleMessageCell: MessageCell, TappableLabelDelegate {
         return cornerMask
     }
 
-    private static func getFontSize(for cellViewModel: MessageViewModel) -> CGFloat {
+    static func getFontSize(for cellViewModel: MessageViewModel) -> CGFloat {
         let baselineFontSize = Values.mediumFontSize
         
         guard cellViewModel.containsOnlyEmoji == true else { return baselineFontSize }
@@ -1024,12 +1024,11 @@ final class VisibleMessageCell: MessageCell, TappableLabelDelegate {
         }
     }
 
-    private func getSize(for cellViewModel: MessageViewModel) -> CGSize {
+    static func getSize(for cellViewModel: MessageViewModel, maxMessageWidth: CGFloat) -> CGSize {
         guard let mediaAttachments: [Attachment] = cellViewModel.attachments?.filter({ $0.isVisualMedia }) else {
             preconditionFailure()
         }
         
-        let maxMessageWidth = VisibleMessageCell.getMaxWidth(for: cellViewModel)
         let defaultSize = MediaAlbumView.layoutSize(forMaxMessageWidth: maxMessageWidth, items: mediaAttachments)
         
         guard
@@ -1072,9 +1071,22 @@ final class VisibleMessageCell: MessageCell, TappableLabelDelegate {
         return CGSize(width: width, height: height)
     }
 
-    static func getMaxWidth(for cellViewModel: MessageViewModel, includingOppositeGutter: Bool = true) -> CGFloat {
+    /// The width available for message content, this is based on the screen size so should only be called on the main thread
+    static var maxContentWidth: CGFloat {
         let screen: CGRect = UIScreen.main.bounds
-        let width: CGFloat = UIDevice.current.isIPad ? screen.width * 0.75 : screen.width
+        
+        return (UIDevice.current.isIPad ? screen.width * 0.75 : screen.width)
+    }
+    
+    static func getMaxWidth(for cellViewModel: MessageViewModel, includingOppositeGutter: Bool = true) -> CGFloat {
+        return getMaxWidth(for: cellViewModel, contentWidth: maxContentWidth, includingOppositeGutter: includingOppositeGutter)
+    }
+    
+    static func getMaxWidth(
+        for cellViewModel: MessageViewModel,
+        contentWidth width: CGFloat,
+        includingOppositeGutter: Bool = true
+    ) -> CGFloat {
         let oppositeEdgePadding: CGFloat = (includingOppositeGutter ? gutterSize : contactThreadHSpacing)
         
         switch cellViewModel.variant {
@@ -183,7 +183,8 @@ class GlobalSearchViewController: BaseVC, UITableViewDelegate, UITableViewDataSo
                     let messageResults: [SessionThreadViewModel] = try SessionThreadViewModel
                         .messagesQuery(
                             userPublicKey: userPublicKey,
-                            pattern: try SessionThreadViewModel.pattern(db, searchTerm: searchText)
+                            pattern: try SessionThreadViewModel.pattern(db, searchTerm: searchText),
+                            searchTerm: searchText
                         )
                         .fetchAll(db)
                     
@@ -10,6 +10,7 @@ import SignalUtilitiesKit
 
 final class HomeVC: BaseVC, UITableViewDataSource, UITableViewDelegate, SeedReminderViewDelegate {
     private static let loadingHeaderHeight: CGFloat = 40
+    private static let prefetchRecentAttachmentsDelay: DispatchTimeInterval = .milliseconds(500)
     public static let newConversationButtonSize: CGFloat = 60
     
     private let viewModel: HomeViewModel = HomeViewModel()
@@ -18,6 +19,7 @@ final class HomeVC: BaseVC, UITableViewDataSource, UITableViewDelegate, SeedRemi
     private var hasLoadedInitialThreadData: Bool = false
     private var isLoadingMore: Bool = false
     private var isAutoLoadingNextPage: Bool = false
+    private var isPrefetchingRecentAttachments: Bool = false
     private var viewHasAppeared: Bool = false
     
     // MARK: - Intialization
@@ -299,6 +301,7 @@ final class HomeVC: BaseVC, UITableViewDataSource, UITableViewDelegate, SeedRemi
         
         self.viewHasAppeared = true
         self.autoLoadNextPageIfNeeded()
+        self.prefetchRecentAttachments()
     }
     
     override func viewWillDisappear(_ animated: Bool) {
@@ -408,6 +411,7 @@ final class HomeVC: BaseVC, UITableViewDataSource, UITableViewDelegate, SeedRemi
                 )
                 
                 self?.viewModel.updateThreadData(updatedData)
+                self?.prefetchRecentAttachments()
             }
             return
         }
@@ -426,6 +430,7 @@ final class HomeVC: BaseVC, UITableViewDataSource, UITableViewDelegate, SeedRemi
             // Complete page loading
             self?.isLoadingMore = false
             self?.autoLoadNextPageIfNeeded()
+            self?.prefetchRecentAttachments()
         }
         
         // Reload the table content (animate changes after the first load)
@@ -475,6 +480,28 @@ final class HomeVC: BaseVC, UITableViewDataSource, UITableViewDelegate, SeedRemi
         }
     }
     
+    /// Start downloading the media in the latest messages of the conversations at the top of the list (as these are the
+    /// conversations the user is most likely to open)
+    ///
+    /// **Note:** This is debounced as the thread data can update in quick succession (eg. while receiving messages)
+    private func prefetchRecentAttachments() {
+        guard !self.isPrefetchingRecentAttachments else { return }
+        
+        self.isPrefetchingRecentAttachments = true
+        
+        DispatchQueue.main.asyncAfter(deadline: .now() + HomeVC.prefetchRecentAttachmentsDelay) { [weak self] in
+            self?.isPrefetchingRecentAttachments = false
+            
+            let threadIds: [String] = (self?.viewModel.threadData
+                .first(where: { $0.model == .threads })?
+                .elements
+                .map { $0.threadId })
+                .defaulting(to: [])
+            
+            AttachmentPrefetcher.shared.prefetchRecentAttachments(threadIds: threadIds)
+        }
+    }
+    
     private func updateNavBarButtons() {
         // Profile picture view
         let profilePictureSize = Values.verySmallProfilePictureSize
@@ -297,6 +297,13 @@ public class HomeViewModel {
     
     public func updateThreadData(_ updatedData: [SectionModel]) {
         self.threadData = updatedData
+        
+        // Prewarm the conversations at the top of the list so opening them doesn't need to hit the database
+        ConversationOpenContextCache.shared.prewarm(
+            threads: (updatedData.first(where: { $0.model == .threads })?.elements ?? [])
+                .prefix(ConversationOpenContextCache.numPrewarmedThreads)
+                .map { (threadId: $0.threadId, threadVariant: $0.threadVariant) }
+        )
     }
     
     // MARK: - Functions
@@ -29,6 +29,7 @@ class AppDelegate: UIResponder, UIApplicationDelegate, UNUserNotificationCenterD
     func application(_ application: UIApplication, didFinishLaunchingWithOptions launchOptions: [UIApplication.LaunchOptionsKey: Any]?) -> Bool {
         // These should be the first things we do (the startup process can fail without them)
         SetCurrentAppContext(MainAppContext())
+        LaunchTiming.start("App")
         verifyDBKeysAvailableBeforeBackgroundLaunch()
 
         Cryptography.seedRandom()
@@ -98,7 +98,8 @@ protocol NotificationPresenterAdaptee: AnyObject {
         sound: Preferences.Sound?,
         threadVariant: SessionThread.Variant,
         threadName: String,
-        replacingIdentifier: String?
+        replacingIdentifier: String?,
+        numberOfMessages: Int
     )
 
     func cancelNotifications(threadId: String)
@@ -126,7 +127,33 @@ extension NotificationPresenterAdaptee {
             sound: sound,
             threadVariant: threadVariant,
             threadName: threadName,
-            replacingIdentifier: nil
+            replacingIdentifier: nil,
+            numberOfMessages: 1
+        )
+    }
+    
+    func notify(
+        category: AppNotificationCategory,
+        title: String?,
+        body: String,
+        userInfo: [AnyHashable: Any],
+        previewType: Preferences.NotificationPreviewType,
+        sound: Preferences.Sound?,
+        threadVariant: SessionThread.Variant,
+        threadName: String,
+        replacingIdentifier: String?
+    ) {
+        notify(
+            category: category,
+            title: title,
+            body: body,
+            userInfo: userInfo,
+            previewType: previewType,
+            sound: sound,
+            threadVariant: threadVariant,
+            threadName: threadName,
+            replacingIdentifier: replacingIdentifier,
+            numberOfMessages: 1
         )
     }
 }
@@ -151,122 +178,107 @@ public class NotificationPresenter: NSObject, NotificationsProtocol {
         return adaptee.registerNotificationSettings()
     }
 
-    public func notifyUser(_ db: Database, for interaction: Interaction, in thread: SessionThread) {
-        let isMessageRequest: Bool = thread.isMessageRequest(db, includeNonVisible: true)
-        
-        // Ensure we should be showing a notification for the thread
-        guard thread.shouldShowNotification(db, for: interaction, isMessageRequest: isMessageRequest) else {
-            return
+    public func notifyUser(for batch: NotificationBatch) {
+        struct ThreadNotification {
+            let threadInfo: NotificationBatch.ThreadInfo
+            let identifier: String
+            let title: String?
+            let body: String?
         }
         
-        // Try to group notifications for interactions from open groups
-        let identifier: String = interaction.notificationIdentifier(
-            shouldGroupMessagesForThread: (thread.variant == .openGroup)
-        )
-
-        // While batch processing, some of the necessary changes have not been commited.
-        let rawMessageText = interaction.previewText(db)
-
-        // iOS strips anything that looks like a printf formatting character from
-        // the notification body, so if we want to dispay a literal "%" in a notification
-        // it must be escaped.
-        // see https://developer.apple.com/documentation/uikit/uilocalnotification/1616646-alertbody
-        // for more details.
-        let messageText: String? = String.filterNotificationText(rawMessageText)
-        let notificationTitle: String?
-        var notificationBody: String?
-        
-        let senderName = Profile.displayName(db, id: interaction.authorId, threadVariant: thread.variant)
-        let previewType: Preferences.NotificationPreviewType = db[.preferencesNotificationPreviewType]
-            .defaulting(to: .defaultPreviewType)
-        let groupName: String = SessionThread.displayName(
-            threadId: thread.id,
-            variant: thread.variant,
-            closedGroupName: try? thread.closedGroup
-                .select(.name)
-                .asRequest(of: String.self)
-                .fetchOne(db),
-            openGroupName: try? thread.openGroup
-                .select(.name)
-                .asRequest(of: String.self)
-                .fetchOne(db)
-        )
-        
-        switch previewType {
-            case .noNameNoPreview:
-                notificationTitle = "Session"
-                
-            case .nameNoPreview, .nameAndPreview:
-                switch thread.variant {
-                    case .contact:
-                        notificationTitle = (isMessageRequest ? "Session" : senderName)
-                        
-                    case .closedGroup, .openGroup:
-                        notificationTitle = String(
-                            format: NotificationStrings.incomingGroupMessageTitleFormat,
-                            senderName,
-                            groupName
-                        )
-                }
+        let notifications: [ThreadNotification] = batch.threads.compactMap { threadInfo -> ThreadNotification? in
+            let thread: SessionThread = threadInfo.thread
+            
+            // Try to group notifications for interactions from open groups, when multiple messages were
+            // received for the thread within the batch or when the thread already has a grouped notification
+            let identifier: String = threadInfo.notificationIdentifier
+            
+            // iOS strips anything that looks like a printf formatting character from
+            // the notification body, so if we want to dispay a literal "%" in a notification
+            // it must be escaped.
+            // see https://developer.apple.com/documentation/uikit/uilocalnotification/1616646-alertbody
+            // for more details.
+            let messageText: String? = String.filterNotificationText(threadInfo.previewText)
+            let notificationTitle: String?
+            var notificationBody: String?
+            
+            switch batch.previewType {
+                case .noNameNoPreview:
+                    notificationTitle = "Session"
+                    
+                case .nameNoPreview, .nameAndPreview:
+                    switch thread.variant {
+                        case .contact:
+                            notificationTitle = (threadInfo.isMessageRequest ? "Session" : threadInfo.senderName)
+                            
+                        case .closedGroup, .openGroup:
+                            notificationTitle = String(
+                                format: NotificationStrings.incomingGroupMessageTitleFormat,
+                                threadInfo.senderName,
+                                threadInfo.threadName
+                            )
+                    }
+            }
+            
+            switch batch.previewType {
+                case .noNameNoPreview, .nameNoPreview: notificationBody = NotificationStrings.incomingMessageBody
+                case .nameAndPreview: notificationBody = messageText
+            }
+            
+            // If it's a message request then overwrite the body to be something generic (only show a notification
+            // when receiving a new message request if there aren't any others or the user had hidden them)
+            if threadInfo.isMessageRequest {
+                notificationBody = "MESSAGE_REQUESTS_NOTIFICATION".localized()
+            }
+            
+            guard notificationBody != nil || notificationTitle != nil else {
+                SNLog("AppNotifications error: No notification content")
+                return nil
+            }
+            
+            return ThreadNotification(
+                threadInfo: threadInfo,
+                identifier: identifier,
+                title: notificationTitle,
+                body: notificationBody
+            )
         }
         
-        switch previewType {
-            case .noNameNoPreview, .nameNoPreview: notificationBody = NotificationStrings.incomingMessageBody
-            case .nameAndPreview: notificationBody = messageText
-        }
+        guard !notifications.isEmpty else { return }
         
-        // If it's a message request then overwrite the body to be something generic (only show a notification
-        // when receiving a new message request if there aren't any others or the user had hidden them)
-        if isMessageRequest {
-            notificationBody = "MESSAGE_REQUESTS_NOTIFICATION".localized()
-        }
-
-        guard notificationBody != nil || notificationTitle != nil else {
-            SNLog("AppNotifications error: No notification content")
-            return
-        }
-
         // Don't reply from lockscreen if anyone in this conversation is
         // "no longer verified".
         let category = AppNotificationCategory.incomingMessage
-
-        let userInfo = [
-            AppNotificationUserInfoKey.threadId: thread.id
-        ]
         
-        let userPublicKey: String = getUserHexEncodedPublicKey(db)
-        let userBlindedKey: String? = SessionThread.getUserHexEncodedBlindedKey(
-            db,
-            threadId: thread.id,
-            threadVariant: thread.variant
-        )
-        let fallbackSound: Preferences.Sound = db[.defaultNotificationSound]
-            .defaulting(to: Preferences.Sound.defaultNotificationSound)
-
         DispatchQueue.main.async {
-            let sound: Preferences.Sound? = self.requestSound(
-                thread: thread,
-                fallbackSound: fallbackSound
-            )
-            
-            notificationBody = MentionUtilities.highlightMentionsNoAttributes(
-                in: (notificationBody ?? ""),
-                threadVariant: thread.variant,
-                currentUserPublicKey: userPublicKey,
-                currentUserBlindedPublicKey: userBlindedKey
-            )
-            
-            self.adaptee.notify(
-                category: category,
-                title: notificationTitle,
-                body: (notificationBody ?? ""),
-                userInfo: userInfo,
-                previewType: previewType,
-                sound: sound,
-                threadVariant: thread.variant,
-                threadName: groupName,
-                replacingIdentifier: identifier
-            )
+            notifications.forEach { notification in
+                let thread: SessionThread = notification.threadInfo.thread
+                let sound: Preferences.Sound? = self.requestSound(
+                    thread: thread,
+                    fallbackSound: batch.defaultSound
+                )
+                let notificationBody: String = MentionUtilities.highlightMentionsNoAttributes(
+                    in: (notification.body ?? ""),
+                    threadVariant: thread.variant,
+                    currentUserPublicKey: batch.currentUserPublicKey,
+                    currentUserBlindedPublicKey: notification.threadInfo.currentUserBlindedPublicKey
+                )
+                
+                self.adaptee.notify(
+                    category: category,
+                    title: notification.title,
+                    body: notificationBody,
+                    userInfo: [
+                        AppNotificationUserInfoKey.threadId: thread.id
+                    ],
+                    previewType: batch.previewType,
+                    sound: sound,
+                    threadVariant: thread.variant,
+                    threadName: notification.threadInfo.threadName,
+                    replacingIdentifier: notification.identifier,
+                    numberOfMessages: notification.threadInfo.interactions.count
+                )
+            }
         }
     }
     
@@ -445,6 +457,9 @@ public class NotificationPresenter: NSObject, NotificationsProtocol {
     
     @objc
     public func cancelNotifications(identifiers: [String]) {
+        // The grouped notification identifier for a thread is the thread id
+        NotificationCoalescer.groupedNotificationsRemoved(threadIds: identifiers)
+        
         DispatchQueue.main.async {
             self.adaptee.cancelNotifications(identifiers: identifiers)
         }
@@ -452,11 +467,13 @@ public class NotificationPresenter: NSObject, NotificationsProtocol {
 
     @objc
     public func cancelNotifications(threadId: String) {
+        NotificationCoalescer.groupedNotificationsRemoved(threadIds: [threadId])
         self.adaptee.cancelNotifications(threadId: threadId)
     }
 
     @objc
     public func clearAllNotifications() {
+        NotificationCoalescer.allGroupedNotificationsRemoved()
         adaptee.clearAllNotifications()
     }
 
@@ -98,7 +98,8 @@ extension UserNotificationPresenterAdaptee: NotificationPresenterAdaptee {
         sound: Preferences.Sound?,
         threadVariant: SessionThread.Variant,
         threadName: String,
-        replacingIdentifier: String?
+        replacingIdentifier: String?,
+        numberOfMessages: Int
     ) {
         AssertIsOnMainThread()
 
@@ -108,8 +109,9 @@ extension UserNotificationPresenterAdaptee: NotificationPresenterAdaptee {
         content.userInfo = userInfo
         content.threadIdentifier = (threadIdentifier ?? content.threadIdentifier)
         
+        // Grouped notifications use the thread id as their identifier
         let shouldGroupNotification: Bool = (
-            threadVariant == .openGroup &&
+            threadIdentifier != nil &&
             replacingIdentifier == threadIdentifier
         )
         let isAppActive = UIApplication.shared.applicationState == .active
@@ -130,20 +132,20 @@ extension UserNotificationPresenterAdaptee: NotificationPresenterAdaptee {
             }
             
             if shouldGroupNotification {
-                trigger = UNTimeIntervalNotificationTrigger(
-                    timeInterval: Notifications.delayForGroupedNotifications,
-                    repeats: false
-                )
+                if threadVariant == .openGroup {
+                    trigger = UNTimeIntervalNotificationTrigger(
+                        timeInterval: Notifications.delayForGroupedNotifications,
+                        repeats: false
+                    )
+                }
                 
                 let numberExistingNotifications: Int? = notifications[notificationIdentifier]?
                     .content
                     .userInfo[AppNotificationUserInfoKey.threadNotificationCounter]
                     .asType(Int.self)
-                var numberOfNotifications: Int = (numberExistingNotifications ?? 1)
+                let numberOfNotifications: Int = ((numberExistingNotifications ?? 0) + numberOfMessages)
                 
-                if numberExistingNotifications != nil {
-                    numberOfNotifications += 1  // Add one for the current notification
-                    
+                if numberOfNotifications > 1 {
                     content.title = (previewType == .noNameNoPreview ?
                         content.title :
                         threadName
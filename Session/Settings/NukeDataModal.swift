@@ -229,6 +229,9 @@ final class NukeDataModal: Modal {
         // Remove the cached key so it gets re-cached on next access
         General.cache.mutate { $0.encodedPublicKey = nil }
         
+        // Clear any prewarmed conversation data
+        ConversationOpenContextCache.shared.clearAll()
+        
         // Clear the Snode pool
         SnodeAPI.clearSnodePool()
         
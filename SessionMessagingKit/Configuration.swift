@@ -26,7 +26,10 @@ public enum SNMessagingKit { // Just to make the external API nice
                     _009_OpenGroupPermission.self,
                     _010_AddThreadIdToFTS.self,
                     _011_AddPendingReadReceipts.self,
-                    _012_AddFTSIfNeeded.self
+                    _012_AddFTSIfNeeded.self,
+                    _013_QuoteOriginalInteractionId.self,
+                    _014_AttachmentBlurHash.self,
+                    _015_DeferredSearchIndexing.self
                 ]
             ]
         )
@@ -47,5 +50,6 @@ public enum SNMessagingKit { // Just to make the external API nice
         JobRunner.add(executor: AttachmentDownloadJob.self, for: .attachmentDownload)
         JobRunner.add(executor: AttachmentUploadJob.self, for: .attachmentUpload)
         JobRunner.add(executor: GroupLeavingJob.self, for: .groupLeaving)
+        JobRunner.add(executor: SearchIndexingJob.self, for: .searchIndexing)
     }
 }
@@ -0,0 +1,98 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionUtilitiesKit
+
+/// This migration adds a column to the `Quote` table to store the id of the quoted interaction so the conversation query can join
+/// on the primary key instead of matching on `timestampMs` and `authorId` each time it's run
+enum _013_QuoteOriginalInteractionId: Migration {
+    static let target: TargetMigrations.Identifier = .messagingKit
+    static let identifier: String = "QuoteOriginalInteractionId"
+    static let needsConfigSync: Bool = false
+    static let minExpectedRunDuration: TimeInterval = 0.1
+    
+    static func migrate(_ db: Database) throws {
+        try db.alter(table: Quote.self) { t in
+            t.add(.originalInteractionId, .integer)
+                .references(Interaction.self, onDelete: .setNull)     // Clear if interaction deleted
+        }
+        
+        try db.create(
+            index: "quote_on_originalInteractionId",
+            on: Quote.databaseTableName,
+            columns: [Quote.Columns.originalInteractionId.name]
+        )
+        
+        try db.create(
+            index: "quote_on_timestampMs",
+            on: Quote.databaseTableName,
+            columns: [Quote.Columns.timestampMs.name]
+        )
+        
+        try populateOriginalInteractionIds(db)
+        
+        Storage.update(progress: 1, for: self, in: target) // In case this is the last migration
+    }
+    
+    /// Populate the column for existing quotes
+    internal static func populateOriginalInteractionIds(_ db: Database) throws {
+        let quote: TypedTableAlias<Quote> = TypedTableAlias()
+        let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
+        
+        try db.execute(literal: """
+            UPDATE \(Quote.self)
+            SET \(Quote.Columns.originalInteractionId) = (
+                SELECT \(interaction[.id])
+                FROM \(Interaction.self)
+                WHERE (
+                    \(interaction[.timestampMs]) = \(quote[.timestampMs]) AND
+                    \(interaction[.authorId]) = \(quote[.authorId])
+                )
+                LIMIT 1
+            )
+        """)
+        
+        // A users outgoing message in an open group is stored using their standard id but quotes of it will use their
+        // blinded id for that server, so for each open group link the quotes which use the users blinded id for that
+        // server to the users messages in that thread
+        let userPublicKey: String = getUserHexEncodedPublicKey(db)
+        let openGroupThreadIds: [String] = try OpenGroup
+            .select(.threadId)
+            .asRequest(of: String.self)
+            .fetchAll(db)
+        
+        try openGroupThreadIds.forEach { threadId in
+            guard
+                let blindedPublicKey: String = SessionThread.getUserHexEncodedBlindedKey(
+                    db,
+                    threadId: threadId,
+                    threadVariant: .openGroup
+                )
+            else { return }
+            
+            try db.execute(literal: """
+                UPDATE \(Quote.self)
+                SET \(Quote.Columns.originalInteractionId) = (
+                    SELECT \(interaction[.id])
+                    FROM \(Interaction.self)
+                    WHERE (
+                        \(interaction[.threadId]) = \(threadId) AND
+                        \(interaction[.timestampMs]) = \(quote[.timestampMs]) AND
+                        \(interaction[.authorId]) = \(userPublicKey)
+                    )
+                    LIMIT 1
+                )
+                WHERE (
+                    \(quote[.originalInteractionId]) IS NULL AND
+                    \(quote[.authorId]) = \(blindedPublicKey) AND
+                    \(quote[.interactionId]) IN (
+                        SELECT \(interaction[.id])
+                        FROM \(Interaction.self)
+                        WHERE \(interaction[.threadId]) = \(threadId)
+                    )
+                )
+            """)
+        }
+    }
+}
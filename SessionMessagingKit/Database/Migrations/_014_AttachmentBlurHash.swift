@@ -0,0 +1,21 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionUtilitiesKit
+
+/// This migration adds a column to the `Attachment` table to store the `BlurHash` preview sent with visual media
+enum _014_AttachmentBlurHash: Migration {
+    static let target: TargetMigrations.Identifier = .messagingKit
+    static let identifier: String = "AttachmentBlurHash"
+    static let needsConfigSync: Bool = false
+    static let minExpectedRunDuration: TimeInterval = 0.1
+    
+    static func migrate(_ db: Database) throws {
+        try db.alter(table: Attachment.self) { t in
+            t.add(.blurHash, .text)
+        }
+        
+        Storage.update(progress: 1, for: self, in: target) // In case this is the last migration
+    }
+}
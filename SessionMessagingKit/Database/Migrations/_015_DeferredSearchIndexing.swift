@@ -0,0 +1,24 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionUtilitiesKit
+
+/// This migration adds a table to track interactions which are waiting to be added to the search index (when importing a large number
+/// of messages the indexing gets deferred to the `SearchIndexingJob` rather than happening within the import transaction)
+enum _015_DeferredSearchIndexing: Migration {
+    static let target: TargetMigrations.Identifier = .messagingKit
+    static let identifier: String = "DeferredSearchIndexing"
+    static let needsConfigSync: Bool = false
+    static let minExpectedRunDuration: TimeInterval = 0.1
+    
+    static func migrate(_ db: Database) throws {
+        try db.create(table: Interaction.pendingSearchIndexTableName) { t in
+            t.column(Interaction.pendingSearchIndexIdColumn.name, .integer)
+                .notNull()
+                .primaryKey()
+        }
+        
+        Storage.update(progress: 1, for: self, in: target) // In case this is the last migration
+    }
+}
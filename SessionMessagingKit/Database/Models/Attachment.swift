@@ -42,6 +42,7 @@ public struct Attachment: Codable, Identifiable, Equatable, Hashable, FetchableR
         case encryptionKey
         case digest
         case caption
+        case blurHash
     }
     
     public enum Variant: Int, Codable, DatabaseValueConvertible {
@@ -129,6 +130,10 @@ public struct Attachment: Codable, Identifiable, Equatable, Hashable, FetchableR
     /// Caption for the attachment
     public let caption: String?
     
+    /// A compact preview of visual media generated by the sender (see `BlurHash`), this allows recipients to render something
+    /// representative of the content while the attachment is downloading
+    public let blurHash: String?
+    
     // MARK: - Initialization
     
     public init(
@@ -149,7 +154,8 @@ public struct Attachment: Codable, Identifiable, Equatable, Hashable, FetchableR
         isValid: Bool = false,
         encryptionKey: Data? = nil,
         digest: Data? = nil,
-        caption: String? = nil
+        caption: String? = nil,
+        blurHash: String? = nil
     ) {
         self.id = id
         self.serverId = serverId
@@ -173,6 +179,7 @@ public struct Attachment: Codable, Identifiable, Equatable, Hashable, FetchableR
         self.encryptionKey = encryptionKey
         self.digest = digest
         self.caption = caption
+        self.blurHash = blurHash
     }
     
     /// This initializer should only be used when converting from either a LinkPreview or a SignalAttachment to an Attachment (prior to upload)
@@ -221,6 +228,7 @@ public struct Attachment: Codable, Identifiable, Equatable, Hashable, FetchableR
         self.encryptionKey = nil
         self.digest = nil
         self.caption = caption
+        self.blurHash = nil
     }
 }
 
@@ -322,7 +330,8 @@ extension Attachment {
         downloadUrl: String? = nil,
         localRelativeFilePath: String? = nil,
         encryptionKey: Data? = nil,
-        digest: Data? = nil
+        digest: Data? = nil,
+        blurHash: String? = nil
     ) -> Attachment {
         let (isValid, duration): (Bool, TimeInterval?) = {
             switch (self.state, state) {
@@ -382,7 +391,8 @@ extension Attachment {
             isValid: isValid,
             encryptionKey: (encryptionKey ?? self.encryptionKey),
             digest: (digest ?? self.digest),
-            caption: self.caption
+            caption: self.caption,
+            blurHash: (blurHash ?? self.blurHash)
         )
     }
 }
@@ -432,6 +442,7 @@ extension Attachment {
         self.encryptionKey = proto.key
         self.digest = proto.digest
         self.caption = (proto.hasCaption ? proto.caption : nil)
+        self.blurHash = (proto.hasBlurHash && BlurHash.isValid(proto.blurHash) ? proto.blurHash : nil)
     }
     
     public func buildProto() -> SNProtoAttachmentPointer? {
@@ -448,6 +459,10 @@ extension Attachment {
             builder.setCaption(caption)
         }
         
+        if let blurHash: String = self.blurHash, !blurHash.isEmpty {
+            builder.setBlurHash(blurHash)
+        }
+        
         builder.setSize(UInt32(byteCount))
         builder.setFlags(variant == .voiceMessage ?
             UInt32(SNProtoAttachmentPointer.SNProtoAttachmentPointerFlags.voiceMessage.rawValue) :
@@ -543,6 +558,10 @@ extension Attachment {
     }
 
     public static func stateInfo(interactionId: Int64, state: State? = nil) -> SQLRequest<Attachment.StateInfo> {
+        return stateInfo(interactionIds: [interactionId], state: state)
+    }
+    
+    public static func stateInfo(interactionIds: [Int64], state: State? = nil) -> SQLRequest<Attachment.StateInfo> {
         let attachment: TypedTableAlias<Attachment> = TypedTableAlias()
         let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
         let quote: TypedTableAlias<Quote> = TypedTableAlias()
@@ -563,7 +582,7 @@ extension Attachment {
             FROM \(Attachment.self)
             
             JOIN \(Interaction.self) ON
-                \(SQL("\(interaction[.id]) = \(interactionId)")) AND (
+                \(SQL("\(interaction[.id]) IN \(interactionIds)")) AND (
                     \(interaction[.id]) = \(quote[.interactionId]) OR
                     \(interaction[.id]) = \(interactionAttachment[.interactionId]) OR
                     (
@@ -781,6 +800,23 @@ extension Attachment {
         return UIImage(contentsOfFile: originalFilePath)
     }
     
+    /// Generate a `BlurHash` preview of the attachment content, this will be `nil` for non-visual attachments
+    var generatedBlurHash: String? {
+        guard let originalFilePath: String = originalFilePath, isValid else { return nil }
+        
+        if isVideo {
+            guard let stillImage: CGImage = Attachment.videoStillImage(filePath: originalFilePath)?.cgImage else {
+                return nil
+            }
+            
+            return BlurHash.encode(image: stillImage)
+        }
+        
+        guard isImage || isAnimated else { return nil }
+        
+        return BlurHash.encode(imageAtPath: originalFilePath)
+    }
+    
     public var isImage: Bool { MIMETypeUtil.isImage(contentType) }
     public var isVideo: Bool { MIMETypeUtil.isVideo(contentType) }
     public var isAnimated: Bool { MIMETypeUtil.isAnimated(contentType) }
@@ -998,8 +1034,11 @@ extension Attachment {
             return
         }
         
-        // Get the attachment
-        guard var data = try? readDataFromFile() else {
+        // Check the attachment exists
+        guard
+            let originalFilePath: String = self.originalFilePath,
+            FileManager.default.fileExists(atPath: originalFilePath)
+        else {
             SNLog("Couldn't read attachment from disk.")
             failure?(AttachmentError.noAttachment)
             return
@@ -1050,24 +1089,44 @@ extension Attachment {
             return
         }
         
-        var processedAttachment: Attachment = self
+        // Generate a preview of visual media for recipients to display while the attachment downloads
+        var processedAttachment: Attachment = (isVisualMedia && blurHash == nil ?
+            self.with(blurHash: generatedBlurHash) :
+            self
+        )
+        
+        let data: Data
         
         // Encrypt the attachment if needed
-        if encrypt {
-            var encryptionKey: NSData = NSData()
-            var digest: NSData = NSData()
-            
-            guard let ciphertext = Cryptography.encryptAttachmentData(data, shouldPad: true, outKey: &encryptionKey, outDigest: &digest) else {
-                SNLog("Couldn't encrypt attachment.")
-                failure?(AttachmentError.encryptionFailed)
-                return
+        //
+        // Note: The file is encrypted in chunks into a temporary file which is then memory-mapped so neither the
+        // plaintext nor the ciphertext need to be loaded into memory (the temporary file can be removed as soon as
+        // it's mapped as the mapping keeps the content accessible until the data is released), the onion request
+        // still needs the whole payload as it's encrypted again for each hop
+        do {
+            if encrypt {
+                let encryptedFilePath: String = OWSFileSystem.temporaryFilePath(withFileExtension: "encrypted")
+                defer { try? FileManager.default.removeItem(atPath: encryptedFilePath) }
+                
+                let result: AttachmentEncryptor.Result = try AttachmentEncryptor.encryptFile(
+                    atPath: originalFilePath,
+                    toPath: encryptedFilePath
+                )
+                
+                processedAttachment = processedAttachment.with(
+                    encryptionKey: result.encryptionKey,
+                    digest: result.digest
+                )
+                data = try Data(contentsOf: URL(fileURLWithPath: encryptedFilePath), options: .alwaysMapped)
             }
-            
-            processedAttachment = processedAttachment.with(
-                encryptionKey: encryptionKey as Data,
-                digest: digest as Data
-            )
-            data = ciphertext
+            else {
+                data = try Data(contentsOf: URL(fileURLWithPath: originalFilePath), options: .alwaysMapped)
+            }
+        }
+        catch {
+            SNLog("Couldn't \(encrypt ? "encrypt" : "read") attachment.")
+            failure?(encrypt ? AttachmentError.encryptionFailed : AttachmentError.noAttachment)
+            return
         }
         
         // Check the file size
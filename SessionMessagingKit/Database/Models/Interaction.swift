@@ -367,6 +367,17 @@ public struct Interaction: Codable, Identifiable, Equatable, FetchableRecord, Mu
             return
         }
         
+        // Quotes can be received before the interaction they reference so link any which are
+        // waiting on this interaction
+        if variant == .standardIncoming || variant == .standardOutgoing {
+            try Quote.updateOriginalInteractionIds(
+                db,
+                for: self,
+                interactionId: success.rowID,
+                threadVariant: threadVariant
+            )
+        }
+        
         switch variant {
             case .standardOutgoing:
                 // New outgoing messages should immediately determine their recipient list
@@ -662,7 +673,7 @@ public extension Interaction {
 // MARK: - Search Queries
 
 public extension Interaction {
-    static func idsForTermWithin(threadId: String, pattern: FTS5Pattern) -> SQLRequest<Int64> {
+    static func idsForTermWithin(threadId: String, pattern: FTS5Pattern, searchTerm: String) -> SQLRequest<Int64> {
         let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
         let interactionFullTextSearch: SQL = SQL(stringLiteral: Interaction.fullTextSearchTableName)
         let threadIdLiteral: SQL = SQL(stringLiteral: Interaction.Columns.threadId.name)
@@ -670,11 +681,20 @@ public extension Interaction {
         let request: SQLRequest<Int64> = """
             SELECT \(interaction[.id])
             FROM \(Interaction.self)
-            JOIN \(interactionFullTextSearch) ON (
-                \(interactionFullTextSearch).rowid = \(interaction.alias[Column.rowID]) AND
-                \(SQL("\(interactionFullTextSearch).\(threadIdLiteral) = \(threadId)")) AND
-                \(interactionFullTextSearch).\(SQL(stringLiteral: Interaction.Columns.body.name)) MATCH \(pattern)
-            )
+            JOIN (
+                SELECT \(interactionFullTextSearch).rowid AS \(Interaction.searchMatchRowIdKey)
+                FROM \(interactionFullTextSearch)
+                WHERE (
+                    \(SQL("\(interactionFullTextSearch).\(threadIdLiteral) = \(threadId)")) AND
+                    \(interactionFullTextSearch).\(SQL(stringLiteral: Interaction.Columns.body.name)) MATCH \(pattern)
+                )
+        
+                UNION ALL
+        
+                SELECT \(Interaction.searchMatchRowIdKey)
+                FROM (\(Interaction.unindexedSearchMatches(searchTerm: searchTerm)))
+            ) AS \(Interaction.searchMatchKey) ON \(Interaction.searchMatchKey).\(Interaction.searchMatchRowIdKey) = \(interaction.alias[Column.rowID])
+            WHERE \(SQL("\(interaction[.threadId]) = \(threadId)"))
         
             ORDER BY \(interaction[.timestampMs].desc)
         """
@@ -683,6 +703,184 @@ public extension Interaction {
     }
 }
 
+// MARK: - Deferred Search Indexing
+
+public extension Interaction {
+    /// The number of interactions being inserted within a single transaction at which it's worth deferring the search indexing
+    static let deferredSearchIndexingThreshold: Int = 100
+    
+    /// The table which tracks the interactions which haven't been added to the FTS table yet
+    static let pendingSearchIndexTableName: String = "\(databaseTableName)_ftsPending"
+    
+    internal static let pendingSearchIndexIdColumn: Column = Column("interactionId")
+    internal static let searchMatchKey: SQL = SQL(stringLiteral: "searchMatch")
+    internal static let searchMatchRowIdKey: SQL = SQL(stringLiteral: "searchMatchRowId")
+    internal static let searchMatchRankKey: SQL = SQL(stringLiteral: "searchMatchRank")
+    
+    /// Switch the FTS table into deferred mode if it isn't already, while in this mode the synchronisation triggers record newly inserted
+    /// interactions in the `pendingSearchIndexTableName` table instead of tokenising them within the inserting transaction and the
+    /// `SearchIndexingJob` indexes them in batches (switching back to synchronous indexing once there are none left)
+    ///
+    /// **Note:** The search queries match pending interactions directly against the search term so results remain complete while
+    /// they are waiting to be indexed
+    static func deferSearchIndexing(_ db: Database) throws {
+        guard !db[.isSearchIndexingDeferred] else { return }
+        
+        // Use a savepoint so a failure can't leave the FTS table without synchronisation triggers
+        try db.inSavepoint {
+            try replaceSearchSynchronizationTriggers(db, deferred: true)
+            db[.isSearchIndexingDeferred] = true
+            
+            return .commit
+        }
+        
+        JobRunner.add(
+            db,
+            job: Job(
+                variant: .searchIndexing,
+                behaviour: .runOnce
+            )
+        )
+    }
+    
+    /// Add up to `limit` pending interactions to the FTS table, once there are no more pending interactions this will switch back to
+    /// synchronous indexing
+    ///
+    /// - Returns: The number of interactions which are still waiting to be indexed
+    @discardableResult static func indexPendingSearchEntries(_ db: Database, limit: Int) throws -> Int {
+        let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
+        let interactionFullTextSearch: SQL = SQL(stringLiteral: Interaction.fullTextSearchTableName)
+        let pendingSearchIndex: SQL = SQL(stringLiteral: Interaction.pendingSearchIndexTableName)
+        let bodyLiteral: SQL = SQL(stringLiteral: Interaction.Columns.body.name)
+        let threadIdLiteral: SQL = SQL(stringLiteral: Interaction.Columns.threadId.name)
+        let pendingRequest: SQLRequest<Int64> = """
+            SELECT \(Interaction.pendingSearchIndexIdColumn)
+            FROM \(pendingSearchIndex)
+            ORDER BY \(Interaction.pendingSearchIndexIdColumn)
+            LIMIT \(limit)
+        """
+        let interactionIds: [Int64] = try pendingRequest.fetchAll(db)
+        
+        if !interactionIds.isEmpty {
+            try db.execute(literal: """
+                INSERT INTO \(interactionFullTextSearch) (rowid, \(bodyLiteral), \(threadIdLiteral))
+                SELECT \(interaction[.id]), \(interaction[.body]), \(interaction[.threadId])
+                FROM \(Interaction.self)
+                WHERE \(interactionIds.contains(interaction[.id]))
+            """)
+            try db.execute(literal: """
+                DELETE FROM \(pendingSearchIndex)
+                WHERE \(interactionIds.contains(Interaction.pendingSearchIndexIdColumn))
+            """)
+        }
+        
+        let remainingCount: Int = try Int
+            .fetchOne(db, sql: "SELECT COUNT(*) FROM \(Interaction.pendingSearchIndexTableName.quotedDatabaseIdentifier)")
+            .defaulting(to: 0)
+        
+        // Since writes are serial nothing else can be inserted before the triggers are switched back
+        if remainingCount == 0 && db[.isSearchIndexingDeferred] {
+            try replaceSearchSynchronizationTriggers(db, deferred: false)
+            db[.isSearchIndexingDeferred] = false
+        }
+        
+        return remainingCount
+    }
+    
+    /// Interactions which are waiting to be indexed can't be matched by the FTS table so this matches them directly against the parts of
+    /// the search term (the same parts the FTS pattern is generated from)
+    ///
+    /// **Note:** In order to behave like the FTS prefix queries each part needs to match the start of a token in the body (ie. the start of
+    /// the body or after a character which isn't a letter or digit), this approximates the FTS tokenizer by only treating ASCII letters and
+    /// digits as token characters and matching case insensitively
+    internal static func unindexedSearchMatches(searchTerm: String) -> SQL {
+        let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
+        let pendingSearchIndex: SQL = SQL(stringLiteral: Interaction.pendingSearchIndexTableName)
+        let lowercaseBody: SQL = SQL("lower(\(interaction[.body]))")
+        let bodyMatches: [SQL] = SessionThreadViewModel.searchTermParts(searchTerm)
+            .map { $0.trimmingCharacters(in: CharacterSet(charactersIn: "\"")).lowercased() }
+            .filter { !$0.isEmpty }
+            .map { part in
+                let pattern: String = Interaction.globEscaped(part)
+                
+                return SQL("(\(lowercaseBody) GLOB \("\(pattern)*") OR \(lowercaseBody) GLOB \("*[^0-9a-z]\(pattern)*"))")
+            }
+        
+        return """
+            SELECT
+                \(interaction.alias[Column.rowID]) AS \(Interaction.searchMatchRowIdKey),
+                0 AS \(Interaction.searchMatchRankKey)
+            FROM \(pendingSearchIndex)
+            JOIN \(Interaction.self) ON \(interaction[.id]) = \(pendingSearchIndex).\(Interaction.pendingSearchIndexIdColumn)
+            WHERE (\(bodyMatches.isEmpty ? SQL("false") : bodyMatches.joined(separator: " OR ")))
+        """
+    }
+    
+    /// Escape the characters which have a special meaning in a `GLOB` pattern
+    private static func globEscaped(_ value: String) -> String {
+        return value
+            .map { character -> String in
+                switch character {
+                    case "*", "?", "[": return "[\(character)]"
+                    default: return String(character)
+                }
+            }
+            .joined()
+    }
+    
+    /// Replace the FTS synchronisation triggers (these keep the names of the triggers GRDB creates so `dropFTS5SynchronizationTriggers`
+    /// continues to work)
+    ///
+    /// **Note:** In deferred mode interactions which are still pending never have their values removed from the FTS table as that would
+    /// corrupt the index
+    private static func replaceSearchSynchronizationTriggers(_ db: Database, deferred: Bool) throws {
+        let content: String = Interaction.databaseTableName.quotedDatabaseIdentifier
+        let fts: String = Interaction.fullTextSearchTableName.quotedDatabaseIdentifier
+        let pending: String = Interaction.pendingSearchIndexTableName.quotedDatabaseIdentifier
+        let triggerPrefix: String = "__\(Interaction.fullTextSearchTableName)"
+        let id: String = Interaction.Columns.id.name.quotedDatabaseIdentifier
+        let body: String = Interaction.Columns.body.name.quotedDatabaseIdentifier
+        let threadId: String = Interaction.Columns.threadId.name.quotedDatabaseIdentifier
+        let pendingId: String = Interaction.pendingSearchIndexIdColumn.name.quotedDatabaseIdentifier
+        let isNotPending: String = "NOT EXISTS (SELECT 1 FROM \(pending) WHERE \(pendingId) = old.\(id))"
+        
+        try db.dropFTS5SynchronizationTriggers(forTable: Interaction.fullTextSearchTableName)
+        
+        switch deferred {
+            case true:
+                try db.execute(sql: """
+                    CREATE TRIGGER "\(triggerPrefix)_ai" AFTER INSERT ON \(content) BEGIN
+                        INSERT OR IGNORE INTO \(pending) (\(pendingId)) VALUES (new.\(id));
+                    END;
+                    CREATE TRIGGER "\(triggerPrefix)_ad" AFTER DELETE ON \(content) BEGIN
+                        INSERT INTO \(fts) (\(fts), rowid, \(body), \(threadId))
+                        SELECT 'delete', old.\(id), old.\(body), old.\(threadId)
+                        WHERE \(isNotPending);
+                        DELETE FROM \(pending) WHERE \(pendingId) = old.\(id);
+                    END;
+                    CREATE TRIGGER "\(triggerPrefix)_au" AFTER UPDATE ON \(content) WHEN \(isNotPending) BEGIN
+                        INSERT INTO \(fts) (\(fts), rowid, \(body), \(threadId)) VALUES ('delete', old.\(id), old.\(body), old.\(threadId));
+                        INSERT INTO \(fts) (rowid, \(body), \(threadId)) VALUES (new.\(id), new.\(body), new.\(threadId));
+                    END;
+                """)
+                
+            case false:
+                try db.execute(sql: """
+                    CREATE TRIGGER "\(triggerPrefix)_ai" AFTER INSERT ON \(content) BEGIN
+                        INSERT INTO \(fts) (rowid, \(body), \(threadId)) VALUES (new.\(id), new.\(body), new.\(threadId));
+                    END;
+                    CREATE TRIGGER "\(triggerPrefix)_ad" AFTER DELETE ON \(content) BEGIN
+                        INSERT INTO \(fts) (\(fts), rowid, \(body), \(threadId)) VALUES ('delete', old.\(id), old.\(body), old.\(threadId));
+                    END;
+                    CREATE TRIGGER "\(triggerPrefix)_au" AFTER UPDATE ON \(content) BEGIN
+                        INSERT INTO \(fts) (\(fts), rowid, \(body), \(threadId)) VALUES ('delete', old.\(id), old.\(body), old.\(threadId));
+                        INSERT INTO \(fts) (rowid, \(body), \(threadId)) VALUES (new.\(id), new.\(body), new.\(threadId));
+                    END;
+                """)
+        }
+    }
+}
+
 // MARK: - Convenience
 
 public extension Interaction {
@@ -8,13 +8,13 @@ public struct Quote: Codable, Equatable, Hashable, FetchableRecord, PersistableR
     public static var databaseTableName: String { "quote" }
     public static let interactionForeignKey = ForeignKey([Columns.interactionId], to: [Interaction.Columns.id])
     internal static let originalInteractionForeignKey = ForeignKey(
-        [Columns.timestampMs, Columns.authorId],
-        to: [Interaction.Columns.timestampMs, Interaction.Columns.authorId]
+        [Columns.originalInteractionId],
+        to: [Interaction.Columns.id]
     )
     internal static let profileForeignKey = ForeignKey([Columns.authorId], to: [Profile.Columns.id])
     internal static let interaction = belongsTo(Interaction.self, using: interactionForeignKey)
     private static let profile = hasOne(Profile.self, using: profileForeignKey)
-    private static let quotedInteraction = hasOne(Interaction.self, using: originalInteractionForeignKey)
+    private static let quotedInteraction = belongsTo(Interaction.self, using: originalInteractionForeignKey)
     public static let attachment = hasOne(Attachment.self, using: Attachment.quoteForeignKey)
     
     public typealias Columns = CodingKeys
@@ -24,6 +24,7 @@ public struct Quote: Codable, Equatable, Hashable, FetchableRecord, PersistableR
         case timestampMs
         case body
         case attachmentId
+        case originalInteractionId
     }
     
     /// The id for the interaction this Quote belongs to
@@ -41,6 +42,12 @@ public struct Quote: Codable, Equatable, Hashable, FetchableRecord, PersistableR
     /// The id for the attachment this Quote is associated with
     public let attachmentId: String?
     
+    /// The id for the interaction this Quote is quoting
+    ///
+    /// **Note:** This will be `null` if the quoted interaction hasn't been received yet (or was deleted), it gets resolved
+    /// when the Quote is created and again when an interaction with a matching `timestampMs` and `authorId` is inserted
+    public let originalInteractionId: Int64?
+    
     // MARK: - Relationships
     
     public var interaction: QueryInterfaceRequest<Interaction> {
@@ -66,13 +73,15 @@ public struct Quote: Codable, Equatable, Hashable, FetchableRecord, PersistableR
         authorId: String,
         timestampMs: Int64,
         body: String?,
-        attachmentId: String?
+        attachmentId: String?,
+        originalInteractionId: Int64? = nil
     ) {
         self.interactionId = interactionId
         self.authorId = authorId
         self.timestampMs = timestampMs
         self.body = body
         self.attachmentId = attachmentId
+        self.originalInteractionId = originalInteractionId
     }
 }
 
@@ -84,14 +93,16 @@ public extension Quote {
         authorId: String? = nil,
         timestampMs: Int64? = nil,
         body: String? = nil,
-        attachmentId: String? = nil
+        attachmentId: String? = nil,
+        originalInteractionId: Int64? = nil
     ) -> Quote {
         return Quote(
             interactionId: interactionId ?? self.interactionId,
             authorId: authorId ?? self.authorId,
             timestampMs: timestampMs ?? self.timestampMs,
             body: body ?? self.body,
-            attachmentId: attachmentId ?? self.attachmentId
+            attachmentId: attachmentId ?? self.attachmentId,
+            originalInteractionId: originalInteractionId ?? self.originalInteractionId
         )
     }
 }
@@ -111,5 +122,87 @@ public extension Quote {
         self.authorId = quoteProto.author
         self.body = nil
         self.attachmentId = nil
+        self.originalInteractionId = Quote.originalInteractionId(
+            db,
+            timestampMs: Int64(quoteProto.id),
+            authorId: quoteProto.author,
+            threadId: thread.id,
+            threadVariant: thread.variant
+        )
+    }
+}
+
+// MARK: - Original Interaction Resolution
+
+public extension Quote {
+    /// Returns the id of the interaction which matches the quote info
+    ///
+    /// **Note:** A users outgoing message is stored in some cases using their standard id but the quote will use their
+    /// blinded id so we need to handle that case
+    static func originalInteractionId(
+        _ db: Database,
+        timestampMs: Int64,
+        authorId: String,
+        threadId: String,
+        threadVariant: SessionThread.Variant
+    ) -> Int64? {
+        let isCurrentUserBlindedId: Bool = (
+            threadVariant == .openGroup &&
+            SessionId.Prefix(from: authorId) == .blinded &&
+            SessionThread.getUserHexEncodedBlindedKey(
+                db,
+                threadId: threadId,
+                threadVariant: threadVariant
+            ) == authorId
+        )
+        let authorIds: [String] = [authorId]
+            .appending(isCurrentUserBlindedId ? getUserHexEncodedPublicKey(db) : nil)
+        
+        return try? Interaction
+            .select(.id)
+            .filter(Interaction.Columns.timestampMs == timestampMs)
+            .filter(authorIds.contains(Interaction.Columns.authorId))
+            .asRequest(of: Int64.self)
+            .fetchOne(db)
+    }
+    
+    /// Links any quotes which were created before the interaction they reference was received to that interaction
+    ///
+    /// **Note:** Quotes of the users own messages in open groups use their blinded id so the blinded id needs to be matched
+    /// as well in that case (`getUserHexEncodedBlindedKey` caches the blinded id so this doesn't re-derive it each time)
+    static func updateOriginalInteractionIds(
+        _ db: Database,
+        for interaction: Interaction,
+        interactionId: Int64,
+        threadVariant: SessionThread.Variant
+    ) throws {
+        // Most threads don't have any quotes waiting on an interaction so check for one (this can use the index on
+        // 'originalInteractionId') before deriving the author ids and running the update
+        let hasUnresolvedQuotes: Bool = try Quote
+            .filter(Columns.originalInteractionId == nil)
+            .joining(required: Quote.interaction.filter(Interaction.Columns.threadId == interaction.threadId))
+            .isNotEmpty(db)
+        
+        guard hasUnresolvedQuotes else { return }
+        
+        let isCurrentUserInOpenGroup: Bool = (
+            threadVariant == .openGroup &&
+            interaction.authorId == getUserHexEncodedPublicKey(db)
+        )
+        let authorIds: [String] = [interaction.authorId]
+            .appending(isCurrentUserInOpenGroup ?
+                SessionThread.getUserHexEncodedBlindedKey(
+                    db,
+                    threadId: interaction.threadId,
+                    threadVariant: threadVariant
+                ) :
+                nil
+            )
+        
+        try Quote
+            .filter(Columns.originalInteractionId == nil)
+            .filter(Columns.timestampMs == interaction.timestampMs)
+            .filter(authorIds.contains(Columns.authorId))
+            .updateAll(db, Columns.originalInteractionId.set(to: interactionId))
     }
 }
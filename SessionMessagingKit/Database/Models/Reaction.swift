@@ -132,3 +132,42 @@ public extension Reaction {
         return 0
     }
 }
+
+// MARK: - Batch Updates
+
+public extension Reaction {
+    /// The maximum number of rows inserted by a single statement (keeps the number of arguments well below SQLite's limit)
+    private static let maxRowsPerInsert: Int = 100
+    
+    /// Insert the provided reactions using multi-row `INSERT` statements rather than a statement per reaction, this is used
+    /// when handling bursts of incoming reactions
+    static func insertAll(_ db: Database, _ reactions: [Reaction]) throws {
+        let columns: [Columns] = [.interactionId, .serverHash, .timestampMs, .authorId, .emoji, .count, .sortId]
+        let rowPlaceholder: String = "(\(columns.map { _ in "?" }.joined(separator: ", ")))"
+        let columnNames: String = columns
+            .map { $0.name.quotedDatabaseIdentifier }
+            .joined(separator: ", ")
+        
+        try reactions.chunked(by: maxRowsPerInsert).forEach { chunk in
+            try db.execute(
+                sql: """
+                    INSERT INTO \(databaseTableName.quotedDatabaseIdentifier) (\(columnNames))
+                    VALUES \(chunk.map { _ in rowPlaceholder }.joined(separator: ", "))
+                """,
+                arguments: StatementArguments(
+                    chunk.flatMap { reaction -> [DatabaseValueConvertible?] in
+                        [
+                            reaction.interactionId,
+                            reaction.serverHash,
+                            reaction.timestampMs,
+                            reaction.authorId,
+                            reaction.emoji,
+                            reaction.count,
+                            reaction.sortId
+                        ]
+                    }
+                )
+            )
+        }
+    }
+}
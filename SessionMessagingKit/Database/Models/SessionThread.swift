@@ -316,6 +316,10 @@ public extension SessionThread {
         }
     }
     
+    /// Blinding the users key is relatively expensive and the result only depends on the server public key and the users ed25519
+    /// key so the results are cached keyed by both (which means entries never need to be invalidated)
+    private static let blindedKeyCache: Atomic<[String: String]> = Atomic([:])
+    
     static func getUserHexEncodedBlindedKey(
         _ db: Database? = nil,
         threadId: String,
@@ -335,7 +339,7 @@ public extension SessionThread {
         }
         
         guard
-            let userEdKeyPair: Box.KeyPair = Identity.fetchUserEd25519KeyPair(db),
+            let userEdPublicKey: Bytes = Identity.fetchUserEd25519PublicKey(db),
             let openGroupInfo: OpenGroupInfo = try? OpenGroup
                 .filter(id: threadId)
                 .select(.publicKey, .server)
@@ -353,16 +357,24 @@ public extension SessionThread {
         
         guard capabilities.isEmpty || capabilities.contains(.blind) else { return nil }
         
+        let cacheKey: String = "\(openGroupInfo.publicKey)-\(userEdPublicKey.toHexString())"
+        
+        if let cachedBlindedKey: String = blindedKeyCache.wrappedValue[cacheKey] { return cachedBlindedKey }
+        
         let sodium: Sodium = Sodium()
         
-        let blindedKeyPair: Box.KeyPair? = sodium.blindedKeyPair(
-            serverPublicKey: openGroupInfo.publicKey,
-            edKeyPair: userEdKeyPair,
-            genericHash: sodium.getGenericHash()
-        )
+        guard
+            let userEdKeyPair: Box.KeyPair = Identity.fetchUserEd25519KeyPair(db),
+            let blindedKeyPair: Box.KeyPair = sodium.blindedKeyPair(
+                serverPublicKey: openGroupInfo.publicKey,
+                edKeyPair: userEdKeyPair,
+                genericHash: sodium.getGenericHash()
+            )
+        else { return nil }
         
-        return blindedKeyPair.map { keyPair -> String in
-            SessionId(.blinded, publicKey: keyPair.publicKey).hexString
-        }
+        let blindedKey: String = SessionId(.blinded, publicKey: blindedKeyPair.publicKey).hexString
+        blindedKeyCache.mutate { $0[cacheKey] = blindedKey }
+        
+        return blindedKey
     }
 }
@@ -294,6 +294,8 @@ public enum GarbageCollectionJob: JobExecutor {
                     _ = try PendingReadReceipt
                         .filter(PendingReadReceipt.Columns.serverExpirationTimestamp <= timestampNow)
                         .deleteAll(db)
+                    
+                    PendingReadReceiptIndex.expiredReceiptsRemoved(db, before: timestampNow)
                 }
             },
             completion: { _, _ in
@@ -31,6 +31,11 @@ public enum MessageReceiveJob: JobExecutor {
         Storage.shared.write { db in
             var remainingMessagesToProcess: [Details.MessageInfo] = []
             
+            // Defer the search indexing when catching up on a large number of messages
+            if details.messages.count >= Interaction.deferredSearchIndexingThreshold {
+                try? Interaction.deferSearchIndexing(db)
+            }
+            
             for messageInfo in details.messages {
                 do {
                     try MessageReceiver.handle(
@@ -70,6 +75,9 @@ public enum MessageReceiveJob: JobExecutor {
                 }
             }
             
+            // Apply any pending read receipts for the outgoing messages which were just inserted
+            try PendingReadReceiptIndex.applyPendingMatches(db)
+            
             // If any messages failed to process then we want to update the job to only include
             // those failed messages
             updatedJob = try job
@@ -0,0 +1,41 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionUtilitiesKit
+
+/// This job adds interactions which were inserted while search indexing was deferred (see `Interaction.deferSearchIndexing`) to
+/// the FTS table, each batch is indexed in it's own write transaction so the job doesn't block other writes for long
+public enum SearchIndexingJob: JobExecutor {
+    public static let maxFailureCount: Int = -1
+    public static let requiresThreadId: Bool = false
+    public static let requiresInteractionId: Bool = false
+    
+    /// The number of interactions to index within each write transaction
+    internal static let batchSize: Int = 500
+    
+    public static func run(
+        _ job: Job,
+        queue: DispatchQueue,
+        success: @escaping (Job, Bool) -> (),
+        failure: @escaping (Job, Error?, Bool) -> (),
+        deferred: @escaping (Job) -> ()
+    ) {
+        var remainingCount: Int = 0
+        
+        repeat {
+            let maybeRemainingCount: Int? = Storage.shared.write { db in
+                try Interaction.indexPendingSearchEntries(db, limit: batchSize)
+            }
+            
+            guard let updatedRemainingCount: Int = maybeRemainingCount else {
+                failure(job, StorageError.generic, false)
+                return
+            }
+            
+            remainingCount = updatedRemainingCount
+        } while remainingCount > 0
+        
+        success(job, false)
+    }
+}
@@ -66,7 +66,7 @@ extension OpenGroupAPI.Message {
         
         // If we have data and a signature (ie. the message isn't a deletion) then validate the signature
         if let base64EncodedData: String = maybeBase64EncodedData, let base64EncodedSignature: String = maybeBase64EncodedSignature {
-            guard let sender: String = maybeSender, let data = Data(base64Encoded: base64EncodedData), let signature = Data(base64Encoded: base64EncodedSignature) else {
+            guard let sender: String = maybeSender, let data = Base64.decodedData(base64EncodedData), let signature = Base64.decodedData(base64EncodedSignature) else {
                 throw HTTP.Error.parsingFailed
             }
             guard let dependencies: SMKDependencies = decoder.userInfo[Dependencies.userInfoKey] as? SMKDependencies else {
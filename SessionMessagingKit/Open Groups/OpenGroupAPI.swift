@@ -769,6 +769,51 @@ public enum OpenGroupAPI {
             .decoded(as: ReactionRemoveAllResponse.self, on: OpenGroupAPI.workQueue, using: dependencies)
     }
     
+    /// Adds and removes multiple reactions in a room using a single `/batch` request
+    ///
+    /// The result is keyed by the `reaction` endpoint for each change (which contains the percent encoded emoji) and each value will contain
+    /// either a `ReactionAddResponse` or a `ReactionRemoveResponse` depending on the type of change
+    ///
+    /// **Note:** Each change must be for a unique `id` and `emoji` combination as the subrequests are run independently
+    public static func reactionChanges(
+        _ db: Database,
+        _ changes: [(emoji: String, id: Int64, remove: Bool)],
+        in roomToken: String,
+        on server: String,
+        using dependencies: SMKDependencies = SMKDependencies()
+    ) -> Promise<[Endpoint: (OnionRequestResponseInfoType, Codable?)]> {
+        var requests: [BatchRequestInfoType] = []
+        
+        for change in changes {
+            /// URL(String:) won't convert raw emojis, so need to do a little encoding here.
+            /// The raw emoji will come back when calling url.path
+            guard let encodedEmoji: String = change.emoji.addingPercentEncoding(withAllowedCharacters: .urlPathAllowed) else {
+                return Promise(error: OpenGroupAPIError.invalidEmoji)
+            }
+            
+            requests.append(change.remove ?
+                BatchRequestInfo(
+                    request: Request<NoBody, Endpoint>(
+                        method: .delete,
+                        server: server,
+                        endpoint: .reaction(roomToken, id: change.id, emoji: encodedEmoji)
+                    ),
+                    responseType: ReactionRemoveResponse.self
+                ) :
+                BatchRequestInfo(
+                    request: Request<NoBody, Endpoint>(
+                        method: .put,
+                        server: server,
+                        endpoint: .reaction(roomToken, id: change.id, emoji: encodedEmoji)
+                    ),
+                    responseType: ReactionAddResponse.self
+                )
+            )
+        }
+        
+        return OpenGroupAPI.batch(db, server: server, requests: requests, using: dependencies)
+    }
+    
     // MARK: - Pinning
     
     /// Adds a pinned message to this room
@@ -1342,10 +1387,10 @@ public enum OpenGroupAPI {
         let method: String = (request.httpMethod ?? "GET")
         let timestamp: Int = Int(floor(dependencies.date.timeIntervalSince1970))
         let nonce: Data = Data(dependencies.nonceGenerator16.nonce())
-        let serverPublicKeyData: Data = Data(hex: serverPublicKey)
         
         guard
-            !serverPublicKeyData.isEmpty,
+            let serverPublicKeyBytes: Bytes = Hex.decodedBytes(serverPublicKey),
+            !serverPublicKeyBytes.isEmpty,
             let timestampBytes: Bytes = "\(timestamp)".data(using: .ascii)?.bytes
         else { return nil }
         
@@ -1364,7 +1409,7 @@ public enum OpenGroupAPI {
         ///     `Method`
         ///     `Path`
         ///     `Body` is a Blake2b hash of the data (if there is a body)
-        let messageBytes: Bytes = serverPublicKeyData.bytes
+        let messageBytes: Bytes = serverPublicKeyBytes
             .appending(contentsOf: nonce.bytes)
             .appending(contentsOf: timestampBytes)
             .appending(contentsOf: method.bytes)
@@ -1380,8 +1425,8 @@ public enum OpenGroupAPI {
             .updated(with: [
                 Header.sogsPubKey.rawValue: signResult.publicKey,
                 Header.sogsTimestamp.rawValue: "\(timestamp)",
-                Header.sogsNonce.rawValue: nonce.base64EncodedString(),
-                Header.sogsSignature.rawValue: signResult.signature.toBase64()
+                Header.sogsNonce.rawValue: Base64.encodedString(nonce),
+                Header.sogsSignature.rawValue: Base64.encodedString(signResult.signature)
             ])
         
         return updatedRequest
@@ -537,6 +537,7 @@ public final class OpenGroupManager: NSObject {
         var messageServerIdsToRemove: [Int64] = messages
             .filter { $0.deleted == true }
             .map { $0.id }
+        var reactionsToUpdate: [Int64: [Reaction]] = [:]
         
         if let seqNo: Int64 = seqNo {
             // Update the 'openGroupSequenceNumber' value (Note: SOGS V4 uses the 'seqNo' instead of the 'serverId')
@@ -551,6 +552,12 @@ public final class OpenGroupManager: NSObject {
             }
         }
         
+        // Large imports (eg. joining a room or catching up after being offline) defer the search indexing so
+        // tokenising the messages doesn't slow down the import
+        if sortedMessages.count >= Interaction.deferredSearchIndexingThreshold {
+            try? Interaction.deferSearchIndexing(db)
+        }
+        
         // Process the messages
         sortedMessages.forEach { message in
             if message.base64EncodedData == nil && message.reactions == nil {
@@ -598,39 +605,39 @@ public final class OpenGroupManager: NSObject {
                 }
             }
             
-            // Handle reactions
+            // Gather the reactions (these get updated together once the messages have been processed)
             if message.reactions != nil {
-                do {
-                    let reactions: [Reaction] = Message.processRawReceivedReactions(
-                        db,
-                        openGroupId: openGroup.id,
-                        message: message,
-                        associatedPendingChanges: dependencies.cache.pendingChanges
-                            .filter {
-                                guard $0.server == server && $0.room == roomToken && $0.changeType == .reaction else {
-                                    return false
-                                }
-                                
-                                if case .reaction(let messageId, _, _) = $0.metadata {
-                                    return messageId == message.id
-                                }
+                reactionsToUpdate[message.id] = Message.processRawReceivedReactions(
+                    db,
+                    openGroupId: openGroup.id,
+                    message: message,
+                    associatedPendingChanges: dependencies.cache.pendingChanges
+                        .filter {
+                            guard $0.server == server && $0.room == roomToken && $0.changeType == .reaction else {
                                 return false
-                            },
-                        dependencies: dependencies
-                    )
-                    
-                    try MessageReceiver.handleOpenGroupReactions(
-                        db,
-                        threadId: openGroup.threadId,
-                        openGroupMessageServerId: message.id,
-                        openGroupReactions: reactions
-                    )
-                }
-                catch {
-                    SNLog("Couldn't handle open group reactions due to error: \(error).")
-                }
+                            }
+                            
+                            if case .reaction(let messageId, _, _) = $0.metadata {
+                                return messageId == message.id
+                            }
+                            return false
+                        },
+                    dependencies: dependencies
+                )
             }
         }
+        
+        // Handle reactions
+        do {
+            try MessageReceiver.handleOpenGroupReactions(
+                db,
+                threadId: openGroup.threadId,
+                openGroupReactions: reactionsToUpdate
+            )
+        }
+        catch {
+            SNLog("Couldn't handle open group reactions due to error: \(error).")
+        }
 
         // Handle any deletions that are needed
         guard !messageServerIdsToRemove.isEmpty else { return }
@@ -674,6 +681,12 @@ public final class OpenGroupManager: NSObject {
                 .updateAll(db, OpenGroup.Columns.inboxLatestMessageId.set(to: latestMessageId))
         }
 
+        // Large imports (eg. joining a room or catching up after being offline) defer the search indexing so
+        // tokenising the messages doesn't slow down the import
+        if sortedMessages.count >= Interaction.deferredSearchIndexingThreshold {
+            try? Interaction.deferSearchIndexing(db)
+        }
+        
         // Process the messages
         sortedMessages.forEach { message in
             guard let messageData = Data(base64Encoded: message.base64EncodedMessage) else {
@@ -879,7 +892,7 @@ public final class OpenGroupManager: NSObject {
                         guard let userEdKeyPair: Box.KeyPair = Identity.fetchUserEd25519KeyPair(db) else {
                             return false
                         }
-                        guard sessionId.prefix != .unblinded || publicKey == SessionId(.unblinded, publicKey: userEdKeyPair.publicKey).hexString else {
+                        guard sessionId.prefix != .unblinded || sessionId == SessionId(.unblinded, publicKey: userEdKeyPair.publicKey) else {
                             return false
                         }
                         fallthrough
@@ -898,7 +911,7 @@ public final class OpenGroupManager: NSObject {
                                 genericHash: dependencies.genericHash
                             )
                         else { return false }
-                        guard sessionId.prefix != .blinded || publicKey == SessionId(.blinded, publicKey: blindedKeyPair.publicKey).hexString else {
+                        guard sessionId.prefix != .blinded || sessionId == SessionId(.blinded, publicKey: blindedKeyPair.publicKey) else {
                             return false
                         }
                         
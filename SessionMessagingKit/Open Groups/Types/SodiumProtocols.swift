@@ -36,6 +36,7 @@ public protocol Ed25519Type {
 public protocol BoxType {
     func seal(message: Bytes, recipientPublicKey: Bytes) -> Bytes?
     func open(anonymousCipherText: Bytes, recipientPublicKey: Bytes, recipientSecretKey: Bytes) -> Bytes?
+    func open(anonymousCipherText: Bytes, recipientPublicKey: Bytes, recipientSecretKey: UnsafeRawBufferPointer) -> Bytes?
 }
 
 public protocol GenericHashType {
@@ -50,6 +51,7 @@ public protocol SignType {
     
     func toX25519(ed25519PublicKey: Bytes) -> Bytes?
     func signature(message: Bytes, secretKey: Bytes) -> Bytes?
+    func signature(message: Bytes, secretKey: UnsafeRawBufferPointer) -> Bytes?
     func verify(message: Bytes, publicKey: Bytes, signature: Bytes) -> Bool
 }
 
@@ -3477,6 +3477,9 @@ extension SNProtoReceiptMessage.SNProtoReceiptMessageBuilder {
         if let _value = caption {
             builder.setCaption(_value)
         }
+        if let _value = blurHash {
+            builder.setBlurHash(_value)
+        }
         if let _value = url {
             builder.setUrl(_value)
         }
@@ -3539,6 +3542,10 @@ extension SNProtoReceiptMessage.SNProtoReceiptMessageBuilder {
             proto.caption = valueParam
         }
 
+        @objc public func setBlurHash(_ valueParam: String) {
+            proto.blurHash = valueParam
+        }
+
         @objc public func setUrl(_ valueParam: String) {
             proto.url = valueParam
         }
@@ -3644,6 +3651,16 @@ extension SNProtoReceiptMessage.SNProtoReceiptMessageBuilder {
         return proto.hasCaption
     }
 
+    @objc public var blurHash: String? {
+        guard proto.hasBlurHash else {
+            return nil
+        }
+        return proto.blurHash
+    }
+    @objc public var hasBlurHash: Bool {
+        return proto.hasBlurHash
+    }
+
     @objc public var url: String? {
         guard proto.hasURL else {
             return nil
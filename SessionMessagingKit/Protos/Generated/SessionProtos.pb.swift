@@ -1522,6 +1522,15 @@ struct SessionProtos_AttachmentPointer {
   /// Clears the value of `caption`. Subsequent reads from it will return its default value.
   mutating func clearCaption() {self._caption = nil}
 
+  var blurHash: String {
+    get {return _blurHash ?? String()}
+    set {_blurHash = newValue}
+  }
+  /// Returns true if `blurHash` has been explicitly set.
+  var hasBlurHash: Bool {return self._blurHash != nil}
+  /// Clears the value of `blurHash`. Subsequent reads from it will return its default value.
+  mutating func clearBlurHash() {self._blurHash = nil}
+
   var url: String {
     get {return _url ?? String()}
     set {_url = newValue}
@@ -1569,6 +1578,7 @@ struct SessionProtos_AttachmentPointer {
   fileprivate var _width: UInt32? = nil
   fileprivate var _height: UInt32? = nil
   fileprivate var _caption: String? = nil
+  fileprivate var _blurHash: String? = nil
   fileprivate var _url: String? = nil
 }
 
@@ -3202,6 +3212,7 @@ extension SessionProtos_AttachmentPointer: SwiftProtobuf.Message, SwiftProtobuf.
     9: .same(proto: "width"),
     10: .same(proto: "height"),
     11: .same(proto: "caption"),
+    12: .same(proto: "blurHash"),
     101: .same(proto: "url"),
   ]
 
@@ -3227,6 +3238,7 @@ extension SessionProtos_AttachmentPointer: SwiftProtobuf.Message, SwiftProtobuf.
       case 9: try { try decoder.decodeSingularUInt32Field(value: &self._width) }()
       case 10: try { try decoder.decodeSingularUInt32Field(value: &self._height) }()
       case 11: try { try decoder.decodeSingularStringField(value: &self._caption) }()
+      case 12: try { try decoder.decodeSingularStringField(value: &self._blurHash) }()
       case 101: try { try decoder.decodeSingularStringField(value: &self._url) }()
       default: break
       }
@@ -3271,6 +3283,9 @@ extension SessionProtos_AttachmentPointer: SwiftProtobuf.Message, SwiftProtobuf.
     try { if let v = self._caption {
       try visitor.visitSingularStringField(value: v, fieldNumber: 11)
     } }()
+    try { if let v = self._blurHash {
+      try visitor.visitSingularStringField(value: v, fieldNumber: 12)
+    } }()
     try { if let v = self._url {
       try visitor.visitSingularStringField(value: v, fieldNumber: 101)
     } }()
@@ -3289,6 +3304,7 @@ extension SessionProtos_AttachmentPointer: SwiftProtobuf.Message, SwiftProtobuf.
     if lhs._width != rhs._width {return false}
     if lhs._height != rhs._height {return false}
     if lhs._caption != rhs._caption {return false}
+    if lhs._blurHash != rhs._blurHash {return false}
     if lhs._url != rhs._url {return false}
     if lhs.unknownFields != rhs.unknownFields {return false}
     return true
@@ -0,0 +1,131 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import CryptoSwift
+import SessionUtilitiesKit
+
+/// The `AttachmentEncryptor` encrypts an attachment file into it's upload payload in fixed size chunks so neither the plaintext nor
+/// the ciphertext ever need to be loaded into memory
+///
+/// The payload matches the format produced by `Cryptography.encryptAttachmentData` (`iv || AES-256-CBC(padded data)
+/// || HMAC-SHA256(iv || ciphertext)`) where the key is `aesKey || hmacKey` and the digest is the SHA256 of the whole payload
+/// so it can be decrypted by `Cryptography.decryptAttachment` on any client
+///
+/// **Note:** Files are encrypted when they are uploaded rather than while they are written (eg. voice messages aren't encrypted
+/// while recording) as `AVAudioRecorder` only finalises the m4a container when it stops (it rewrites the `mdat` size and appends
+/// the `moov` atom) so the recording isn't append-only until then
+public enum AttachmentEncryptor {
+    public struct Result {
+        public let encryptionKey: Data
+        public let digest: Data
+        public let encryptedByteCount: UInt64
+    }
+    
+    private static let chunkSize: Int = (64 * 1024)
+    private static let keySize: UInt = 32
+    private static let ivSize: UInt = 16
+    private static let hmacBlockSize: Int = 64
+    
+    // MARK: - Padding
+    
+    /// The size the plaintext is padded to (with zeroes) before encryption to obscure the exact size of the attachment
+    public static func paddedSize(for unpaddedSize: UInt64) -> UInt64 {
+        guard unpaddedSize > 0 else { return 541 }
+        
+        return max(541, UInt64(floor(pow(1.05, ceil(log(Double(unpaddedSize)) / log(1.05))))))
+    }
+    
+    // MARK: - Encryption
+    
+    /// Encrypt the file at `sourcePath` writing the payload to `destinationPath`
+    ///
+    /// **Note:** Sync. Don't call from the main thread.
+    public static func encryptFile(
+        atPath sourcePath: String,
+        toPath destinationPath: String,
+        shouldPad: Bool = true
+    ) throws -> Result {
+        guard
+            let unpaddedSize: UInt64 = OWSFileSystem.fileSize(ofPath: sourcePath)?.uint64Value,
+            let aesKey: Data = Data.getSecureRandomData(ofSize: keySize),
+            let hmacKey: Data = Data.getSecureRandomData(ofSize: keySize),
+            let iv: Data = Data.getSecureRandomData(ofSize: ivSize),
+            FileManager.default.createFile(atPath: destinationPath, contents: nil)
+        else { throw AttachmentError.encryptionFailed }
+        
+        let source: FileHandle = try FileHandle(forReadingFrom: URL(fileURLWithPath: sourcePath))
+        let destination: FileHandle = try FileHandle(forWritingTo: URL(fileURLWithPath: destinationPath))
+        defer {
+            source.closeFile()
+            destination.closeFile()
+        }
+        
+        // HMAC-SHA256 is calculated as 'SHA256((key ^ opad) || SHA256((key ^ ipad) || message))' which lets us
+        // update it as each chunk is written
+        let paddedHmacKey: [UInt8] = hmacKey.bytes + [UInt8](repeating: 0, count: (hmacBlockSize - hmacKey.count))
+        var innerHmac: SHA2 = SHA2(variant: .sha256)
+        var digest: SHA2 = SHA2(variant: .sha256)
+        var encryptor: Cryptor & Updatable = try AES(
+            key: aesKey.bytes,
+            blockMode: CBC(iv: iv.bytes),
+            padding: .pkcs7
+        ).makeEncryptor()
+        var encryptedByteCount: UInt64 = 0
+        
+        func write(_ bytes: [UInt8], includeInHmac: Bool = true) throws {
+            guard !bytes.isEmpty else { return }
+            
+            if includeInHmac {
+                _ = try innerHmac.update(withBytes: bytes)
+            }
+            
+            _ = try digest.update(withBytes: bytes)
+            destination.write(Data(bytes))
+            encryptedByteCount += UInt64(bytes.count)
+        }
+        
+        _ = try innerHmac.update(withBytes: paddedHmacKey.map { $0 ^ 0x36 })
+        try write(iv.bytes)
+        
+        // Encrypt the file content
+        var hasMoreData: Bool = true
+        
+        while hasMoreData {
+            try autoreleasepool {
+                let chunk: Data = source.readData(ofLength: chunkSize)
+                
+                guard !chunk.isEmpty else {
+                    hasMoreData = false
+                    return
+                }
+                
+                try write(try encryptor.update(withBytes: chunk.bytes))
+            }
+        }
+        
+        // Encrypt the padding
+        var remainingPadding: UInt64 = (shouldPad ? (max(unpaddedSize, paddedSize(for: unpaddedSize)) - unpaddedSize) : 0)
+        
+        while remainingPadding > 0 {
+            let paddingChunkSize: Int = Int(min(UInt64(chunkSize), remainingPadding))
+            try write(try encryptor.update(withBytes: [UInt8](repeating: 0, count: paddingChunkSize)))
+            remainingPadding -= UInt64(paddingChunkSize)
+        }
+        
+        try write(try encryptor.finish())
+        
+        // Append the HMAC
+        var outerHmac: SHA2 = SHA2(variant: .sha256)
+        _ = try outerHmac.update(withBytes: paddedHmacKey.map { $0 ^ 0x5c })
+        let hmac: [UInt8] = try outerHmac.finish(withBytes: try innerHmac.finish())
+        try write(hmac, includeInHmac: false)
+        
+        destination.synchronizeFile()
+        
+        return Result(
+            encryptionKey: (aesKey + hmacKey),
+            digest: Data(try digest.finish()),
+            encryptedByteCount: encryptedByteCount
+        )
+    }
+}
@@ -0,0 +1,412 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionUtilitiesKit
+
+/// The `AttachmentPrefetcher` schedules attachment downloads and thumbnail generation for content the user is likely to view
+/// soon (eg. the messages just beyond the edge of the screen in the direction the user is scrolling, or the latest messages in the
+/// conversations at the top of the home screen) so the media is ready before the cell appears
+///
+/// Downloads are only scheduled for attachments which would have been downloaded automatically on receipt (ie. from trusted
+/// contacts or group threads) and are added to the end of the `attachmentDownload` queue so they run after any downloads
+/// which were explicitly requested, thumbnails are requested furthest-first because the `ThumbnailService` processes the
+/// most recent request first
+///
+/// **Note:** The amount of work scheduled is limited by a `Budget` based on the network type and the power state of the device
+public final class AttachmentPrefetcher {
+    public static let shared: AttachmentPrefetcher = AttachmentPrefetcher()
+    
+    public struct Candidate {
+        public let threadId: String
+        public let interactionId: Int64
+        public let attachment: Attachment
+        
+        /// Whether the user's trust settings allow this attachment to be downloaded automatically
+        public let canAutoDownload: Bool
+        
+        public init(threadId: String, interactionId: Int64, attachment: Attachment, canAutoDownload: Bool) {
+            self.threadId = threadId
+            self.interactionId = interactionId
+            self.attachment = attachment
+            self.canAutoDownload = canAutoDownload
+        }
+    }
+    
+    /// The limits for the work scheduled around the visible content, downloads which are still in progress from previous plans
+    /// count towards the download limits
+    public struct Budget: Equatable {
+        public let maxDownloadCount: Int
+        public let maxDownloadBytes: UInt
+        public let maxThumbnailCount: Int
+        
+        public static let none: Budget = Budget(maxDownloadCount: 0, maxDownloadBytes: 0, maxThumbnailCount: 0)
+        
+        public init(maxDownloadCount: Int, maxDownloadBytes: UInt, maxThumbnailCount: Int) {
+            self.maxDownloadCount = maxDownloadCount
+            self.maxDownloadBytes = maxDownloadBytes
+            self.maxThumbnailCount = maxThumbnailCount
+        }
+        
+        /// The budget given the current network and power state
+        public static func current(
+            isReachable: Bool,
+            isReachableViaWiFi: Bool,
+            isLowPowerModeEnabled: Bool = ProcessInfo.processInfo.isLowPowerModeEnabled,
+            thermalState: ProcessInfo.ThermalState = ProcessInfo.processInfo.thermalState
+        ) -> Budget {
+            // Thumbnail generation is local so it's only limited when the device is constrained
+            guard !isLowPowerModeEnabled && thermalState != .serious && thermalState != .critical else {
+                return Budget(maxDownloadCount: 0, maxDownloadBytes: 0, maxThumbnailCount: 2)
+            }
+            guard isReachable else {
+                return Budget(maxDownloadCount: 0, maxDownloadBytes: 0, maxThumbnailCount: 8)
+            }
+            guard isReachableViaWiFi else {
+                return Budget(maxDownloadCount: 2, maxDownloadBytes: (2 * 1024 * 1024), maxThumbnailCount: 8)
+            }
+            
+            return Budget(maxDownloadCount: 6, maxDownloadBytes: (20 * 1024 * 1024), maxThumbnailCount: 8)
+        }
+    }
+    
+    public struct Plan {
+        public let downloads: [Candidate]
+        
+        /// The attachments to generate thumbnails for, ordered from most to least likely to be viewed
+        public let thumbnails: [Candidate]
+    }
+    
+    /// The number of rows beyond the visible rows to consider when the table isn't scrolling
+    private static let baseLookahead: Int = 6
+    
+    /// How far ahead (in seconds of scrolling) to prefetch in the direction of the scroll
+    private static let scrollLeadTime: Double = 1.5
+    private static let maxLookahead: Int = 40
+    
+    /// Rows behind the scroll direction are less likely to be viewed so their distance is weighted by this factor
+    private static let trailingDistanceFactor: Int = 3
+    
+    /// The number of conversations at the top of the home screen to prefetch for and the number of recent messages in each
+    private static let homeScreenThreadCount: Int = 3
+    private static let homeScreenInteractionCount: Int = 10
+    
+    private let queue: DispatchQueue = DispatchQueue(label: "AttachmentPrefetcher.queue", qos: .utility)
+    
+    /// The attachments which have already been scheduled this session (so they aren't scheduled repeatedly while scrolling)
+    private let scheduledAttachmentIds: Atomic<Set<String>> = Atomic([])
+    
+    // MARK: - Planning
+    
+    /// Determine which attachments should be prefetched
+    ///
+    /// - Parameters:
+    ///   - rows: The candidates for each row of the paged window, in the order they are displayed
+    ///   - visibleRows: The range of rows which are currently visible
+    ///   - rowsPerSecond: The scroll velocity, positive values scroll towards higher row indexes
+    ///   - budget: The limits for the plan
+    ///   - excludedAttachmentIds: Attachments which have already been scheduled
+    ///   - hasThumbnail: Whether a thumbnail has already been generated for an attachment
+    public static func plan(
+        rows: [[Candidate]],
+        visibleRows: ClosedRange<Int>,
+        rowsPerSecond: Double,
+        budget: Budget,
+        excludedAttachmentIds: Set<String> = [],
+        hasThumbnail: (Attachment) -> Bool
+    ) -> Plan {
+        guard !rows.isEmpty else { return Plan(downloads: [], thumbnails: []) }
+        
+        let visibleRows: ClosedRange<Int> = visibleRows.clamped(to: 0...(rows.count - 1))
+        let scrollLookahead: Int = min(maxLookahead, baseLookahead + Int(abs(rowsPerSecond) * scrollLeadTime))
+        let isScrollingForwards: Bool = (rowsPerSecond > 0)
+        let isScrolling: Bool = (rowsPerSecond != 0)
+        
+        // Order the rows by how soon they are likely to be displayed
+        let orderedRows: [Int] = (0..<rows.count)
+            .compactMap { row -> (row: Int, cost: Int)? in
+                guard !visibleRows.contains(row) else { return (row, 0) }
+                
+                let isForwards: Bool = (row > visibleRows.upperBound)
+                let distance: Int = (isForwards ?
+                    (row - visibleRows.upperBound) :
+                    (visibleRows.lowerBound - row)
+                )
+                let isLeading: Bool = (!isScrolling || isForwards == isScrollingForwards)
+                
+                switch isLeading {
+                    case true:
+                        guard distance <= scrollLookahead else { return nil }
+                        
+                        return (row, distance)
+                    
+                    case false:
+                        guard distance <= baseLookahead else { return nil }
+                        
+                        return (row, (distance * trailingDistanceFactor))
+                }
+            }
+            .sorted { lhs, rhs in (lhs.cost == rhs.cost ? lhs.row < rhs.row : lhs.cost < rhs.cost) }
+            .map { $0.row }
+        
+        // Downloads which were scheduled by a previous plan and haven't completed count towards the budget (so
+        // frequent planning while scrolling can't flood the download queue)
+        let inProgressDownloads: [Candidate] = orderedRows
+            .flatMap { rows[$0] }
+            .filter { candidate in
+                excludedAttachmentIds.contains(candidate.attachment.id) && (
+                    candidate.attachment.state == .pendingDownload ||
+                    candidate.attachment.state == .downloading
+                )
+            }
+        var downloads: [Candidate] = []
+        var downloadCount: Int = inProgressDownloads.count
+        var downloadBytes: UInt = inProgressDownloads.reduce(0) { result, next in result + next.attachment.byteCount }
+        var thumbnails: [Candidate] = []
+        
+        orderedRows.forEach { row in
+            rows[row].forEach { candidate in
+                guard !excludedAttachmentIds.contains(candidate.attachment.id) else { return }
+                
+                switch candidate.attachment.state {
+                    case .pendingDownload:
+                        guard
+                            candidate.canAutoDownload,
+                            downloadCount < budget.maxDownloadCount,
+                            (downloadBytes + candidate.attachment.byteCount) <= budget.maxDownloadBytes
+                        else { return }
+                        
+                        downloads.append(candidate)
+                        downloadCount += 1
+                        downloadBytes += candidate.attachment.byteCount
+                    
+                    case .downloaded, .uploaded:
+                        guard
+                            thumbnails.count < budget.maxThumbnailCount,
+                            AttachmentPrefetcher.needsThumbnail(candidate.attachment),
+                            !hasThumbnail(candidate.attachment)
+                        else { return }
+                        
+                        thumbnails.append(candidate)
+                    
+                    default: break
+                }
+            }
+        }
+        
+        return Plan(downloads: downloads, thumbnails: thumbnails)
+    }
+    
+    /// Only attachments displayed using a generated thumbnail (see `MediaView`) need to be thumbnailed, if the original is
+    /// smaller than the thumbnail size then it's used directly
+    private static func needsThumbnail(_ attachment: Attachment) -> Bool {
+        let dimension: UInt = Attachment.ThumbnailSize.medium.dimension
+        
+        guard
+            attachment.isValid,
+            (attachment.isImage || attachment.isVideo) && !attachment.isAnimated,
+            let width: UInt = attachment.width,
+            let height: UInt = attachment.height
+        else { return false }
+        
+        return (width >= dimension && height >= dimension)
+    }
+    
+    // MARK: - Conversation
+    
+    /// The prefetch candidates for a message (ie. it's attachments, quote thumbnail and link preview image)
+    public static func candidates(for cellViewModel: MessageViewModel) -> [Candidate] {
+        // Match the logic used when receiving messages (ie. trusted contact or group thread)
+        let canAutoDownload: Bool = (cellViewModel.threadIsTrusted || cellViewModel.threadVariant != .contact)
+        
+        return (cellViewModel.attachments ?? [])
+            .appending(cellViewModel.quoteAttachment)
+            .appending(cellViewModel.linkPreviewAttachment)
+            .map { attachment in
+                Candidate(
+                    threadId: cellViewModel.threadId,
+                    interactionId: cellViewModel.id,
+                    attachment: attachment,
+                    canAutoDownload: canAutoDownload
+                )
+            }
+    }
+    
+    /// Prefetch the attachments around the visible messages in a conversation
+    ///
+    /// **Note:** This can be called frequently (eg. while scrolling) as the planning is done on a background queue
+    public func prefetch(
+        for cellViewModels: [MessageViewModel],
+        visibleRows: ClosedRange<Int>,
+        rowsPerSecond: Double
+    ) {
+        let budget: Budget = currentBudget()
+        
+        guard budget != .none else { return }
+        
+        queue.async { [weak self] in
+            let plan: Plan = AttachmentPrefetcher.plan(
+                rows: cellViewModels.map { AttachmentPrefetcher.candidates(for: $0) },
+                visibleRows: visibleRows,
+                rowsPerSecond: rowsPerSecond,
+                budget: budget,
+                excludedAttachmentIds: (self?.scheduledAttachmentIds.wrappedValue ?? []),
+                hasThumbnail: { attachment in
+                    FileManager.default.fileExists(
+                        atPath: attachment.thumbnailPath(for: Attachment.ThumbnailSize.medium.dimension)
+                    )
+                }
+            )
+            
+            self?.schedule(plan)
+        }
+    }
+    
+    // MARK: - Home Screen
+    
+    /// Prefetch the attachments in the most recent messages of the conversations at the top of the home screen
+    public func prefetchRecentAttachments(threadIds: [String]) {
+        let threadIds: [String] = Array(threadIds.prefix(AttachmentPrefetcher.homeScreenThreadCount))
+        let budget: Budget = currentBudget()
+        
+        guard !threadIds.isEmpty && budget.maxDownloadCount > 0 else { return }
+        
+        queue.async { [weak self] in
+            let rows: [[Candidate]] = Storage.shared
+                .read { db -> [[Candidate]] in
+                    let threads: [SessionThread] = try SessionThread
+                        .filter(ids: threadIds)
+                        .fetchAll(db)
+                    let trustedContactIds: Set<String> = try Contact
+                        .select(.id)
+                        .filter(ids: threadIds)
+                        .filter(Contact.Columns.isTrusted == true)
+                        .asRequest(of: String.self)
+                        .fetchSet(db)
+                    
+                    let eligibleThreadIds: [String] = threadIds.filter { threadId in
+                        guard let thread: SessionThread = threads.first(where: { $0.id == threadId }) else {
+                            return false
+                        }
+                        
+                        return (thread.variant != .contact || trustedContactIds.contains(threadId))
+                    }
+                    let recentInteractionIds: [String: [Int64]] = try eligibleThreadIds
+                        .reduce(into: [:]) { result, threadId in
+                            result[threadId] = try Interaction
+                                .select(.id)
+                                .filter(Interaction.Columns.threadId == threadId)
+                                .order(Interaction.Columns.timestampMs.desc)
+                                .limit(AttachmentPrefetcher.homeScreenInteractionCount)
+                                .asRequest(of: Int64.self)
+                                .fetchAll(db)
+                        }
+                    let interactionIds: [Int64] = recentInteractionIds.values.flatMap { $0 }
+                    
+                    guard !interactionIds.isEmpty else { return [] }
+                    
+                    // Retrieve the attachments for all of the interactions at once
+                    let stateInfo: [Int64: [Attachment.StateInfo]] = try Attachment
+                        .stateInfo(interactionIds: interactionIds, state: .pendingDownload)
+                        .fetchAll(db)
+                        .grouped(by: \.interactionId)
+                    let attachments: [String: Attachment] = try Attachment
+                        .filter(ids: stateInfo.values.flatMap { $0.map { $0.attachmentId } })
+                        .fetchAll(db)
+                        .reduce(into: [:]) { result, next in result[next.id] = next }
+                    
+                    // Each thread is treated as a row ordered as it is on the home screen
+                    return threadIds.map { threadId -> [Candidate] in
+                        (recentInteractionIds[threadId] ?? []).flatMap { interactionId -> [Candidate] in
+                            (stateInfo[interactionId] ?? [])
+                                .sorted { lhs, rhs in lhs.albumIndex < rhs.albumIndex }
+                                .compactMap { stateInfo -> Candidate? in
+                                    attachments[stateInfo.attachmentId].map { attachment in
+                                        Candidate(
+                                            threadId: threadId,
+                                            interactionId: interactionId,
+                                            attachment: attachment,
+                                            canAutoDownload: true
+                                        )
+                                    }
+                                }
+                        }
+                    }
+                }
+                .defaulting(to: [])
+            
+            self?.schedule(
+                AttachmentPrefetcher.plan(
+                    rows: rows,
+                    visibleRows: 0...0,
+                    rowsPerSecond: 0,
+                    budget: Budget(
+                        maxDownloadCount: budget.maxDownloadCount,
+                        maxDownloadBytes: budget.maxDownloadBytes,
+                        maxThumbnailCount: 0
+                    ),
+                    excludedAttachmentIds: (self?.scheduledAttachmentIds.wrappedValue ?? []),
+                    hasThumbnail: { _ in true }
+                )
+            )
+        }
+    }
+    
+    // MARK: - Scheduling
+    
+    private func currentBudget() -> Budget {
+        guard let reachabilityManager: SSKReachabilityManager = Environment.shared?.reachabilityManager else {
+            return .none
+        }
+        
+        return Budget.current(
+            isReachable: reachabilityManager.isReachable,
+            isReachableViaWiFi: reachabilityManager.isReachable(via: .wifi)
+        )
+    }
+    
+    private func schedule(_ plan: Plan) {
+        guard !plan.downloads.isEmpty || !plan.thumbnails.isEmpty else { return }
+        
+        scheduledAttachmentIds.mutate { ids in
+            ids.formUnion(plan.downloads.map { $0.attachment.id })
+            ids.formUnion(plan.thumbnails.map { $0.attachment.id })
+        }
+        
+        if !plan.downloads.isEmpty {
+            Storage.shared.writeAsync { db in
+                plan.downloads.forEach { candidate in
+                    let details: AttachmentDownloadJob.Details = AttachmentDownloadJob.Details(
+                        attachmentId: candidate.attachment.id
+                    )
+                    
+                    // The attachment may already have been queued when the message was received
+                    guard !JobRunner.hasPendingOrRunningJob(with: .attachmentDownload, details: details) else {
+                        return
+                    }
+                    
+                    JobRunner.add(
+                        db,
+                        job: Job(
+                            variant: .attachmentDownload,
+                            threadId: candidate.threadId,
+                            interactionId: candidate.interactionId,
+                            details: details
+                        )
+                    )
+                }
+            }
+        }
+        
+        // The 'ThumbnailService' processes the most recent request first so add the least likely to be
+        // viewed first (this also means any thumbnails requested by visible cells will jump ahead of these)
+        ThumbnailService.shared.ensureThumbnails(
+            for: plan.thumbnails.reversed().map { $0.attachment },
+            dimensions: Attachment.ThumbnailSize.medium.dimension,
+            failure: { [weak self] attachment, _ in
+                // Allow the thumbnail to be retried by a later plan
+                self?.scheduledAttachmentIds.mutate { $0.remove(attachment.id) }
+            }
+        )
+    }
+}
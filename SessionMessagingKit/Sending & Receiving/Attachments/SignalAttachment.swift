@@ -598,7 +598,7 @@ public class SignalAttachment: Equatable, Hashable {
             if isValidOutput {
                 return removeImageMetadata(attachment: attachment)
             } else {
-                return compressImageAsJPEG(image: image, attachment: attachment, filename: dataSource.sourceFilename, imageQuality: imageQuality)
+                return compressImageAsJPEG(dataSource: dataSource, image: image, attachment: attachment, filename: dataSource.sourceFilename, imageQuality: imageQuality)
             }
         }
     }
@@ -659,7 +659,7 @@ public class SignalAttachment: Equatable, Hashable {
         var imageUploadQuality = imageQuality.imageQualityTier()
 
         while true {
-            let maxSize = maxSizeForImage(image: image, imageUploadQuality: imageUploadQuality)
+            let maxSize = maxSizeForImage(imageSize: image.size, imageUploadQuality: imageUploadQuality)
             var dstImage: UIImage! = image
             if image.size.width > maxSize ||
                 image.size.height > maxSize {
@@ -711,6 +711,234 @@ public class SignalAttachment: Equatable, Hashable {
         }
     }
 
+    // Compresses an image directly from its encoded data.
+    //
+    // Rather than decoding the full resolution image and then resizing and encoding it
+    // for each quality tier until the output is small enough, we:
+    //
+    // * Predict the tier from the pixel count and the source's bytes per pixel (a rough
+    //   estimate of the image's entropy).
+    // * Downsample while decoding using ImageIO thumbnailing.
+    // * Binary search the JPEG quality if the prediction was too optimistic before
+    //   dropping to the next tier.
+    //
+    // The metadata is stripped as part of the encode as none of the source properties are
+    // copied to the output (the orientation is applied to the pixels when downsampling).
+    private class func compressImageAsJPEG(dataSource: DataSource, image: UIImage, attachment: SignalAttachment, filename: String?, imageQuality: TSImageQuality) -> SignalAttachment {
+        assert(attachment.error == nil)
+
+        if imageQuality == .original &&
+            attachment.dataLength < kMaxFileSizeGeneric &&
+            outputImageUTISet.contains(attachment.dataUTI) {
+            // We should avoid resizing images attached "as documents" if possible.
+            return attachment
+        }
+
+        guard
+            let source = CGImageSourceCreateWithData(dataSource.data() as CFData, nil),
+            let properties = CGImageSourceCopyPropertiesAtIndex(source, 0, nil) as? [CFString: Any],
+            let pixelWidth = (properties[kCGImagePropertyPixelWidth] as? NSNumber)?.doubleValue,
+            let pixelHeight = (properties[kCGImagePropertyPixelHeight] as? NSNumber)?.doubleValue,
+            pixelWidth > 0,
+            pixelHeight > 0
+        else {
+            // Fall back to compressing the decoded image.
+            return compressImageAsJPEG(image: image, attachment: attachment, filename: filename, imageQuality: imageQuality)
+        }
+
+        let imageSize = CGSize(width: pixelWidth, height: pixelHeight)
+        let tiers = imageQualityTiers(startingAt: imageQuality.imageQualityTier())
+
+        // Skip any tiers which are predicted to be too large.
+        let predictedTier = predictedImageQualityTier(
+            imageSize: imageSize,
+            sourceDataLength: dataSource.dataLength(),
+            imageQuality: imageQuality
+        )
+        let predictedTierIndex = (tiers.firstIndex(of: predictedTier) ?? (tiers.count - 1))
+
+        let baseFilename = filename?.filenameWithoutExtension
+        let jpgFilename = baseFilename?.appendingFileExtension("jpg")
+
+        for tierIndex in predictedTierIndex..<tiers.count {
+            let imageUploadQuality = tiers[tierIndex]
+            let maxSize = maxSizeForImage(imageSize: imageSize, imageUploadQuality: imageUploadQuality)
+
+            guard let dstImage = downsampledImage(source: source, maxPixelSize: maxSize) else {
+                attachment.error = .couldNotResizeImage
+                return attachment
+            }
+
+            let encode = { (quality: CGFloat) throws -> DataSource? in
+                guard
+                    let jpgImageData = jpegData(image: dstImage, compressionQuality: quality),
+                    let dataSource = DataSourceValue.dataSource(with: jpgImageData, fileExtension: "jpg")
+                else { throw SignalAttachmentError.couldNotConvertToJpeg }
+
+                dataSource.sourceFilename = jpgFilename
+
+                guard
+                    doesImageHaveAcceptableFileSize(dataSource: dataSource, imageQuality: imageQuality) &&
+                    dataSource.dataLength() <= kMaxFileSizeImage
+                else { return nil }
+
+                return dataSource
+            }
+            let recompressedAttachment = { (dataSource: DataSource) -> SignalAttachment in
+                let recompressedAttachment = SignalAttachment(dataSource: dataSource, dataUTI: kUTTypeJPEG as String)
+                recompressedAttachment.cachedImage = UIImage(cgImage: dstImage)
+                return recompressedAttachment
+            }
+
+            do {
+                let maxQuality = jpegCompressionQuality(imageUploadQuality: imageUploadQuality)
+
+                if let dataSource = try encode(maxQuality) {
+                    return recompressedAttachment(dataSource)
+                }
+
+                // If the output is too large then search the qualities between this tier's and the
+                // next tier's, if even the next tier's quality is too large at this size then we
+                // drop to the next tier
+                guard tierIndex < tiers.count - 1 else { continue }
+
+                let minQuality = jpegCompressionQuality(imageUploadQuality: tiers[tierIndex + 1])
+
+                guard let minQualityDataSource = try encode(minQuality) else { continue }
+
+                let bestDataSource = try searchCompressionQuality(
+                    lowerQuality: minQuality,
+                    lowerOutput: minQualityDataSource,
+                    upperQuality: maxQuality,
+                    encode: encode
+                )
+
+                return recompressedAttachment(bestDataSource)
+            } catch {
+                attachment.error = ((error as? SignalAttachmentError) ?? .couldNotConvertToJpeg)
+                return attachment
+            }
+        }
+
+        attachment.error = .fileSizeTooLarge
+        return attachment
+    }
+
+    static let maxQualitySearchSteps: Int = 4
+
+    // Predicts the first quality tier whose output is expected to fit within the file size limit
+    // for the image quality (the last tier is used if none of them are expected to fit).
+    class func predictedImageQualityTier(imageSize: CGSize, sourceDataLength: UInt, imageQuality: TSImageQuality) -> TSImageQualityTier {
+        let tiers = imageQualityTiers(startingAt: imageQuality.imageQualityTier())
+        let sourceBytesPerPixel = (Double(sourceDataLength) / Double(imageSize.width * imageSize.height))
+        let maxFileSize = Double(maxAcceptableFileSize(imageQuality: imageQuality))
+
+        return tiers.first(where: { tier in
+            predictedJPEGFileSize(
+                imageSize: imageSize,
+                sourceBytesPerPixel: sourceBytesPerPixel,
+                imageUploadQuality: tier
+            ) <= maxFileSize
+        }) ?? tiers[tiers.count - 1]
+    }
+
+    // Binary searches the qualities between `lowerQuality` (which is known to produce an
+    // acceptable output) and `upperQuality` (which is known not to), returning the output
+    // for the highest acceptable quality which was found.
+    class func searchCompressionQuality<Output>(
+        lowerQuality: CGFloat,
+        lowerOutput: Output,
+        upperQuality: CGFloat,
+        steps: Int = maxQualitySearchSteps,
+        encode: (CGFloat) throws -> Output?
+    ) rethrows -> Output {
+        var lowerQuality = lowerQuality
+        var upperQuality = upperQuality
+        var bestOutput = lowerOutput
+
+        for _ in 0..<steps {
+            let quality = ((lowerQuality + upperQuality) / 2)
+
+            if let output = try encode(quality) {
+                bestOutput = output
+                lowerQuality = quality
+            } else {
+                upperQuality = quality
+            }
+        }
+
+        return bestOutput
+    }
+
+    private class func imageQualityTiers(startingAt imageUploadQuality: TSImageQualityTier) -> [TSImageQualityTier] {
+        let allTiers: [TSImageQualityTier] = [.original, .high, .mediumHigh, .medium, .mediumLow, .low]
+
+        return Array(allTiers.drop(while: { $0 != imageUploadQuality }))
+    }
+
+    private class func maxAcceptableFileSize(imageQuality: TSImageQuality) -> UInt {
+        switch imageQuality {
+        case .original:
+            return kMaxFileSizeImage
+        case .medium:
+            return min(kMaxFileSizeImage, UInt(1024 * 1024))
+        case .compact:
+            return min(kMaxFileSizeImage, UInt(400 * 1024))
+        }
+    }
+
+    // A rough estimate of the JPEG output size; the source's bytes per pixel reflects how
+    // much detail the image contains (noisy photos compress far worse than screenshots) and
+    // the quality factors approximate how JPEG output scales with the compression quality.
+    private class func predictedJPEGFileSize(imageSize: CGSize, sourceBytesPerPixel: Double, imageUploadQuality: TSImageQualityTier) -> Double {
+        let maxSize = maxSizeForImage(imageSize: imageSize, imageUploadQuality: imageUploadQuality)
+        let scale = min(1, Double(maxSize / max(imageSize.width, imageSize.height)))
+        let pixelCount = Double(imageSize.width * imageSize.height) * scale * scale
+        let qualityFactor: Double = {
+            switch imageUploadQuality {
+            case .original: return 2.5
+            case .high: return 1
+            case .mediumHigh: return 0.75
+            case .medium: return 0.6
+            case .mediumLow: return 0.5
+            case .low: return 0.45
+            }
+        }()
+
+        // Downsampling an image increases the detail per pixel so clamp the estimate to
+        // sensible bounds for a JPEG at ~0.9 quality
+        let bytesPerPixel = min(max(sourceBytesPerPixel, 0.15), 1.5)
+
+        return (pixelCount * bytesPerPixel * qualityFactor)
+    }
+
+    private class func downsampledImage(source: CGImageSource, maxPixelSize: CGFloat) -> CGImage? {
+        let options: [CFString: Any] = [
+            kCGImageSourceCreateThumbnailFromImageAlways: true,
+            kCGImageSourceCreateThumbnailWithTransform: true,
+            kCGImageSourceShouldCacheImmediately: true,
+            kCGImageSourceThumbnailMaxPixelSize: maxPixelSize
+        ]
+
+        return CGImageSourceCreateThumbnailAtIndex(source, 0, options as CFDictionary)
+    }
+
+    private class func jpegData(image: CGImage, compressionQuality: CGFloat) -> Data? {
+        let mutableData = NSMutableData()
+        guard let destination = CGImageDestinationCreateWithData(mutableData as CFMutableData, kUTTypeJPEG, 1, nil) else {
+            return nil
+        }
+
+        // Note: No metadata is added to the destination
+        let properties: [CFString: Any] = [kCGImageDestinationLossyCompressionQuality: compressionQuality]
+        CGImageDestinationAddImage(destination, image, properties as CFDictionary)
+
+        guard CGImageDestinationFinalize(destination) else {
+            return nil
+        }
+        return mutableData as Data
+    }
+
     // NOTE: For unknown reasons, resizing images with UIGraphicsBeginImageContext()
     // crashes reliably in the share extension after screen lock's auth UI has been presented.
     // Resizing using a CGContext seems to work fine.
@@ -765,10 +993,10 @@ public class SignalAttachment: Equatable, Hashable {
         }
     }
 
-    private class func maxSizeForImage(image: UIImage, imageUploadQuality: TSImageQualityTier) -> CGFloat {
+    private class func maxSizeForImage(imageSize: CGSize, imageUploadQuality: TSImageQualityTier) -> CGFloat {
         switch imageUploadQuality {
         case .original:
-            return max(image.size.width, image.size.height)
+            return max(imageSize.width, imageSize.height)
         case .high:
             return 2048
         case .mediumHigh:
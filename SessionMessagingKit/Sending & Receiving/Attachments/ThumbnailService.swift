@@ -44,6 +44,32 @@ public class ThumbnailService {
         }
     }
 
+    /// Requests thumbnails for a number of attachments at once, since requests are processed in reverse order the last attachment
+    /// will be processed first and any requests made before these have been processed will jump ahead of them
+    public func ensureThumbnails(
+        for attachments: [Attachment],
+        dimensions: UInt,
+        failure: @escaping (Attachment, Error) -> Void
+    ) {
+        guard !attachments.isEmpty else { return }
+        
+        serialQueue.async {
+            self.requestStack.append(
+                contentsOf: attachments.map { attachment in
+                    Request(
+                        attachment: attachment,
+                        dimensions: dimensions,
+                        success: { _ in },
+                        failure: { error in failure(attachment, error) }
+                    )
+                }
+            )
+            
+            // Process each request in a separate block so that newer requests can be added to the stack in between
+            attachments.forEach { _ in self.processNextRequestAsync() }
+        }
+    }
+
     private func processNextRequestAsync() {
         serialQueue.async {
             self.processNextRequestSync()
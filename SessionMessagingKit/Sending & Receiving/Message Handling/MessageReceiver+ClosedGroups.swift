@@ -153,7 +153,7 @@ extension MessageReceiver {
             case let .encryptionKeyPair(explicitGroupPublicKey, wrappers) = message.kind,
             let groupPublicKey: String = (explicitGroupPublicKey?.toHexString() ?? message.groupPublicKey)
         else { return }
-        guard let userKeyPair: Box.KeyPair = Identity.fetchUserKeyPair(db) else {
+        guard let userX25519PublicKey: Data = Identity.fetchUserPublicKey(db) else {
             return SNLog("Couldn't find user X25519 key pair.")
         }
         guard let thread: SessionThread = try? SessionThread.fetchOne(db, id: groupPublicKey) else {
@@ -165,21 +165,22 @@ extension MessageReceiver {
             return SNLog("Ignoring closed group encryption key pair from non-admin.")
         }
         // Find our wrapper and decrypt it if possible
-        let userPublicKey: String = SessionId(.standard, publicKey: userKeyPair.publicKey).hexString
+        let userPublicKey: String = SessionId(.standard, publicKey: userX25519PublicKey.bytes).hexString
         
         guard
             let wrapper = wrappers.first(where: { $0.publicKey == userPublicKey }),
             let encryptedKeyPair = wrapper.encryptedKeyPair
         else { return }
         
-        let plaintext: Data
-        do {
-            plaintext = try MessageReceiver.decryptWithSessionProtocol(
+        let maybePlaintext: Data? = try? Identity.withUserX25519SecretKey(db) { secretKey in
+            try MessageReceiver.decryptWithSessionProtocol(
                 ciphertext: encryptedKeyPair,
-                using: userKeyPair
+                recipientX25519PublicKey: userX25519PublicKey.bytes,
+                recipientX25519PrivateKey: secretKey
             ).plaintext
         }
-        catch {
+        
+        guard let plaintext: Data = maybePlaintext else {
             return SNLog("Couldn't decrypt closed group encryption key pair.")
         }
         
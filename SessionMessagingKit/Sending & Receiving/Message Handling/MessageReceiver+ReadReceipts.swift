@@ -24,12 +24,15 @@ extension MessageReceiver {
         
         // We have some pending read receipts so store them in the database
         try pendingTimestampMs.forEach { timestampMs in
-            try PendingReadReceipt(
+            let pendingReadReceipt: PendingReadReceipt = PendingReadReceipt(
                 threadId: sender,
                 interactionTimestampMs: timestampMs,
                 readTimestampMs: readTimestampMs,
                 serverExpirationTimestamp: (serverExpirationTimestamp ?? 0)
-            ).save(db)
+            )
+            try pendingReadReceipt.save(db)
+            
+            PendingReadReceiptIndex.insert(pendingReadReceipt)
         }
     }
 }
@@ -74,7 +74,7 @@ extension MessageReceiver {
                         )
                     else { return .standardIncoming }
                     
-                    return (sender == SessionId(.blinded, publicKey: blindedKeyPair.publicKey).hexString ?
+                    return (senderSessionId == SessionId(.blinded, publicKey: blindedKeyPair.publicKey) ?
                         .standardOutgoing :
                         .standardIncoming
                     )
@@ -286,13 +286,9 @@ extension MessageReceiver {
         // Notify the user if needed
         guard variant == .standardIncoming else { return interactionId }
         
-        // Use the same identifier for notifications when in backgroud polling to prevent spam
-        Environment.shared?.notificationsManager.wrappedValue?
-            .notifyUser(
-                db,
-                for: interaction,
-                in: thread
-            )
+        // Notifications are coalesced per thread and emitted once the current transaction commits to
+        // prevent spam when processing a large batch of messages (eg. during background polling)
+        NotificationCoalescer.add(db, interaction: interaction, in: thread)
         
         return interactionId
     }
@@ -420,21 +416,11 @@ extension MessageReceiver {
             trySendReadReceipt: true
         )
         
-        // Process any PendingReadReceipt values
-        let maybePendingReadReceipt: PendingReadReceipt? = try PendingReadReceipt
-            .filter(PendingReadReceipt.Columns.threadId == thread.id)
-            .filter(PendingReadReceipt.Columns.interactionTimestampMs == Int64(messageSentTimestamp * 1000))
-            .fetchOne(db)
-        
-        if let pendingReadReceipt: PendingReadReceipt = maybePendingReadReceipt {
-            try Interaction.markAsRead(
-                db,
-                recipientId: thread.id,
-                timestampMsValues: [pendingReadReceipt.interactionTimestampMs],
-                readTimestampMs: pendingReadReceipt.readTimestampMs
-            )
-            
-            _ = try pendingReadReceipt.delete(db)
-        }
+        // Process any PendingReadReceipt values (these get applied in bulk once the batch of messages has been processed)
+        PendingReadReceiptIndex.interactionInserted(
+            db,
+            threadId: thread.id,
+            timestampMs: Int64(messageSentTimestamp * 1000)
+        )
     }
 }
@@ -0,0 +1,217 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionUtilitiesKit
+
+/// Read receipts can arrive before the interactions they relate to (particularly when restoring or catching up after being offline) so
+/// they get stored as `PendingReadReceipt` values which need to be checked whenever an outgoing interaction is inserted
+///
+/// In order to avoid querying the `pendingReadReceipt` table for every inserted interaction the `PendingReadReceiptIndex`
+/// keeps an in-memory bloom filter of the pending receipts (split into buckets based on their `serverExpirationTimestamp` so that
+/// entries can be dropped once the garbage collection removes the expired receipts without rebuilding the filter), only interactions
+/// which might have a pending receipt get recorded and the matching receipts are then applied together by `applyPendingMatches`
+/// before the inserting transaction commits
+///
+/// **Note:** The filter can return false positives (eg. for receipts which have since been applied) but never false negatives so
+/// a "might contain" result always gets confirmed against the database
+public enum PendingReadReceiptIndex {
+    internal struct Key: Hashable {
+        let threadId: String
+        let interactionTimestampMs: Int64
+    }
+    
+    // MARK: - Filter
+    
+    internal struct Filter {
+        /// The period covered by each bucket, pending receipts expire with the message on the server so this results in roughly
+        /// a couple of weeks worth of buckets
+        static let bucketDuration: TimeInterval = (24 * 60 * 60)
+        static let bitsPerBucket: Int = (8 * 1024)
+        static let hashCount: Int = 3
+        
+        private var buckets: [Int: [UInt64]] = [:]
+        
+        var bucketCount: Int { buckets.count }
+        
+        /// **Note:** Receipts without an expiration timestamp (or which have already expired) end up in the oldest buckets so
+        /// will be dropped the next time the garbage collection runs (which is also when their rows get deleted)
+        mutating func insert(_ key: Key, serverExpirationTimestamp: TimeInterval) {
+            let bucket: Int = Int(max(0, serverExpirationTimestamp) / Filter.bucketDuration)
+            var bits: [UInt64] = (buckets[bucket] ?? [UInt64](repeating: 0, count: (Filter.bitsPerBucket / 64)))
+            
+            Filter.bitIndexes(for: key).forEach { index in
+                bits[index / 64] |= (1 << UInt64(index % 64))
+            }
+            
+            buckets[bucket] = bits
+        }
+        
+        func mightContain(_ key: Key) -> Bool {
+            let indexes: [Int] = Filter.bitIndexes(for: key)
+            
+            return buckets.values.contains { bits in
+                indexes.allSatisfy { index in (bits[index / 64] & (1 << UInt64(index % 64))) != 0 }
+            }
+        }
+        
+        /// Remove any buckets which only contain receipts with a `serverExpirationTimestamp` at or before the provided
+        /// timestamp
+        ///
+        /// **Note:** This should only be called once the receipts have been deleted from the database, otherwise the filter
+        /// would return false negatives for them
+        mutating func removeExpired(before timestamp: TimeInterval) {
+            buckets = buckets.filter { bucket, _ in (TimeInterval(bucket + 1) * Filter.bucketDuration) > timestamp }
+        }
+        
+        /// Generate the bits for a key using double hashing (`h1 + (i * h2)`) so only a single hash needs to be calculated
+        private static func bitIndexes(for key: Key) -> [Int] {
+            let hash: UInt64 = UInt64(bitPattern: Int64(key.hashValue))
+            let h1: UInt64 = (hash & 0xFFFFFFFF)
+            let h2: UInt64 = ((hash >> 32) | 1)
+            
+            return (0..<UInt64(hashCount)).map { i in
+                Int((h1 &+ (i &* h2)) % UInt64(bitsPerBucket))
+            }
+        }
+    }
+    
+    /// The keys which might have a pending receipt, split by whether the transaction which inserted their interaction has committed
+    ///
+    /// **Note:** Matches which weren't applied before their transaction committed are still valid (the interaction and receipt
+    /// both exist) so they get applied by the next call to `applyPendingMatches`
+    internal struct Matches {
+        var committed: Set<Key> = []
+        var uncommitted: Set<Key> = []
+    }
+    
+    private static let filter: Atomic<Filter?> = Atomic(nil)
+    private static let pendingMatches: Atomic<Matches> = Atomic(Matches())
+    
+    // MARK: - Functions
+    
+    /// Add a newly stored `PendingReadReceipt` to the index
+    internal static func insert(_ pendingReadReceipt: PendingReadReceipt) {
+        // If the filter hasn't been loaded then the receipt will be included when it is
+        guard filter.wrappedValue != nil else { return }
+        
+        filter.mutate {
+            $0?.insert(
+                Key(threadId: pendingReadReceipt.threadId, interactionTimestampMs: pendingReadReceipt.interactionTimestampMs),
+                serverExpirationTimestamp: pendingReadReceipt.serverExpirationTimestamp
+            )
+        }
+    }
+    
+    /// Record that the garbage collection deleted the receipts which expired at or before `timestamp` so they can be dropped
+    /// from the filter once the transaction commits
+    internal static func expiredReceiptsRemoved(_ db: Database, before timestamp: TimeInterval) {
+        db.afterNextTransaction(
+            onCommit: { _ in filter.mutate { $0?.removeExpired(before: timestamp) } }
+        )
+    }
+    
+    /// Record that an outgoing interaction was inserted, if there might be a pending read receipt for it then it will be applied by
+    /// the next call to `applyPendingMatches`
+    internal static func interactionInserted(_ db: Database, threadId: String, timestampMs: Int64) {
+        let key: Key = Key(threadId: threadId, interactionTimestampMs: timestampMs)
+        
+        guard mightContain(db, key) else { return }
+        
+        let isFirstMatch: Bool = pendingMatches.mutate { pendingMatches -> Bool in
+            let isFirstMatch: Bool = pendingMatches.uncommitted.isEmpty
+            pendingMatches.uncommitted.insert(key)
+            
+            return isFirstMatch
+        }
+        
+        guard isFirstMatch else { return }
+        
+        db.afterNextTransaction(
+            onCommit: { _ in
+                pendingMatches.mutate { pendingMatches in
+                    pendingMatches.committed.formUnion(pendingMatches.uncommitted)
+                    pendingMatches.uncommitted = []
+                }
+            },
+            onRollback: { _ in pendingMatches.mutate { $0.uncommitted = [] } }
+        )
+    }
+    
+    /// Apply any pending read receipts which match the interactions recorded by `interactionInserted`
+    ///
+    /// **Note:** This should be called once a batch of messages has been processed (within the same transaction) so the
+    /// receipts are fetched, applied and deleted together rather than once per inserted interaction
+    internal static func applyPendingMatches(_ db: Database) throws {
+        let keys: Set<Key> = pendingMatches.mutate { pendingMatches -> Set<Key> in
+            let keys: Set<Key> = pendingMatches.committed.union(pendingMatches.uncommitted)
+            pendingMatches = Matches()
+            
+            return keys
+        }
+        
+        guard !keys.isEmpty else { return }
+        
+        let pendingReadReceipts: [PendingReadReceipt] = try PendingReadReceipt
+            .filter(Set(keys.map { $0.threadId }).contains(PendingReadReceipt.Columns.threadId))
+            .filter(Set(keys.map { $0.interactionTimestampMs }).contains(PendingReadReceipt.Columns.interactionTimestampMs))
+            .fetchAll(db)
+            .filter { keys.contains(Key(threadId: $0.threadId, interactionTimestampMs: $0.interactionTimestampMs)) }
+        
+        guard !pendingReadReceipts.isEmpty else { return }
+        
+        // Receipts from the same read receipt message share a 'readTimestampMs' (and a receive job only contains messages
+        // for a single thread) so generally this results in a single update
+        try pendingReadReceipts
+            .grouped(by: { "\($0.threadId)-\($0.readTimestampMs)" })
+            .values
+            .forEach { receipts in
+                guard let firstReceipt: PendingReadReceipt = receipts.first else { return }
+                
+                try Interaction.markAsRead(
+                    db,
+                    recipientId: firstReceipt.threadId,
+                    timestampMsValues: receipts.map { $0.interactionTimestampMs },
+                    readTimestampMs: firstReceipt.readTimestampMs
+                )
+            }
+        
+        try pendingReadReceipts
+            .grouped(by: \.threadId)
+            .forEach { threadId, receipts in
+                _ = try PendingReadReceipt
+                    .filter(PendingReadReceipt.Columns.threadId == threadId)
+                    .filter(receipts.map { $0.interactionTimestampMs }.contains(PendingReadReceipt.Columns.interactionTimestampMs))
+                    .deleteAll(db)
+            }
+    }
+    
+    // MARK: - Internal Functions
+    
+    private static func mightContain(_ db: Database, _ key: Key) -> Bool {
+        return filter.mutate { filter -> Bool in
+            guard filter != nil else {
+                filter = load(db)
+                return (filter?.mightContain(key) != false)
+            }
+            
+            return (filter?.mightContain(key) == true)
+        }
+    }
+    
+    private static func load(_ db: Database) -> Filter? {
+        guard
+            let rows: [Row] = try? PendingReadReceipt
+                .select(.threadId, .interactionTimestampMs, .serverExpirationTimestamp)
+                .asRequest(of: Row.self)
+                .fetchAll(db)
+        else { return nil }
+        
+        return rows.reduce(into: Filter()) { filter, row in
+            filter.insert(
+                Key(threadId: row[0], interactionTimestampMs: row[1]),
+                serverExpirationTimestamp: row[2]
+            )
+        }
+    }
+}
@@ -9,8 +9,23 @@ import SessionUtilitiesKit
 
 extension MessageReceiver {
     internal static func decryptWithSessionProtocol(ciphertext: Data, using x25519KeyPair: Box.KeyPair, dependencies: SMKDependencies = SMKDependencies()) throws -> (plaintext: Data, senderX25519PublicKey: String) {
-        let recipientX25519PrivateKey = x25519KeyPair.secretKey
-        let recipientX25519PublicKey = x25519KeyPair.publicKey
+        return try x25519KeyPair.secretKey.withUnsafeBytes { recipientX25519PrivateKey in
+            try decryptWithSessionProtocol(
+                ciphertext: ciphertext,
+                recipientX25519PublicKey: x25519KeyPair.publicKey,
+                recipientX25519PrivateKey: recipientX25519PrivateKey,
+                dependencies: dependencies
+            )
+        }
+    }
+    
+    /// **Note:** This takes the private key as a pointer so the user's key can be used directly from the `IdentityKeyCache`
+    internal static func decryptWithSessionProtocol(
+        ciphertext: Data,
+        recipientX25519PublicKey: Bytes,
+        recipientX25519PrivateKey: UnsafeRawBufferPointer,
+        dependencies: SMKDependencies = SMKDependencies()
+    ) throws -> (plaintext: Data, senderX25519PublicKey: String) {
         let signatureSize = dependencies.sign.Bytes
         let ed25519PublicKeySize = dependencies.sign.PublicKeyBytes
         
@@ -18,8 +33,8 @@ extension MessageReceiver {
         guard
             let plaintextWithMetadata = dependencies.box.open(
                 anonymousCipherText: Bytes(ciphertext),
-                recipientPublicKey: Box.PublicKey(Bytes(recipientX25519PublicKey)),
-                recipientSecretKey: Bytes(recipientX25519PrivateKey)
+                recipientPublicKey: Box.PublicKey(recipientX25519PublicKey),
+                recipientSecretKey: recipientX25519PrivateKey
             ),
             plaintextWithMetadata.count > (signatureSize + ed25519PublicKeySize)
         else {
@@ -58,7 +73,10 @@ extension MessageReceiver {
         else { throw MessageReceiverError.decryptionFailed }
 
         /// Step one: calculate the shared encryption key, receiving from A to B
-        let otherKeyBytes: Bytes = Data(hex: otherBlindedPublicKey.removingIdPrefixIfNeeded()).bytes
+        guard let otherKeyBytes: Bytes = Hex.decodedBytes(otherBlindedPublicKey.removingIdPrefixIfNeeded()) else {
+            throw MessageReceiverError.decryptionFailed
+        }
+        
         let kA: Bytes = (isOutgoing ? blindedKeyPair.publicKey : otherKeyBytes)
         guard let dec_key: Bytes = dependencies.sodium.sharedBlindedEncryptionKey(
             secretKey: userEd25519KeyPair.secretKey,
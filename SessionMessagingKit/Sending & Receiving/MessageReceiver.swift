@@ -40,11 +40,18 @@ public enum MessageReceiver {
                     // Default to 'standard' as the old code didn't seem to require an `envelope.source`
                     switch (SessionId.Prefix(from: envelope.source) ?? .standard) {
                         case .standard, .unblinded:
-                            guard let userX25519KeyPair: Box.KeyPair = Identity.fetchUserKeyPair(db) else {
-                                throw MessageReceiverError.noUserX25519KeyPair
-                            }
+                            guard
+                                let userX25519PublicKey: Data = Identity.fetchUserPublicKey(db),
+                                let result: (plaintext: Data, senderX25519PublicKey: String) = try Identity.withUserX25519SecretKey(db, { secretKey in
+                                    try decryptWithSessionProtocol(
+                                        ciphertext: ciphertext,
+                                        recipientX25519PublicKey: userX25519PublicKey.bytes,
+                                        recipientX25519PrivateKey: secretKey
+                                    )
+                                })
+                            else { throw MessageReceiverError.noUserX25519KeyPair }
                             
-                            (plaintext, sender) = try decryptWithSessionProtocol(ciphertext: ciphertext, using: userX25519KeyPair)
+                            (plaintext, sender) = result
                             
                         case .blinded:
                             guard let otherBlindedPublicKey: String = otherBlindedPublicKey else {
@@ -253,29 +260,44 @@ public enum MessageReceiver {
         }
     }
     
+    /// Replace the reactions for the provided open group messages (keyed by their server id) with the latest state from the server
+    ///
+    /// **Note:** The reactions for every message in a poll are replaced together using a single `DELETE` and multi-row `INSERT`
+    /// statements rather than a set of statements per message
     public static func handleOpenGroupReactions(
         _ db: Database,
         threadId: String,
-        openGroupMessageServerId: Int64,
-        openGroupReactions: [Reaction]
+        openGroupReactions: [Int64: [Reaction]]
     ) throws {
-        guard let interactionId: Int64 = try? Interaction
-            .select(.id)
+        guard !openGroupReactions.isEmpty else { return }
+        
+        let interactionIds: [Int64: Int64] = try Interaction
+            .select(.openGroupServerMessageId, .id)
             .filter(Interaction.Columns.threadId == threadId)
-            .filter(Interaction.Columns.openGroupServerMessageId == openGroupMessageServerId)
-            .asRequest(of: Int64.self)
-            .fetchOne(db)
-        else {
-            throw MessageReceiverError.invalidMessage
+            .filter(openGroupReactions.keys.contains(Interaction.Columns.openGroupServerMessageId))
+            .asRequest(of: Row.self)
+            .fetchAll(db)
+            .reduce(into: [:]) { result, row in
+                let serverId: Int64 = row[0]
+                result[serverId] = row[1]
+            }
+        
+        if interactionIds.count != openGroupReactions.count {
+            SNLog("Couldn't handle open group reactions for \(openGroupReactions.count - interactionIds.count) missing message(s).")
         }
         
+        guard !interactionIds.isEmpty else { return }
+        
         _ = try Reaction
-            .filter(Reaction.Columns.interactionId == interactionId)
+            .filter(interactionIds.values.contains(Reaction.Columns.interactionId))
             .deleteAll(db)
         
-        for reaction in openGroupReactions {
-            try reaction.with(interactionId: interactionId).insert(db)
-        }
+        try Reaction.insertAll(
+            db,
+            interactionIds.flatMap { serverId, interactionId -> [Reaction] in
+                (openGroupReactions[serverId] ?? []).map { $0.with(interactionId: interactionId) }
+            }
+        )
     }
     
     // MARK: - Convenience
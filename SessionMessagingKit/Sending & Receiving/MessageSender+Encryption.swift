@@ -10,18 +10,26 @@ extension MessageSender {
         for recipientHexEncodedX25519PublicKey: String,
         using dependencies: SMKDependencies = SMKDependencies()
     ) throws -> Data {
-        guard let userEd25519KeyPair: Box.KeyPair = dependencies.storage.read({ db in Identity.fetchUserEd25519KeyPair(db) }) else {
-            throw MessageSenderError.noUserED25519KeyPair
-        }
-        
         let recipientX25519PublicKey = Data(hex: recipientHexEncodedX25519PublicKey.removingIdPrefixIfNeeded())
         
-        let verificationData = plaintext + Data(userEd25519KeyPair.publicKey) + recipientX25519PublicKey
-        guard let signature = dependencies.sign.signature(message: Bytes(verificationData), secretKey: userEd25519KeyPair.secretKey) else {
-            throw MessageSenderError.signingFailed
+        // Sign using the secret key directly from the `IdentityKeyCache` to avoid copying it
+        let maybeSignatureInfo: (publicKey: Bytes, signature: Bytes?)? = dependencies.storage.read { db in
+            guard let userEd25519PublicKey: Bytes = Identity.fetchUserEd25519PublicKey(db) else { return nil }
+            
+            let verificationData = plaintext + Data(userEd25519PublicKey) + recipientX25519PublicKey
+            let signature: Bytes? = Identity.withUserEd25519SecretKey(db) { secretKey in
+                dependencies.sign.signature(message: Bytes(verificationData), secretKey: secretKey)
+            } ?? nil
+            
+            return (userEd25519PublicKey, signature)
+        }
+        
+        guard let signatureInfo: (publicKey: Bytes, signature: Bytes?) = maybeSignatureInfo else {
+            throw MessageSenderError.noUserED25519KeyPair
         }
+        guard let signature: Bytes = signatureInfo.signature else { throw MessageSenderError.signingFailed }
         
-        let plaintextWithMetadata = plaintext + Data(userEd25519KeyPair.publicKey) + Data(signature)
+        let plaintextWithMetadata = plaintext + Data(signatureInfo.publicKey) + Data(signature)
         guard let ciphertext = dependencies.box.seal(message: Bytes(plaintextWithMetadata), recipientPublicKey: Bytes(recipientX25519PublicKey)) else {
             throw MessageSenderError.encryptionFailed
         }
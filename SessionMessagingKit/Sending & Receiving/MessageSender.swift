@@ -182,7 +182,7 @@ public final class MessageSender {
         let wrappedMessage: Data
         do {
             wrappedMessage = try MessageWrapper.wrap(type: kind, timestamp: message.sentTimestamp!,
-                senderPublicKey: senderPublicKey, base64EncodedContent: ciphertext.base64EncodedString())
+                senderPublicKey: senderPublicKey, base64EncodedContent: Base64.encodedString(ciphertext))
         }
         catch {
             SNLog("Couldn't wrap message due to error: \(error).")
@@ -191,7 +191,7 @@ public final class MessageSender {
         }
         
         // Send the result
-        let base64EncodedData = wrappedMessage.base64EncodedString()
+        let base64EncodedData = Base64.encodedString(wrappedMessage)
 
         let snodeMessage = SnodeMessage(
             recipient: message.recipient!,
@@ -0,0 +1,221 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionUtilitiesKit
+
+// MARK: - NotificationBatch
+
+/// A set of notifications which should be presented together, containing at most one entry per thread
+public struct NotificationBatch {
+    public struct ThreadInfo {
+        public let thread: SessionThread
+        public let isMessageRequest: Bool
+        
+        /// The interactions which should be notified for, ordered by when they were received
+        public let interactions: [Interaction]
+        public let threadName: String
+        public let senderName: String
+        public let previewText: String
+        public let currentUserBlindedPublicKey: String?
+        
+        /// Whether the notification should replace the grouped notification for the thread rather than being shown individually
+        public let shouldGroupNotifications: Bool
+        
+        /// The interaction the notification content should be generated from
+        public var latestInteraction: Interaction { interactions[interactions.count - 1] }
+        
+        /// The identifier the notification should be presented with
+        public var notificationIdentifier: String {
+            latestInteraction.notificationIdentifier(shouldGroupMessagesForThread: shouldGroupNotifications)
+        }
+    }
+    
+    public let threads: [ThreadInfo]
+    public let currentUserPublicKey: String
+    public let previewType: Preferences.NotificationPreviewType
+    public let defaultSound: Preferences.Sound
+}
+
+// MARK: - NotificationCoalescer
+
+/// The receive pipeline handles messages in batches (eg. `MessageReceiveJob` processes every message retrieved by a poll
+/// within a single write transaction) so rather than notifying for each interaction individually the `NotificationCoalescer`
+/// gathers them per thread and, once the transaction commits, resolves the data needed for the notifications with set-based
+/// reads and passes a single `NotificationBatch` to the `NotificationsProtocol`
+///
+/// **Note:** Write transactions are serial so only one batch can be pending at a time
+public enum NotificationCoalescer {
+    private struct PendingThread {
+        let thread: SessionThread
+        let isMessageRequest: Bool
+        var interactions: [Interaction]
+    }
+    
+    private struct PendingBatch {
+        var threadIds: [String] = []
+        var threads: [String: PendingThread] = [:]
+    }
+    
+    private static let pendingBatch: Atomic<PendingBatch> = Atomic(PendingBatch())
+    
+    /// The ids of the threads which currently have a grouped notification, once one has been shown any subsequent notifications
+    /// for the thread need to replace it (otherwise the user would see the same messages in both the grouped notification and
+    /// the individual ones)
+    private static let groupedNotificationThreadIds: Atomic<Set<String>> = Atomic([])
+    
+    // MARK: - Functions
+    
+    public static func add(_ db: Database, interaction: Interaction, in thread: SessionThread) {
+        let isMessageRequest: Bool = (
+            pendingBatch.wrappedValue.threads[thread.id]?.isMessageRequest ??
+            thread.isMessageRequest(db, includeNonVisible: true)
+        )
+        
+        // Ensure we should be showing a notification for the interaction (this needs to happen within
+        // the transaction as it can update the 'hasHiddenMessageRequests' setting)
+        guard thread.shouldShowNotification(db, for: interaction, isMessageRequest: isMessageRequest) else {
+            return
+        }
+        
+        let isFirstInBatch: Bool = pendingBatch.mutate { batch -> Bool in
+            let isFirstInBatch: Bool = batch.threadIds.isEmpty
+            
+            guard batch.threads[thread.id] == nil else {
+                batch.threads[thread.id]?.interactions.append(interaction)
+                return isFirstInBatch
+            }
+            
+            batch.threadIds.append(thread.id)
+            batch.threads[thread.id] = PendingThread(
+                thread: thread,
+                isMessageRequest: isMessageRequest,
+                interactions: [interaction]
+            )
+            return isFirstInBatch
+        }
+        
+        guard isFirstInBatch else { return }
+        
+        db.afterNextTransaction(
+            onCommit: { db in notifyPendingBatch(db) },
+            onRollback: { _ in pendingBatch.mutate { $0 = PendingBatch() } }
+        )
+    }
+    
+    /// Should be called when the notifications for the threads are removed so that subsequent notifications are shown individually
+    /// again
+    public static func groupedNotificationsRemoved(threadIds: [String]) {
+        groupedNotificationThreadIds.mutate { $0.subtract(threadIds) }
+    }
+    
+    public static func allGroupedNotificationsRemoved() {
+        groupedNotificationThreadIds.mutate { $0.removeAll() }
+    }
+    
+    /// Notifications for interactions from open groups, or when multiple messages were received for the thread within the batch,
+    /// are grouped into a single notification for the thread
+    ///
+    /// **Note:** This records the grouped notification so it should only be called when the notification is going to be presented
+    internal static func shouldGroupNotifications(
+        threadId: String,
+        threadVariant: SessionThread.Variant,
+        numberOfInteractions: Int
+    ) -> Bool {
+        return groupedNotificationThreadIds.mutate { threadIds -> Bool in
+            guard
+                threadVariant == .openGroup ||
+                numberOfInteractions > 1 ||
+                threadIds.contains(threadId)
+            else { return false }
+            
+            threadIds.insert(threadId)
+            return true
+        }
+    }
+    
+    private static func notifyPendingBatch(_ db: Database) {
+        let pendingThreads: [PendingThread] = pendingBatch.mutate { batch -> [PendingThread] in
+            let pendingThreads: [PendingThread] = batch.threadIds.compactMap { batch.threads[$0] }
+            batch = PendingBatch()
+            
+            return pendingThreads
+        }
+        
+        guard let batch: NotificationBatch = resolveBatch(db, for: pendingThreads) else { return }
+        
+        Environment.shared?.notificationsManager.wrappedValue?.notifyUser(for: batch)
+    }
+    
+    private static func resolveBatch(_ db: Database, for pendingThreads: [PendingThread]) -> NotificationBatch? {
+        guard !pendingThreads.isEmpty else { return nil }
+        
+        let threadIdsByVariant: [SessionThread.Variant: [String]] = pendingThreads
+            .grouped(by: \.thread.variant)
+            .mapValues { threads in threads.map { $0.thread.id } }
+        let senderIds: Set<String> = pendingThreads
+            .compactMap { $0.interactions.last?.authorId }
+            .asSet()
+        let profiles: [String: Profile] = (try? Profile
+            .filter(ids: senderIds)
+            .fetchAll(db))
+            .defaulting(to: [])
+            .reduce(into: [:]) { result, next in result[next.id] = next }
+        let closedGroupNames: [String: String] = (try? ClosedGroup
+            .filter(ids: (threadIdsByVariant[.closedGroup] ?? []))
+            .fetchAll(db))
+            .defaulting(to: [])
+            .reduce(into: [:]) { result, next in result[next.threadId] = next.name }
+        let openGroupNames: [String: String] = (try? OpenGroup
+            .filter(ids: (threadIdsByVariant[.openGroup] ?? []))
+            .fetchAll(db))
+            .defaulting(to: [])
+            .reduce(into: [:]) { result, next in result[next.threadId] = next.name }
+        
+        // Only open groups can have a blinded key (the derivation itself is cached by 'SessionThread')
+        let blindedPublicKeys: [String: String] = (threadIdsByVariant[.openGroup] ?? [])
+            .reduce(into: [:]) { result, threadId in
+                result[threadId] = SessionThread.getUserHexEncodedBlindedKey(
+                    db,
+                    threadId: threadId,
+                    threadVariant: .openGroup
+                )
+            }
+        
+        return NotificationBatch(
+            threads: pendingThreads.map { pendingThread in
+                let thread: SessionThread = pendingThread.thread
+                let latestInteraction: Interaction = pendingThread.interactions[pendingThread.interactions.count - 1]
+                
+                return NotificationBatch.ThreadInfo(
+                    thread: thread,
+                    isMessageRequest: pendingThread.isMessageRequest,
+                    interactions: pendingThread.interactions,
+                    threadName: SessionThread.displayName(
+                        threadId: thread.id,
+                        variant: thread.variant,
+                        closedGroupName: closedGroupNames[thread.id],
+                        openGroupName: openGroupNames[thread.id],
+                        profile: profiles[thread.id]
+                    ),
+                    senderName: (
+                        profiles[latestInteraction.authorId]?.displayName(for: thread.variant) ??
+                        latestInteraction.authorId
+                    ),
+                    previewText: latestInteraction.previewText(db),
+                    currentUserBlindedPublicKey: blindedPublicKeys[thread.id],
+                    shouldGroupNotifications: shouldGroupNotifications(
+                        threadId: thread.id,
+                        threadVariant: thread.variant,
+                        numberOfInteractions: pendingThread.interactions.count
+                    )
+                )
+            },
+            currentUserPublicKey: getUserHexEncodedPublicKey(db),
+            previewType: db[.preferencesNotificationPreviewType]
+                .defaulting(to: .defaultPreviewType),
+            defaultSound: db[.defaultNotificationSound]
+                .defaulting(to: Preferences.Sound.defaultNotificationSound)
+        )
+    }
+}
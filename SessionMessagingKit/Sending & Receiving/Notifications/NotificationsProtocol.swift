@@ -4,7 +4,7 @@ import Foundation
 import GRDB
 
 public protocol NotificationsProtocol {
-    func notifyUser(_ db: Database, for interaction: Interaction, in thread: SessionThread)
+    func notifyUser(for batch: NotificationBatch)
     func notifyUser(_ db: Database, forIncomingCall interaction: Interaction, in thread: SessionThread)
     func notifyUser(_ db: Database, forReaction reaction: Reaction, in thread: SessionThread)
     func cancelNotifications(identifiers: [String])
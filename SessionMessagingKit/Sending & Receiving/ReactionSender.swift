@@ -0,0 +1,320 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import PromiseKit
+import SessionUtilitiesKit
+
+/// The `ReactionSender` batches the reactions the current user adds and removes in open groups so rapidly tapping reactions doesn't
+/// result in a separate network request for each tap
+///
+/// The caller updates the database and enqueues the change within the same write transaction (so the UI reflects the change straight
+/// away), open group changes are registered with the `OpenGroupManager` as pending changes immediately (so a poll which happens before
+/// they are sent doesn't revert them) and once no further changes have been queued for `debounceInterval` all of the pending changes
+/// are sent together in a single `/batch` request per room
+///
+/// **Note:** Changes for the same emoji on the same message are collapsed (the latest change wins and an add followed by a remove
+/// cancels out entirely) so only the net change is ever sent, one-to-one and closed group reactions are sent as messages so the
+/// `MessageSendJob` for them is persisted in the same transaction as the local change rather than being held in memory
+public enum ReactionSender {
+    public struct Change {
+        public let threadId: String
+        public let interactionId: Int64
+        public let emoji: String
+        public let remove: Bool
+        public let sentTimestampMs: Int64
+        
+        /// The reaction which was inserted (or deleted) locally, this is used to revert the local change if it fails to send
+        public let reaction: Reaction?
+        
+        /// The open group room and message the change should be sent to
+        internal let openGroup: OpenGroup?
+        internal let openGroupServerMessageId: Int64?
+        
+        /// The change registered with the `OpenGroupManager` when this change was enqueued
+        internal let pendingChange: OpenGroupAPI.PendingChange?
+        
+        public init(
+            threadId: String,
+            interactionId: Int64,
+            emoji: String,
+            remove: Bool,
+            sentTimestampMs: Int64,
+            reaction: Reaction?
+        ) {
+            self.init(
+                threadId: threadId,
+                interactionId: interactionId,
+                emoji: emoji,
+                remove: remove,
+                sentTimestampMs: sentTimestampMs,
+                reaction: reaction,
+                openGroup: nil,
+                openGroupServerMessageId: nil,
+                pendingChange: nil
+            )
+        }
+        
+        internal init(
+            threadId: String,
+            interactionId: Int64,
+            emoji: String,
+            remove: Bool,
+            sentTimestampMs: Int64,
+            reaction: Reaction?,
+            openGroup: OpenGroup?,
+            openGroupServerMessageId: Int64?,
+            pendingChange: OpenGroupAPI.PendingChange?
+        ) {
+            self.threadId = threadId
+            self.interactionId = interactionId
+            self.emoji = emoji
+            self.remove = remove
+            self.sentTimestampMs = sentTimestampMs
+            self.reaction = reaction
+            self.openGroup = openGroup
+            self.openGroupServerMessageId = openGroupServerMessageId
+            self.pendingChange = pendingChange
+        }
+        
+        fileprivate func with(
+            openGroup: OpenGroup,
+            openGroupServerMessageId: Int64,
+            pendingChange: OpenGroupAPI.PendingChange
+        ) -> Change {
+            return Change(
+                threadId: threadId,
+                interactionId: interactionId,
+                emoji: emoji,
+                remove: remove,
+                sentTimestampMs: sentTimestampMs,
+                reaction: reaction,
+                openGroup: openGroup,
+                openGroupServerMessageId: openGroupServerMessageId,
+                pendingChange: pendingChange
+            )
+        }
+        
+        fileprivate func isSameReaction(as other: Change) -> Bool {
+            return (
+                threadId == other.threadId &&
+                interactionId == other.interactionId &&
+                emoji == other.emoji
+            )
+        }
+    }
+    
+    public static let debounceInterval: DispatchTimeInterval = .milliseconds(750)
+    
+    private static let queue: DispatchQueue = DispatchQueue(label: "ReactionSender.queue", qos: .userInitiated)
+    private static let pendingChanges: Atomic<[Change]> = Atomic([])
+    private static let scheduledFlush: Atomic<DispatchWorkItem?> = Atomic(nil)
+    
+    // MARK: - Functions
+    
+    /// Send a change which has just been written to the database within the same transaction, open group changes are queued to be
+    /// sent once the transaction is committed and the user stops reacting, all other changes are scheduled as a `MessageSendJob`
+    /// immediately
+    public static func enqueue(
+        _ db: Database,
+        _ change: Change,
+        using dependencies: OGMDependencies = OGMDependencies()
+    ) throws {
+        guard let thread: SessionThread = try SessionThread.fetchOne(db, id: change.threadId) else { return }
+        
+        guard
+            thread.variant == .openGroup,
+            let openGroup: OpenGroup = try OpenGroup.fetchOne(db, id: change.threadId),
+            OpenGroupManager.isOpenGroupSupport(.reactions, on: openGroup.server, using: dependencies)
+        else {
+            guard let interaction: Interaction = try Interaction.fetchOne(db, id: change.interactionId) else { return }
+            
+            try MessageSender.send(
+                db,
+                message: VisibleMessage(
+                    sentTimestamp: UInt64(change.sentTimestampMs),
+                    text: nil,
+                    reaction: VisibleMessage.VMReaction(
+                        timestamp: UInt64(interaction.timestampMs),
+                        publicKey: interaction.authorId,
+                        emoji: change.emoji,
+                        kind: (change.remove ? .remove : .react)
+                    )
+                ),
+                interactionId: change.interactionId,
+                in: thread
+            )
+            return
+        }
+        guard
+            let openGroupServerMessageId: Int64 = try Interaction
+                .select(.openGroupServerMessageId)
+                .filter(id: change.interactionId)
+                .asRequest(of: Int64.self)
+                .fetchOne(db)
+        else { return }
+        
+        // Only queue the change once the transaction has been committed (if it was rolled back then the reaction was never
+        // stored so shouldn't be sent or shown as pending)
+        db.afterNextTransaction(onCommit: { _ in
+            let pendingChange: OpenGroupAPI.PendingChange = OpenGroupManager.addPendingReaction(
+                emoji: change.emoji,
+                id: openGroupServerMessageId,
+                in: openGroup.roomToken,
+                on: openGroup.server,
+                type: (change.remove ? .remove : .add),
+                using: dependencies
+            )
+            let openGroupChange: Change = change.with(
+                openGroup: openGroup,
+                openGroupServerMessageId: openGroupServerMessageId,
+                pendingChange: pendingChange
+            )
+            let cancelledChanges: [Change] = pendingChanges.mutate { pendingChanges -> [Change] in
+                let result: (changes: [Change], cancelled: [Change]) = ReactionSender.collapse(
+                    pendingChanges,
+                    adding: openGroupChange
+                )
+                pendingChanges = result.changes
+                
+                return result.cancelled
+            }
+            
+            // Changes which were cancelled out will never be sent so they shouldn't be pending anymore
+            cancelledChanges
+                .compactMap { $0.pendingChange }
+                .forEach { OpenGroupManager.removePendingChange($0, using: dependencies) }
+            
+            let workItem: DispatchWorkItem = DispatchWorkItem { ReactionSender.flush() }
+            scheduledFlush.mutate {
+                $0?.cancel()
+                $0 = workItem
+            }
+            queue.asyncAfter(deadline: .now() + debounceInterval, execute: workItem)
+        })
+    }
+    
+    /// Send any pending changes immediately (eg. when leaving the conversation or going into the background)
+    public static func flush() {
+        scheduledFlush.mutate {
+            $0?.cancel()
+            $0 = nil
+        }
+        
+        let changes: [Change] = pendingChanges.mutate { pendingChanges in
+            let result: [Change] = pendingChanges
+            pendingChanges = []
+            
+            return result
+        }
+        
+        guard !changes.isEmpty else { return }
+        
+        // This can be called from the main thread so perform the read on the background queue
+        queue.async {
+            Storage.shared.read { db in
+                changes.grouped(by: { $0.threadId }).forEach { _, threadChanges in
+                    guard let openGroup: OpenGroup = threadChanges.first?.openGroup else { return }
+                    
+                    send(db, threadChanges, to: openGroup)
+                }
+            }
+        }
+    }
+    
+    // MARK: - Internal Functions
+    
+    /// Add a change to the pending changes, replacing (or cancelling out) any pending change for the same reaction, the `cancelled`
+    /// changes are the ones which will no longer be sent
+    internal static func collapse(_ changes: [Change], adding change: Change) -> (changes: [Change], cancelled: [Change]) {
+        guard let existingIndex: Int = changes.firstIndex(where: { $0.isSameReaction(as: change) }) else {
+            return (changes.appending(change), [])
+        }
+        
+        var updatedChanges: [Change] = changes
+        let existingChange: Change = changes[existingIndex]
+        
+        // If the change is the opposite of the pending one then neither needs to be sent
+        guard existingChange.remove == change.remove else {
+            updatedChanges.remove(at: existingIndex)
+            return (updatedChanges, [existingChange, change])
+        }
+        
+        updatedChanges[existingIndex] = change
+        return (updatedChanges, [existingChange])
+    }
+    
+    private static func send(_ db: Database, _ changes: [Change], to openGroup: OpenGroup) {
+        let serverChanges: [(change: Change, serverId: Int64, pendingChange: OpenGroupAPI.PendingChange)] = changes
+            .compactMap { change in
+                guard
+                    let serverId: Int64 = change.openGroupServerMessageId,
+                    let pendingChange: OpenGroupAPI.PendingChange = change.pendingChange
+                else { return nil }
+                
+                return (change, serverId, pendingChange)
+            }
+        
+        guard !serverChanges.isEmpty else { return }
+        
+        OpenGroupAPI
+            .reactionChanges(
+                db,
+                serverChanges.map { change, serverId, _ in (change.emoji, serverId, change.remove) },
+                in: openGroup.roomToken,
+                on: openGroup.server
+            )
+            .done { response in
+                var failedChanges: [Change] = []
+                
+                serverChanges.forEach { serverChange in
+                    let subResponse: Codable? = serverChange.change.emoji
+                        .addingPercentEncoding(withAllowedCharacters: .urlPathAllowed)
+                        .flatMap { encodedEmoji in
+                            response[.reaction(openGroup.roomToken, id: serverChange.serverId, emoji: encodedEmoji)]?.1
+                        }
+                    
+                    switch subResponse {
+                        case let subResponse as OpenGroupAPI.BatchSubResponse<OpenGroupAPI.ReactionAddResponse> where subResponse.body != nil:
+                            OpenGroupManager.updatePendingChange(serverChange.pendingChange, seqNo: subResponse.body?.seqNo)
+                        
+                        case let subResponse as OpenGroupAPI.BatchSubResponse<OpenGroupAPI.ReactionRemoveResponse> where subResponse.body != nil:
+                            OpenGroupManager.updatePendingChange(serverChange.pendingChange, seqNo: subResponse.body?.seqNo)
+                        
+                        default:
+                            OpenGroupManager.removePendingChange(serverChange.pendingChange)
+                            failedChanges.append(serverChange.change)
+                    }
+                }
+                
+                revert(failedChanges)
+            }
+            .catch { _ in
+                serverChanges.forEach { OpenGroupManager.removePendingChange($0.pendingChange) }
+                revert(serverChanges.map { $0.change })
+            }
+            .retainUntilComplete()
+    }
+    
+    /// Reverse the local changes for reactions which failed to send
+    private static func revert(_ changes: [Change]) {
+        guard changes.contains(where: { $0.reaction != nil }) else { return }
+        
+        Storage.shared.writeAsync { db in
+            try changes.forEach { change in
+                guard let reaction: Reaction = change.reaction else { return }
+                
+                guard !change.remove else {
+                    try reaction.insert(db)
+                    return
+                }
+                
+                _ = try Reaction
+                    .filter(Reaction.Columns.interactionId == reaction.interactionId)
+                    .filter(Reaction.Columns.authorId == reaction.authorId)
+                    .filter(Reaction.Columns.emoji == reaction.emoji)
+                    .deleteAll(db)
+            }
+        }
+    }
+}
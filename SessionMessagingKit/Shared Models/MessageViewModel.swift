@@ -8,6 +8,7 @@ import SessionUtilitiesKit
 
 fileprivate typealias ViewModel = MessageViewModel
 fileprivate typealias AttachmentInteractionInfo = MessageViewModel.AttachmentInteractionInfo
+fileprivate typealias QuoteAttachmentInfo = MessageViewModel.QuoteAttachmentInfo
 fileprivate typealias ReactionInfo = MessageViewModel.ReactionInfo
 fileprivate typealias TypingIndicatorInfo = MessageViewModel.TypingIndicatorInfo
 
@@ -28,7 +29,6 @@ public struct MessageViewModel: FetchableRecordWithRowId, Decodable, Equatable,
     public static let isSenderOpenGroupModeratorKey: SQL = SQL(stringLiteral: CodingKeys.isSenderOpenGroupModerator.stringValue)
     public static let profileKey: SQL = SQL(stringLiteral: CodingKeys.profile.stringValue)
     public static let quoteKey: SQL = SQL(stringLiteral: CodingKeys.quote.stringValue)
-    public static let quoteAttachmentKey: SQL = SQL(stringLiteral: CodingKeys.quoteAttachment.stringValue)
     public static let linkPreviewKey: SQL = SQL(stringLiteral: CodingKeys.linkPreview.stringValue)
     public static let linkPreviewAttachmentKey: SQL = SQL(stringLiteral: CodingKeys.linkPreviewAttachment.stringValue)
     public static let currentUserPublicKeyKey: SQL = SQL(stringLiteral: CodingKeys.currentUserPublicKey.stringValue)
@@ -43,7 +43,6 @@ public struct MessageViewModel: FetchableRecordWithRowId, Decodable, Equatable,
     
     public static let profileString: String = CodingKeys.profile.stringValue
     public static let quoteString: String = CodingKeys.quote.stringValue
-    public static let quoteAttachmentString: String = CodingKeys.quoteAttachment.stringValue
     public static let linkPreviewString: String = CodingKeys.linkPreview.stringValue
     public static let linkPreviewAttachmentString: String = CodingKeys.linkPreviewAttachment.stringValue
     
@@ -89,6 +88,8 @@ public struct MessageViewModel: FetchableRecordWithRowId, Decodable, Equatable,
     public let isTypingIndicator: Bool?
     public let profile: Profile?
     public let quote: Quote?
+    
+    /// This value is populated by the `QuoteAttachmentInfo` associated record rather than the main query
     public let quoteAttachment: Attachment?
     public let linkPreview: LinkPreview?
     public let linkPreviewAttachment: Attachment?
@@ -154,6 +155,7 @@ public struct MessageViewModel: FetchableRecordWithRowId, Decodable, Equatable,
     
     public func with(
         attachments: Updatable<[Attachment]> = .existing,
+        quoteAttachment: Updatable<Attachment> = .existing,
         reactionInfo: Updatable<[ReactionInfo]> = .existing
     ) -> MessageViewModel {
         return MessageViewModel(
@@ -182,7 +184,7 @@ public struct MessageViewModel: FetchableRecordWithRowId, Decodable, Equatable,
             isTypingIndicator: self.isTypingIndicator,
             profile: self.profile,
             quote: self.quote,
-            quoteAttachment: self.quoteAttachment,
+            quoteAttachment: (quoteAttachment ?? self.quoteAttachment),
             linkPreview: self.linkPreview,
             linkPreviewAttachment: self.linkPreviewAttachment,
             currentUserPublicKey: self.currentUserPublicKey,
@@ -449,6 +451,29 @@ public extension MessageViewModel {
     }
 }
 
+// MARK: - QuoteAttachmentInfo
+
+public extension MessageViewModel {
+    struct QuoteAttachmentInfo: FetchableRecordWithRowId, Decodable, Identifiable, Equatable {
+        public static let rowIdKey: SQL = SQL(stringLiteral: CodingKeys.rowId.stringValue)
+        public static let interactionIdKey: SQL = SQL(stringLiteral: CodingKeys.interactionId.stringValue)
+        public static let attachmentKey: SQL = SQL(stringLiteral: CodingKeys.attachment.stringValue)
+        
+        public static let attachmentString: String = CodingKeys.attachment.stringValue
+        
+        /// The `rowId` of the `Quote`
+        public let rowId: Int64
+        
+        /// The id of the interaction which contains the quote
+        public let interactionId: Int64
+        public let attachment: Attachment
+        
+        // MARK: - Identifiable
+        
+        public var id: Int64 { interactionId }
+    }
+}
+
 // MARK: - ReactionInfo
 
 public extension MessageViewModel {
@@ -637,7 +662,6 @@ public extension MessageViewModel {
     
     static func baseQuery(
         userPublicKey: String,
-        blindedPublicKey: String?,
         orderSQL: SQL,
         groupSQL: SQL?
     ) -> (([Int64]) -> AdaptedFetchRequest<SQLRequest<MessageViewModel>>) {
@@ -655,7 +679,6 @@ public extension MessageViewModel {
             
             let threadProfile: SQL = SQL(stringLiteral: "threadProfile")
             let quoteInteraction: SQL = SQL(stringLiteral: "quoteInteraction")
-            let quoteInteractionAttachment: SQL = SQL(stringLiteral: "quoteInteractionAttachment")
             let readReceipt: SQL = SQL(stringLiteral: "readReceipt")
             let idColumn: SQL = SQL(stringLiteral: Interaction.Columns.id.name)
             let interactionBodyColumn: SQL = SQL(stringLiteral: Interaction.Columns.body.name)
@@ -663,15 +686,9 @@ public extension MessageViewModel {
             let nicknameColumn: SQL = SQL(stringLiteral: Profile.Columns.nickname.name)
             let nameColumn: SQL = SQL(stringLiteral: Profile.Columns.name.name)
             let quoteBodyColumn: SQL = SQL(stringLiteral: Quote.Columns.body.name)
-            let quoteAttachmentIdColumn: SQL = SQL(stringLiteral: Quote.Columns.attachmentId.name)
             let readReceiptInteractionIdColumn: SQL = SQL(stringLiteral: RecipientState.Columns.interactionId.name)
             let readTimestampMsColumn: SQL = SQL(stringLiteral: RecipientState.Columns.readTimestampMs.name)
-            let timestampMsColumn: SQL = SQL(stringLiteral: Interaction.Columns.timestampMs.name)
-            let authorIdColumn: SQL = SQL(stringLiteral: Interaction.Columns.authorId.name)
             let attachmentIdColumn: SQL = SQL(stringLiteral: Attachment.Columns.id.name)
-            let interactionAttachmentInteractionIdColumn: SQL = SQL(stringLiteral: InteractionAttachment.Columns.interactionId.name)
-            let interactionAttachmentAttachmentIdColumn: SQL = SQL(stringLiteral: InteractionAttachment.Columns.attachmentId.name)
-            let interactionAttachmentAlbumIndexColumn: SQL = SQL(stringLiteral: InteractionAttachment.Columns.albumIndex.name)
             
             let numColumnsBeforeLinkedRecords: Int = 21
             let finalGroupSQL: SQL = (groupSQL ?? "")
@@ -719,8 +736,8 @@ public extension MessageViewModel {
                     \(quote[.authorId]),
                     \(quote[.timestampMs]),
                     \(quoteInteraction).\(interactionBodyColumn) AS \(quoteBodyColumn),
-                    \(quoteInteractionAttachment).\(interactionAttachmentAttachmentIdColumn) AS \(quoteAttachmentIdColumn),
-                    \(ViewModel.quoteAttachmentKey).*,
+                    \(quote[.attachmentId]),
+                    \(quote[.originalInteractionId]),
                     \(ViewModel.linkPreviewKey).*,
                     \(ViewModel.linkPreviewAttachmentKey).*,
                     
@@ -745,21 +762,7 @@ public extension MessageViewModel {
                 LEFT JOIN \(OpenGroup.self) ON \(openGroup[.threadId]) = \(interaction[.threadId])
                 LEFT JOIN \(Profile.self) ON \(profile[.id]) = \(interaction[.authorId])
                 LEFT JOIN \(Quote.self) ON \(quote[.interactionId]) = \(interaction[.id])
-                LEFT JOIN \(Interaction.self) AS \(quoteInteraction) ON (
-                    \(quoteInteraction).\(timestampMsColumn) = \(quote[.timestampMs]) AND (
-                        \(quoteInteraction).\(authorIdColumn) = \(quote[.authorId]) OR (
-                            -- A users outgoing message is stored in some cases using their standard id
-                            -- but the quote will use their blinded id so handle that case
-                            \(quote[.authorId]) = \(blindedPublicKey ?? "''") AND
-                            \(quoteInteraction).\(authorIdColumn) = \(userPublicKey)
-                        )
-                    )
-                )
-                LEFT JOIN \(InteractionAttachment.self) AS \(quoteInteractionAttachment) ON (
-                    \(quoteInteractionAttachment).\(interactionAttachmentInteractionIdColumn) = \(quoteInteraction).\(idColumn) AND
-                    \(quoteInteractionAttachment).\(interactionAttachmentAlbumIndexColumn) = 0
-                )
-                LEFT JOIN \(Attachment.self) AS \(ViewModel.quoteAttachmentKey) ON \(ViewModel.quoteAttachmentKey).\(attachmentIdColumn) = \(quoteInteractionAttachment).\(interactionAttachmentAttachmentIdColumn)
+                LEFT JOIN \(Interaction.self) AS \(quoteInteraction) ON \(quoteInteraction).\(idColumn) = \(quote[.originalInteractionId])
             
                 LEFT JOIN \(LinkPreview.self) ON (
                     \(linkPreview[.url]) = \(interaction[.linkPreviewUrl]) AND
@@ -785,7 +788,6 @@ public extension MessageViewModel {
                     numColumnsBeforeLinkedRecords,
                     Profile.numberOfSelectedColumns(db),
                     Quote.numberOfSelectedColumns(db),
-                    Attachment.numberOfSelectedColumns(db),
                     LinkPreview.numberOfSelectedColumns(db),
                     Attachment.numberOfSelectedColumns(db)
                 ])
@@ -793,9 +795,8 @@ public extension MessageViewModel {
                 return ScopeAdapter([
                     ViewModel.profileString: adapters[1],
                     ViewModel.quoteString: adapters[2],
-                    ViewModel.quoteAttachmentString: adapters[3],
-                    ViewModel.linkPreviewString: adapters[4],
-                    ViewModel.linkPreviewAttachmentString: adapters[5]
+                    ViewModel.linkPreviewString: adapters[3],
+                    ViewModel.linkPreviewAttachmentString: adapters[4]
                 ])
             }
         }
@@ -885,6 +886,131 @@ public extension MessageViewModel.AttachmentInteractionInfo {
     }
 }
 
+// MARK: --QuoteAttachmentInfo
+
+public extension MessageViewModel.QuoteAttachmentInfo {
+    static let baseQuery: ((SQL?) -> AdaptedFetchRequest<SQLRequest<MessageViewModel.QuoteAttachmentInfo>>) = {
+        return { additionalFilters -> AdaptedFetchRequest<SQLRequest<QuoteAttachmentInfo>> in
+            let quote: TypedTableAlias<Quote> = TypedTableAlias()
+            let interactionAttachment: TypedTableAlias<InteractionAttachment> = TypedTableAlias()
+            let attachmentIdColumn: SQL = SQL(stringLiteral: Attachment.Columns.id.name)
+            
+            /// **Note:** The `additionalFilters` reference the unqualified `rowid` so we need to apply them in a sub-query
+            /// which only contains the `Quote` table
+            let finalFilterSQL: SQL = {
+                guard let additionalFilters: SQL = additionalFilters else {
+                    return SQL(stringLiteral: "")
+                }
+                
+                return """
+                    WHERE \(quote.alias[Column.rowID]) IN (
+                        SELECT \(Column.rowID)
+                        FROM \(Quote.self)
+                        WHERE \(additionalFilters)
+                    )
+                """
+            }()
+            let numColumnsBeforeLinkedRecords: Int = 2
+            let request: SQLRequest<QuoteAttachmentInfo> = """
+                SELECT
+                    \(quote.alias[Column.rowID]) AS \(QuoteAttachmentInfo.rowIdKey),
+                    \(quote[.interactionId]) AS \(QuoteAttachmentInfo.interactionIdKey),
+                    \(QuoteAttachmentInfo.attachmentKey).*
+                FROM \(Quote.self)
+                JOIN \(InteractionAttachment.self) ON (
+                    \(interactionAttachment[.interactionId]) = \(quote[.originalInteractionId]) AND
+                    \(interactionAttachment[.albumIndex]) = 0
+                )
+                JOIN \(Attachment.self) AS \(QuoteAttachmentInfo.attachmentKey) ON \(QuoteAttachmentInfo.attachmentKey).\(attachmentIdColumn) = \(interactionAttachment[.attachmentId])
+                \(finalFilterSQL)
+            """
+            
+            return request.adapted { db in
+                let adapters = try splittingRowAdapters(columnCounts: [
+                    numColumnsBeforeLinkedRecords,
+                    Attachment.numberOfSelectedColumns(db)
+                ])
+                
+                return ScopeAdapter([
+                    QuoteAttachmentInfo.attachmentString: adapters[1]
+                ])
+            }
+        }
+    }()
+    
+    static var joinToViewModelQuerySQL: SQL = {
+        let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
+        let quote: TypedTableAlias<Quote> = TypedTableAlias()
+        
+        return """
+            JOIN \(Quote.self) ON \(quote[.interactionId]) = \(interaction[.id])
+        """
+    }()
+    
+    /// The quote attachment comes from the quoted interaction so changes to it's `InteractionAttachment` need to be mapped
+    /// back to the interaction containing the quote
+    static var joinInteractionAttachmentToViewModelQuerySQL: SQL = {
+        let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
+        let quote: TypedTableAlias<Quote> = TypedTableAlias()
+        let interactionAttachment: TypedTableAlias<InteractionAttachment> = TypedTableAlias()
+        
+        return """
+            JOIN \(Quote.self) ON \(quote[.interactionId]) = \(interaction[.id])
+            JOIN \(InteractionAttachment.self) ON (
+                \(interactionAttachment[.interactionId]) = \(quote[.originalInteractionId]) AND
+                \(interactionAttachment[.albumIndex]) = 0
+            )
+        """
+    }()
+    
+    /// The quote attachment comes from the quoted interaction so changes to the `Attachment` need to be mapped back to the
+    /// interaction containing the quote
+    static var joinAttachmentToViewModelQuerySQL: SQL = {
+        let interactionAttachment: TypedTableAlias<InteractionAttachment> = TypedTableAlias()
+        let attachment: TypedTableAlias<Attachment> = TypedTableAlias()
+        
+        return """
+            \(joinInteractionAttachmentToViewModelQuerySQL)
+            JOIN \(Attachment.self) ON \(attachment[.id]) = \(interactionAttachment[.attachmentId])
+        """
+    }()
+    
+    static func createAssociateDataClosure() -> (DataCache<MessageViewModel.QuoteAttachmentInfo>, DataCache<MessageViewModel>) -> DataCache<MessageViewModel> {
+        return { dataCache, pagedDataCache -> DataCache<MessageViewModel> in
+            var updatedPagedDataCache: DataCache<MessageViewModel> = pagedDataCache
+            var pagedRowIdsWithNoQuoteAttachment: Set<Int64> = Set(pagedDataCache.data.keys)
+            
+            // Add any new quote attachments
+            dataCache
+                .values
+                .forEach { quoteAttachmentInfo in
+                    guard
+                        let interactionRowId: Int64 = updatedPagedDataCache.lookup[quoteAttachmentInfo.interactionId],
+                        let dataToUpdate: ViewModel = updatedPagedDataCache.data[interactionRowId]
+                    else { return }
+                    
+                    pagedRowIdsWithNoQuoteAttachment.remove(interactionRowId)
+                    
+                    guard dataToUpdate.quoteAttachment != quoteAttachmentInfo.attachment else { return }
+                    
+                    updatedPagedDataCache = updatedPagedDataCache.upserting(
+                        dataToUpdate.with(quoteAttachment: .update(quoteAttachmentInfo.attachment))
+                    )
+                }
+            
+            // Remove any removed quote attachments
+            updatedPagedDataCache = updatedPagedDataCache.upserting(
+                items: pagedRowIdsWithNoQuoteAttachment
+                    .compactMap { rowId -> ViewModel? in updatedPagedDataCache.data[rowId] }
+                    .filter { viewModel -> Bool in viewModel.quoteAttachment != nil }
+                    .map { viewModel -> ViewModel in viewModel.with(quoteAttachment: nil) }
+            )
+            
+            return updatedPagedDataCache
+        }
+    }
+}
+
 // MARK: --ReactionInfo
 
 public extension MessageViewModel.ReactionInfo {
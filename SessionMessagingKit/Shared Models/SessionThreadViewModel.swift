@@ -313,6 +313,7 @@ public extension SessionThreadViewModel {
 
 public extension SessionThreadViewModel {
     func with(
+        interactionState: InteractionState? = nil,
         recentReactionEmoji: [String]? = nil
     ) -> SessionThreadViewModel {
         return SessionThreadViewModel(
@@ -331,7 +332,10 @@ public extension SessionThreadViewModel {
             threadOnlyNotifyForMentions: self.threadOnlyNotifyForMentions,
             threadMessageDraft: self.threadMessageDraft,
             threadContactIsTyping: self.threadContactIsTyping,
-            threadUnreadCount: self.threadUnreadCount,
+            threadUnreadCount: (interactionState != nil ?
+                interactionState?.threadUnreadCount :
+                self.threadUnreadCount
+            ),
             threadUnreadMentionCount: self.threadUnreadMentionCount,
             contactProfile: self.contactProfile,
             closedGroupProfileFront: self.closedGroupProfileFront,
@@ -348,7 +352,10 @@ public extension SessionThreadViewModel {
             openGroupProfilePictureData: self.openGroupProfilePictureData,
             openGroupUserCount: self.openGroupUserCount,
             openGroupPermissions: self.openGroupPermissions,
-            interactionId: self.interactionId,
+            interactionId: (interactionState != nil ?
+                interactionState?.interactionId :
+                self.interactionId
+            ),
             interactionVariant: self.interactionVariant,
             interactionTimestampMs: self.interactionTimestampMs,
             interactionBody: self.interactionBody,
@@ -736,18 +743,24 @@ public extension SessionThreadViewModel {
 // MARK: - ConversationVC
 
 public extension SessionThreadViewModel {
-    /// **Note:** This query **will** include deleted incoming messages in it's unread count (they should never be marked as unread
-    /// but including this warning just in case there is a discrepancy)
+    /// This type contains the values of the `SessionThreadViewModel` which are derived from the `Interaction` table, these
+    /// are retrieved separately from the `conversationQuery` so that new messages don't result in the entire header being
+    /// recomputed
+    struct InteractionState: Decodable, Equatable, FetchableRecord {
+        public let interactionId: Int64?
+        public let threadUnreadCount: UInt?
+    }
+    
+    /// This query retrieves the thread info displayed in the conversation header, it intentionally **doesn't** include any
+    /// `Interaction` data (see `conversationInteractionStateQuery`) so that the observed region doesn't include the
+    /// `Interaction` table
     static func conversationQuery(threadId: String, userPublicKey: String) -> AdaptedFetchRequest<SQLRequest<SessionThreadViewModel>> {
         let thread: TypedTableAlias<SessionThread> = TypedTableAlias()
         let contact: TypedTableAlias<Contact> = TypedTableAlias()
         let closedGroup: TypedTableAlias<ClosedGroup> = TypedTableAlias()
         let groupMember: TypedTableAlias<GroupMember> = TypedTableAlias()
         let openGroup: TypedTableAlias<OpenGroup> = TypedTableAlias()
-        let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
         
-        let aggregateInteractionLiteral: SQL = SQL(stringLiteral: "aggregateInteraction")
-        let timestampMsColumnLiteral: SQL = SQL(stringLiteral: Interaction.Columns.timestampMs.name)
         let closedGroupUserCountTableLiteral: SQL = SQL(stringLiteral: "\(ViewModel.closedGroupUserCountString)_table")
         let groupMemberGroupIdColumnLiteral: SQL = SQL(stringLiteral: GroupMember.Columns.groupId.name)
         let profileIdColumnLiteral: SQL = SQL(stringLiteral: Profile.Columns.id.name)
@@ -757,7 +770,7 @@ public extension SessionThreadViewModel {
         /// parse and might throw
         ///
         /// Explicitly set default values for the fields ignored for search results
-        let numColumnsBeforeProfiles: Int = 14
+        let numColumnsBeforeProfiles: Int = 13
         let request: SQLRequest<ViewModel> = """
             SELECT
                 \(thread.alias[Column.rowID]) AS \(ViewModel.rowIdKey),
@@ -782,8 +795,6 @@ public extension SessionThreadViewModel {
                 \(thread[.mutedUntilTimestamp]) AS \(ViewModel.threadMutedUntilTimestampKey),
                 \(thread[.onlyNotifyForMentions]) AS \(ViewModel.threadOnlyNotifyForMentionsKey),
                 \(thread[.messageDraft]) AS \(ViewModel.threadMessageDraftKey),
-        
-                \(aggregateInteractionLiteral).\(ViewModel.threadUnreadCountKey),
             
                 \(ViewModel.contactProfileKey).*,
                 \(closedGroup[.name]) AS \(ViewModel.closedGroupNameKey),
@@ -805,26 +816,11 @@ public extension SessionThreadViewModel {
                 \(openGroup[.publicKey]) AS \(ViewModel.openGroupPublicKeyKey),
                 \(openGroup[.userCount]) AS \(ViewModel.openGroupUserCountKey),
                 \(openGroup[.permissions]) AS \(ViewModel.openGroupPermissionsKey),
-        
-                \(aggregateInteractionLiteral).\(ViewModel.interactionIdKey),
             
                 \(SQL("\(userPublicKey)")) AS \(ViewModel.currentUserPublicKeyKey)
             
             FROM \(SessionThread.self)
             LEFT JOIN \(Contact.self) ON \(contact[.id]) = \(thread[.id])
-            LEFT JOIN (
-                SELECT
-                    \(interaction[.id]) AS \(ViewModel.interactionIdKey),
-                    \(interaction[.threadId]) AS \(ViewModel.threadIdKey),
-                    MAX(\(interaction[.timestampMs])) AS \(timestampMsColumnLiteral),
-                    SUM(\(interaction[.wasRead]) = false) AS \(ViewModel.threadUnreadCountKey)
-                FROM \(Interaction.self)
-                WHERE (
-                    \(SQL("\(interaction[.threadId]) = \(threadId)")) AND
-                    \(SQL("\(interaction[.variant]) != \(Interaction.Variant.standardIncomingDeleted)"))
-                )
-            ) AS \(aggregateInteractionLiteral) ON \(aggregateInteractionLiteral).\(ViewModel.threadIdKey) = \(thread[.id])
-            
             LEFT JOIN \(Profile.self) AS \(ViewModel.contactProfileKey) ON \(ViewModel.contactProfileKey).\(profileIdColumnLiteral) = \(thread[.id])
             LEFT JOIN \(OpenGroup.self) ON \(openGroup[.threadId]) = \(thread[.id])
             LEFT JOIN \(ClosedGroup.self) ON \(closedGroup[.threadId]) = \(thread[.id])
@@ -854,6 +850,28 @@ public extension SessionThreadViewModel {
         }
     }
     
+    /// This query retrieves the `Interaction` derived values for the conversation header, the observed region for this query
+    /// only includes the columns it selects so it won't be triggered by changes to other `Interaction` columns
+    ///
+    /// **Note:** This query **will** include deleted incoming messages in it's unread count (they should never be marked as unread
+    /// but including this warning just in case there is a discrepancy)
+    static func conversationInteractionStateQuery(threadId: String) -> SQLRequest<InteractionState> {
+        let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
+        let timestampMsColumnLiteral: SQL = SQL(stringLiteral: Interaction.Columns.timestampMs.name)
+        
+        return """
+            SELECT
+                \(interaction[.id]) AS \(ViewModel.interactionIdKey),
+                MAX(\(interaction[.timestampMs])) AS \(timestampMsColumnLiteral),
+                SUM(\(interaction[.wasRead]) = false) AS \(ViewModel.threadUnreadCountKey)
+            FROM \(Interaction.self)
+            WHERE (
+                \(SQL("\(interaction[.threadId]) = \(threadId)")) AND
+                \(SQL("\(interaction[.variant]) != \(Interaction.Variant.standardIncomingDeleted)"))
+            )
+        """
+    }
+    
     static func conversationSettingsQuery(threadId: String, userPublicKey: String) -> AdaptedFetchRequest<SQLRequest<SessionThreadViewModel>> {
         let thread: TypedTableAlias<SessionThread> = TypedTableAlias()
         let contact: TypedTableAlias<Contact> = TypedTableAlias()
@@ -1037,7 +1055,7 @@ public extension SessionThreadViewModel {
         return pattern
     }
     
-    static func messagesQuery(userPublicKey: String, pattern: FTS5Pattern) -> AdaptedFetchRequest<SQLRequest<SessionThreadViewModel>> {
+    static func messagesQuery(userPublicKey: String, pattern: FTS5Pattern, searchTerm: String) -> AdaptedFetchRequest<SQLRequest<SessionThreadViewModel>> {
         let interaction: TypedTableAlias<Interaction> = TypedTableAlias()
         let thread: TypedTableAlias<SessionThread> = TypedTableAlias()
         let closedGroup: TypedTableAlias<ClosedGroup> = TypedTableAlias()
@@ -1082,10 +1100,17 @@ public extension SessionThreadViewModel {
                 \(SQL("\(userPublicKey)")) AS \(ViewModel.currentUserPublicKeyKey)
             
             FROM \(Interaction.self)
-            JOIN \(interactionFullTextSearch) ON (
-                \(interactionFullTextSearch).rowid = \(interactionLiteral).rowid AND
-                \(interactionFullTextSearch).\(SQL(stringLiteral: Interaction.Columns.body.name)) MATCH \(pattern)
-            )
+            JOIN (
+                SELECT
+                    \(interactionFullTextSearch).rowid AS \(Interaction.searchMatchRowIdKey),
+                    \(interactionFullTextSearch).rank AS \(Interaction.searchMatchRankKey)
+                FROM \(interactionFullTextSearch)
+                WHERE \(interactionFullTextSearch).\(SQL(stringLiteral: Interaction.Columns.body.name)) MATCH \(pattern)
+        
+                UNION ALL
+        
+                \(Interaction.unindexedSearchMatches(searchTerm: searchTerm))
+            ) AS \(Interaction.searchMatchKey) ON \(Interaction.searchMatchKey).\(Interaction.searchMatchRowIdKey) = \(interactionLiteral).rowid
             JOIN \(SessionThread.self) ON \(thread[.id]) = \(interaction[.threadId])
             JOIN \(Profile.self) ON \(profile[.id]) = \(interaction[.authorId])
             LEFT JOIN \(Profile.self) AS \(ViewModel.contactProfileKey) ON \(ViewModel.contactProfileKey).\(profileIdColumnLiteral) = \(interaction[.threadId])
@@ -1123,7 +1148,7 @@ public extension SessionThreadViewModel {
                 \(ViewModel.closedGroupProfileBackFallbackKey).\(profileIdColumnLiteral) = \(userPublicKey)
             )
         
-            ORDER BY \(Column.rank), \(interaction[.timestampMs].desc)
+            ORDER BY \(Interaction.searchMatchKey).\(Interaction.searchMatchRankKey), \(interaction[.timestampMs].desc)
             LIMIT \(SQL("\(SessionThreadViewModel.searchResultsLimit)"))
         """
         
@@ -65,6 +65,10 @@ public extension Setting.BoolKey {
     /// Controls whether concurrent audio messages should automatically be played after the one the user starts
     /// playing finishes
     static let shouldAutoPlayConsecutiveAudioMessages: Setting.BoolKey = "shouldAutoPlayConsecutiveAudioMessages"
+    
+    /// A flag indicating whether newly inserted interactions are being added to the search index by the `SearchIndexingJob`
+    /// rather than when they are inserted
+    static let isSearchIndexingDeferred: Setting.BoolKey = "isSearchIndexingDeferred"
 }
 
 public extension Setting.StringKey {
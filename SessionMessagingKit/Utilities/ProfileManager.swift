@@ -12,7 +12,17 @@ public struct ProfileManager {
     private static let nameDataLength: UInt = 64
     public static let maxAvatarDiameter: CGFloat = 640
     
-    private static var profileAvatarCache: Atomic<[String: Data]> = Atomic([:])
+    private static let profileAvatarCacheIdentifier: String = "ProfileManager.profileAvatarCache"
+    private static var profileAvatarCache: Atomic<[String: Data]> = {
+        // Avatars are shown throughout the app so they are given a high priority
+        CacheGovernor.shared.register(profileAvatarCacheIdentifier, priority: .high) { keys in
+            profileAvatarCache.mutate { cache in
+                keys.compactMap { $0.base as? String }.forEach { cache[$0] = nil }
+            }
+        }
+        
+        return Atomic([:])
+    }()
     private static var currentAvatarDownloads: Atomic<Set<String>> = Atomic([])
     
     // MARK: - Functions
@@ -44,6 +54,7 @@ public struct ProfileManager {
     
     private static func loadProfileAvatar(for fileName: String, profile: Profile) -> Data? {
         if let cachedImageData: Data = profileAvatarCache.wrappedValue[fileName] {
+            CacheGovernor.shared.recordAccess(in: profileAvatarCacheIdentifier, key: fileName)
             return cachedImageData
         }
         
@@ -70,10 +81,21 @@ public struct ProfileManager {
             return nil
         }
     
-        profileAvatarCache.mutate { $0[fileName] = data }
+        cacheProfileAvatar(data, for: fileName)
         return data
     }
     
+    private static func cacheProfileAvatar(_ data: Data?, for fileName: String) {
+        profileAvatarCache.mutate { $0[fileName] = data }
+        
+        guard let data: Data = data else {
+            CacheGovernor.shared.recordRemoval(in: profileAvatarCacheIdentifier, key: fileName)
+            return
+        }
+        
+        CacheGovernor.shared.recordInsertion(in: profileAvatarCacheIdentifier, key: fileName, cost: data.count)
+    }
+    
     private static func loadProfileData(with fileName: String) -> Data? {
         let filePath: String = ProfileManager.profileAvatarFilepath(filename: fileName)
         
@@ -212,7 +234,7 @@ public struct ProfileManager {
                         _ = try? Profile
                             .filter(id: profile.id)
                             .updateAll(db, Profile.Columns.profilePictureFileName.set(to: fileName))
-                        profileAvatarCache.mutate { $0[fileName] = decryptedData }
+                        cacheProfileAvatar(decryptedData, for: fileName)
                     }
                     
                     // Redundant but without reading 'backgroundTask' it will warn that the variable
@@ -321,7 +343,7 @@ public struct ProfileManager {
                     
                     // Remove any cached avatar image value
                     if let fileName: String = existingProfile.profilePictureFileName {
-                        profileAvatarCache.mutate { $0[fileName] = nil }
+                        cacheProfileAvatar(nil, for: fileName)
                     }
                     
                     SNLog("Successfully updated service with profile.")
@@ -381,7 +403,7 @@ public struct ProfileManager {
                             .saved(db)
                         
                         // Update the cached avatar image value
-                        profileAvatarCache.mutate { $0[fileName] = data }
+                        cacheProfileAvatar(data, for: fileName)
                         
                         SNLog("Successfully updated service with profile.")
                         try success?(db, profile)
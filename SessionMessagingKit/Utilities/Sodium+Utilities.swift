@@ -25,9 +25,11 @@ extension Sodium {
     /// 64-byte blake2b hash then reduce to get the blinding factor
     public func generateBlindingFactor(serverPublicKey: String, genericHash: GenericHashType) -> Bytes? {
         /// k = salt.crypto_core_ed25519_scalar_reduce(blake2b(server_pk, digest_size=64).digest())
-        let serverPubKeyData: Data = Data(hex: serverPublicKey)
-        
-        guard !serverPubKeyData.isEmpty, let serverPublicKeyHashBytes: Bytes = genericHash.hash(message: [UInt8](serverPubKeyData), outputLength: 64) else {
+        guard
+            let serverPubKeyBytes: Bytes = Hex.decodedBytes(serverPublicKey),
+            !serverPubKeyBytes.isEmpty,
+            let serverPublicKeyHashBytes: Bytes = genericHash.hash(message: serverPubKeyBytes, outputLength: 64)
+        else {
             return nil
         }
         
@@ -213,7 +215,7 @@ extension Sodium {
         ///
         /// Note: The below method is code we have exposed from the `curve25519_verify` method within the Curve25519 library
         /// rather than custom code we have written
-        guard let xEd25519Key: Data = try? Ed25519.publicKey(from: Data(hex: sessionId.publicKey)) else { return false }
+        guard let xEd25519Key: Data = try? Ed25519.publicKey(from: Data(sessionId.publicKeyBytes)) else { return false }
         
         /// Blind the positive public key
         guard let pk1: Bytes = combineKeys(lhsKeyBytes: kBytes, rhsKeyBytes: xEd25519Key.bytes) else { return false }
@@ -223,8 +225,8 @@ extension Sodium {
         let pk2: Bytes = (pk1[0..<31] + [(pk1[31] ^ 0b1000_0000)])
         
         return (
-            SessionId(.blinded, publicKey: pk1).publicKey == blindedId.publicKey ||
-            SessionId(.blinded, publicKey: pk2).publicKey == blindedId.publicKey
+            pk1 == blindedId.publicKeyBytes ||
+            pk2 == blindedId.publicKeyBytes
         )
     }
 }
@@ -0,0 +1,222 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import PromiseKit
+import Sodium
+import SessionUtilitiesKit
+
+import Quick
+import Nimble
+
+@testable import SessionSnodeKit
+
+class PendingRemoteMutationsSpec: QuickSpec {
+    typealias DeletionResult = PendingRemoteMutations.DeletionResult
+    typealias ExpiryResult = PendingRemoteMutations.ExpiryResult
+    
+    // MARK: - Spec
+    
+    override func spec() {
+        let ed25519PublicKey: Bytes = Array(repeating: 1, count: 32)
+        let sign: (Bytes) -> Bytes? = { _ in Array(repeating: 2, count: 64) }
+        var pendingMutations: PendingRemoteMutations!
+        
+        @discardableResult func addDeletion(
+            publicKey: String = "05TestKey",
+            serverHashes: [String]
+        ) -> Promise<DeletionResult> {
+            let (promise, seal) = Promise<DeletionResult>.pending()
+            pendingMutations.addDeletion(
+                publicKey: publicKey,
+                userPublicKey: publicKey,
+                ed25519PublicKey: ed25519PublicKey,
+                serverHashes: serverHashes,
+                seal: seal
+            )
+            
+            return promise
+        }
+        
+        @discardableResult func addExpiry(
+            publicKey: String = "05TestKey",
+            updatedExpiryMs: UInt64,
+            serverHashes: [String]
+        ) -> Promise<ExpiryResult> {
+            let (promise, seal) = Promise<ExpiryResult>.pending()
+            pendingMutations.addExpiry(
+                publicKey: publicKey,
+                ed25519PublicKey: ed25519PublicKey,
+                updatedExpiryMs: updatedExpiryMs,
+                serverHashes: serverHashes,
+                seal: seal
+            )
+            
+            return promise
+        }
+        
+        describe("PendingRemoteMutations") {
+            beforeEach {
+                pendingMutations = PendingRemoteMutations()
+            }
+            
+            // MARK: - when tracking mutations
+            context("when tracking mutations") {
+                it("starts empty") {
+                    expect(pendingMutations.isEmpty).to(beTrue())
+                }
+                
+                it("coalesces deletions for the same swarm") {
+                    addDeletion(serverHashes: ["a", "b"])
+                    addDeletion(serverHashes: ["c"])
+                    
+                    let deletion: PendingRemoteMutations.Deletion? = pendingMutations.mutations["05TestKey"]?.deletion
+                    expect(pendingMutations.mutations.count).to(equal(1))
+                    expect(deletion?.serverHashes.values).to(equal(["a", "b", "c"]))
+                    expect(deletion?.seals.count).to(equal(2))
+                }
+                
+                it("de-duplicates hashes while keeping the order they were added in") {
+                    addDeletion(serverHashes: ["a", "b"])
+                    addDeletion(serverHashes: ["b", "c", "a"])
+                    
+                    expect(pendingMutations.mutations["05TestKey"]?.deletion?.serverHashes.values)
+                        .to(equal(["a", "b", "c"]))
+                }
+                
+                it("keeps separate mutations for each swarm and expiry") {
+                    addDeletion(publicKey: "05TestKey1", serverHashes: ["a"])
+                    addDeletion(publicKey: "05TestKey2", serverHashes: ["b"])
+                    addExpiry(publicKey: "05TestKey1", updatedExpiryMs: 1000, serverHashes: ["c"])
+                    addExpiry(publicKey: "05TestKey1", updatedExpiryMs: 2000, serverHashes: ["d"])
+                    addExpiry(publicKey: "05TestKey1", updatedExpiryMs: 1000, serverHashes: ["e"])
+                    
+                    expect(pendingMutations.mutations.count).to(equal(2))
+                    expect(pendingMutations.mutations["05TestKey1"]?.deletion?.serverHashes.values).to(equal(["a"]))
+                    expect(pendingMutations.mutations["05TestKey2"]?.deletion?.serverHashes.values).to(equal(["b"]))
+                    expect(pendingMutations.mutations["05TestKey2"]?.expiries).to(beEmpty())
+                    expect(pendingMutations.mutations["05TestKey1"]?.expiries.count).to(equal(2))
+                    expect(
+                        pendingMutations.mutations["05TestKey1"]?
+                            .expiries[PendingRemoteMutations.ExpiryKey(expiryMs: 1000, ed25519PublicKey: ed25519PublicKey)]?
+                            .serverHashes
+                            .values
+                    ).to(equal(["c", "e"]))
+                }
+                
+                it("removes all of the mutations") {
+                    addDeletion(serverHashes: ["a"])
+                    addExpiry(updatedExpiryMs: 1000, serverHashes: ["b"])
+                    
+                    let removedMutations: [String: PendingRemoteMutations.Mutations] = pendingMutations.removeAll()
+                    
+                    expect(removedMutations.count).to(equal(1))
+                    expect(pendingMutations.isEmpty).to(beTrue())
+                }
+            }
+            
+            // MARK: - when building requests
+            context("when building requests") {
+                it("groups the requests by swarm in a consistent order") {
+                    addExpiry(publicKey: "05TestKey2", updatedExpiryMs: 2000, serverHashes: ["a"])
+                    addExpiry(publicKey: "05TestKey2", updatedExpiryMs: 1000, serverHashes: ["b"])
+                    addDeletion(publicKey: "05TestKey2", serverHashes: ["c"])
+                    addDeletion(publicKey: "05TestKey1", serverHashes: ["d"])
+                    
+                    let groups = SnodeAPI.remoteMutationRequestGroups(for: pendingMutations.removeAll(), sign: sign)
+                    
+                    expect(groups.map { $0.publicKey }).to(equal(["05TestKey1", "05TestKey2"]))
+                    expect(groups[1].requests.map { $0.method }).to(equal([.deleteMessage, .expire, .expire]))
+                    expect(groups[1].requests.map { $0.parameters["expiry"] as? UInt64 }).to(equal([nil, 1000, 2000]))
+                    expect(groups[1].requests.map { $0.deletedHashes }).to(equal([["c"], [], []]))
+                }
+                
+                it("splits the requests for a swarm into batches") {
+                    let expiryCount: Int = (SnodeAPI.maxBatchSubrequestCount + 5)
+                    (0..<expiryCount).forEach { index in
+                        addExpiry(updatedExpiryMs: UInt64(index), serverHashes: ["\(index)"])
+                    }
+                    
+                    let groups = SnodeAPI.remoteMutationRequestGroups(for: pendingMutations.removeAll(), sign: sign)
+                    
+                    expect(groups.map { $0.requests.count }).to(equal([SnodeAPI.maxBatchSubrequestCount, 5]))
+                    expect(groups.map { $0.publicKey }).to(equal(["05TestKey", "05TestKey"]))
+                    expect(groups.flatMap { $0.requests }.compactMap { $0.parameters["expiry"] as? UInt64 })
+                        .to(equal((0..<expiryCount).map { UInt64($0) }))
+                }
+                
+                it("fails the callers when the request can't be signed") {
+                    let promise: Promise<DeletionResult> = addDeletion(serverHashes: ["a"])
+                    
+                    let groups = SnodeAPI.remoteMutationRequestGroups(
+                        for: pendingMutations.removeAll(),
+                        sign: { _ in nil }
+                    )
+                    
+                    expect(groups.flatMap { $0.requests }).to(beEmpty())
+                    expect(promise.isRejected).to(beTrue())
+                }
+            }
+            
+            // MARK: - when handling a batch response
+            context("when handling a batch response") {
+                it("only fails the callers of the failed subrequests") {
+                    let deletionPromise: Promise<DeletionResult> = addDeletion(serverHashes: ["a", "b"])
+                    let expiryPromise: Promise<ExpiryResult> = addExpiry(updatedExpiryMs: 1000, serverHashes: ["c"])
+                    let requests: [SnodeAPI.RemoteMutationRequest] = SnodeAPI
+                        .remoteMutationRequestGroups(for: pendingMutations.removeAll(), sign: sign)
+                        .flatMap { $0.requests }
+                    
+                    let deletedHashes: [String]? = try? SnodeAPI.handleBatchResponse(
+                        [
+                            "results": [
+                                [ "code": UInt(200), "body": [ "swarm": [:] ] ],
+                                [ "code": UInt(400), "body": "Invalid request" ]
+                            ]
+                        ],
+                        for: requests
+                    )
+                    
+                    expect(deletedHashes).to(equal(["a", "b"]))
+                    expect(deletionPromise.isFulfilled).to(beTrue())
+                    expect(expiryPromise.isRejected).to(beTrue())
+                    
+                    guard case .httpRequestFailed(let statusCode, _) = expiryPromise.error as? HTTP.Error else {
+                        return fail("Expected the expiry to fail with an httpRequestFailed error")
+                    }
+                    
+                    expect(statusCode).to(equal(400))
+                }
+                
+                it("doesn't return the deleted hashes when the response can't be parsed") {
+                    let deletionPromise: Promise<DeletionResult> = addDeletion(serverHashes: ["a"])
+                    let requests: [SnodeAPI.RemoteMutationRequest] = SnodeAPI
+                        .remoteMutationRequestGroups(for: pendingMutations.removeAll(), sign: sign)
+                        .flatMap { $0.requests }
+                    
+                    let deletedHashes: [String]? = try? SnodeAPI.handleBatchResponse(
+                        [ "results": [ [ "code": UInt(200), "body": [:] ] ] ],
+                        for: requests
+                    )
+                    
+                    expect(deletedHashes).to(equal([]))
+                    expect(deletionPromise.isRejected).to(beTrue())
+                }
+                
+                it("throws when a result is missing") {
+                    addDeletion(serverHashes: ["a"])
+                    addExpiry(updatedExpiryMs: 1000, serverHashes: ["b"])
+                    let requests: [SnodeAPI.RemoteMutationRequest] = SnodeAPI
+                        .remoteMutationRequestGroups(for: pendingMutations.removeAll(), sign: sign)
+                        .flatMap { $0.requests }
+                    
+                    expect {
+                        try SnodeAPI.handleBatchResponse(
+                            [ "results": [ [ "code": UInt(200), "body": [ "swarm": [:] ] ] ] ],
+                            for: requests
+                        )
+                    }.to(throwError(HTTP.Error.invalidJSON))
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,206 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionUtilitiesKit
+
+import Quick
+import Nimble
+
+@testable import SessionSnodeKit
+
+class PendingSnodeChangesSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        let swarmKey: String = "05TestKey"
+        let pathKey: String = "\(SnodeSet.onionRequestPathPrefix)0"
+        let pool: [Snode] = (0..<30).map {
+            Snode(
+                address: "https://127.0.0.\($0)",
+                port: 443,
+                ed25519PublicKey: "ed25519Key\($0)",
+                x25519PublicKey: "x25519Key\($0)"
+            )
+        }
+        let swarm: Set<Snode> = Set(pool[0..<5])
+        let path: Set<Snode> = Set(pool[5..<8])
+        var mockStorage: Storage!
+        
+        func persistedPool() -> Set<Snode>? {
+            return mockStorage.read { db in try Snode.fetchSet(db) }
+        }
+        
+        func persistedSet(_ key: String) -> Set<Snode>? {
+            return mockStorage.read { db in try Snode.fetchSet(db, publicKey: key) }
+        }
+        
+        func apply(_ changes: PendingSnodeChanges) {
+            mockStorage.write { db in try changes.apply(db) }
+        }
+        
+        describe("PendingSnodeChanges") {
+            beforeEach {
+                mockStorage = Storage(
+                    customWriter: try! DatabaseQueue(),
+                    customMigrations: [
+                        SNUtilitiesKit.migrations(),
+                        SNSnodeKit.migrations()
+                    ]
+                )
+                
+                var initialChanges: PendingSnodeChanges = PendingSnodeChanges()
+                initialChanges.updatePool(from: [], to: Set(pool))
+                initialChanges.updateSwarm(for: swarmKey, from: [], to: swarm)
+                initialChanges.updateSwarm(for: pathKey, from: [], to: path)
+                apply(initialChanges)
+            }
+            
+            // MARK: - when tracking changes
+            context("when tracking changes") {
+                it("starts empty") {
+                    expect(PendingSnodeChanges().isEmpty).to(beTrue())
+                }
+                
+                it("cancels out a swarm member which is removed and re-added") {
+                    var changes: PendingSnodeChanges = PendingSnodeChanges()
+                    changes.updateSwarm(for: swarmKey, from: swarm, to: swarm.subtracting([pool[0]]))
+                    changes.updateSwarm(for: swarmKey, from: swarm.subtracting([pool[0]]), to: swarm)
+                    
+                    expect(changes.swarmInsertions[swarmKey]).to(beEmpty())
+                    expect(changes.swarmDeletions[swarmKey]).to(beEmpty())
+                    
+                    apply(changes)
+                    expect(mockStorage.read { db in try SnodeSet.filter(SnodeSet.Columns.key == swarmKey).fetchCount(db) })
+                        .to(equal(swarm.count))
+                }
+                
+                it("discards previous changes when the pool is cleared") {
+                    var changes: PendingSnodeChanges = PendingSnodeChanges()
+                    changes.updatePool(from: Set(pool), to: Set(pool[1...]))
+                    changes.clearPool()
+                    
+                    expect(changes.shouldClearPool).to(beTrue())
+                    expect(changes.poolDeletions).to(beEmpty())
+                    
+                    apply(changes)
+                    expect(persistedPool()).to(beEmpty())
+                    expect(persistedSet(swarmKey)).to(beEmpty())
+                }
+            }
+            
+            // MARK: - when applying changes
+            context("when applying changes") {
+                it("only removes the failed snodes during a path failure storm") {
+                    // Simulate a number of paths failing at once, each failure drops a snode from the pool (and any swarm
+                    // it is in) as a separate change
+                    let failedSnodes: [Snode] = [pool[0], pool[1], pool[10], pool[11], pool[12], pool[20]]
+                    var currentPool: Set<Snode> = Set(pool)
+                    var currentSwarm: Set<Snode> = swarm
+                    var changes: PendingSnodeChanges = PendingSnodeChanges()
+                    
+                    failedSnodes.forEach { snode in
+                        changes.updatePool(from: currentPool, to: currentPool.subtracting([snode]))
+                        currentPool.remove(snode)
+                        
+                        guard currentSwarm.contains(snode) else { return }
+                        
+                        changes.updateSwarm(for: swarmKey, from: currentSwarm, to: currentSwarm.subtracting([snode]))
+                        currentSwarm.remove(snode)
+                    }
+                    
+                    expect(changes.poolDeletions).to(equal(Set(failedSnodes)))
+                    expect(changes.poolInsertions).to(beEmpty())
+                    
+                    apply(changes)
+                    expect(persistedPool()).to(equal(currentPool))
+                    expect(persistedSet(swarmKey)).to(equal(Set(pool[2..<5])))
+                    expect(persistedSet(pathKey)).to(equal(path))
+                }
+                
+                it("keeps the swarm and path entries for snodes which are updated by a pool refresh") {
+                    let updatedSnode: Snode = Snode(
+                        address: pool[5].address,
+                        port: pool[5].port,
+                        ed25519PublicKey: "updatedEd25519Key",
+                        x25519PublicKey: "updatedX25519Key"
+                    )
+                    var changes: PendingSnodeChanges = PendingSnodeChanges()
+                    changes.updatePool(
+                        from: Set(pool),
+                        to: Set(pool).subtracting([pool[5]]).union([updatedSnode])
+                    )
+                    
+                    apply(changes)
+                    expect(persistedPool()?.count).to(equal(pool.count))
+                    expect(persistedPool()?.contains(updatedSnode)).to(beTrue())
+                    expect(persistedSet(pathKey)?.count).to(equal(path.count))
+                }
+                
+                it("writes multiple chunks of snodes") {
+                    let largePool: Set<Snode> = Set((0..<(PendingSnodeChanges.maxRowsPerStatement * 2 + 10)).map {
+                        Snode(
+                            address: "https://127.0.1.\($0)",
+                            port: 443,
+                            ed25519PublicKey: "ed25519Key\($0)",
+                            x25519PublicKey: "x25519Key\($0)"
+                        )
+                    })
+                    var insertChanges: PendingSnodeChanges = PendingSnodeChanges()
+                    insertChanges.updatePool(from: Set(pool), to: largePool)
+                    
+                    apply(insertChanges)
+                    expect(persistedPool()).to(equal(largePool))
+                }
+            }
+            
+            // MARK: - when merging changes
+            context("when merging changes") {
+                it("produces the same result as applying the changes in order") {
+                    var failedChanges: PendingSnodeChanges = PendingSnodeChanges()
+                    failedChanges.updatePool(from: Set(pool), to: Set(pool[2...]))
+                    failedChanges.updateSwarm(for: swarmKey, from: swarm, to: Set(pool[2..<5]))
+                    
+                    // Re-add one of the dropped snodes and drop another
+                    var newerChanges: PendingSnodeChanges = PendingSnodeChanges()
+                    newerChanges.updatePool(from: Set(pool[2...]), to: Set(pool[3...]).union([pool[0]]))
+                    newerChanges.updateSwarm(
+                        for: swarmKey,
+                        from: Set(pool[2..<5]),
+                        to: Set(pool[3..<5]).union([pool[0]])
+                    )
+                    
+                    apply(failedChanges.merging(newerChanges))
+                    
+                    expect(persistedPool()).to(equal(Set(pool[3...]).union([pool[0]])))
+                    expect(persistedSet(swarmKey)).to(equal(Set(pool[3..<5]).union([pool[0]])))
+                    expect(persistedSet(pathKey)).to(equal(path))
+                }
+                
+                it("keeps the newer changes when they clear the pool") {
+                    var failedChanges: PendingSnodeChanges = PendingSnodeChanges()
+                    failedChanges.updatePool(from: Set(pool), to: Set(pool[2...]))
+                    var newerChanges: PendingSnodeChanges = PendingSnodeChanges()
+                    newerChanges.clearPool()
+                    
+                    let mergedChanges: PendingSnodeChanges = failedChanges.merging(newerChanges)
+                    
+                    expect(mergedChanges.shouldClearPool).to(beTrue())
+                    expect(mergedChanges.poolDeletions).to(beEmpty())
+                }
+                
+                it("keeps a clear from the failed changes") {
+                    var failedChanges: PendingSnodeChanges = PendingSnodeChanges()
+                    failedChanges.clearPool()
+                    var newerChanges: PendingSnodeChanges = PendingSnodeChanges()
+                    newerChanges.updatePool(from: [], to: Set(pool[0..<3]))
+                    
+                    apply(failedChanges.merging(newerChanges))
+                    
+                    expect(persistedPool()).to(equal(Set(pool[0..<3])))
+                    expect(persistedSet(swarmKey)).to(beEmpty())
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,202 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import Sodium
+import SessionUtilitiesKit
+
+import Quick
+import Nimble
+
+@testable import SessionSnodeKit
+
+class SnodeSignatureVerifierSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        let sodium: Sodium = Sodium()
+        let cacheDuration: TimeInterval = 60
+        let snodeKeyPairs: [Sign.KeyPair] = (0..<8).map { _ in sodium.sign.keyPair()! }
+        var currentDate: Atomic<Date>!
+        var verifier: SnodeSignatureVerifier!
+        
+        func item(for keyPair: Sign.KeyPair, message: String) -> SnodeSignatureVerifier.Item {
+            return SnodeSignatureVerifier.Item(
+                snodePublicKey: Hex.encodedString(keyPair.publicKey),
+                signature: Base64.encodedString(sodium.sign.signature(message: Array(message.utf8), secretKey: keyPair.secretKey)!),
+                message: Array(message.utf8)
+            )
+        }
+        
+        func tampered(_ string: String) -> String {
+            // Flip a bit in the first byte of the base64 encoded signature
+            var bytes: Bytes = Base64.decodedBytes(string)!
+            bytes[0] ^= 0x01
+            
+            return Base64.encodedString(bytes)
+        }
+        
+        describe("a SnodeSignatureVerifier") {
+            beforeEach {
+                currentDate = Atomic(Date(timeIntervalSince1970: 1_680_000_000))
+                verifier = SnodeSignatureVerifier(
+                    sodium: sodium,
+                    cacheDuration: cacheDuration,
+                    maxCacheSize: 100,
+                    now: { currentDate.wrappedValue }
+                )
+            }
+            
+            // MARK: - when verifying a single signature
+            context("when verifying a single signature") {
+                it("accepts a valid signature") {
+                    expect(verifier.verify(item(for: snodeKeyPairs[0], message: "TestMessage"))).to(beTrue())
+                }
+                
+                it("rejects a tampered signature") {
+                    let validItem: SnodeSignatureVerifier.Item = item(for: snodeKeyPairs[0], message: "TestMessage")
+                    let tamperedItem: SnodeSignatureVerifier.Item = SnodeSignatureVerifier.Item(
+                        snodePublicKey: validItem.snodePublicKey,
+                        signature: tampered(validItem.signature),
+                        message: validItem.message
+                    )
+                    
+                    expect(verifier.verify(tamperedItem)).to(beFalse())
+                }
+                
+                it("rejects a tampered message") {
+                    let validItem: SnodeSignatureVerifier.Item = item(for: snodeKeyPairs[0], message: "TestMessage")
+                    let tamperedItem: SnodeSignatureVerifier.Item = SnodeSignatureVerifier.Item(
+                        snodePublicKey: validItem.snodePublicKey,
+                        signature: validItem.signature,
+                        message: Array("TestMessagf".utf8)
+                    )
+                    
+                    expect(verifier.verify(tamperedItem)).to(beFalse())
+                }
+                
+                it("rejects a signature from a different snode") {
+                    let validItem: SnodeSignatureVerifier.Item = item(for: snodeKeyPairs[0], message: "TestMessage")
+                    let otherSnodeItem: SnodeSignatureVerifier.Item = SnodeSignatureVerifier.Item(
+                        snodePublicKey: Hex.encodedString(snodeKeyPairs[1].publicKey),
+                        signature: validItem.signature,
+                        message: validItem.message
+                    )
+                    
+                    expect(verifier.verify(otherSnodeItem)).to(beFalse())
+                }
+                
+                it("rejects an invalid public key or signature encoding") {
+                    let validItem: SnodeSignatureVerifier.Item = item(for: snodeKeyPairs[0], message: "TestMessage")
+                    
+                    expect(
+                        verifier.verify(
+                            SnodeSignatureVerifier.Item(
+                                snodePublicKey: "zz\(validItem.snodePublicKey.dropFirst(2))",
+                                signature: validItem.signature,
+                                message: validItem.message
+                            )
+                        )
+                    ).to(beFalse())
+                    expect(
+                        verifier.verify(
+                            SnodeSignatureVerifier.Item(
+                                snodePublicKey: validItem.snodePublicKey,
+                                signature: "!\(validItem.signature.dropFirst())",
+                                message: validItem.message
+                            )
+                        )
+                    ).to(beFalse())
+                    expect(
+                        verifier.verify(
+                            SnodeSignatureVerifier.Item(
+                                snodePublicKey: validItem.snodePublicKey,
+                                signature: Base64.encodedString(Bytes(repeating: 0, count: 10)),
+                                message: validItem.message
+                            )
+                        )
+                    ).to(beFalse())
+                }
+            }
+            
+            // MARK: - when verifying a batch of signatures
+            context("when verifying a batch of signatures") {
+                it("returns the results in the same order as the items") {
+                    let items: [SnodeSignatureVerifier.Item] = snodeKeyPairs.enumerated().map { index, keyPair in
+                        let validItem: SnodeSignatureVerifier.Item = item(for: keyPair, message: "TestMessage\(index)")
+                        
+                        guard index % 3 == 0 else { return validItem }
+                        
+                        return SnodeSignatureVerifier.Item(
+                            snodePublicKey: validItem.snodePublicKey,
+                            signature: tampered(validItem.signature),
+                            message: validItem.message
+                        )
+                    }
+                    
+                    expect(verifier.verify(items)).to(equal(snodeKeyPairs.indices.map { $0 % 3 != 0 }))
+                }
+                
+                it("returns an empty result for no items") {
+                    expect(verifier.verify([])).to(equal([]))
+                }
+            }
+            
+            // MARK: - when a signature has already been verified
+            context("when a signature has already been verified") {
+                var validItem: SnodeSignatureVerifier.Item!
+                
+                beforeEach {
+                    validItem = item(for: snodeKeyPairs[0], message: "TestMessage")
+                    expect(verifier.verify(validItem)).to(beTrue())
+                }
+                
+                it("still accepts it") {
+                    expect(verifier.verify(validItem)).to(beTrue())
+                }
+                
+                it("rejects a tampered copy of it") {
+                    let tamperedItem: SnodeSignatureVerifier.Item = SnodeSignatureVerifier.Item(
+                        snodePublicKey: validItem.snodePublicKey,
+                        signature: tampered(validItem.signature),
+                        message: validItem.message
+                    )
+                    
+                    expect(verifier.verify(tamperedItem)).to(beFalse())
+                    expect(verifier.verify(validItem)).to(beTrue())
+                }
+                
+                it("rejects it if it is used for a different message") {
+                    let replayedItem: SnodeSignatureVerifier.Item = SnodeSignatureVerifier.Item(
+                        snodePublicKey: validItem.snodePublicKey,
+                        signature: validItem.signature,
+                        message: Array("OtherMessage".utf8)
+                    )
+                    
+                    expect(verifier.verify(replayedItem)).to(beFalse())
+                }
+                
+                it("verifies it again once the cache has expired") {
+                    currentDate.mutate { $0 = $0.addingTimeInterval(cacheDuration + 1) }
+                    
+                    expect(verifier.verify(validItem)).to(beTrue())
+                }
+            }
+            
+            // MARK: - when a signature has failed verification
+            context("when a signature has failed verification") {
+                it("does not cache the failure") {
+                    let validItem: SnodeSignatureVerifier.Item = item(for: snodeKeyPairs[0], message: "TestMessage")
+                    let tamperedItem: SnodeSignatureVerifier.Item = SnodeSignatureVerifier.Item(
+                        snodePublicKey: validItem.snodePublicKey,
+                        signature: tampered(validItem.signature),
+                        message: validItem.message
+                    )
+                    
+                    expect(verifier.verify(tamperedItem)).to(beFalse())
+                    expect(verifier.verify(tamperedItem)).to(beFalse())
+                    expect(verifier.verify(validItem)).to(beTrue())
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,198 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import PromiseKit
+import SessionUtilitiesKit
+
+import Quick
+import Nimble
+
+@testable import SessionSnodeKit
+
+class SwarmResolverSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        let refreshInterval: TimeInterval = 60
+        let swarm: Set<Snode> = Set((0..<3).map {
+            Snode(
+                address: "https://127.0.0.\($0)",
+                port: 443,
+                ed25519PublicKey: "ed25519Key\($0)",
+                x25519PublicKey: "x25519Key\($0)"
+            )
+        })
+        var cachedSwarms: Atomic<[String: Set<Snode>]>!
+        var fetchCounts: Atomic<[String: Int]>!
+        var pendingFetches: Atomic<[String: Resolver<Set<Snode>>]>!
+        var currentDate: Atomic<Date>!
+        var resolver: SwarmResolver!
+        
+        describe("a SwarmResolver") {
+            beforeEach {
+                cachedSwarms = Atomic([:])
+                fetchCounts = Atomic([:])
+                pendingFetches = Atomic([:])
+                currentDate = Atomic(Date(timeIntervalSince1970: 1_680_000_000))
+                resolver = SwarmResolver(
+                    minSwarmSnodeCount: 3,
+                    refreshInterval: refreshInterval,
+                    loadSwarm: { publicKey in (cachedSwarms.wrappedValue[publicKey] ?? []) },
+                    fetchSwarm: { publicKey in
+                        let (promise, seal) = Promise<Set<Snode>>.pending()
+                        fetchCounts.mutate { $0[publicKey] = ($0[publicKey] ?? 0) + 1 }
+                        pendingFetches.mutate { $0[publicKey] = seal }
+                        
+                        return promise.map { swarm in
+                            cachedSwarms.mutate { $0[publicKey] = swarm }
+                            return swarm
+                        }
+                    },
+                    now: { currentDate.wrappedValue }
+                )
+            }
+            
+            func completeFetch(for publicKey: String, with result: Set<Snode> = swarm) {
+                pendingFetches.mutate { $0.removeValue(forKey: publicKey) }?.fulfill(result)
+            }
+            
+            // MARK: - when there is no cached swarm
+            context("when there is no cached swarm") {
+                it("only sends a single request for each key when accessed concurrently") {
+                    let publicKeys: [String] = (0..<4).map { "05TestKey\($0)" }
+                    let promises: Atomic<[Promise<Set<Snode>>]> = Atomic([])
+                    
+                    DispatchQueue.concurrentPerform(iterations: 200) { index in
+                        let promise: Promise<Set<Snode>> = resolver.swarm(for: publicKeys[index % publicKeys.count])
+                        promises.mutate { $0.append(promise) }
+                    }
+                    
+                    expect(fetchCounts.wrappedValue).to(equal(Dictionary(uniqueKeysWithValues: publicKeys.map { ($0, 1) })))
+                    expect(promises.wrappedValue.allSatisfy { $0.isPending }).to(beTrue())
+                    
+                    publicKeys.forEach { completeFetch(for: $0) }
+                    
+                    expect(promises.wrappedValue.allSatisfy { $0.value == swarm }).toEventually(beTrue())
+                    expect(fetchCounts.wrappedValue.values.allSatisfy { $0 == 1 }).to(beTrue())
+                }
+                
+                it("allows another request once the previous one has completed") {
+                    let promise: Promise<Set<Snode>> = resolver.refresh("05TestKey")
+                    completeFetch(for: "05TestKey")
+                    expect(promise.value).toEventually(equal(swarm))
+                    
+                    // The in-flight request is cleared after the promise has resolved
+                    expect(resolver.refresh("05TestKey").isPending).toEventually(beTrue())
+                    expect(fetchCounts.wrappedValue["05TestKey"]).toEventually(equal(2))
+                }
+                
+                it("allows another request once the previous one has failed") {
+                    let promise: Promise<Set<Snode>> = resolver.refresh("05TestKey")
+                    pendingFetches.mutate { $0.removeValue(forKey: "05TestKey") }?.reject(HTTP.Error.invalidResponse)
+                    expect(promise.isRejected).toEventually(beTrue())
+                    
+                    expect(resolver.refresh("05TestKey").isPending).toEventually(beTrue())
+                    expect(fetchCounts.wrappedValue["05TestKey"]).toEventually(equal(2))
+                }
+                
+                it("doesn't hold the lock while starting the request") {
+                    var nestedPromise: Promise<Set<Snode>>?
+                    resolver = SwarmResolver(
+                        minSwarmSnodeCount: 3,
+                        refreshInterval: refreshInterval,
+                        loadSwarm: { _ in [] },
+                        fetchSwarm: { publicKey in
+                            // Refreshing another key from within the fetch would deadlock if the lock was held
+                            if publicKey == "05TestKey1" {
+                                nestedPromise = resolver.refresh("05TestKey2")
+                            }
+                            
+                            return Promise.value(swarm)
+                        }
+                    )
+                    
+                    expect(resolver.refresh("05TestKey1").value).toEventually(equal(swarm))
+                    expect(nestedPromise?.value).toEventually(equal(swarm))
+                }
+            }
+            
+            // MARK: - when there is a cached swarm
+            context("when there is a cached swarm") {
+                beforeEach {
+                    cachedSwarms.mutate { $0["05TestKey"] = swarm }
+                }
+                
+                it("returns the cached swarm without a request when it is fresh") {
+                    let promise: Promise<Set<Snode>> = resolver.swarm(for: "05TestKey")
+                    
+                    expect(promise.value).to(equal(swarm))
+                    expect(fetchCounts.wrappedValue["05TestKey"]).to(beNil())
+                }
+                
+                it("returns the cached swarm immediately and refreshes it when it is stale") {
+                    _ = resolver.swarm(for: "05TestKey")
+                    currentDate.mutate { $0 = $0.addingTimeInterval(refreshInterval + 1) }
+                    
+                    let promises: [Promise<Set<Snode>>] = (0..<10).map { _ in resolver.swarm(for: "05TestKey") }
+                    
+                    expect(promises.allSatisfy { $0.value == swarm }).to(beTrue())
+                    expect(fetchCounts.wrappedValue["05TestKey"]).to(equal(1))
+                }
+                
+                it("returns the cached swarm immediately and refreshes it when it has too few snodes") {
+                    cachedSwarms.mutate { $0["05TestKey"] = Set(swarm.prefix(1)) }
+                    
+                    let promise: Promise<Set<Snode>> = resolver.swarm(for: "05TestKey")
+                    
+                    expect(promise.value).to(equal(Set(swarm.prefix(1))))
+                    expect(fetchCounts.wrappedValue["05TestKey"]).to(equal(1))
+                }
+                
+                it("does not refresh again until the refreshed swarm is stale") {
+                    _ = resolver.swarm(for: "05TestKey")
+                    currentDate.mutate { $0 = $0.addingTimeInterval(refreshInterval + 1) }
+                    _ = resolver.swarm(for: "05TestKey")
+                    
+                    let inFlightPromise: Promise<Set<Snode>> = resolver.refresh("05TestKey")
+                    completeFetch(for: "05TestKey")
+                    expect(inFlightPromise.value).toEventually(equal(swarm))
+                    
+                    _ = resolver.swarm(for: "05TestKey")
+                    expect(fetchCounts.wrappedValue["05TestKey"]).to(equal(1))
+                }
+            }
+            
+            // MARK: - when picking target snodes
+            context("when picking target snodes") {
+                it("prefers the healthiest snodes") {
+                    let sortedSwarm: [Snode] = swarm.sorted { $0.address < $1.address }
+                    resolver.recordFailure(for: sortedSwarm[0], publicKey: "05TestKey")
+                    resolver.recordSuccess(for: sortedSwarm[2], publicKey: "05TestKey")
+                    
+                    (0..<20).forEach { _ in
+                        let targetSnodes: [Snode] = resolver.targetSnodes(from: swarm, for: "05TestKey", count: 2)
+                        
+                        expect(targetSnodes).to(equal([sortedSwarm[2], sortedSwarm[1]]))
+                    }
+                }
+                
+                it("tracks health separately for each swarm") {
+                    let snode: Snode = swarm.first!
+                    resolver.recordFailure(for: snode, publicKey: "05TestKey1")
+                    
+                    expect(resolver.healthScore(for: snode, publicKey: "05TestKey1")).to(equal(-SwarmResolver.failurePenalty))
+                    expect(resolver.healthScore(for: snode, publicKey: "05TestKey2")).to(equal(0))
+                }
+                
+                it("limits the health scores") {
+                    let snode: Snode = swarm.first!
+                    (0..<20).forEach { _ in resolver.recordSuccess(for: snode, publicKey: "05TestKey") }
+                    expect(resolver.healthScore(for: snode, publicKey: "05TestKey")).to(equal(SwarmResolver.maxHealthScore))
+                    
+                    (0..<20).forEach { _ in resolver.recordFailure(for: snode, publicKey: "05TestKey") }
+                    expect(resolver.healthScore(for: snode, publicKey: "05TestKey")).to(equal(SwarmResolver.minHealthScore))
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,176 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionSnodeKit
+import SessionUtilitiesKit
+
+import Quick
+import Nimble
+
+@testable import SessionMessagingKit
+
+class _013_QuoteOriginalInteractionIdSpec: QuickSpec {
+    // MARK: - Spec
+
+    override func spec() {
+        let userPublicKey: String = "05\(TestConstants.publicKey)"
+        let otherBlindedId: String = "15\(TestConstants.blindedPublicKey)"
+        let threadId: String = OpenGroup.idFor(roomToken: "testRoom", server: "testServer")
+        let otherThreadId: String = OpenGroup.idFor(roomToken: "testRoom", server: "otherServer")
+        var mockStorage: Storage!
+        var userBlindedId: String!
+        
+        func insertInteraction(_ db: Database, threadId: String, authorId: String, timestampMs: Int64) throws -> Int64? {
+            return try Interaction(
+                threadId: threadId,
+                authorId: authorId,
+                variant: (authorId == userPublicKey ? .standardOutgoing : .standardIncoming),
+                body: "Test",
+                timestampMs: timestampMs
+            ).inserted(db).id
+        }
+        
+        func insertQuote(_ db: Database, threadId: String, authorId: String, timestampMs: Int64) throws -> Int64? {
+            guard
+                let interactionId: Int64 = try insertInteraction(
+                    db,
+                    threadId: threadId,
+                    authorId: "05Quoter",
+                    timestampMs: (timestampMs + 1000)
+                )
+            else { return nil }
+            
+            try Quote(
+                interactionId: interactionId,
+                authorId: authorId,
+                timestampMs: timestampMs,
+                body: nil,
+                attachmentId: nil
+            ).insert(db)
+            
+            return interactionId
+        }
+        
+        func originalInteractionId(forQuoteIn interactionId: Int64?) -> Int64? {
+            return mockStorage.read { db in
+                try Quote
+                    .filter(Quote.Columns.interactionId == interactionId)
+                    .select(.originalInteractionId)
+                    .asRequest(of: Int64.self)
+                    .fetchOne(db)
+            }
+        }
+        
+        describe("the QuoteOriginalInteractionId migration") {
+            beforeEach {
+                mockStorage = Storage(
+                    customWriter: try! DatabaseQueue(),
+                    customMigrations: [
+                        SNUtilitiesKit.migrations(),
+                        SNSnodeKit.migrations(),
+                        SNMessagingKit.migrations()
+                    ]
+                )
+                
+                mockStorage.write { db in
+                    try Identity(variant: .x25519PublicKey, data: Data(hex: TestConstants.publicKey)).insert(db)
+                    try Identity(variant: .x25519PrivateKey, data: Data(hex: TestConstants.privateKey)).insert(db)
+                    try Identity(variant: .ed25519PublicKey, data: Data(hex: TestConstants.edPublicKey)).insert(db)
+                    try Identity(variant: .ed25519SecretKey, data: Data(hex: TestConstants.edSecretKey)).insert(db)
+                    
+                    try [(threadId, "testServer", TestConstants.serverPublicKey), (otherThreadId, "otherServer", TestConstants.edPublicKey)]
+                        .forEach { id, server, publicKey in
+                            try SessionThread(id: id, variant: .openGroup).insert(db)
+                            try OpenGroup(
+                                server: server,
+                                roomToken: "testRoom",
+                                publicKey: publicKey,
+                                isActive: true,
+                                name: "Test",
+                                userCount: 0,
+                                infoUpdates: 0
+                            ).insert(db)
+                        }
+                }
+                
+                userBlindedId = mockStorage.read { db in
+                    SessionThread.getUserHexEncodedBlindedKey(db, threadId: threadId, threadVariant: .openGroup)
+                }
+            }
+            
+            it("links a quote to the interaction with the same timestamp and author") {
+                let quoteInteractionId: Int64? = mockStorage.write { db -> Int64? in
+                    _ = try insertInteraction(db, threadId: threadId, authorId: "05Other", timestampMs: 1)
+                    
+                    return try insertQuote(db, threadId: threadId, authorId: "05Other", timestampMs: 1)
+                }
+                let expectedId: Int64? = mockStorage.read { db in
+                    try Interaction
+                        .select(.id)
+                        .filter(Interaction.Columns.authorId == "05Other")
+                        .filter(Interaction.Columns.timestampMs == 1)
+                        .asRequest(of: Int64.self)
+                        .fetchOne(db)
+                }
+                
+                mockStorage.write { db in try _013_QuoteOriginalInteractionId.populateOriginalInteractionIds(db) }
+                
+                expect(expectedId).toNot(beNil())
+                expect(originalInteractionId(forQuoteIn: quoteInteractionId)).to(equal(expectedId))
+            }
+            
+            it("links a quote using the users blinded id to the users message in that open group") {
+                let (userInteractionId, quoteInteractionId): (Int64?, Int64?) = mockStorage.write { db in
+                    (
+                        try insertInteraction(db, threadId: threadId, authorId: userPublicKey, timestampMs: 2),
+                        try insertQuote(db, threadId: threadId, authorId: userBlindedId, timestampMs: 2)
+                    )
+                } ?? (nil, nil)
+                
+                mockStorage.write { db in try _013_QuoteOriginalInteractionId.populateOriginalInteractionIds(db) }
+                
+                expect(userBlindedId).toNot(beNil())
+                expect(userInteractionId).toNot(beNil())
+                expect(originalInteractionId(forQuoteIn: quoteInteractionId)).to(equal(userInteractionId))
+            }
+            
+            it("does not link a quote using a different blinded id to the users message") {
+                let quoteInteractionId: Int64? = mockStorage.write { db -> Int64? in
+                    _ = try insertInteraction(db, threadId: threadId, authorId: userPublicKey, timestampMs: 3)
+                    
+                    return try insertQuote(db, threadId: threadId, authorId: otherBlindedId, timestampMs: 3)
+                }
+                
+                mockStorage.write { db in try _013_QuoteOriginalInteractionId.populateOriginalInteractionIds(db) }
+                
+                expect(userBlindedId).toNot(equal(otherBlindedId))
+                expect(originalInteractionId(forQuoteIn: quoteInteractionId)).to(beNil())
+            }
+            
+            it("does not link a quote using the users blinded id for a different server") {
+                let quoteInteractionId: Int64? = mockStorage.write { db -> Int64? in
+                    _ = try insertInteraction(db, threadId: otherThreadId, authorId: userPublicKey, timestampMs: 4)
+                    
+                    return try insertQuote(db, threadId: otherThreadId, authorId: userBlindedId, timestampMs: 4)
+                }
+                
+                mockStorage.write { db in try _013_QuoteOriginalInteractionId.populateOriginalInteractionIds(db) }
+                
+                expect(originalInteractionId(forQuoteIn: quoteInteractionId)).to(beNil())
+            }
+            
+            it("links a quote when the interaction it references is inserted afterwards") {
+                let quoteInteractionId: Int64? = mockStorage.write { db -> Int64? in
+                    try insertQuote(db, threadId: threadId, authorId: "05Other", timestampMs: 5)
+                }
+                let interactionId: Int64? = mockStorage.write { db -> Int64? in
+                    try insertInteraction(db, threadId: threadId, authorId: "05Other", timestampMs: 5)
+                }
+                
+                expect(interactionId).toNot(beNil())
+                expect(originalInteractionId(forQuoteIn: quoteInteractionId)).to(equal(interactionId))
+            }
+        }
+    }
+}
@@ -0,0 +1,235 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionSnodeKit
+import SessionUtilitiesKit
+
+import Quick
+import Nimble
+
+@testable import SessionMessagingKit
+
+class InteractionSearchIndexingSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        let threadId: String = "TestThreadId"
+        let interactionFullTextSearch: SQL = SQL(stringLiteral: Interaction.fullTextSearchTableName)
+        var mockStorage: Storage!
+        
+        @discardableResult func insertInteraction(_ db: Database, body: String) throws -> Int64 {
+            return try Interaction(
+                threadId: threadId,
+                authorId: "TestAuthorId",
+                variant: .standardIncoming,
+                body: body,
+                timestampMs: 1234
+            ).inserted(db).id!
+        }
+        
+        func indexedIds(matching searchTerm: String) -> Set<Int64>? {
+            return mockStorage.read { db in
+                let pattern: FTS5Pattern = try SessionThreadViewModel.pattern(db, searchTerm: searchTerm)
+                
+                return try SQLRequest<Int64>(literal: """
+                    SELECT rowid
+                    FROM \(interactionFullTextSearch)
+                    WHERE \(interactionFullTextSearch) MATCH \(pattern)
+                """).fetchSet(db)
+            }
+        }
+        
+        func pendingIds() -> Set<Int64>? {
+            return mockStorage.read { db in
+                try SQLRequest<Int64>(literal: """
+                    SELECT \(Interaction.pendingSearchIndexIdColumn)
+                    FROM \(SQL(stringLiteral: Interaction.pendingSearchIndexTableName))
+                """).fetchSet(db)
+            }
+        }
+        
+        func unindexedIds(matching searchTerm: String) -> Set<Int64>? {
+            return mockStorage.read { db in
+                try SQLRequest<Int64>(literal: """
+                    SELECT \(Interaction.searchMatchRowIdKey)
+                    FROM (\(Interaction.unindexedSearchMatches(searchTerm: searchTerm)))
+                """).fetchSet(db)
+            }
+        }
+        
+        /// The FTS 'integrity-check' command fails if the index doesn't match the content table
+        func isIndexConsistent() -> Bool? {
+            return mockStorage.write { db in
+                try db.execute(literal: """
+                    INSERT INTO \(interactionFullTextSearch) (\(interactionFullTextSearch)) VALUES ('integrity-check')
+                """)
+                
+                return true
+            }
+        }
+        
+        describe("an Interaction") {
+            beforeEach {
+                mockStorage = Storage(
+                    customWriter: try! DatabaseQueue(),
+                    customMigrations: [
+                        SNUtilitiesKit.migrations(),
+                        SNSnodeKit.migrations(),
+                        SNMessagingKit.migrations()
+                    ]
+                )
+                
+                mockStorage.write { db in
+                    try SessionThread(id: threadId, variant: .contact).insert(db)
+                }
+            }
+            
+            // MARK: - when deferring search indexing
+            context("when deferring search indexing") {
+                it("records inserted interactions as pending instead of indexing them") {
+                    let interactionId: Int64! = mockStorage.write { db in
+                        try Interaction.deferSearchIndexing(db)
+                        
+                        return try insertInteraction(db, body: "Hello world")
+                    }
+                    
+                    expect(mockStorage.read { db in db[.isSearchIndexingDeferred] }).to(beTrue())
+                    expect(pendingIds()).to(equal([interactionId]))
+                    expect(indexedIds(matching: "hello")).to(beEmpty())
+                }
+                
+                it("includes pending interactions in the search results") {
+                    let interactionId: Int64! = mockStorage.write { db in
+                        try Interaction.deferSearchIndexing(db)
+                        
+                        return try insertInteraction(db, body: "Hello world")
+                    }
+                    let results: [Int64]? = mockStorage.read { db in
+                        try Interaction
+                            .idsForTermWithin(
+                                threadId: threadId,
+                                pattern: try SessionThreadViewModel.pattern(db, searchTerm: "hello"),
+                                searchTerm: "hello"
+                            )
+                            .fetchAll(db)
+                    }
+                    
+                    expect(results).to(equal([interactionId]))
+                }
+                
+                it("keeps existing entries in the index when pending interactions are updated or deleted") {
+                    let indexedId: Int64! = mockStorage.write { db in try insertInteraction(db, body: "Indexed") }
+                    
+                    mockStorage.write { db in
+                        try Interaction.deferSearchIndexing(db)
+                        let updatedId: Int64 = try insertInteraction(db, body: "Pending")
+                        let deletedId: Int64 = try insertInteraction(db, body: "Deleted")
+                        
+                        try Interaction
+                            .filter(Interaction.Columns.id == updatedId)
+                            .updateAll(db, Interaction.Columns.body.set(to: "Updated"))
+                        _ = try Interaction
+                            .filter(Interaction.Columns.id == deletedId)
+                            .deleteAll(db)
+                    }
+                    
+                    expect(pendingIds()?.count).to(equal(1))
+                    expect(indexedIds(matching: "indexed")).to(equal([indexedId]))
+                    expect(unindexedIds(matching: "updated")?.count).to(equal(1))
+                    expect(unindexedIds(matching: "pending")).to(beEmpty())
+                }
+            }
+            
+            // MARK: - when indexing pending entries
+            context("when indexing pending entries") {
+                beforeEach {
+                    mockStorage.write { db in
+                        try Interaction.deferSearchIndexing(db)
+                        try (0..<5).forEach { index in try insertInteraction(db, body: "Test \(index)") }
+                    }
+                }
+                
+                it("indexes the pending interactions in batches") {
+                    expect(mockStorage.write { db in try Interaction.indexPendingSearchEntries(db, limit: 2) })
+                        .to(equal(3))
+                    expect(indexedIds(matching: "test")?.count).to(equal(2))
+                    expect(pendingIds()?.count).to(equal(3))
+                    
+                    expect(mockStorage.write { db in try Interaction.indexPendingSearchEntries(db, limit: 2) })
+                        .to(equal(1))
+                    expect(mockStorage.write { db in try Interaction.indexPendingSearchEntries(db, limit: 2) })
+                        .to(equal(0))
+                    expect(indexedIds(matching: "test")?.count).to(equal(5))
+                    expect(pendingIds()).to(beEmpty())
+                }
+                
+                it("switches back to synchronous indexing once there are no pending interactions") {
+                    mockStorage.write { db in try Interaction.indexPendingSearchEntries(db, limit: 10) }
+                    let interactionId: Int64! = mockStorage.write { db in try insertInteraction(db, body: "Later") }
+                    
+                    expect(mockStorage.read { db in db[.isSearchIndexingDeferred] }).to(beFalse())
+                    expect(pendingIds()).to(beEmpty())
+                    expect(indexedIds(matching: "later")).to(equal([interactionId]))
+                }
+                
+                it("keeps the index consistent with the interactions") {
+                    mockStorage.write { db in
+                        try Interaction.indexPendingSearchEntries(db, limit: 2)
+                        try Interaction
+                            .filter(Interaction.Columns.body == "Test 0")
+                            .updateAll(db, Interaction.Columns.body.set(to: "Updated 0"))
+                        try Interaction
+                            .filter(Interaction.Columns.body == "Test 4")
+                            .updateAll(db, Interaction.Columns.body.set(to: "Updated 4"))
+                        _ = try Interaction.filter(Interaction.Columns.body == "Test 3").deleteAll(db)
+                        try Interaction.indexPendingSearchEntries(db, limit: 10)
+                    }
+                    
+                    expect(isIndexConsistent()).to(beTrue())
+                    expect(indexedIds(matching: "updated")?.count).to(equal(2))
+                    expect(indexedIds(matching: "test")?.count).to(equal(2))
+                }
+            }
+            
+            // MARK: - when matching pending interactions
+            context("when matching pending interactions") {
+                var interactionId: Int64!
+                
+                beforeEach {
+                    interactionId = mockStorage.write { db in
+                        try Interaction.deferSearchIndexing(db)
+                        
+                        return try insertInteraction(db, body: "Say (HELLO) to 50% of the world_wide a*b")
+                    }
+                }
+                
+                it("matches the start of a token") {
+                    expect(unindexedIds(matching: "hel")).to(equal([interactionId]))
+                    expect(unindexedIds(matching: "say")).to(equal([interactionId]))
+                    expect(unindexedIds(matching: "wide")).to(equal([interactionId]))
+                }
+                
+                it("doesn't match within a token") {
+                    expect(unindexedIds(matching: "ello")).to(beEmpty())
+                    expect(unindexedIds(matching: "orld")).to(beEmpty())
+                }
+                
+                it("matches any of the search term parts") {
+                    expect(unindexedIds(matching: "missing worl")).to(equal([interactionId]))
+                    expect(unindexedIds(matching: "x \"to 50\"")).to(equal([interactionId]))
+                    expect(unindexedIds(matching: "x \"to 60\"")).to(beEmpty())
+                }
+                
+                it("treats special characters literally") {
+                    expect(unindexedIds(matching: "50%")).to(equal([interactionId]))
+                    expect(unindexedIds(matching: "5_")).to(beEmpty())
+                    expect(unindexedIds(matching: "a*b")).to(equal([interactionId]))
+                    expect(unindexedIds(matching: "a?b")).to(beEmpty())
+                    expect(unindexedIds(matching: "s*")).to(beEmpty())
+                    expect(unindexedIds(matching: "[h]ello")).to(beEmpty())
+                }
+            }
+        }
+    }
+}
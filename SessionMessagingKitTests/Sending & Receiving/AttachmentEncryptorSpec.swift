@@ -0,0 +1,150 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import CryptoSwift
+import SignalCoreKit
+import SessionUtilitiesKit
+
+import Quick
+import Nimble
+
+@testable import SessionMessagingKit
+
+class AttachmentEncryptorSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        var sourcePath: String!
+        var destinationPath: String!
+        
+        func plaintext(count: Int) -> Data {
+            return Data((0..<count).map { UInt8(truncatingIfNeeded: $0 * 7) })
+        }
+        
+        func encrypt(_ data: Data, shouldPad: Bool = true) throws -> (result: AttachmentEncryptor.Result, payload: Data) {
+            try data.write(to: URL(fileURLWithPath: sourcePath))
+            
+            let result: AttachmentEncryptor.Result = try AttachmentEncryptor.encryptFile(
+                atPath: sourcePath,
+                toPath: destinationPath,
+                shouldPad: shouldPad
+            )
+            
+            return (result, try Data(contentsOf: URL(fileURLWithPath: destinationPath)))
+        }
+        
+        func roundTrip(_ data: Data, shouldPad: Bool = true) throws -> Data {
+            let encrypted: (result: AttachmentEncryptor.Result, payload: Data) = try encrypt(data, shouldPad: shouldPad)
+            
+            return try Cryptography.decryptAttachment(
+                encrypted.payload,
+                withKey: encrypted.result.encryptionKey,
+                digest: encrypted.result.digest,
+                unpaddedSize: UInt32(data.count)
+            )
+        }
+        
+        describe("an AttachmentEncryptor") {
+            beforeEach {
+                let directoryPath: String = NSTemporaryDirectory()
+                sourcePath = (directoryPath as NSString).appendingPathComponent(UUID().uuidString)
+                destinationPath = (directoryPath as NSString).appendingPathComponent(UUID().uuidString)
+            }
+            
+            afterEach {
+                try? FileManager.default.removeItem(atPath: sourcePath)
+                try? FileManager.default.removeItem(atPath: destinationPath)
+            }
+            
+            // MARK: - when encrypting
+            context("when encrypting") {
+                it("produces a payload which can be decrypted by the existing decryption") {
+                    let data: Data = plaintext(count: 1000)
+                    
+                    expect(try roundTrip(data)).to(equal(data))
+                }
+                
+                it("produces a payload which can be decrypted at the padding and block boundaries") {
+                    // Sizes either side of the minimum padded size, the AES block size and the chunk size
+                    let sizes: [Int] = [1, 15, 16, 17, 540, 541, 542, (64 * 1024) - 1, (64 * 1024), (64 * 1024) + 1]
+                    
+                    sizes.forEach { size in
+                        let data: Data = plaintext(count: size)
+                        
+                        expect(try roundTrip(data)).to(equal(data))
+                    }
+                }
+                
+                it("produces a payload which can be decrypted without padding") {
+                    let data: Data = plaintext(count: 32)
+                    
+                    expect(try roundTrip(data, shouldPad: false)).to(equal(data))
+                }
+                
+                it("produces a payload the same size as the existing encryption") {
+                    [1, 16, 541, 1000, (64 * 1024) + 1].forEach { size in
+                        let data: Data = plaintext(count: size)
+                        var encryptionKey: NSData = NSData()
+                        var digest: NSData = NSData()
+                        let expectedPayload: Data? = Cryptography.encryptAttachmentData(
+                            data,
+                            shouldPad: true,
+                            outKey: &encryptionKey,
+                            outDigest: &digest
+                        )
+                        
+                        expect(try encrypt(data).result.encryptedByteCount)
+                            .to(equal(expectedPayload.map { UInt64($0.count) }))
+                    }
+                }
+                
+                it("reports the size of the payload") {
+                    let encrypted: (result: AttachmentEncryptor.Result, payload: Data)? = try? encrypt(plaintext(count: 1000))
+                    
+                    expect(encrypted?.result.encryptedByteCount).to(equal(encrypted.map { UInt64($0.payload.count) }))
+                }
+                
+                it("generates a digest of the whole payload") {
+                    let encrypted: (result: AttachmentEncryptor.Result, payload: Data)? = try? encrypt(plaintext(count: 1000))
+                    
+                    expect(encrypted?.result.digest).to(equal(encrypted.map { Data($0.payload.bytes.sha256()) }))
+                }
+            }
+            
+            // MARK: - when decrypting a modified payload
+            context("when decrypting a modified payload") {
+                it("fails if the digest doesn't match") {
+                    let data: Data = plaintext(count: 1000)
+                    let encrypted: (result: AttachmentEncryptor.Result, payload: Data)? = try? encrypt(data)
+                    var digest: Data = (encrypted?.result.digest ?? Data())
+                    digest[0] ^= 0xff
+                    
+                    expect {
+                        try Cryptography.decryptAttachment(
+                            encrypted?.payload ?? Data(),
+                            withKey: encrypted?.result.encryptionKey ?? Data(),
+                            digest: digest,
+                            unpaddedSize: UInt32(data.count)
+                        )
+                    }.to(throwError())
+                }
+                
+                it("fails if the ciphertext was modified") {
+                    let data: Data = plaintext(count: 1000)
+                    let encrypted: (result: AttachmentEncryptor.Result, payload: Data)? = try? encrypt(data)
+                    var payload: Data = (encrypted?.payload ?? Data())
+                    payload[payload.count / 2] ^= 0xff
+                    
+                    expect {
+                        try Cryptography.decryptAttachment(
+                            payload,
+                            withKey: encrypted?.result.encryptionKey ?? Data(),
+                            digest: Data(payload.bytes.sha256()),
+                            unpaddedSize: UInt32(data.count)
+                        )
+                    }.to(throwError())
+                }
+            }
+        }
+    }
+}
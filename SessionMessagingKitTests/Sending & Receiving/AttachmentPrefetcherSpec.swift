@@ -0,0 +1,279 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+
+import Quick
+import Nimble
+
+@testable import SessionMessagingKit
+
+class AttachmentPrefetcherSpec: QuickSpec {
+    typealias Candidate = AttachmentPrefetcher.Candidate
+    typealias Budget = AttachmentPrefetcher.Budget
+    
+    // MARK: - Spec
+    
+    override func spec() {
+        let wifiBudget: Budget = Budget.current(
+            isReachable: true,
+            isReachableViaWiFi: true,
+            isLowPowerModeEnabled: false,
+            thermalState: .nominal
+        )
+        
+        describe("an AttachmentPrefetcher") {
+            // MARK: - when planning
+            context("when planning") {
+                it("orders the visible rows first followed by the rows in the direction of the scroll") {
+                    let plan: AttachmentPrefetcher.Plan = AttachmentPrefetcher.plan(
+                        rows: (0..<20).map { [AttachmentPrefetcherSpec.candidate(row: $0)] },
+                        visibleRows: 8...9,
+                        rowsPerSecond: 4,
+                        budget: Budget(maxDownloadCount: 4, maxDownloadBytes: .max, maxThumbnailCount: 0),
+                        hasThumbnail: { _ in true }
+                    )
+                    
+                    expect(plan.downloads.map { $0.attachment.id }).to(equal(["8", "9", "10", "11"]))
+                }
+                
+                it("prioritises rows ahead of the scroll over rows behind it") {
+                    let plan: AttachmentPrefetcher.Plan = AttachmentPrefetcher.plan(
+                        rows: (0..<20).map { [AttachmentPrefetcherSpec.candidate(row: $0)] },
+                        visibleRows: 8...9,
+                        rowsPerSecond: -4,
+                        budget: Budget(maxDownloadCount: 6, maxDownloadBytes: .max, maxThumbnailCount: 0),
+                        hasThumbnail: { _ in true }
+                    )
+                    
+                    expect(plan.downloads.map { $0.attachment.id }).to(equal(["8", "9", "7", "6", "5", "10"]))
+                }
+                
+                it("does not download attachments the user's trust settings would not download") {
+                    let plan: AttachmentPrefetcher.Plan = AttachmentPrefetcher.plan(
+                        rows: [
+                            [AttachmentPrefetcherSpec.candidate(row: 0, canAutoDownload: false)],
+                            [AttachmentPrefetcherSpec.candidate(row: 1)]
+                        ],
+                        visibleRows: 0...1,
+                        rowsPerSecond: 0,
+                        budget: wifiBudget,
+                        hasThumbnail: { _ in true }
+                    )
+                    
+                    expect(plan.downloads.map { $0.attachment.id }).to(equal(["1"]))
+                }
+                
+                it("does not exceed the download byte budget") {
+                    let plan: AttachmentPrefetcher.Plan = AttachmentPrefetcher.plan(
+                        rows: (0..<5).map { [AttachmentPrefetcherSpec.candidate(row: $0, byteCount: 1000)] },
+                        visibleRows: 0...4,
+                        rowsPerSecond: 0,
+                        budget: Budget(maxDownloadCount: 5, maxDownloadBytes: 2500, maxThumbnailCount: 0),
+                        hasThumbnail: { _ in true }
+                    )
+                    
+                    expect(plan.downloads.map { $0.attachment.id }).to(equal(["0", "1"]))
+                }
+                
+                it("excludes attachments which have already been scheduled") {
+                    let plan: AttachmentPrefetcher.Plan = AttachmentPrefetcher.plan(
+                        rows: (0..<3).map { [AttachmentPrefetcherSpec.candidate(row: $0)] },
+                        visibleRows: 0...2,
+                        rowsPerSecond: 0,
+                        budget: wifiBudget,
+                        excludedAttachmentIds: ["1"],
+                        hasThumbnail: { _ in true }
+                    )
+                    
+                    expect(plan.downloads.map { $0.attachment.id }).to(equal(["0", "2"]))
+                }
+                
+                it("counts downloads which are still in progress towards the budget") {
+                    let plan: AttachmentPrefetcher.Plan = AttachmentPrefetcher.plan(
+                        rows: (0..<4).map { [AttachmentPrefetcherSpec.candidate(row: $0)] },
+                        visibleRows: 0...3,
+                        rowsPerSecond: 0,
+                        budget: Budget(maxDownloadCount: 3, maxDownloadBytes: .max, maxThumbnailCount: 0),
+                        excludedAttachmentIds: ["0", "1"],
+                        hasThumbnail: { _ in true }
+                    )
+                    
+                    expect(plan.downloads.map { $0.attachment.id }).to(equal(["2"]))
+                }
+                
+                it("generates thumbnails for downloaded images which do not have one") {
+                    let plan: AttachmentPrefetcher.Plan = AttachmentPrefetcher.plan(
+                        rows: [
+                            [AttachmentPrefetcherSpec.candidate(row: 0, state: .downloaded)],
+                            [AttachmentPrefetcherSpec.candidate(row: 1, state: .downloaded)],
+                            [AttachmentPrefetcherSpec.candidate(row: 2, state: .downloaded, size: 100)]
+                        ],
+                        visibleRows: 0...2,
+                        rowsPerSecond: 0,
+                        budget: wifiBudget,
+                        hasThumbnail: { attachment in attachment.id == "1" }
+                    )
+                    
+                    expect(plan.downloads).to(beEmpty())
+                    expect(plan.thumbnails.map { $0.attachment.id }).to(equal(["0"]))
+                }
+            }
+            
+            // MARK: - when determining the budget
+            context("when determining the budget") {
+                it("does not download when the device is in low power mode") {
+                    let budget: Budget = Budget.current(
+                        isReachable: true,
+                        isReachableViaWiFi: true,
+                        isLowPowerModeEnabled: true,
+                        thermalState: .nominal
+                    )
+                    
+                    expect(budget.maxDownloadCount).to(equal(0))
+                }
+                
+                it("downloads less over cellular than over wifi") {
+                    let budget: Budget = Budget.current(
+                        isReachable: true,
+                        isReachableViaWiFi: false,
+                        isLowPowerModeEnabled: false,
+                        thermalState: .nominal
+                    )
+                    
+                    expect(budget.maxDownloadCount).to(beLessThan(wifiBudget.maxDownloadCount))
+                    expect(budget.maxDownloadBytes).to(beLessThan(wifiBudget.maxDownloadBytes))
+                }
+            }
+            
+            // MARK: - when simulating a scroll
+            context("when simulating a scroll") {
+                it("reduces the time placeholders are visible") {
+                    let simulation: PrefetchSimulation = PrefetchSimulation(budget: wifiBudget)
+                    let baselineTime: TimeInterval = simulation.placeholderVisibleTime(usingPrefetcher: false)
+                    let prefetchedTime: TimeInterval = simulation.placeholderVisibleTime(usingPrefetcher: true)
+                    
+                    expect(baselineTime).to(beGreaterThan(0))
+                    expect(prefetchedTime).to(beLessThan(baselineTime * 0.5))
+                }
+            }
+        }
+    }
+    
+    // MARK: - Convenience
+    
+    fileprivate static func candidate(
+        row: Int,
+        state: Attachment.State = .pendingDownload,
+        byteCount: UInt = (100 * 1024),
+        size: UInt = 1000,
+        canAutoDownload: Bool = true
+    ) -> Candidate {
+        return Candidate(
+            threadId: "TestThreadId",
+            interactionId: Int64(row),
+            attachment: Attachment(
+                id: "\(row)",
+                variant: .standard,
+                state: state,
+                contentType: "image/jpeg",
+                byteCount: byteCount,
+                width: size,
+                height: size,
+                isValid: true
+            ),
+            canAutoDownload: canAutoDownload
+        )
+    }
+}
+
+// MARK: - PrefetchSimulation
+
+/// Simulates scrolling through a conversation where every message contains an image which needs to be downloaded and measures
+/// the total time placeholders are visible (summed across the visible rows)
+///
+/// Without the prefetcher a download is only requested when a cell becomes visible, downloads run serially (matching the
+/// `attachmentDownload` job queue)
+private struct PrefetchSimulation {
+    let budget: AttachmentPrefetcher.Budget
+    let rowCount: Int = 120
+    let visibleRowCount: Int = 6
+    let rowsPerSecond: Double = 2
+    let downloadDuration: TimeInterval = 0.25
+    let planInterval: TimeInterval = 0.25
+    let timeStep: TimeInterval = 0.05
+    
+    func placeholderVisibleTime(usingPrefetcher: Bool) -> TimeInterval {
+        let duration: TimeInterval = (Double(rowCount - visibleRowCount) / rowsPerSecond)
+        var time: TimeInterval = 0
+        var lastPlanTime: TimeInterval = -planInterval
+        var requestedRows: Set<Int> = []
+        var downloadedRows: Set<Int> = []
+        var downloadQueue: [Int] = []
+        var currentDownload: (row: Int, completionTime: TimeInterval)?
+        var placeholderVisibleTime: TimeInterval = 0
+        
+        while time <= duration {
+            let firstVisibleRow: Int = min((rowCount - visibleRowCount), Int(time * rowsPerSecond))
+            let visibleRows: ClosedRange<Int> = firstVisibleRow...(firstVisibleRow + visibleRowCount - 1)
+            
+            // Visible cells request their own media
+            visibleRows
+                .filter { !requestedRows.contains($0) }
+                .forEach { row in
+                    requestedRows.insert(row)
+                    downloadQueue.append(row)
+                }
+            
+            if usingPrefetcher && (time - lastPlanTime) >= planInterval {
+                lastPlanTime = time
+                
+                AttachmentPrefetcher
+                    .plan(
+                        rows: (0..<rowCount).map { row in
+                            [
+                                Candidate(
+                                    threadId: "TestThreadId",
+                                    interactionId: Int64(row),
+                                    attachment: Attachment(
+                                        id: "\(row)",
+                                        variant: .standard,
+                                        state: (downloadedRows.contains(row) ? .downloaded : .pendingDownload),
+                                        contentType: "image/jpeg",
+                                        byteCount: (100 * 1024)
+                                    ),
+                                    canAutoDownload: true
+                                )
+                            ]
+                        },
+                        visibleRows: visibleRows,
+                        rowsPerSecond: rowsPerSecond,
+                        budget: budget,
+                        excludedAttachmentIds: Set(requestedRows.map { "\($0)" }),
+                        hasThumbnail: { _ in true }
+                    )
+                    .downloads
+                    .compactMap { Int($0.attachment.id) }
+                    .forEach { row in
+                        requestedRows.insert(row)
+                        downloadQueue.append(row)
+                    }
+            }
+            
+            if let download = currentDownload, download.completionTime <= time {
+                downloadedRows.insert(download.row)
+                currentDownload = nil
+            }
+            
+            if currentDownload == nil && !downloadQueue.isEmpty {
+                currentDownload = (downloadQueue.removeFirst(), (time + downloadDuration))
+            }
+            
+            placeholderVisibleTime += (Double(visibleRows.filter { !downloadedRows.contains($0) }.count) * timeStep)
+            time += timeStep
+        }
+        
+        return placeholderVisibleTime
+    }
+    
+    private typealias Candidate = AttachmentPrefetcher.Candidate
+}
@@ -0,0 +1,117 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import SessionUtilitiesKit
+
+import Quick
+import Nimble
+
+@testable import SessionMessagingKit
+
+class NotificationCoalescerSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        func threadInfo(threadId: String, variant: SessionThread.Variant, numberOfInteractions: Int) -> NotificationBatch.ThreadInfo {
+            return NotificationBatch.ThreadInfo(
+                thread: SessionThread(id: threadId, variant: variant),
+                isMessageRequest: false,
+                interactions: (0..<numberOfInteractions).map { index in
+                    try! Interaction(
+                        threadId: threadId,
+                        authorId: "TestAuthorId",
+                        variant: .standardIncoming,
+                        body: "Test \(index)",
+                        timestampMs: Int64(index)
+                    )
+                },
+                threadName: "TestThreadName",
+                senderName: "TestSenderName",
+                previewText: "Test",
+                currentUserBlindedPublicKey: nil,
+                shouldGroupNotifications: NotificationCoalescer.shouldGroupNotifications(
+                    threadId: threadId,
+                    threadVariant: variant,
+                    numberOfInteractions: numberOfInteractions
+                )
+            )
+        }
+        
+        describe("a NotificationCoalescer") {
+            beforeEach {
+                NotificationCoalescer.allGroupedNotificationsRemoved()
+            }
+            
+            afterEach {
+                NotificationCoalescer.allGroupedNotificationsRemoved()
+            }
+            
+            // MARK: - when determining the notification identifier
+            context("when determining the notification identifier") {
+                it("uses an individual identifier for a single message") {
+                    expect(threadInfo(threadId: "TestId", variant: .contact, numberOfInteractions: 1).notificationIdentifier)
+                        .to(equal("TestId-0"))
+                }
+                
+                it("uses the grouped identifier for multiple messages") {
+                    expect(threadInfo(threadId: "TestId", variant: .contact, numberOfInteractions: 2).notificationIdentifier)
+                        .to(equal("TestId"))
+                }
+                
+                it("uses the grouped identifier for open groups") {
+                    expect(threadInfo(threadId: "TestId", variant: .openGroup, numberOfInteractions: 1).notificationIdentifier)
+                        .to(equal("TestId"))
+                }
+                
+                it("keeps using the grouped identifier once a grouped notification was shown") {
+                    _ = threadInfo(threadId: "TestId", variant: .contact, numberOfInteractions: 2)
+                    
+                    expect(threadInfo(threadId: "TestId", variant: .contact, numberOfInteractions: 1).shouldGroupNotifications)
+                        .to(beTrue())
+                    expect(threadInfo(threadId: "TestId", variant: .contact, numberOfInteractions: 1).notificationIdentifier)
+                        .to(equal("TestId"))
+                }
+                
+                it("doesn't group notifications for other threads") {
+                    _ = threadInfo(threadId: "TestId", variant: .contact, numberOfInteractions: 2)
+                    
+                    expect(threadInfo(threadId: "TestId2", variant: .contact, numberOfInteractions: 1).shouldGroupNotifications)
+                        .to(beFalse())
+                }
+            }
+            
+            // MARK: - when notifications are removed
+            context("when notifications are removed") {
+                beforeEach {
+                    _ = threadInfo(threadId: "TestId", variant: .contact, numberOfInteractions: 2)
+                    _ = threadInfo(threadId: "TestId2", variant: .contact, numberOfInteractions: 2)
+                }
+                
+                it("uses an individual identifier again once the grouped notification was removed") {
+                    NotificationCoalescer.groupedNotificationsRemoved(threadIds: ["TestId"])
+                    
+                    expect(threadInfo(threadId: "TestId", variant: .contact, numberOfInteractions: 1).shouldGroupNotifications)
+                        .to(beFalse())
+                    expect(threadInfo(threadId: "TestId2", variant: .contact, numberOfInteractions: 1).shouldGroupNotifications)
+                        .to(beTrue())
+                }
+                
+                it("ignores individual notification identifiers") {
+                    NotificationCoalescer.groupedNotificationsRemoved(threadIds: ["TestId-0"])
+                    
+                    expect(threadInfo(threadId: "TestId", variant: .contact, numberOfInteractions: 1).shouldGroupNotifications)
+                        .to(beTrue())
+                }
+                
+                it("uses individual identifiers again once all notifications were removed") {
+                    NotificationCoalescer.allGroupedNotificationsRemoved()
+                    
+                    expect(threadInfo(threadId: "TestId", variant: .contact, numberOfInteractions: 1).shouldGroupNotifications)
+                        .to(beFalse())
+                    expect(threadInfo(threadId: "TestId2", variant: .contact, numberOfInteractions: 1).shouldGroupNotifications)
+                        .to(beFalse())
+                }
+            }
+        }
+    }
+}
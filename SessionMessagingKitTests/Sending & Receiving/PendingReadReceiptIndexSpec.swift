@@ -0,0 +1,95 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+
+import Quick
+import Nimble
+
+@testable import SessionMessagingKit
+
+class PendingReadReceiptIndexSpec: QuickSpec {
+    typealias Filter = PendingReadReceiptIndex.Filter
+    typealias Key = PendingReadReceiptIndex.Key
+    
+    // MARK: - Spec
+    
+    override func spec() {
+        let now: TimeInterval = 1_680_000_000
+        let day: TimeInterval = Filter.bucketDuration
+        var filter: Filter!
+        
+        describe("a PendingReadReceiptIndex Filter") {
+            beforeEach {
+                filter = Filter()
+            }
+            
+            // MARK: - when checking for keys
+            context("when checking for keys") {
+                it("contains every inserted key") {
+                    let keys: [Key] = (0..<500).map { Key(threadId: "05\($0 % 10)", interactionTimestampMs: Int64($0)) }
+                    keys.forEach { filter.insert($0, serverExpirationTimestamp: (now + day)) }
+                    
+                    expect(keys.allSatisfy { filter.mightContain($0) }).to(beTrue())
+                }
+                
+                it("rarely matches keys which were not inserted") {
+                    (0..<500).forEach {
+                        filter.insert(
+                            Key(threadId: "05TestId", interactionTimestampMs: Int64($0)),
+                            serverExpirationTimestamp: (now + day)
+                        )
+                    }
+                    
+                    let falsePositiveCount: Int = (1000..<2000)
+                        .filter { filter.mightContain(Key(threadId: "05TestId", interactionTimestampMs: Int64($0))) }
+                        .count
+                    
+                    expect(falsePositiveCount).to(beLessThan(50))
+                }
+                
+                it("does not match anything when empty") {
+                    expect(filter.mightContain(Key(threadId: "05TestId", interactionTimestampMs: 1))).to(beFalse())
+                }
+            }
+            
+            // MARK: - when removing expired entries
+            context("when removing expired entries") {
+                it("removes buckets which only contain receipts that have been collected") {
+                    let expiringKey: Key = Key(threadId: "05TestId", interactionTimestampMs: 1)
+                    let remainingKey: Key = Key(threadId: "05TestId", interactionTimestampMs: 2)
+                    filter.insert(expiringKey, serverExpirationTimestamp: (now + day))
+                    filter.insert(remainingKey, serverExpirationTimestamp: (now + (10 * day)))
+                    
+                    filter.removeExpired(before: (now + (3 * day)))
+                    
+                    expect(filter.bucketCount).to(equal(1))
+                    expect(filter.mightContain(remainingKey)).to(beTrue())
+                }
+                
+                it("keeps buckets which contain receipts that haven't expired yet") {
+                    let key: Key = Key(threadId: "05TestId", interactionTimestampMs: 1)
+                    filter.insert(key, serverExpirationTimestamp: (now + 1))
+                    
+                    filter.removeExpired(before: now)
+                    
+                    expect(filter.mightContain(key)).to(beTrue())
+                }
+                
+                it("keeps expired receipts until they have been collected") {
+                    let key: Key = Key(threadId: "05TestId", interactionTimestampMs: 1)
+                    let expiredKey: Key = Key(threadId: "05TestId", interactionTimestampMs: 2)
+                    filter.insert(key, serverExpirationTimestamp: 0)
+                    filter.insert(expiredKey, serverExpirationTimestamp: (now - (2 * day)))
+                    
+                    expect(filter.mightContain(key)).to(beTrue())
+                    expect(filter.mightContain(expiredKey)).to(beTrue())
+                    
+                    filter.removeExpired(before: now)
+                    
+                    expect(filter.mightContain(key)).to(beFalse())
+                    expect(filter.mightContain(expiredKey)).to(beFalse())
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,154 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionUtilitiesKit
+
+import Quick
+import Nimble
+
+@testable import SessionMessagingKit
+
+class ReactionSenderSpec: QuickSpec {
+    typealias Change = ReactionSender.Change
+    
+    // MARK: - Spec
+    
+    override func spec() {
+        func change(interactionId: Int64 = 1, emoji: String = "👍", remove: Bool, timestampMs: Int64 = 1) -> Change {
+            return Change(
+                threadId: "TestThreadId",
+                interactionId: interactionId,
+                emoji: emoji,
+                remove: remove,
+                sentTimestampMs: timestampMs,
+                reaction: nil
+            )
+        }
+        
+        func summary(_ changes: [Change]) -> [String] {
+            return changes.map { "\($0.interactionId):\($0.emoji):\($0.remove ? "remove" : "add"):\($0.sentTimestampMs)" }
+        }
+        
+        describe("a ReactionSender") {
+            // MARK: - when collapsing changes
+            context("when collapsing changes") {
+                it("adds changes for different reactions") {
+                    let first = ReactionSender.collapse([], adding: change(remove: false))
+                    let second = ReactionSender.collapse(first.changes, adding: change(emoji: "❤️", remove: false))
+                    let third = ReactionSender.collapse(second.changes, adding: change(interactionId: 2, remove: true))
+                    
+                    expect(summary(third.changes)).to(equal(["1:👍:add:1", "1:❤️:add:1", "2:👍:remove:1"]))
+                    expect(first.cancelled).to(beEmpty())
+                    expect(second.cancelled).to(beEmpty())
+                    expect(third.cancelled).to(beEmpty())
+                }
+                
+                it("cancels out an add followed by a remove") {
+                    let added = ReactionSender.collapse([change(emoji: "❤️", remove: false)], adding: change(remove: false))
+                    let removed = ReactionSender.collapse(added.changes, adding: change(remove: true, timestampMs: 2))
+                    
+                    expect(summary(removed.changes)).to(equal(["1:❤️:add:1"]))
+                    expect(summary(removed.cancelled)).to(equal(["1:👍:add:1", "1:👍:remove:2"]))
+                }
+                
+                it("cancels out a remove followed by an add") {
+                    let removed = ReactionSender.collapse([], adding: change(remove: true))
+                    let added = ReactionSender.collapse(removed.changes, adding: change(remove: false, timestampMs: 2))
+                    
+                    expect(added.changes).to(beEmpty())
+                    expect(summary(added.cancelled)).to(equal(["1:👍:remove:1", "1:👍:add:2"]))
+                }
+                
+                it("replaces a pending change in the same direction with the latest one") {
+                    let first = ReactionSender.collapse([], adding: change(remove: false))
+                    let second = ReactionSender.collapse(first.changes, adding: change(remove: false, timestampMs: 2))
+                    
+                    expect(summary(second.changes)).to(equal(["1:👍:add:2"]))
+                    expect(summary(second.cancelled)).to(equal(["1:👍:add:1"]))
+                }
+                
+                it("only sends the net change for rapid toggling") {
+                    let result: [Change] = (0..<5).reduce([]) { changes, index in
+                        ReactionSender.collapse(changes, adding: change(remove: (index % 2 == 1), timestampMs: Int64(index))).changes
+                    }
+                    
+                    expect(summary(result)).to(equal(["1:👍:add:4"]))
+                }
+            }
+            
+            // MARK: - when inserting reactions in bulk
+            context("when inserting reactions in bulk") {
+                var mockStorage: Storage!
+                var interactionId: Int64!
+                
+                beforeEach {
+                    mockStorage = Storage(
+                        customWriter: try! DatabaseQueue(),
+                        customMigrations: [
+                            SNUtilitiesKit.migrations(),
+                            SNMessagingKit.migrations()
+                        ]
+                    )
+                    interactionId = mockStorage.write { db in
+                        try SessionThread(id: "TestThreadId", variant: .contact).insert(db)
+                        
+                        return try Interaction(
+                            threadId: "TestThreadId",
+                            authorId: "TestAuthorId",
+                            variant: .standardIncoming,
+                            body: "Test",
+                            timestampMs: 1234
+                        ).inserted(db).id
+                    }
+                }
+                
+                it("inserts every reaction across multiple statements") {
+                    let reactions: [Reaction] = (0..<250).map { index in
+                        Reaction(
+                            interactionId: interactionId,
+                            serverHash: (index % 2 == 0 ? "TestHash\(index)" : nil),
+                            timestampMs: Int64(index),
+                            authorId: "TestAuthor\(index)",
+                            emoji: (index % 3 == 0 ? "👍" : "❤️"),
+                            count: Int64(index % 5),
+                            sortId: Int64(index % 7)
+                        )
+                    }
+                    
+                    mockStorage.write { db in try Reaction.insertAll(db, reactions) }
+                    
+                    let storedReactions: [Reaction]? = mockStorage.read { db in
+                        try Reaction.order(Reaction.Columns.timestampMs).fetchAll(db)
+                    }
+                    
+                    expect(storedReactions).to(equal(reactions))
+                }
+                
+                it("does nothing when there are no reactions") {
+                    mockStorage.write { db in try Reaction.insertAll(db, []) }
+                    
+                    expect(mockStorage.read { db in try Reaction.fetchCount(db) }).to(equal(0))
+                }
+                
+                it("inserts nothing if any of the reactions fail to insert") {
+                    let reactions: [Reaction] = (0..<150).map { index in
+                        Reaction(
+                            interactionId: (index == 149 ? (interactionId + 1) : interactionId),
+                            serverHash: nil,
+                            timestampMs: Int64(index),
+                            authorId: "TestAuthor\(index)",
+                            emoji: "👍",
+                            count: 1,
+                            sortId: 0
+                        )
+                    }
+                    
+                    mockStorage.write { db in try Reaction.insertAll(db, reactions) }
+                    
+                    expect(mockStorage.read { db in try Reaction.fetchCount(db) }).to(equal(0))
+                }
+            }
+        }
+    }
+}
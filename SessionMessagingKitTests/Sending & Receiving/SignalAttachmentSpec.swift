@@ -0,0 +1,140 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import UIKit
+import MobileCoreServices
+import SignalCoreKit
+import SessionUtilitiesKit
+
+import Quick
+import Nimble
+
+@testable import SessionMessagingKit
+
+class SignalAttachmentSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        let photoSize: CGSize = CGSize(width: 4000, height: 3000)
+        
+        /// Generate a PNG of random noise (which compresses very poorly so needs to use a low quality tier)
+        func noiseImageData(width: Int, height: Int) -> Data {
+            var pixels: Data = Randomness.generateRandomBytes(Int32(width * height * 4))
+            
+            return pixels.withUnsafeMutableBytes { bytes -> Data in
+                let context: CGContext = CGContext(
+                    data: bytes.baseAddress,
+                    width: width,
+                    height: height,
+                    bitsPerComponent: 8,
+                    bytesPerRow: (width * 4),
+                    space: CGColorSpaceCreateDeviceRGB(),
+                    bitmapInfo: CGImageAlphaInfo.noneSkipLast.rawValue
+                )!
+                
+                return UIImage(cgImage: context.makeImage()!).pngData()!
+            }
+        }
+        
+        describe("a SignalAttachment") {
+            // MARK: - when predicting the quality tier
+            context("when predicting the quality tier") {
+                it("uses the first tier for a photo with typical detail") {
+                    expect(
+                        SignalAttachment.predictedImageQualityTier(
+                            imageSize: photoSize,
+                            sourceDataLength: 6_000_000,
+                            imageQuality: .medium
+                        )
+                    ).to(equal(.mediumHigh))
+                }
+                
+                it("skips the tiers which are predicted to be too large for a detailed photo") {
+                    expect(
+                        SignalAttachment.predictedImageQualityTier(
+                            imageSize: photoSize,
+                            sourceDataLength: 24_000_000,
+                            imageQuality: .medium
+                        )
+                    ).to(equal(.medium))
+                    expect(
+                        SignalAttachment.predictedImageQualityTier(
+                            imageSize: photoSize,
+                            sourceDataLength: 24_000_000,
+                            imageQuality: .compact
+                        )
+                    ).to(equal(.mediumLow))
+                }
+                
+                it("uses the first tier for an image which doesn't need to be resized") {
+                    expect(
+                        SignalAttachment.predictedImageQualityTier(
+                            imageSize: CGSize(width: 800, height: 600),
+                            sourceDataLength: 240_000,
+                            imageQuality: .compact
+                        )
+                    ).to(equal(.medium))
+                }
+                
+                it("uses the last tier for a very large image") {
+                    expect(
+                        SignalAttachment.predictedImageQualityTier(
+                            imageSize: CGSize(width: 20000, height: 20000),
+                            sourceDataLength: 600_000_000,
+                            imageQuality: .compact
+                        )
+                    ).to(equal(.low))
+                }
+            }
+            
+            // MARK: - when searching for the compression quality
+            context("when searching for the compression quality") {
+                /// The output "size" is proportional to the quality and is acceptable up to the provided limit
+                func search(limit: Int) -> Int {
+                    return SignalAttachment.searchCompressionQuality(
+                        lowerQuality: 0.8,
+                        lowerOutput: 800,
+                        upperQuality: 0.9,
+                        encode: { quality -> Int? in
+                            let size: Int = Int((quality * 1000).rounded())
+                            
+                            return (size <= limit ? size : nil)
+                        }
+                    )
+                }
+                
+                it("returns the output for the highest acceptable quality") {
+                    expect(search(limit: 850)).to(equal(850))
+                }
+                
+                it("never returns an output above the limit") {
+                    expect(search(limit: 830)).to(beLessThanOrEqualTo(830))
+                    expect(search(limit: 830)).to(beGreaterThan(800))
+                }
+                
+                it("returns the lower output when no higher quality is acceptable") {
+                    expect(search(limit: 800)).to(equal(800))
+                }
+            }
+            
+            // MARK: - when compressing an image
+            context("when compressing an image") {
+                it("produces a JPEG within the file size limit for the image quality") {
+                    let dataSource: DataSource? = DataSourceValue.dataSource(
+                        with: noiseImageData(width: 1200, height: 1200),
+                        fileExtension: "png"
+                    )
+                    let attachment: SignalAttachment = SignalAttachment.attachment(
+                        dataSource: dataSource,
+                        dataUTI: (kUTTypePNG as String),
+                        imageQuality: .compact
+                    )
+                    
+                    expect(attachment.error).to(beNil())
+                    expect(attachment.dataUTI).to(equal(kUTTypeJPEG as String))
+                    expect(attachment.dataLength).to(beLessThanOrEqualTo(400 * 1024))
+                    expect(attachment.image().map { max($0.size.width, $0.size.height) }).to(beLessThanOrEqualTo(1024))
+                }
+            }
+        }
+    }
+}
@@ -14,4 +14,12 @@ class MockBox: Mock<BoxType>, BoxType {
     func open(anonymousCipherText: Bytes, recipientPublicKey: Bytes, recipientSecretKey: Bytes) -> Bytes? {
         return accept(args: [anonymousCipherText, recipientPublicKey, recipientSecretKey]) as? Bytes
     }
+    
+    func open(anonymousCipherText: Bytes, recipientPublicKey: Bytes, recipientSecretKey: UnsafeRawBufferPointer) -> Bytes? {
+        return open(
+            anonymousCipherText: anonymousCipherText,
+            recipientPublicKey: recipientPublicKey,
+            recipientSecretKey: Array(recipientSecretKey)
+        )
+    }
 }
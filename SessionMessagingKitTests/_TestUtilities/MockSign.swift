@@ -14,6 +14,10 @@ class MockSign: Mock<SignType>, SignType {
         return accept(args: [message, secretKey]) as? Bytes
     }
     
+    func signature(message: Bytes, secretKey: UnsafeRawBufferPointer) -> Bytes? {
+        return signature(message: message, secretKey: Array(secretKey))
+    }
+    
     func verify(message: Bytes, publicKey: Bytes, signature: Bytes) -> Bool {
         return accept(args: [message, publicKey, signature]) as! Bool
     }
@@ -9,119 +9,102 @@ import SessionMessagingKit
 public class NSENotificationPresenter: NSObject, NotificationsProtocol {
     private var notifications: [String: UNNotificationRequest] = [:]
      
-    public func notifyUser(_ db: Database, for interaction: Interaction, in thread: SessionThread) {
-        let isMessageRequest: Bool = thread.isMessageRequest(db, includeNonVisible: true)
-        
-        // Ensure we should be showing a notification for the thread
-        guard thread.shouldShowNotification(db, for: interaction, isMessageRequest: isMessageRequest) else {
-            return
-        }
-        
-        let senderName: String = Profile.displayName(db, id: interaction.authorId, threadVariant: thread.variant)
-        let groupName: String = SessionThread.displayName(
-            threadId: thread.id,
-            variant: thread.variant,
-            closedGroupName: (try? thread.closedGroup.fetchOne(db))?.name,
-            openGroupName: (try? thread.openGroup.fetchOne(db))?.name
-        )
-        var notificationTitle: String = senderName
-        
-        if thread.variant == .closedGroup || thread.variant == .openGroup {
-            if thread.onlyNotifyForMentions && !interaction.hasMention {
-                // Ignore PNs if the group is set to only notify for mentions
-                return
+    public func notifyUser(for batch: NotificationBatch) {
+        batch.threads.forEach { threadInfo in
+            let thread: SessionThread = threadInfo.thread
+            let numberOfMessages: Int = threadInfo.interactions.count
+            var notificationTitle: String = threadInfo.senderName
+            
+            if thread.variant == .closedGroup || thread.variant == .openGroup {
+                notificationTitle = String(
+                    format: NotificationStrings.incomingGroupMessageTitleFormat,
+                    threadInfo.senderName,
+                    threadInfo.threadName
+                )
             }
             
-            notificationTitle = String(
-                format: NotificationStrings.incomingGroupMessageTitleFormat,
-                senderName,
-                groupName
-            )
-        }
-        
-        let snippet: String = (interaction.previewText(db)
-            .filterForDisplay?
-            .replacingMentions(for: thread.id))
-            .defaulting(to: "APN_Message".localized())
-        
-        var userInfo: [String: Any] = [ NotificationServiceExtension.isFromRemoteKey: true ]
-        userInfo[NotificationServiceExtension.threadIdKey] = thread.id
-        
-        let notificationContent = UNMutableNotificationContent()
-        notificationContent.userInfo = userInfo
-        notificationContent.sound = thread.notificationSound
-            .defaulting(to: db[.defaultNotificationSound] ?? Preferences.Sound.defaultNotificationSound)
-            .notificationSound(isQuiet: false)
-        
-        // Badge Number
-        let newBadgeNumber = CurrentAppContext().appUserDefaults().integer(forKey: "currentBadgeNumber") + 1
-        notificationContent.badge = NSNumber(value: newBadgeNumber)
-        CurrentAppContext().appUserDefaults().set(newBadgeNumber, forKey: "currentBadgeNumber")
-        
-        // Title & body
-        let previewType: Preferences.NotificationPreviewType = db[.preferencesNotificationPreviewType]
-            .defaulting(to: .defaultPreviewType)
-        
-        switch previewType {
-            case .nameAndPreview:
-                notificationContent.title = notificationTitle
-                notificationContent.body = snippet
-        
-            case .nameNoPreview:
-                notificationContent.title = notificationTitle
-                notificationContent.body = NotificationStrings.incomingMessageBody
-                
-            case .noNameNoPreview:
+            let snippet: String = (threadInfo.previewText
+                .filterForDisplay?
+                .replacingMentions(for: thread.id))
+                .defaulting(to: "APN_Message".localized())
+            
+            var userInfo: [String: Any] = [ NotificationServiceExtension.isFromRemoteKey: true ]
+            userInfo[NotificationServiceExtension.threadIdKey] = thread.id
+            
+            let notificationContent = UNMutableNotificationContent()
+            notificationContent.userInfo = userInfo
+            notificationContent.sound = thread.notificationSound
+                .defaulting(to: batch.defaultSound)
+                .notificationSound(isQuiet: false)
+            
+            // Badge Number
+            let newBadgeNumber = CurrentAppContext().appUserDefaults().integer(forKey: "currentBadgeNumber") + numberOfMessages
+            notificationContent.badge = NSNumber(value: newBadgeNumber)
+            CurrentAppContext().appUserDefaults().set(newBadgeNumber, forKey: "currentBadgeNumber")
+            
+            // Title & body
+            switch batch.previewType {
+                case .nameAndPreview:
+                    notificationContent.title = notificationTitle
+                    notificationContent.body = snippet
+            
+                case .nameNoPreview:
+                    notificationContent.title = notificationTitle
+                    notificationContent.body = NotificationStrings.incomingMessageBody
+                    
+                case .noNameNoPreview:
+                    notificationContent.title = "Session"
+                    notificationContent.body = NotificationStrings.incomingMessageBody
+            }
+            
+            // If it's a message request then overwrite the body to be something generic (only show a notification
+            // when receiving a new message request if there aren't any others or the user had hidden them)
+            if threadInfo.isMessageRequest {
                 notificationContent.title = "Session"
-                notificationContent.body = NotificationStrings.incomingMessageBody
-        }
-        
-        // If it's a message request then overwrite the body to be something generic (only show a notification
-        // when receiving a new message request if there aren't any others or the user had hidden them)
-        if isMessageRequest {
-            notificationContent.title = "Session"
-            notificationContent.body = "MESSAGE_REQUESTS_NOTIFICATION".localized()
-        }
-        
-        // Add request (try to group notifications for interactions from open groups)
-        let identifier: String = interaction.notificationIdentifier(
-            shouldGroupMessagesForThread: (thread.variant == .openGroup)
-        )
-        var trigger: UNNotificationTrigger?
-        
-        if thread.variant == .openGroup {
-            trigger = UNTimeIntervalNotificationTrigger(
-                timeInterval: Notifications.delayForGroupedNotifications,
-                repeats: false
-            )
+                notificationContent.body = "MESSAGE_REQUESTS_NOTIFICATION".localized()
+            }
             
-            let numberExistingNotifications: Int? = notifications[identifier]?
-                .content
-                .userInfo[NotificationServiceExtension.threadNotificationCounter]
-                .asType(Int.self)
-            var numberOfNotifications: Int = (numberExistingNotifications ?? 1)
+            // Add request (try to group notifications for interactions from open groups, when multiple
+            // messages were received for the thread within the batch or when the thread already has a
+            // grouped notification)
+            let shouldGroupNotification: Bool = threadInfo.shouldGroupNotifications
+            let identifier: String = threadInfo.notificationIdentifier
+            var trigger: UNNotificationTrigger?
             
-            if numberExistingNotifications != nil {
-                numberOfNotifications += 1  // Add one for the current notification
+            if shouldGroupNotification {
+                if thread.variant == .openGroup {
+                    trigger = UNTimeIntervalNotificationTrigger(
+                        timeInterval: Notifications.delayForGroupedNotifications,
+                        repeats: false
+                    )
+                }
                 
-                notificationContent.title = (previewType == .noNameNoPreview ?
-                    notificationContent.title :
-                    groupName
-                )
-                notificationContent.body = String(
-                    format: NotificationStrings.incomingCollapsedMessagesBody,
-                    "\(numberOfNotifications)"
-                )
+                let numberExistingNotifications: Int? = notifications[identifier]?
+                    .content
+                    .userInfo[NotificationServiceExtension.threadNotificationCounter]
+                    .asType(Int.self)
+                let numberOfNotifications: Int = ((numberExistingNotifications ?? 0) + numberOfMessages)
+                
+                if numberOfNotifications > 1 {
+                    notificationContent.title = (batch.previewType == .noNameNoPreview ?
+                        notificationContent.title :
+                        threadInfo.threadName
+                    )
+                    notificationContent.body = String(
+                        format: NotificationStrings.incomingCollapsedMessagesBody,
+                        "\(numberOfNotifications)"
+                    )
+                }
+                
+                notificationContent.userInfo[NotificationServiceExtension.threadNotificationCounter] = numberOfNotifications
             }
             
-            notificationContent.userInfo[NotificationServiceExtension.threadNotificationCounter] = numberOfNotifications
+            addNotifcationRequest(
+                identifier: identifier,
+                notificationContent: notificationContent,
+                trigger: trigger
+            )
         }
-        
-        addNotifcationRequest(
-            identifier: identifier,
-            notificationContent: notificationContent,
-            trigger: trigger
-        )
     }
     
     public func notifyUser(_ db: Database, forIncomingCall interaction: Interaction, in thread: SessionThread) {
@@ -215,12 +198,16 @@ public class NSENotificationPresenter: NSObject, NotificationsProtocol {
         let notificationCenter = UNUserNotificationCenter.current()
         notificationCenter.removePendingNotificationRequests(withIdentifiers: identifiers)
         notificationCenter.removeDeliveredNotifications(withIdentifiers: identifiers)
+        
+        // The grouped notification identifier for a thread is the thread id
+        NotificationCoalescer.groupedNotificationsRemoved(threadIds: identifiers)
     }
     
     public func clearAllNotifications() {
         let notificationCenter = UNUserNotificationCenter.current()
         notificationCenter.removeAllPendingNotificationRequests()
         notificationCenter.removeAllDeliveredNotifications()
+        NotificationCoalescer.allGroupedNotificationsRemoved()
     }
     
     private func addNotifcationRequest(identifier: String, notificationContent: UNNotificationContent, trigger: UNNotificationTrigger?) {
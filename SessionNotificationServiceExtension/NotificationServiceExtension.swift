@@ -7,6 +7,7 @@ import UserNotifications
 import BackgroundTasks
 import PromiseKit
 import SessionMessagingKit
+import SessionUtilitiesKit
 import SignalUtilitiesKit
 
 public final class NotificationServiceExtension: UNNotificationServiceExtension {
@@ -173,6 +174,7 @@ public final class NotificationServiceExtension: UNNotificationServiceExtension
 
         // This should be the first thing we do.
         SetCurrentAppContext(NotificationServiceExtensionContext())
+        LaunchTiming.start("NotificationServiceExtension")
 
         _ = AppVersion.sharedInstance()
 
@@ -185,7 +187,9 @@ public final class NotificationServiceExtension: UNNotificationServiceExtension
         // and don't disturb the user. Messages will be processed when they open the app.
         guard Storage.shared[.isReadyForAppExtensions] else { return completeSilenty() }
 
+        // Note: The extension only processes a single message at a time so doesn't need many reader connections
         AppSetup.setupEnvironment(
+            prewarmReaderCount: 1,
             appSpecificBlock: {
                 Environment.shared?.notificationsManager.mutate {
                     $0 = NSENotificationPresenter()
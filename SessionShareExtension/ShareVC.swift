@@ -3,6 +3,7 @@
 import UIKit
 import CoreServices
 import PromiseKit
+import SessionUtilitiesKit
 import SignalUtilitiesKit
 import SessionUIKit
 
@@ -32,6 +33,8 @@ final class ShareVC: UINavigationController, ShareViewDelegate {
             SetCurrentAppContext(appContext)
         }
         
+        LaunchTiming.start("ShareExtension")
+        
         // Need to manually trigger these since we don't have a "mainWindow" here and the current theme
         // might have been changed since the share extension was last opened
         ThemeManager.applySavedTheme()
@@ -0,0 +1,211 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import SessionUtilitiesKit
+
+/// The snode pool and swarms are cached in memory and get updated frequently (particularly when a number of paths fail at the same
+/// time and each failure drops a snode) so rather than rewriting the entire pool or swarm on every change the `PendingSnodeChanges`
+/// tracks the difference between what has been persisted and what is in memory so that only the changed rows need to be written
+///
+/// **Note:** Deleting a `Snode` also deletes any `SnodeSet` rows which reference it (ie. swarm and onion request path entries)
+/// so snodes which get updated are upserted rather than deleted and re-inserted
+internal struct PendingSnodeChanges {
+    /// The maximum number of rows to include in a single statement (to avoid hitting the SQLite variable and expression depth limits)
+    static let maxRowsPerStatement: Int = 100
+    
+    private(set) var shouldClearPool: Bool = false
+    private(set) var poolInsertions: Set<Snode> = []
+    private(set) var poolDeletions: Set<Snode> = []
+    private(set) var swarmInsertions: [String: Set<Snode>] = [:]
+    private(set) var swarmDeletions: [String: Set<Snode>] = [:]
+    
+    var isEmpty: Bool {
+        !shouldClearPool &&
+        poolInsertions.isEmpty &&
+        poolDeletions.isEmpty &&
+        swarmInsertions.values.allSatisfy { $0.isEmpty } &&
+        swarmDeletions.values.allSatisfy { $0.isEmpty }
+    }
+    
+    // MARK: - Tracking
+    
+    mutating func updatePool(from oldValue: Set<Snode>, to newValue: Set<Snode>) {
+        let insertions: Set<Snode> = newValue.subtracting(oldValue)
+        let deletions: Set<Snode> = oldValue.subtracting(newValue)
+        
+        (poolInsertions, poolDeletions) = PendingSnodeChanges.combine(
+            (poolInsertions, poolDeletions),
+            with: (insertions, deletions)
+        )
+    }
+    
+    mutating func updateSwarm(for key: String, from oldValue: Set<Snode>, to newValue: Set<Snode>) {
+        let insertions: Set<Snode> = newValue.subtracting(oldValue)
+        let deletions: Set<Snode> = oldValue.subtracting(newValue)
+        
+        (swarmInsertions[key], swarmDeletions[key]) = PendingSnodeChanges.combine(
+            ((swarmInsertions[key] ?? []), (swarmDeletions[key] ?? [])),
+            with: (insertions, deletions)
+        )
+    }
+    
+    /// Clearing the pool removes every snode (and, as a result, every swarm and onion request path) so any previously tracked
+    /// changes no longer need to be applied
+    mutating func clearPool() {
+        self = PendingSnodeChanges()
+        shouldClearPool = true
+    }
+    
+    /// Combine these changes with changes which were made after them (eg. when these changes failed to be persisted and need to
+    /// be retried along with any changes made since), the result is equivalent to applying these changes followed by `newerChanges`
+    func merging(_ newerChanges: PendingSnodeChanges) -> PendingSnodeChanges {
+        guard !newerChanges.shouldClearPool else { return newerChanges }
+        
+        var result: PendingSnodeChanges = self
+        (result.poolInsertions, result.poolDeletions) = PendingSnodeChanges.combine(
+            (poolInsertions, poolDeletions),
+            with: (newerChanges.poolInsertions, newerChanges.poolDeletions)
+        )
+        
+        Set(newerChanges.swarmInsertions.keys)
+            .union(newerChanges.swarmDeletions.keys)
+            .forEach { key in
+                (result.swarmInsertions[key], result.swarmDeletions[key]) = PendingSnodeChanges.combine(
+                    ((swarmInsertions[key] ?? []), (swarmDeletions[key] ?? [])),
+                    with: ((newerChanges.swarmInsertions[key] ?? []), (newerChanges.swarmDeletions[key] ?? []))
+                )
+            }
+        
+        return result
+    }
+    
+    /// Combine pending insertions and deletions with a subsequent change, the pending changes are relative to the persisted state so
+    /// re-adding a pending deletion (or removing a pending insertion) cancels it out rather than being written as a new change
+    private static func combine(
+        _ pending: (insertions: Set<Snode>, deletions: Set<Snode>),
+        with change: (insertions: Set<Snode>, deletions: Set<Snode>)
+    ) -> (insertions: Set<Snode>, deletions: Set<Snode>) {
+        return (
+            pending.insertions
+                .subtracting(change.deletions)
+                .union(change.insertions.subtracting(pending.deletions)),
+            pending.deletions
+                .subtracting(change.insertions)
+                .union(change.deletions.subtracting(pending.insertions))
+        )
+    }
+    
+    // MARK: - Persistence
+    
+    func apply(_ db: Database) throws {
+        if shouldClearPool {
+            _ = try Snode.deleteAll(db)
+        }
+        
+        // Snodes which are being upserted shouldn't be deleted (otherwise their swarm entries would also be deleted)
+        let upsertedSnodes: Set<Snode> = swarmInsertions.values.reduce(poolInsertions) { $0.union($1) }
+        let upsertedKeys: Set<String> = upsertedSnodes.map { $0.description }.asSet()
+        
+        try Snode.deleteAll(db, snodes: poolDeletions.filter { !upsertedKeys.contains($0.description) })
+        try Snode.upsertAll(db, snodes: upsertedSnodes)
+        
+        try swarmDeletions.forEach { key, snodes in try SnodeSet.deleteAll(db, key: key, snodes: snodes) }
+        try swarmInsertions.forEach { key, snodes in try SnodeSet.insertAll(db, key: key, snodes: snodes) }
+    }
+}
+
+// MARK: - GRDB Interactions
+
+fileprivate extension Snode {
+    static func deleteAll(_ db: Database, snodes: Set<Snode>) throws {
+        try Array(snodes)
+            .chunked(by: PendingSnodeChanges.maxRowsPerStatement)
+            .forEach { chunk in
+                _ = try Snode
+                    .filter(
+                        chunk
+                            .map { Snode.Columns.address == $0.address && Snode.Columns.port == $0.port }
+                            .joined(operator: .or)
+                    )
+                    .deleteAll(db)
+            }
+    }
+    
+    /// Insert or update the snodes using multi-row statements
+    ///
+    /// **Note:** A `REPLACE` would delete the existing row (and cascade to the `SnodeSet` table) so this needs to use an upsert
+    static func upsertAll(_ db: Database, snodes: Set<Snode>) throws {
+        let columns: [Columns] = [.address, .port, .ed25519PublicKey, .x25519PublicKey]
+        let rowPlaceholder: String = "(\(columns.map { _ in "?" }.joined(separator: ", ")))"
+        let columnNames: String = columns
+            .map { $0.name.quotedDatabaseIdentifier }
+            .joined(separator: ", ")
+        
+        try Array(snodes)
+            .chunked(by: PendingSnodeChanges.maxRowsPerStatement)
+            .forEach { chunk in
+                try db.execute(
+                    sql: """
+                        INSERT INTO \(databaseTableName.quotedDatabaseIdentifier) (\(columnNames))
+                        VALUES \(chunk.map { _ in rowPlaceholder }.joined(separator: ", "))
+                        ON CONFLICT(\(Columns.address.name.quotedDatabaseIdentifier), \(Columns.port.name.quotedDatabaseIdentifier))
+                        DO UPDATE SET
+                            \(Columns.ed25519PublicKey.name.quotedDatabaseIdentifier) = excluded.\(Columns.ed25519PublicKey.name.quotedDatabaseIdentifier),
+                            \(Columns.x25519PublicKey.name.quotedDatabaseIdentifier) = excluded.\(Columns.x25519PublicKey.name.quotedDatabaseIdentifier)
+                    """,
+                    arguments: StatementArguments(
+                        chunk.flatMap { snode -> [DatabaseValueConvertible?] in
+                            [
+                                snode.address,
+                                snode.port,
+                                snode.ed25519PublicKey,
+                                snode.x25519PublicKey
+                            ]
+                        }
+                    )
+                )
+            }
+    }
+}
+
+fileprivate extension SnodeSet {
+    static func deleteAll(_ db: Database, key: String, snodes: Set<Snode>) throws {
+        try Array(snodes)
+            .chunked(by: PendingSnodeChanges.maxRowsPerStatement)
+            .forEach { chunk in
+                _ = try SnodeSet
+                    .filter(SnodeSet.Columns.key == key)
+                    .filter(
+                        chunk
+                            .map { SnodeSet.Columns.address == $0.address && SnodeSet.Columns.port == $0.port }
+                            .joined(operator: .or)
+                    )
+                    .deleteAll(db)
+            }
+    }
+    
+    /// Add the snodes to the end of the set (the snodes themselves must already exist)
+    static func insertAll(_ db: Database, key: String, snodes: Set<Snode>) throws {
+        guard !snodes.isEmpty else { return }
+        
+        let maxNodeIndex: Int? = try SnodeSet
+            .select(max(SnodeSet.Columns.nodeIndex))
+            .filter(SnodeSet.Columns.key == key)
+            .asRequest(of: Int.self)
+            .fetchOne(db)
+        let initialNodeIndex: Int = (maxNodeIndex.map { $0 + 1 } ?? 0)
+        
+        try Array(snodes)
+            .enumerated()
+            .map { index, snode in
+                SnodeSet(
+                    key: key,
+                    nodeIndex: (initialNodeIndex + index),
+                    address: snode.address,
+                    port: snode.port
+                )
+            }
+            .forEach { try $0.insert(db) }
+    }
+}
@@ -0,0 +1,100 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import PromiseKit
+import Sodium
+
+/// Deletions and expiry updates tend to happen in bursts (eg. when processing a number of unsend requests or expiring a number of
+/// disappearing messages) so rather than sending a request for each operation the `SnodeAPI` collects them for a short window and
+/// sends a single request for each swarm, the `PendingRemoteMutations` tracks the operations which are waiting to be sent
+///
+/// **Note:** Server hashes are de-duplicated and keep the order they were added in since the order is part of the signature, only
+/// the user's ed25519 public key is stored as the requests get signed with the secret key when they are sent
+internal struct PendingRemoteMutations {
+    typealias DeletionResult = [String: Bool]
+    typealias ExpiryResult = [String: (hashes: [String], expiry: UInt64)]
+    
+    struct ExpiryKey: Hashable {
+        let expiryMs: UInt64
+        let ed25519PublicKey: Bytes
+    }
+    
+    struct Hashes {
+        private(set) var values: [String] = []
+        private var knownValues: Set<String> = []
+        
+        mutating func append(contentsOf hashes: [String]) {
+            hashes.forEach { hash in
+                guard !knownValues.contains(hash) else { return }
+                
+                knownValues.insert(hash)
+                values.append(hash)
+            }
+        }
+    }
+    
+    struct Deletion {
+        let userPublicKey: String
+        let ed25519PublicKey: Bytes
+        var serverHashes: Hashes = Hashes()
+        var seals: [Resolver<DeletionResult>] = []
+    }
+    
+    struct Expiry {
+        let ed25519PublicKey: Bytes
+        var serverHashes: Hashes = Hashes()
+        var seals: [Resolver<ExpiryResult>] = []
+    }
+    
+    struct Mutations {
+        var deletion: Deletion?
+        var expiries: [ExpiryKey: Expiry] = [:]
+    }
+    
+    /// The pending mutations keyed by the public key of the swarm they need to be sent to
+    private(set) var mutations: [String: Mutations] = [:]
+    
+    var isEmpty: Bool { mutations.isEmpty }
+    
+    // MARK: - Tracking
+    
+    mutating func addDeletion(
+        publicKey: String,
+        userPublicKey: String,
+        ed25519PublicKey: Bytes,
+        serverHashes: [String],
+        seal: Resolver<DeletionResult>
+    ) {
+        var deletion: Deletion = (
+            mutations[publicKey]?.deletion ??
+            Deletion(userPublicKey: userPublicKey, ed25519PublicKey: ed25519PublicKey)
+        )
+        deletion.serverHashes.append(contentsOf: serverHashes)
+        deletion.seals.append(seal)
+        
+        mutations[publicKey, default: Mutations()].deletion = deletion
+    }
+    
+    mutating func addExpiry(
+        publicKey: String,
+        ed25519PublicKey: Bytes,
+        updatedExpiryMs: UInt64,
+        serverHashes: [String],
+        seal: Resolver<ExpiryResult>
+    ) {
+        let key: ExpiryKey = ExpiryKey(expiryMs: updatedExpiryMs, ed25519PublicKey: ed25519PublicKey)
+        var expiry: Expiry = (mutations[publicKey]?.expiries[key] ?? Expiry(ed25519PublicKey: ed25519PublicKey))
+        expiry.serverHashes.append(contentsOf: serverHashes)
+        expiry.seals.append(seal)
+        
+        mutations[publicKey, default: Mutations()].expiries[key] = expiry
+    }
+    
+    /// Remove and return all of the pending mutations
+    mutating func removeAll() -> [String: Mutations] {
+        let result: [String: Mutations] = mutations
+        mutations = [:]
+        
+        return result
+    }
+}
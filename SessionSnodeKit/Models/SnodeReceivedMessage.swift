@@ -16,7 +16,7 @@ public struct SnodeReceivedMessage: CustomDebugStringConvertible {
 
         guard
             let base64EncodedString: String = rawMessage["data"] as? String,
-            let data: Data = Data(base64Encoded: base64EncodedString)
+            let data: Data = Base64.decodedData(base64EncodedString)
         else {
             SNLog("Failed to decode data for message: \(rawMessage).")
             return nil
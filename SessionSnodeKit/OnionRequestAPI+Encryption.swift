@@ -58,7 +58,7 @@ internal extension OnionRequestAPI {
                     parameters = [ "host" : host, "target" : target, "method" : "POST", "protocol" : scheme, "port" : port ]
             }
             
-            parameters["ephemeral_key"] = previousEncryptionResult.ephemeralPublicKey.toHexString()
+            parameters["ephemeral_key"] = Hex.encodedString(previousEncryptionResult.ephemeralPublicKey)
             
             let x25519PublicKey: String
             
@@ -438,7 +438,7 @@ public enum OnionRequestAPI: OnionRequestAPIType {
                         SNLog("Approaching request size limit: ~\(onion.count) bytes.")
                     }
                     let parameters: JSON = [
-                        "ephemeral_key" : finalEncryptionResult.ephemeralPublicKey.toHexString()
+                        "ephemeral_key" : Hex.encodedString(finalEncryptionResult.ephemeralPublicKey)
                     ]
                     let body: Data
                     do {
@@ -645,7 +645,7 @@ public enum OnionRequestAPI: OnionRequestAPIType {
                     return seal.reject(HTTP.Error.invalidJSON)
                 }
                 
-                guard let base64EncodedIVAndCiphertext = json["result"] as? String, let ivAndCiphertext = Data(base64Encoded: base64EncodedIVAndCiphertext), ivAndCiphertext.count >= AESGCM.ivSize else {
+                guard let base64EncodedIVAndCiphertext = json["result"] as? String, let ivAndCiphertext = Base64.decodedData(base64EncodedIVAndCiphertext), ivAndCiphertext.count >= AESGCM.ivSize else {
                     return seal.reject(HTTP.Error.invalidJSON)
                 }
                 
@@ -10,8 +10,12 @@ public final class SnodeAPI {
     private static let sodium = Sodium()
     
     private static var hasLoadedSnodePool: Atomic<Bool> = Atomic(false)
-    private static var loadedSwarms: Atomic<Set<String>> = Atomic([])
+    private static var loadedSwarms: Atomic<[String: Atomic<Bool>]> = Atomic([:])
     private static var getSnodePoolPromise: Atomic<Promise<Set<Snode>>?> = Atomic(nil)
+    private static var pendingSnodeChanges: Atomic<PendingSnodeChanges> = Atomic(PendingSnodeChanges())
+    private static var hasScheduledSnodeChangesPersist: Atomic<Bool> = Atomic(false)
+    private static var pendingRemoteMutations: Atomic<PendingRemoteMutations> = Atomic(PendingRemoteMutations())
+    private static var hasScheduledRemoteMutations: Atomic<Bool> = Atomic(false)
     
     /// - Note: Should only be accessed from `Threading.workQueue` to avoid race conditions.
     internal static var snodeFailureCount: Atomic<[Snode: UInt]> = Atomic([:])
@@ -58,6 +62,18 @@ public final class SnodeAPI {
     private static let snodeFailureThreshold = 3
     private static let targetSwarmSnodeCount = 2
     private static let minSnodePoolCount = 12
+    private static let swarmRefreshInterval: TimeInterval = (2 * 60 * 60)
+    
+    internal static let swarmResolver: SwarmResolver = SwarmResolver(
+        minSwarmSnodeCount: minSwarmSnodeCount,
+        refreshInterval: swarmRefreshInterval,
+        loadSwarm: { publicKey in
+            loadSwarmIfNeeded(for: publicKey)
+            
+            return (swarmCache.wrappedValue[publicKey] ?? [])
+        },
+        fetchSwarm: { publicKey in fetchSwarm(for: publicKey) }
+    )
 
     // MARK: Snode Pool Interaction
     
@@ -75,18 +91,14 @@ public final class SnodeAPI {
     }
     
     private static func setSnodePool(to newValue: Set<Snode>, db: Database? = nil) {
+        let oldValue: Set<Snode> = snodePool.wrappedValue
         snodePool.mutate { $0 = newValue }
+        pendingSnodeChanges.mutate { $0.updatePool(from: oldValue, to: newValue) }
         
-        if let db: Database = db {
-            _ = try? Snode.deleteAll(db)
-            newValue.forEach { try? $0.save(db) }
-        }
-        else {
-            Storage.shared.write { db in
-                _ = try? Snode.deleteAll(db)
-                newValue.forEach { try? $0.save(db) }
-            }
-        }
+        // If we were given a database then persist the changes immediately, otherwise wait in case there are more changes
+        guard let db: Database = db else { return schedulePersistSnodeChanges() }
+        
+        persistSnodeChanges(db)
     }
     
     private static func dropSnodeFromSnodePool(_ snode: Snode) {
@@ -102,35 +114,133 @@ public final class SnodeAPI {
         snodePool.mutate { $0.removeAll() }
         
         Threading.workQueue.async {
-            setSnodePool(to: [])
+            // Clearing the pool deletes every swarm so the cached swarms need to be cleared as well (otherwise they would
+            // continue to be used and any changes to them would be tracked relative to swarms which no longer exist)
+            swarmCache.mutate { $0.removeAll() }
+            loadedSwarms.mutate { $0.removeAll() }
+            pendingSnodeChanges.mutate { $0.clearPool() }
+            schedulePersistSnodeChanges()
         }
     }
     
     // MARK: Swarm Interaction
     private static func loadSwarmIfNeeded(for publicKey: String) {
-        guard !loadedSwarms.wrappedValue.contains(publicKey) else { return }
+        let isLoaded: Atomic<Bool> = loadedSwarms.mutate { loadedSwarms in
+            if let isLoaded: Atomic<Bool> = loadedSwarms[publicKey] { return isLoaded }
+            
+            let isLoaded: Atomic<Bool> = Atomic(false)
+            loadedSwarms[publicKey] = isLoaded
+            
+            return isLoaded
+        }
         
-        let updatedCacheForKey: Set<Snode> = Storage.shared
-           .read { db in try Snode.fetchSet(db, publicKey: publicKey) }
-           .defaulting(to: [])
+        guard !isLoaded.wrappedValue else { return }
         
-        swarmCache.mutate { $0[publicKey] = updatedCacheForKey }
-        loadedSwarms.mutate { $0.insert(publicKey) }
+        /// The read is performed while holding the lock for the key so concurrent callers for the same key wait for the first load
+        /// rather than each reading the swarm from the database (this only happens once for each key), loading the swarms for
+        /// other keys isn't blocked
+        isLoaded.mutate { isLoaded in
+            guard !isLoaded else { return }
+            
+            // If the pool is about to be cleared then the persisted swarm is about to be deleted
+            let updatedCacheForKey: Set<Snode> = (pendingSnodeChanges.wrappedValue.shouldClearPool ?
+                [] :
+                Storage.shared
+                    .read { db in try Snode.fetchSet(db, publicKey: publicKey) }
+                    .defaulting(to: [])
+            )
+            
+            swarmCache.mutate { $0[publicKey] = updatedCacheForKey }
+            isLoaded = true
+        }
     }
     
     private static func setSwarm(to newValue: Set<Snode>, for publicKey: String, persist: Bool = true) {
         #if DEBUG
         dispatchPrecondition(condition: .onQueue(Threading.workQueue))
         #endif
+        guard persist else {
+            swarmCache.mutate { $0[publicKey] = newValue }
+            return
+        }
+        
+        // Need to make sure the persisted swarm has been loaded so the changes are relative to what is in the database
+        loadSwarmIfNeeded(for: publicKey)
+        
+        let oldValue: Set<Snode> = (swarmCache.wrappedValue[publicKey] ?? [])
         swarmCache.mutate { $0[publicKey] = newValue }
+        pendingSnodeChanges.mutate { $0.updateSwarm(for: publicKey, from: oldValue, to: newValue) }
+        schedulePersistSnodeChanges()
+    }
+    
+    // MARK: Persistence
+    
+    /// Changes to the snode pool and swarms tend to come in bursts (eg. when a number of paths fail at once) so they get
+    /// persisted together after `snodeChangesPersistDelay` rather than each change performing it's own write
+    private static let snodeChangesPersistDelay: DispatchTimeInterval = .seconds(1)
+    
+    private static func schedulePersistSnodeChanges() {
+        let alreadyScheduled: Bool = hasScheduledSnodeChangesPersist.mutate { hasScheduled -> Bool in
+            let alreadyScheduled: Bool = hasScheduled
+            hasScheduled = true
+            
+            return alreadyScheduled
+        }
         
-        guard persist else { return }
+        guard !alreadyScheduled else { return }
         
-        Storage.shared.write { db in
-            try? newValue.save(db, key: publicKey)
+        Threading.workQueue.asyncAfter(deadline: .now() + snodeChangesPersistDelay) {
+            hasScheduledSnodeChangesPersist.mutate { $0 = false }
+            persistSnodeChanges()
         }
     }
     
+    /// Persist the pending snode changes, if a `db` is provided then they will be persisted as part of it's transaction
+    ///
+    /// **Note:** The pending changes are taken from within the write (rather than before scheduling it) so they are always
+    /// applied in the order they were made, otherwise an async write could apply older changes after a later synchronous one
+    private static func persistSnodeChanges(_ db: Database? = nil) {
+        guard let db: Database = db else {
+            guard !pendingSnodeChanges.wrappedValue.isEmpty else { return }
+            
+            Storage.shared.writeAsync { db in persistSnodeChanges(db) }
+            return
+        }
+        
+        let changes: PendingSnodeChanges = pendingSnodeChanges.mutate { pendingChanges -> PendingSnodeChanges in
+            let changes: PendingSnodeChanges = pendingChanges
+            pendingChanges = PendingSnodeChanges()
+            
+            return changes
+        }
+        
+        guard !changes.isEmpty else { return }
+        
+        do {
+            try db.inSavepoint {
+                try changes.apply(db)
+                return .commit
+            }
+        }
+        catch {
+            SNLog("Failed to persist snode changes due to error: \(error).")
+            restoreSnodeChanges(changes)
+            return
+        }
+        
+        // If the transaction gets rolled back then the changes weren't persisted so need to be retried
+        db.afterNextTransaction(
+            onCommit: { _ in },
+            onRollback: { _ in restoreSnodeChanges(changes) }
+        )
+    }
+    
+    /// Add changes which failed to be persisted back to the pending changes (before any changes made since) and retry them
+    private static func restoreSnodeChanges(_ changes: PendingSnodeChanges) {
+        pendingSnodeChanges.mutate { $0 = changes.merging($0) }
+        schedulePersistSnodeChanges()
+    }
+    
     public static func dropSnodeFromSwarmIfNeeded(_ snode: Snode, publicKey: String) {
         #if DEBUG
         dispatchPrecondition(condition: .onQueue(Threading.workQueue))
@@ -144,6 +254,14 @@ public final class SnodeAPI {
     // MARK: Internal API
     
     internal static func invoke(_ method: SnodeAPIEndpoint, on snode: Snode, associatedWith publicKey: String? = nil, parameters: JSON) -> Promise<Data> {
+        let promise: Promise<Data> = invokeWithoutTrackingHealth(method, on: snode, associatedWith: publicKey, parameters: parameters)
+        
+        guard let publicKey: String = publicKey else { return promise }
+        
+        return promise.get2 { _ in swarmResolver.recordSuccess(for: snode, publicKey: publicKey) }
+    }
+    
+    private static func invokeWithoutTrackingHealth(_ method: SnodeAPIEndpoint, on snode: Snode, associatedWith publicKey: String?, parameters: JSON) -> Promise<Data> {
         if Features.useOnionRequests {
             return OnionRequestAPI
                 .sendOnionRequest(
@@ -479,17 +597,18 @@ public final class SnodeAPI {
     }
     
     public static func getTargetSnodes(for publicKey: String) -> Promise<[Snode]> {
-        // shuffled() uses the system's default random generator, which is cryptographically secure
-        return getSwarm(for: publicKey).map2 { Array($0.shuffled().prefix(targetSwarmSnodeCount)) }
+        return getSwarm(for: publicKey).map2 { swarm in
+            swarmResolver.targetSnodes(from: swarm, for: publicKey, count: targetSwarmSnodeCount)
+        }
     }
 
+    /// Returns the cached swarm if there is one (refreshing it in the background if it's stale), otherwise fetches the swarm from
+    /// the network, see `SwarmResolver` for more information
     public static func getSwarm(for publicKey: String) -> Promise<Set<Snode>> {
-        loadSwarmIfNeeded(for: publicKey)
-        
-        if let cachedSwarm = swarmCache.wrappedValue[publicKey], cachedSwarm.count >= minSwarmSnodeCount {
-            return Promise<Set<Snode>> { $0.fulfill(cachedSwarm) }
-        }
-        
+        return swarmResolver.swarm(for: publicKey)
+    }
+    
+    private static func fetchSwarm(for publicKey: String) -> Promise<Set<Snode>> {
         SNLog("Getting swarm for: \((publicKey == getUserHexEncodedPublicKey()) ? "self" : publicKey).")
         let parameters: [String: Any] = [
             "pubKey": (Features.useTestnet ? publicKey.removingIdPrefixIfNeeded() : publicKey)
@@ -560,7 +679,7 @@ public final class SnodeAPI {
     private static func getMessagesWithAuthentication(from snode: Snode, associatedWith publicKey: String, namespace: Int) -> Promise<([SnodeReceivedMessage], String?)> {
         /// **Note:** All authentication logic is only apply to 1-1 chats, the reason being that we can't currently support it yet for
         /// closed groups. The Storage Server requires an ed25519 key pair, but we don't have that for our closed groups.
-        guard let userED25519KeyPair: Box.KeyPair = Storage.shared.read({ db in Identity.fetchUserEd25519KeyPair(db) }) else {
+        guard let userED25519PublicKey: Bytes = Identity.fetchUserEd25519PublicKey() else {
             return Promise(error: SnodeAPIError.noKeyPair)
         }
         
@@ -570,12 +689,12 @@ public final class SnodeAPI {
 
         // Construct signature
         let timestamp = UInt64(SnodeAPI.currentOffsetTimestampMs())
-        let ed25519PublicKey = userED25519KeyPair.publicKey.toHexString()
+        let ed25519PublicKey = Hex.encodedString(userED25519PublicKey)
         let namespaceVerificationString = (namespace == defaultNamespace ? "" : String(namespace))
         
         guard
             let verificationData = ("retrieve" + namespaceVerificationString + String(timestamp)).data(using: String.Encoding.utf8),
-            let signature = sodium.sign.signature(message: Bytes(verificationData), secretKey: userED25519KeyPair.secretKey)
+            let signature = signWithUserEd25519Key(Bytes(verificationData))
         else { return Promise(error: SnodeAPIError.signingFailed) }
         
         // Make the request
@@ -585,7 +704,7 @@ public final class SnodeAPI {
             "lastHash": lastHash,
             "timestamp": timestamp,
             "pubkey_ed25519": ed25519PublicKey,
-            "signature": signature.toBase64()
+            "signature": Base64.encodedString(signature)
         ]
         
         return invoke(.getMessages, on: snode, associatedWith: publicKey, parameters: parameters)
@@ -665,17 +784,17 @@ public final class SnodeAPI {
             let messageJson: JSON = try? JSONSerialization.jsonObject(with: messageData, options: [ .fragmentsAllowed ]) as? JSON
         else { return Promise(error: HTTP.Error.invalidJSON) }
         
-        guard let userED25519KeyPair: Box.KeyPair = Storage.shared.read({ db in Identity.fetchUserEd25519KeyPair(db) }) else {
+        guard let userED25519PublicKey: Bytes = Identity.fetchUserEd25519PublicKey() else {
             return Promise(error: SnodeAPIError.noKeyPair)
         }
         
         // Construct signature
         let timestamp = UInt64(SnodeAPI.currentOffsetTimestampMs())
-        let ed25519PublicKey = userED25519KeyPair.publicKey.toHexString()
+        let ed25519PublicKey = Hex.encodedString(userED25519PublicKey)
         
         guard
             let verificationData = ("store" + String(namespace) + String(timestamp)).data(using: String.Encoding.utf8),
-            let signature = sodium.sign.signature(message: Bytes(verificationData), secretKey: userED25519KeyPair.secretKey)
+            let signature = signWithUserEd25519Key(Bytes(verificationData))
         else { return Promise(error: SnodeAPIError.signingFailed) }
         
         // Make the request
@@ -689,7 +808,7 @@ public final class SnodeAPI {
                     parameters["namespace"] = namespace
                     parameters["sig_timestamp"] = timestamp
                     parameters["pubkey_ed25519"] = ed25519PublicKey
-                    parameters["signature"] = signature.toBase64()
+                    parameters["signature"] = Base64.encodedString(signature)
                     
                     return Set(targetSnodes.map { targetSnode in
                         attempt(maxRetryCount: maxRetryCount, recoveringOn: Threading.workQueue) {
@@ -751,196 +870,453 @@ public final class SnodeAPI {
     
     public static func updateExpiry(
         publicKey: String,
-        edKeyPair: Box.KeyPair,
         updatedExpiryMs: UInt64,
         serverHashes: [String]
     ) -> Promise<[String: (hashes: [String], expiry: UInt64)]> {
+        guard let userED25519PublicKey: Bytes = Identity.fetchUserEd25519PublicKey() else {
+            return Promise(error: SnodeAPIError.noKeyPair)
+        }
+        
         let publicKey = (Features.useTestnet ? publicKey.removingIdPrefixIfNeeded() : publicKey)
+        let (promise, seal) = Promise<[String: (hashes: [String], expiry: UInt64)]>.pending()
         
-        return attempt(maxRetryCount: maxRetryCount, recoveringOn: Threading.workQueue) {
-            getSwarm(for: publicKey)
-                .then2 { swarm -> Promise<[String: (hashes: [String], expiry: UInt64)]> in
-                    // "expire" || expiry || messages[0] || ... || messages[N]
-                    let verificationBytes = SnodeAPIEndpoint.expire.rawValue.bytes
-                        .appending(contentsOf: "\(updatedExpiryMs)".data(using: .ascii)?.bytes)
-                        .appending(contentsOf: serverHashes.joined().bytes)
-                    
-                    guard
-                        let snode = swarm.randomElement(),
-                        let signature = sodium.sign.signature(
-                            message: verificationBytes,
-                            secretKey: edKeyPair.secretKey
-                        )
-                    else {
-                        throw SnodeAPIError.signingFailed
-                    }
-                    
-                    let parameters: JSON = [
-                        "pubkey" : publicKey,
-                        "pubkey_ed25519" : edKeyPair.publicKey.toHexString(),
-                        "expiry": updatedExpiryMs,
-                        "messages": serverHashes,
-                        "signature": signature.toBase64()
-                    ]
-                    
-                    return attempt(maxRetryCount: maxRetryCount, recoveringOn: Threading.workQueue) {
-                        invoke(.expire, on: snode, associatedWith: publicKey, parameters: parameters)
-                            .map2 { responseData -> [String: (hashes: [String], expiry: UInt64)] in
-                                guard let responseJson: JSON = try? JSONSerialization.jsonObject(with: responseData, options: [ .fragmentsAllowed ]) as? JSON else {
-                                    throw HTTP.Error.invalidJSON
-                                }
-                                guard let swarm = responseJson["swarm"] as? JSON else { throw HTTP.Error.invalidJSON }
-                                
-                                var result: [String: (hashes: [String], expiry: UInt64)] = [:]
-                                    
-                                for (snodePublicKey, rawJSON) in swarm {
-                                    guard let json = rawJSON as? JSON else { throw HTTP.Error.invalidJSON }
-                                    guard (json["failed"] as? Bool ?? false) == false else {
-                                        if let reason = json["reason"] as? String, let statusCode = json["code"] as? String {
-                                            SNLog("Couldn't delete data from: \(snodePublicKey) due to error: \(reason) (\(statusCode)).")
-                                        }
-                                        else {
-                                            SNLog("Couldn't delete data from: \(snodePublicKey).")
-                                        }
-                                        result[snodePublicKey] = ([], 0)
-                                        continue
-                                    }
-                                    
-                                    guard
-                                        let hashes: [String] = json["updated"] as? [String],
-                                        let expiryApplied: UInt64 = json["expiry"] as? UInt64,
-                                        let signature: String = json["signature"] as? String
-                                    else {
-                                        throw HTTP.Error.invalidJSON
-                                    }
-                                    
-                                    // The signature format is ( PUBKEY_HEX || EXPIRY || RMSG[0] || ... || RMSG[N] || UMSG[0] || ... || UMSG[M] )
-                                    let verificationBytes = publicKey.bytes
-                                        .appending(contentsOf: "\(expiryApplied)".data(using: .ascii)?.bytes)
-                                        .appending(contentsOf: serverHashes.joined().bytes)
-                                        .appending(contentsOf: hashes.joined().bytes)
-                                    let isValid = sodium.sign.verify(
-                                        message: verificationBytes,
-                                        publicKey: Bytes(Data(hex: snodePublicKey)),
-                                        signature: Bytes(Data(base64Encoded: signature)!)
-                                    )
-                                    
-                                    // Ensure the signature is valid
-                                    guard isValid else {
-                                        throw SnodeAPIError.signatureVerificationFailed
-                                    }
-                                    
-                                    result[snodePublicKey] = (hashes, expiryApplied)
-                                }
-                                
-                                return result
-                            }
-                    }
-                }
+        pendingRemoteMutations.mutate {
+            $0.addExpiry(
+                publicKey: publicKey,
+                ed25519PublicKey: userED25519PublicKey,
+                updatedExpiryMs: updatedExpiryMs,
+                serverHashes: serverHashes,
+                seal: seal
+            )
         }
+        scheduleRemoteMutations()
+        
+        return promise
     }
     
     // MARK: Delete
     
     public static func deleteMessage(publicKey: String, serverHashes: [String]) -> Promise<[String: Bool]> {
-        guard let userED25519KeyPair = Identity.fetchUserEd25519KeyPair() else {
+        guard let userED25519PublicKey: Bytes = Identity.fetchUserEd25519PublicKey() else {
             return Promise(error: SnodeAPIError.noKeyPair)
         }
         
         let publicKey = (Features.useTestnet ? publicKey.removingIdPrefixIfNeeded() : publicKey)
         let userX25519PublicKey: String = getUserHexEncodedPublicKey()
+        let (promise, seal) = Promise<[String: Bool]>.pending()
         
-        return attempt(maxRetryCount: maxRetryCount, recoveringOn: Threading.workQueue) {
+        pendingRemoteMutations.mutate {
+            $0.addDeletion(
+                publicKey: publicKey,
+                userPublicKey: userX25519PublicKey,
+                ed25519PublicKey: userED25519PublicKey,
+                serverHashes: serverHashes,
+                seal: seal
+            )
+        }
+        scheduleRemoteMutations()
+        
+        return promise
+    }
+    
+    // MARK: Remote Mutations
+    
+    /// Deletions and expiry updates are collected for `remoteMutationWindow` and then sent as a single request per swarm (using
+    /// a `batch` request if a swarm has multiple different mutations), the requests are retried as a whole so every caller which
+    /// contributed to a request gets the same result
+    private static let remoteMutationWindow: DispatchTimeInterval = .milliseconds(250)
+    internal static let maxBatchSubrequestCount: Int = 20
+    
+    internal struct RemoteMutationRequest {
+        let method: SnodeAPIEndpoint
+        let parameters: JSON
+        let deletedHashes: [String]
+        let handleResponse: (JSON) throws -> Void
+        let handleError: (Error) -> Void
+    }
+    
+    private static func scheduleRemoteMutations() {
+        let alreadyScheduled: Bool = hasScheduledRemoteMutations.mutate { hasScheduled -> Bool in
+            let alreadyScheduled: Bool = hasScheduled
+            hasScheduled = true
+            
+            return alreadyScheduled
+        }
+        
+        guard !alreadyScheduled else { return }
+        
+        Threading.workQueue.asyncAfter(deadline: .now() + remoteMutationWindow) {
+            hasScheduledRemoteMutations.mutate { $0 = false }
+            sendRemoteMutations()
+        }
+    }
+    
+    private static func sendRemoteMutations() {
+        let mutations: [String: PendingRemoteMutations.Mutations] = pendingRemoteMutations.mutate { $0.removeAll() }
+        
+        guard !mutations.isEmpty else { return }
+        
+        let promises: [Promise<[String]>] = remoteMutationRequestGroups(for: mutations)
+            .map { group in sendRemoteMutationRequests(group.requests, to: group.publicKey) }
+        
+        // If any of the deletions succeeded then we assume they have been deleted from at least one service node and as a
+        // result we need to mark the hashes as invalid so we don't try to fetch updates since those hashes going forward (if
+        // we do we would end up re-fetching all old messages), this is done in a single write for all of the deletions
+        when(resolved: promises).done2 { results in
+            let deletedHashes: [String] = results.flatMap { result -> [String] in
+                guard case .fulfilled(let hashes) = result else { return [] }
+                
+                return hashes
+            }
+            
+            guard !deletedHashes.isEmpty else { return }
+            
+            Storage.shared.writeAsync { db in
+                try? SnodeReceivedMessageInfo.handlePotentialDeletedOrInvalidHash(
+                    db,
+                    potentiallyInvalidHashes: deletedHashes
+                )
+            }
+        }
+    }
+    
+    /// Sends the `requests` to a snode in the swarm for `publicKey` and returns the hashes which were deleted
+    private static func sendRemoteMutationRequests(_ requests: [RemoteMutationRequest], to publicKey: String) -> Promise<[String]> {
+        let promise: Promise<[String]> = attempt(maxRetryCount: maxRetryCount, recoveringOn: Threading.workQueue) {
             getSwarm(for: publicKey)
-                .then2 { swarm -> Promise<[String: Bool]> in
-                    // "delete" || messages...
-                    let verificationBytes = SnodeAPIEndpoint.deleteMessage.rawValue.bytes
-                        .appending(contentsOf: serverHashes.joined().bytes)
-                    
-                    guard
-                        let snode = swarm.randomElement(),
-                        let signature = sodium.sign.signature(
-                            message: verificationBytes,
-                            secretKey: userED25519KeyPair.secretKey
-                        )
-                    else {
-                        throw SnodeAPIError.signingFailed
-                    }
-                    
-                    let parameters: JSON = [
-                        "pubkey" : userX25519PublicKey,
-                        "pubkey_ed25519" : userED25519KeyPair.publicKey.toHexString(),
-                        "messages": serverHashes,
-                        "signature": signature.toBase64()
-                    ]
+                .then2 { swarm -> Promise<[String]> in
+                    guard let snode = swarm.randomElement() else { throw SnodeAPIError.generic }
                     
-                    return attempt(maxRetryCount: maxRetryCount, recoveringOn: Threading.workQueue) {
-                        invoke(.deleteMessage, on: snode, associatedWith: publicKey, parameters: parameters)
-                            .map2 { responseData -> [String: Bool] in
+                    // Avoid the overhead of a batch request when there is only a single mutation
+                    guard requests.count > 1 else {
+                        return invoke(requests[0].method, on: snode, associatedWith: publicKey, parameters: requests[0].parameters)
+                            .map2 { responseData -> [String] in
                                 guard let responseJson: JSON = try? JSONSerialization.jsonObject(with: responseData, options: [ .fragmentsAllowed ]) as? JSON else {
                                     throw HTTP.Error.invalidJSON
                                 }
-                                guard let swarm = responseJson["swarm"] as? JSON else { throw HTTP.Error.invalidJSON }
-                                
-                                var result: [String: Bool] = [:]
-                                    
-                                for (snodePublicKey, rawJSON) in swarm {
-                                    guard let json = rawJSON as? JSON else { throw HTTP.Error.invalidJSON }
-                                    
-                                    let isFailed = (json["failed"] as? Bool ?? false)
-                                    
-                                    if !isFailed {
-                                        guard
-                                            let hashes = json["deleted"] as? [String],
-                                            let signature = json["signature"] as? String
-                                        else {
-                                            throw HTTP.Error.invalidJSON
-                                        }
-                                        
-                                        // The signature format is ( PUBKEY_HEX || RMSG[0] || ... || RMSG[N] || DMSG[0] || ... || DMSG[M] )
-                                        let verificationBytes = userX25519PublicKey.bytes
-                                            .appending(contentsOf: serverHashes.joined().bytes)
-                                            .appending(contentsOf: hashes.joined().bytes)
-                                        let isValid = sodium.sign.verify(
-                                            message: verificationBytes,
-                                            publicKey: Bytes(Data(hex: snodePublicKey)),
-                                            signature: Bytes(Data(base64Encoded: signature)!)
-                                        )
-                                        
-                                        result[snodePublicKey] = isValid
-                                    }
-                                    else {
-                                        if let reason = json["reason"] as? String, let statusCode = json["code"] as? String {
-                                            SNLog("Couldn't delete data from: \(snodePublicKey) due to error: \(reason) (\(statusCode)).")
-                                        }
-                                        else {
-                                            SNLog("Couldn't delete data from: \(snodePublicKey).")
-                                        }
-                                        result[snodePublicKey] = false
-                                    }
-                                }
                                 
-                                // If we get to here then we assume it's been deleted from at least one
-                                // service node and as a result we need to mark the hash as invalid so
-                                // we don't try to fetch updates since that hash going forward (if we do
-                                // we would end up re-fetching all old messages)
-                                Storage.shared.writeAsync { db in
-                                    try? SnodeReceivedMessageInfo.handlePotentialDeletedOrInvalidHash(
-                                        db,
-                                        potentiallyInvalidHashes: serverHashes
-                                    )
-                                }
-                                
-                                return result
+                                try requests[0].handleResponse(responseJson)
+                                return requests[0].deletedHashes
                             }
                     }
+                    
+                    let parameters: JSON = [
+                        "requests": requests.map { request -> JSON in
+                            [
+                                "method": request.method.rawValue,
+                                "params": request.parameters
+                            ]
+                        }
+                    ]
+                    
+                    return invoke(.batch, on: snode, associatedWith: publicKey, parameters: parameters)
+                        .map2 { responseData -> [String] in
+                            guard let responseJson: JSON = try? JSONSerialization.jsonObject(with: responseData, options: [ .fragmentsAllowed ]) as? JSON else {
+                                throw HTTP.Error.invalidJSON
+                            }
+                            
+                            return try handleBatchResponse(responseJson, for: requests)
+                        }
                 }
         }
+        
+        promise.catch2 { error in requests.forEach { $0.handleError(error) } }
+        
+        return promise
+    }
+    
+    /// Routes the result of each subrequest in a `batch` response to the request it belongs to and returns the hashes which
+    /// were deleted, a failed subrequest only fails the callers which contributed to that subrequest
+    ///
+    /// **Note:** This throws if the response doesn't contain a result for every request (in which case the whole batch gets retried)
+    internal static func handleBatchResponse(_ responseJson: JSON, for requests: [RemoteMutationRequest]) throws -> [String] {
+        guard
+            let results: [JSON] = responseJson["results"] as? [JSON],
+            results.count == requests.count
+        else { throw HTTP.Error.invalidJSON }
+        
+        return zip(requests, results).flatMap { request, result -> [String] in
+            let statusCode: UInt = ((result["code"] as? UInt) ?? 0)
+            
+            guard (200...299).contains(statusCode), let body: JSON = result["body"] as? JSON else {
+                request.handleError(
+                    HTTP.Error.httpRequestFailed(
+                        statusCode: statusCode,
+                        data: try? JSONSerialization.data(withJSONObject: result, options: [ .fragmentsAllowed ])
+                    )
+                )
+                return []
+            }
+            
+            do {
+                try request.handleResponse(body)
+                return request.deletedHashes
+            }
+            catch {
+                request.handleError(error)
+                return []
+            }
+        }
+    }
+    
+    /// Returns the requests needed to apply the `mutations` grouped by the swarm they need to be sent to, each group contains at
+    /// most `maxBatchSubrequestCount` requests so it can be sent as a single request
+    internal static func remoteMutationRequestGroups(
+        for mutations: [String: PendingRemoteMutations.Mutations],
+        sign: (Bytes) -> Bytes? = signWithUserEd25519Key
+    ) -> [(publicKey: String, requests: [RemoteMutationRequest])] {
+        return mutations
+            .sorted { lhs, rhs in lhs.key < rhs.key }
+            .flatMap { publicKey, mutations -> [(publicKey: String, requests: [RemoteMutationRequest])] in
+                remoteMutationRequests(for: mutations, publicKey: publicKey, sign: sign)
+                    .chunked(by: maxBatchSubrequestCount)
+                    .map { requests in (publicKey, requests) }
+            }
+    }
+    
+    private static func remoteMutationRequests(
+        for mutations: PendingRemoteMutations.Mutations,
+        publicKey: String,
+        sign: (Bytes) -> Bytes?
+    ) -> [RemoteMutationRequest] {
+        var result: [RemoteMutationRequest] = []
+        
+        if let deletion: PendingRemoteMutations.Deletion = mutations.deletion {
+            let serverHashes: [String] = deletion.serverHashes.values
+            
+            // "delete" || messages...
+            let verificationBytes = SnodeAPIEndpoint.deleteMessage.rawValue.bytes
+                .appending(contentsOf: serverHashes.joined().bytes)
+            
+            if let signature = sign(verificationBytes) {
+                result.append(
+                    RemoteMutationRequest(
+                        method: .deleteMessage,
+                        parameters: [
+                            "pubkey" : deletion.userPublicKey,
+                            "pubkey_ed25519" : Hex.encodedString(deletion.ed25519PublicKey),
+                            "messages": serverHashes,
+                            "signature": Base64.encodedString(signature)
+                        ],
+                        deletedHashes: serverHashes,
+                        handleResponse: { responseJson in
+                            let response: [String: Bool] = try parseDeleteResponse(
+                                responseJson,
+                                userPublicKey: deletion.userPublicKey,
+                                serverHashes: serverHashes
+                            )
+                            deletion.seals.forEach { $0.fulfill(response) }
+                        },
+                        handleError: { error in deletion.seals.forEach { $0.reject(error) } }
+                    )
+                )
+            }
+            else {
+                deletion.seals.forEach { $0.reject(SnodeAPIError.signingFailed) }
+            }
+        }
+        
+        // Sort the expiries so the requests are generated in a consistent order
+        mutations.expiries
+            .sorted { lhs, rhs in lhs.key.expiryMs < rhs.key.expiryMs }
+            .forEach { key, expiry in
+                let serverHashes: [String] = expiry.serverHashes.values
+                
+                // "expire" || expiry || messages[0] || ... || messages[N]
+                let verificationBytes = SnodeAPIEndpoint.expire.rawValue.bytes
+                    .appending(contentsOf: "\(key.expiryMs)".data(using: .ascii)?.bytes)
+                    .appending(contentsOf: serverHashes.joined().bytes)
+                
+                guard let signature = sign(verificationBytes) else {
+                    expiry.seals.forEach { $0.reject(SnodeAPIError.signingFailed) }
+                    return
+                }
+                
+                result.append(
+                    RemoteMutationRequest(
+                        method: .expire,
+                        parameters: [
+                            "pubkey" : publicKey,
+                            "pubkey_ed25519" : Hex.encodedString(expiry.ed25519PublicKey),
+                            "expiry": key.expiryMs,
+                            "messages": serverHashes,
+                            "signature": Base64.encodedString(signature)
+                        ],
+                        deletedHashes: [],
+                        handleResponse: { responseJson in
+                            let response: [String: (hashes: [String], expiry: UInt64)] = try parseExpireResponse(
+                                responseJson,
+                                publicKey: publicKey,
+                                serverHashes: serverHashes
+                            )
+                            expiry.seals.forEach { $0.fulfill(response) }
+                        },
+                        handleError: { error in expiry.seals.forEach { $0.reject(error) } }
+                    )
+                )
+            }
+        
+        return result
+    }
+    
+    // MARK: Signing
+    
+    /// Sign a request with the user's ed25519 secret key, the key is used directly from the `IdentityKeyCache` rather than being
+    /// copied into a `Box.KeyPair`
+    private static func signWithUserEd25519Key(_ message: Bytes) -> Bytes? {
+        return Identity.withUserEd25519SecretKey { secretKey in
+            sodium.sign.signature(message: message, secretKey: secretKey)
+        } ?? nil
+    }
+    
+    // MARK: Signature Verification
+    
+    /// The signatures for every snode in a response are verified together (the prefix of the signed message is shared by every
+    /// snode so it only gets built once per response) using a shared verifier so retried requests can reuse it's cache
+    internal static let signatureVerifier: SnodeSignatureVerifier = SnodeSignatureVerifier(sodium: sodium)
+    
+    private static func parseDeleteResponse(_ responseJson: JSON, userPublicKey: String, serverHashes: [String]) throws -> [String: Bool] {
+        guard let swarm = responseJson["swarm"] as? JSON else { throw HTTP.Error.invalidJSON }
+        
+        // The signature format is ( PUBKEY_HEX || RMSG[0] || ... || RMSG[N] || DMSG[0] || ... || DMSG[M] )
+        let verificationPrefix: Bytes = userPublicKey.bytes.appending(contentsOf: serverHashes.joined().bytes)
+        var result: [String: Bool] = [:]
+        var verificationItems: [SnodeSignatureVerifier.Item] = []
+        
+        for (snodePublicKey, rawJSON) in swarm {
+            guard let json = rawJSON as? JSON else { throw HTTP.Error.invalidJSON }
+            guard (json["failed"] as? Bool ?? false) == false else {
+                if let reason = json["reason"] as? String, let statusCode = json["code"] as? String {
+                    SNLog("Couldn't delete data from: \(snodePublicKey) due to error: \(reason) (\(statusCode)).")
+                }
+                else {
+                    SNLog("Couldn't delete data from: \(snodePublicKey).")
+                }
+                result[snodePublicKey] = false
+                continue
+            }
+            guard
+                let hashes = json["deleted"] as? [String],
+                let signature = json["signature"] as? String
+            else {
+                throw HTTP.Error.invalidJSON
+            }
+            
+            verificationItems.append(
+                SnodeSignatureVerifier.Item(
+                    snodePublicKey: snodePublicKey,
+                    signature: signature,
+                    message: verificationPrefix.appending(contentsOf: hashes.joined().bytes)
+                )
+            )
+        }
+        
+        zip(verificationItems, signatureVerifier.verify(verificationItems)).forEach { item, isValid in
+            result[item.snodePublicKey] = isValid
+        }
+        
+        return result
+    }
+    
+    private static func parseExpireResponse(
+        _ responseJson: JSON,
+        publicKey: String,
+        serverHashes: [String]
+    ) throws -> [String: (hashes: [String], expiry: UInt64)] {
+        guard let swarm = responseJson["swarm"] as? JSON else { throw HTTP.Error.invalidJSON }
+        
+        // The signature format is ( PUBKEY_HEX || EXPIRY || RMSG[0] || ... || RMSG[N] || UMSG[0] || ... || UMSG[M] ) since
+        // the expiry can differ between snodes only the public key and requested hashes can be shared
+        let publicKeyBytes: Bytes = publicKey.bytes
+        let serverHashesBytes: Bytes = serverHashes.joined().bytes
+        var result: [String: (hashes: [String], expiry: UInt64)] = [:]
+        var verificationItems: [SnodeSignatureVerifier.Item] = []
+        
+        for (snodePublicKey, rawJSON) in swarm {
+            guard let json = rawJSON as? JSON else { throw HTTP.Error.invalidJSON }
+            guard (json["failed"] as? Bool ?? false) == false else {
+                if let reason = json["reason"] as? String, let statusCode = json["code"] as? String {
+                    SNLog("Couldn't update expiry from: \(snodePublicKey) due to error: \(reason) (\(statusCode)).")
+                }
+                else {
+                    SNLog("Couldn't update expiry from: \(snodePublicKey).")
+                }
+                result[snodePublicKey] = ([], 0)
+                continue
+            }
+            guard
+                let hashes: [String] = json["updated"] as? [String],
+                let expiryApplied: UInt64 = json["expiry"] as? UInt64,
+                let signature: String = json["signature"] as? String
+            else {
+                throw HTTP.Error.invalidJSON
+            }
+            
+            verificationItems.append(
+                SnodeSignatureVerifier.Item(
+                    snodePublicKey: snodePublicKey,
+                    signature: signature,
+                    message: publicKeyBytes
+                        .appending(contentsOf: "\(expiryApplied)".data(using: .ascii)?.bytes)
+                        .appending(contentsOf: serverHashesBytes)
+                        .appending(contentsOf: hashes.joined().bytes)
+                )
+            )
+            result[snodePublicKey] = (hashes, expiryApplied)
+        }
+        
+        // Ensure the signatures are valid
+        guard signatureVerifier.verify(verificationItems).allSatisfy({ $0 }) else {
+            throw SnodeAPIError.signatureVerificationFailed
+        }
+        
+        return result
+    }
+    
+    private static func parseClearAllDataResponse(_ responseJson: JSON, userPublicKey: String, timestamp: UInt64) throws -> [String: Bool] {
+        guard let swarm = responseJson["swarm"] as? JSON else { throw HTTP.Error.invalidJSON }
+        
+        // The signature format is ( PUBKEY_HEX || TIMESTAMP || DELETEDHASH[0] || ... || DELETEDHASH[N] )
+        let verificationPrefix: Bytes = userPublicKey.bytes.appending(contentsOf: String(timestamp).bytes)
+        var result: [String: Bool] = [:]
+        var verificationItems: [SnodeSignatureVerifier.Item] = []
+        
+        for (snodePublicKey, rawJSON) in swarm {
+            guard let json = rawJSON as? JSON else { throw HTTP.Error.invalidJSON }
+            guard (json["failed"] as? Bool ?? false) == false else {
+                if let reason = json["reason"] as? String, let statusCode = json["code"] as? String {
+                    SNLog("Couldn't delete data from: \(snodePublicKey) due to error: \(reason) (\(statusCode)).")
+                } else {
+                    SNLog("Couldn't delete data from: \(snodePublicKey).")
+                }
+                
+                result[snodePublicKey] = false
+                continue
+            }
+            guard
+                let hashes = json["deleted"] as? [String],
+                let signature = json["signature"] as? String
+            else { throw HTTP.Error.invalidJSON }
+            
+            verificationItems.append(
+                SnodeSignatureVerifier.Item(
+                    snodePublicKey: snodePublicKey,
+                    signature: signature,
+                    message: verificationPrefix.appending(contentsOf: hashes.joined().bytes)
+                )
+            )
+        }
+        
+        zip(verificationItems, signatureVerifier.verify(verificationItems)).forEach { item, isValid in
+            result[item.snodePublicKey] = isValid
+        }
+        
+        return result
     }
     
     /// Clears all the user's data from their swarm. Returns a dictionary of snode public key to deletion confirmation.
     public static func clearAllData() -> Promise<[String:Bool]> {
-        guard let userED25519KeyPair = Identity.fetchUserEd25519KeyPair() else {
+        guard let userED25519PublicKey: Bytes = Identity.fetchUserEd25519PublicKey() else {
             return Promise(error: SnodeAPIError.noKeyPair)
         }
         
@@ -955,13 +1331,13 @@ public final class SnodeAPI {
                         getNetworkTime(from: snode).then2 { timestamp -> Promise<[String: Bool]> in
                             let verificationData = (SnodeAPIEndpoint.clearAllData.rawValue + String(timestamp)).data(using: String.Encoding.utf8)!
                             
-                            guard let signature = sodium.sign.signature(message: Bytes(verificationData), secretKey: userED25519KeyPair.secretKey) else {
+                            guard let signature = signWithUserEd25519Key(Bytes(verificationData)) else {
                                 throw SnodeAPIError.signingFailed
                             }
                             
                             let parameters: JSON = [
                                 "pubkey": userX25519PublicKey,
-                                "pubkey_ed25519": userED25519KeyPair.publicKey.toHexString(),
+                                "pubkey_ed25519": userED25519PublicKey.toHexString(),
                                 "timestamp": timestamp,
                                 "signature": signature.toBase64()
                             ]
@@ -972,49 +1348,12 @@ public final class SnodeAPI {
                                         guard let responseJson: JSON = try? JSONSerialization.jsonObject(with: responseData, options: [ .fragmentsAllowed ]) as? JSON else {
                                             throw HTTP.Error.invalidJSON
                                         }
-                                        guard let swarm = responseJson["swarm"] as? JSON else { throw HTTP.Error.invalidJSON }
-                                    
-                                        var result: [String: Bool] = [:]
                                         
-                                        for (snodePublicKey, rawJSON) in swarm {
-                                            guard let json = rawJSON as? JSON else { throw HTTP.Error.invalidJSON }
-                                            
-                                            let isFailed = json["failed"] as? Bool ?? false
-                                            
-                                            if !isFailed {
-                                                guard
-                                                    let hashes = json["deleted"] as? [String],
-                                                    let signature = json["signature"] as? String
-                                                else { throw HTTP.Error.invalidJSON }
-                                                
-                                                // The signature format is ( PUBKEY_HEX || TIMESTAMP || DELETEDHASH[0] || ... || DELETEDHASH[N] )
-                                                let verificationData = [
-                                                    userX25519PublicKey,
-                                                    String(timestamp),
-                                                    hashes.joined()
-                                                ]
-                                                .joined()
-                                                .data(using: String.Encoding.utf8)!
-                                                let isValid = sodium.sign.verify(
-                                                    message: Bytes(verificationData),
-                                                    publicKey: Bytes(Data(hex: snodePublicKey)),
-                                                    signature: Bytes(Data(base64Encoded: signature)!)
-                                                )
-                                                
-                                                result[snodePublicKey] = isValid
-                                            }
-                                            else {
-                                                if let reason = json["reason"] as? String, let statusCode = json["code"] as? String {
-                                                    SNLog("Couldn't delete data from: \(snodePublicKey) due to error: \(reason) (\(statusCode)).")
-                                                } else {
-                                                    SNLog("Couldn't delete data from: \(snodePublicKey).")
-                                                }
-                                                
-                                                result[snodePublicKey] = false
-                                            }
-                                        }
-                                    
-                                        return result
+                                        return try parseClearAllDataResponse(
+                                            responseJson,
+                                            userPublicKey: userX25519PublicKey,
+                                            timestamp: timestamp
+                                        )
                                     }
                             }
                     }
@@ -1067,6 +1406,11 @@ public final class SnodeAPI {
             let newFailureCount = oldFailureCount + 1
             SnodeAPI.snodeFailureCount.mutate { $0[snode] = newFailureCount }
             SNLog("Couldn't reach snode at: \(snode); setting failure count to \(newFailureCount).")
+            
+            if let publicKey = publicKey {
+                SnodeAPI.swarmResolver.recordFailure(for: snode, publicKey: publicKey)
+            }
+            
             if newFailureCount >= SnodeAPI.snodeFailureThreshold {
                 SNLog("Failure threshold reached for: \(snode); dropping it.")
                 if let publicKey = publicKey {
@@ -0,0 +1,139 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import Sodium
+import SessionUtilitiesKit
+
+/// Responses to requests which modify a swarm (eg. `delete`, `delete_all` and `expire`) contain an Ed25519 signature from each
+/// snode in the swarm, the `SnodeSignatureVerifier` verifies all of the signatures in a response together (spreading them across
+/// cores when there are enough of them) and caches the successfully verified signatures for a short period so retried or repeated
+/// confirmations don't get verified again
+///
+/// **Note:** The cache is keyed by a digest of the snode public key, signature and message so any change to one of them (eg. a
+/// tampered signature) will result in a full verification, failed verifications are never cached
+internal final class SnodeSignatureVerifier {
+    struct Item {
+        let snodePublicKey: String
+        let signature: String
+        let message: Bytes
+    }
+    
+    /// Below this number of uncached signatures it's faster to verify them serially than to dispatch them across cores
+    private static let minConcurrentVerificationCount: Int = 4
+    
+    private let sodium: Sodium
+    private let cacheDuration: TimeInterval
+    private let maxCacheSize: Int
+    private let now: () -> Date
+    
+    private let verifiedSignatures: Atomic<[Bytes: Date]> = Atomic([:])
+    
+    // MARK: - Initialization
+    
+    init(
+        sodium: Sodium = Sodium(),
+        cacheDuration: TimeInterval = (10 * 60),
+        maxCacheSize: Int = 1000,
+        now: @escaping () -> Date = { Date() }
+    ) {
+        self.sodium = sodium
+        self.cacheDuration = cacheDuration
+        self.maxCacheSize = maxCacheSize
+        self.now = now
+    }
+    
+    // MARK: - Verification
+    
+    func verify(_ item: Item) -> Bool {
+        return verify([item])[0]
+    }
+    
+    /// Verify the signatures for all of the `items`, the result contains whether the signature for each item is valid (in the
+    /// same order as `items`)
+    ///
+    /// **Note:** An invalid snode public key or signature is treated as an invalid signature
+    func verify(_ items: [Item]) -> [Bool] {
+        guard !items.isEmpty else { return [] }
+        
+        let currentDate: Date = now()
+        let digests: [Bytes?] = items.map { digest(for: $0) }
+        let cachedResults: [Bool] = verifiedSignatures.mutate { verifiedSignatures in
+            digests.map { digest -> Bool in
+                guard
+                    let digest: Bytes = digest,
+                    let expirationDate: Date = verifiedSignatures[digest]
+                else { return false }
+                
+                return (expirationDate > currentDate)
+            }
+        }
+        let uncachedIndexes: [Int] = cachedResults.indices.filter { !cachedResults[$0] }
+        
+        guard !uncachedIndexes.isEmpty else { return cachedResults }
+        
+        var results: [Bool] = cachedResults
+        
+        if uncachedIndexes.count < SnodeSignatureVerifier.minConcurrentVerificationCount {
+            uncachedIndexes.forEach { results[$0] = verifyWithoutCache(items[$0]) }
+        }
+        else {
+            // Each iteration only writes to it's own index so this is safe to do concurrently
+            results.withUnsafeMutableBufferPointer { buffer in
+                let output: UnsafeMutableBufferPointer<Bool> = buffer
+                
+                DispatchQueue.concurrentPerform(iterations: uncachedIndexes.count) { index in
+                    let itemIndex: Int = uncachedIndexes[index]
+                    
+                    output[itemIndex] = verifyWithoutCache(items[itemIndex])
+                }
+            }
+        }
+        
+        let newlyVerifiedDigests: [Bytes] = uncachedIndexes.compactMap { index in (results[index] ? digests[index] : nil) }
+        
+        if !newlyVerifiedDigests.isEmpty {
+            let expirationDate: Date = currentDate.addingTimeInterval(cacheDuration)
+            
+            verifiedSignatures.mutate { verifiedSignatures in
+                newlyVerifiedDigests.forEach { verifiedSignatures[$0] = expirationDate }
+                
+                if verifiedSignatures.count > maxCacheSize {
+                    verifiedSignatures = verifiedSignatures.filter { _, expirationDate in expirationDate > currentDate }
+                }
+                
+                // If the cache is still too large then just start again (the cache only avoids duplicate work so this
+                // is safe to do)
+                if verifiedSignatures.count > maxCacheSize {
+                    verifiedSignatures = [:]
+                }
+            }
+        }
+        
+        return results
+    }
+    
+    func removeAllCachedSignatures() {
+        verifiedSignatures.mutate { $0 = [:] }
+    }
+    
+    // MARK: - Internal Functions
+    
+    private func verifyWithoutCache(_ item: Item) -> Bool {
+        guard
+            let snodePublicKey: Bytes = Hex.decodedBytes(item.snodePublicKey),
+            let signature: Bytes = Base64.decodedBytes(item.signature)
+        else { return false }
+        
+        return sodium.sign.verify(message: item.message, publicKey: snodePublicKey, signature: signature)
+    }
+    
+    private func digest(for item: Item) -> Bytes? {
+        // Include the lengths so different splits of the same bytes can't produce the same digest
+        let input: Bytes = "\(item.snodePublicKey.utf8.count):\(item.signature.utf8.count):".bytes
+            .appending(contentsOf: item.snodePublicKey.bytes)
+            .appending(contentsOf: item.signature.bytes)
+            .appending(contentsOf: item.message)
+        
+        return sodium.genericHash.hash(message: input)
+    }
+}
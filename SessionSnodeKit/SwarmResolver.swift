@@ -0,0 +1,163 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import PromiseKit
+import SessionUtilitiesKit
+
+/// The swarm for a public key is needed by the pollers, the `MessageSender` and a number of jobs (often for the same key at the
+/// same time) so the `SwarmResolver` ensures there is only a single refresh in flight for each key and, when there is already a
+/// cached swarm, returns it immediately and refreshes it in the background when it is stale
+///
+/// It also tracks a health score for each snode within a swarm (based on the success or failure of requests associated with the
+/// swarm's public key) which is used to prefer the healthier snodes when picking target snodes
+///
+/// **Note:** A swarm is considered fresh the first time it is loaded (swarms rarely change so the persisted swarm is trusted until
+/// `refreshInterval` has passed or it has fewer than `minSwarmSnodeCount` snodes)
+internal final class SwarmResolver {
+    internal static let maxHealthScore: Int = 5
+    internal static let minHealthScore: Int = -10
+    internal static let failurePenalty: Int = 2
+    
+    private let minSwarmSnodeCount: Int
+    private let refreshInterval: TimeInterval
+    private let loadSwarm: (String) -> Set<Snode>
+    private let fetchSwarm: (String) -> Promise<Set<Snode>>
+    private let now: () -> Date
+    
+    private let lastRefreshDates: Atomic<[String: Date]> = Atomic([:])
+    private let inFlightRefreshes: Atomic<[String: Promise<Set<Snode>>]> = Atomic([:])
+    private let healthScores: Atomic<[String: [Snode: Int]]> = Atomic([:])
+    
+    // MARK: - Initialization
+    
+    /// - parameter loadSwarm: Returns the cached swarm for the key (loading it from the database if needed)
+    /// - parameter fetchSwarm: Retrieves the swarm for the key from the network (and updates the cache)
+    init(
+        minSwarmSnodeCount: Int,
+        refreshInterval: TimeInterval,
+        loadSwarm: @escaping (String) -> Set<Snode>,
+        fetchSwarm: @escaping (String) -> Promise<Set<Snode>>,
+        now: @escaping () -> Date = { Date() }
+    ) {
+        self.minSwarmSnodeCount = minSwarmSnodeCount
+        self.refreshInterval = refreshInterval
+        self.loadSwarm = loadSwarm
+        self.fetchSwarm = fetchSwarm
+        self.now = now
+    }
+    
+    // MARK: - Swarm Resolution
+    
+    /// Retrieve the swarm for the key, this will only wait for the network if there is no cached swarm
+    func swarm(for publicKey: String) -> Promise<Set<Snode>> {
+        let cachedSwarm: Set<Snode> = loadSwarm(publicKey)
+        
+        guard !cachedSwarm.isEmpty else { return refresh(publicKey) }
+        
+        if isStale(cachedSwarm, for: publicKey) {
+            refresh(publicKey).catch2 { error in
+                SNLog("Failed to refresh swarm in the background due to error: \(error).")
+            }
+        }
+        
+        return Promise.value(cachedSwarm)
+    }
+    
+    /// Fetch the swarm for the key from the network, if there is already a refresh in flight for the key then that will be returned
+    /// instead of starting a new one
+    @discardableResult func refresh(_ publicKey: String) -> Promise<Set<Snode>> {
+        // Insert a pending promise while holding the lock and only start the fetch once it has been released (starting the
+        // fetch can be slow and it can complete synchronously, in which case it would need to take the lock again)
+        let (promise, seal) = Promise<Set<Snode>>.pending()
+        let existingPromise: Promise<Set<Snode>>? = inFlightRefreshes.mutate { inFlightRefreshes in
+            if let existingPromise: Promise<Set<Snode>> = inFlightRefreshes[publicKey] {
+                return existingPromise
+            }
+            
+            inFlightRefreshes[publicKey] = promise
+            return nil
+        }
+        
+        if let existingPromise: Promise<Set<Snode>> = existingPromise { return existingPromise }
+        
+        fetchSwarm(publicKey)
+            .done2 { [weak self] swarm in
+                self?.didRefresh(swarm, for: publicKey)
+                self?.inFlightRefreshes.mutate { $0[publicKey] = nil }
+                seal.fulfill(swarm)
+            }
+            .catch2 { [weak self] error in
+                self?.inFlightRefreshes.mutate { $0[publicKey] = nil }
+                seal.reject(error)
+            }
+        
+        return promise
+    }
+    
+    private func isStale(_ swarm: Set<Snode>, for publicKey: String) -> Bool {
+        guard swarm.count >= minSwarmSnodeCount else { return true }
+        
+        let currentDate: Date = now()
+        let lastRefreshDate: Date = lastRefreshDates.mutate { lastRefreshDates in
+            let lastRefreshDate: Date = (lastRefreshDates[publicKey] ?? currentDate)
+            lastRefreshDates[publicKey] = lastRefreshDate
+            
+            return lastRefreshDate
+        }
+        
+        return (currentDate.timeIntervalSince(lastRefreshDate) > refreshInterval)
+    }
+    
+    private func didRefresh(_ swarm: Set<Snode>, for publicKey: String) {
+        lastRefreshDates.mutate { $0[publicKey] = now() }
+        
+        // Snodes which are no longer in the swarm don't need a health score
+        healthScores.mutate { healthScores in
+            healthScores[publicKey] = healthScores[publicKey]?.filter { snode, _ in swarm.contains(snode) }
+        }
+    }
+    
+    // MARK: - Health
+    
+    func recordSuccess(for snode: Snode, publicKey: String) {
+        healthScores.mutate { healthScores in
+            let score: Int = (healthScores[publicKey]?[snode] ?? 0)
+            healthScores[publicKey, default: [:]][snode] = min(score + 1, SwarmResolver.maxHealthScore)
+        }
+    }
+    
+    func recordFailure(for snode: Snode, publicKey: String) {
+        healthScores.mutate { healthScores in
+            let score: Int = (healthScores[publicKey]?[snode] ?? 0)
+            healthScores[publicKey, default: [:]][snode] = max(
+                score - SwarmResolver.failurePenalty,
+                SwarmResolver.minHealthScore
+            )
+        }
+    }
+    
+    func healthScore(for snode: Snode, publicKey: String) -> Int {
+        return (healthScores.wrappedValue[publicKey]?[snode] ?? 0)
+    }
+    
+    /// Pick `count` snodes from the swarm preferring the snodes with the highest health scores, snodes with the same score are
+    /// picked at random
+    func targetSnodes(from swarm: Set<Snode>, for publicKey: String, count: Int) -> [Snode] {
+        let scores: [Snode: Int] = (healthScores.wrappedValue[publicKey] ?? [:])
+        
+        // shuffled() uses the system's default random generator, which is cryptographically secure
+        return swarm
+            .shuffled()
+            .enumerated()
+            .sorted { lhs, rhs in
+                let lhsScore: Int = (scores[lhs.element] ?? 0)
+                let rhsScore: Int = (scores[rhs.element] ?? 0)
+                
+                guard lhsScore == rhsScore else { return lhsScore > rhsScore }
+                
+                return (lhs.offset < rhs.offset)
+            }
+            .prefix(count)
+            .map { $0.element }
+    }
+}
@@ -0,0 +1,194 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import GRDB
+import Quick
+import Nimble
+import SessionSnodeKit
+import SessionMessagingKit
+import SessionUtilitiesKit
+
+@testable import Session
+
+class ConversationOpenContextCacheSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        let sentinelThreadId: String = "SentinelThreadId"
+        var mockStorage: Storage!
+        var cache: ConversationOpenContextCache!
+        var interactionIds: [String: Int64] = [:]
+        
+        func cachedContext(_ threadId: String) -> ConversationOpenContextCache.Context? {
+            return cache.cachedContext(for: threadId, threadVariant: .contact, focusedInteractionId: nil)
+        }
+        
+        func touchInteraction(in threadId: String) {
+            mockStorage.write { db in
+                try Interaction
+                    .filter(Interaction.Columns.id == interactionIds[threadId])
+                    .updateAll(db, Interaction.Columns.body.set(to: "Updated"))
+            }
+        }
+        
+        /// The cache starts observing the database asynchronously so wait until it receives changes before testing the
+        /// invalidation
+        func waitUntilObserving() {
+            _ = cache.loadContext(for: sentinelThreadId, threadVariant: .contact)
+            
+            expect({ () -> ConversationOpenContextCache.Context? in
+                touchInteraction(in: sentinelThreadId)
+                
+                return cachedContext(sentinelThreadId)
+            }()).toEventually(beNil())
+        }
+        
+        describe("a ConversationOpenContextCache") {
+            beforeEach {
+                mockStorage = Storage(
+                    customWriter: try! DatabaseQueue(),
+                    customMigrations: [
+                        SNUtilitiesKit.migrations(),
+                        SNSnodeKit.migrations(),
+                        SNMessagingKit.migrations()
+                    ]
+                )
+                cache = ConversationOpenContextCache(storage: mockStorage)
+                
+                interactionIds = mockStorage
+                    .write { db -> [String: Int64] in
+                        try ["TestThreadId1", "TestThreadId2", sentinelThreadId]
+                            .reduce(into: [:]) { result, threadId in
+                                try SessionThread(id: threadId, variant: .contact).insert(db)
+                                result[threadId] = try Interaction(
+                                    threadId: threadId,
+                                    authorId: threadId,
+                                    variant: .standardIncoming,
+                                    body: "Test",
+                                    timestampMs: 1234
+                                ).inserted(db).id
+                            }
+                    }
+                    .defaulting(to: [:])
+            }
+            
+            afterEach {
+                cache.clearAll()
+                cache = nil
+                mockStorage = nil
+            }
+            
+            // MARK: - when retrieving contexts
+            context("when retrieving contexts") {
+                it("doesn't return a context which hasn't been loaded") {
+                    expect(cachedContext("TestThreadId1")).to(beNil())
+                }
+                
+                it("caches a loaded context") {
+                    let context: ConversationOpenContextCache.Context? = cache.loadContext(
+                        for: "TestThreadId1",
+                        threadVariant: .contact
+                    )
+                    
+                    expect(context?.firstUnreadInteractionId).to(equal(interactionIds["TestThreadId1"]))
+                    expect(cachedContext("TestThreadId1")?.firstUnreadInteractionId)
+                        .to(equal(interactionIds["TestThreadId1"]))
+                }
+                
+                it("doesn't return a context for a different thread variant") {
+                    _ = cache.loadContext(for: "TestThreadId1", threadVariant: .contact)
+                    
+                    expect(cache.cachedContext(for: "TestThreadId1", threadVariant: .openGroup, focusedInteractionId: nil))
+                        .to(beNil())
+                }
+                
+                it("removes the least recently used contexts once the limit is reached") {
+                    let threadIds: [String] = (0..<ConversationOpenContextCache.maxCachedContexts)
+                        .map { "OtherThreadId\($0)" }
+                    threadIds.forEach { _ = cache.loadContext(for: $0, threadVariant: .contact) }
+                    
+                    // Using a context should prevent it from being the next one evicted
+                    _ = cachedContext(threadIds[0])
+                    _ = cache.loadContext(for: "TestThreadId1", threadVariant: .contact)
+                    
+                    expect(cachedContext(threadIds[0])).toNot(beNil())
+                    expect(cachedContext(threadIds[1])).to(beNil())
+                    expect(cachedContext(threadIds[2])).toNot(beNil())
+                    expect(cachedContext("TestThreadId1")).toNot(beNil())
+                }
+                
+                it("removes all of the contexts") {
+                    _ = cache.loadContext(for: "TestThreadId1", threadVariant: .contact)
+                    cache.clearAll()
+                    
+                    expect(cachedContext("TestThreadId1")).to(beNil())
+                }
+            }
+            
+            // MARK: - when the database changes
+            context("when the database changes") {
+                beforeEach {
+                    waitUntilObserving()
+                    
+                    _ = cache.loadContext(for: "TestThreadId1", threadVariant: .contact)
+                    _ = cache.loadContext(for: "TestThreadId2", threadVariant: .contact)
+                }
+                
+                it("only invalidates the thread an interaction was changed in") {
+                    touchInteraction(in: "TestThreadId1")
+                    
+                    expect(cachedContext("TestThreadId1")).toEventually(beNil(), timeout: .milliseconds(100))
+                    expect(cachedContext("TestThreadId2")).toNot(beNil())
+                }
+                
+                it("invalidates every thread when an interaction is deleted") {
+                    mockStorage.write { db in
+                        _ = try Interaction
+                            .filter(Interaction.Columns.id == interactionIds["TestThreadId1"])
+                            .deleteAll(db)
+                    }
+                    
+                    expect(cachedContext("TestThreadId1")).to(beNil())
+                    expect(cachedContext("TestThreadId2")).to(beNil())
+                }
+                
+                it("keeps contexts without a page when a table only used in the page changes") {
+                    mockStorage.write { db in
+                        try Reaction(
+                            interactionId: interactionIds["TestThreadId1"]!,
+                            serverHash: nil,
+                            timestampMs: 1234,
+                            authorId: "TestAuthorId",
+                            emoji: "👍",
+                            count: 1,
+                            sortId: 0
+                        ).insert(db)
+                    }
+                    
+                    expect(cachedContext("TestThreadId1")).toNot(beNil())
+                    expect(cachedContext("TestThreadId2")).toNot(beNil())
+                }
+                
+                it("only invalidates the prewarmed thread a table only used in the page was changed in") {
+                    cache.prewarm(threads: [
+                        (threadId: "TestThreadId1", threadVariant: .contact),
+                        (threadId: "TestThreadId2", threadVariant: .contact)
+                    ])
+                    mockStorage.write { db in
+                        try Reaction(
+                            interactionId: interactionIds["TestThreadId1"]!,
+                            serverHash: nil,
+                            timestampMs: 1234,
+                            authorId: "TestAuthorId",
+                            emoji: "👍",
+                            count: 1,
+                            sortId: 0
+                        ).insert(db)
+                    }
+                    
+                    expect(cachedContext("TestThreadId1")).toEventually(beNil(), timeout: .milliseconds(100))
+                    expect(cachedContext("TestThreadId2")).toNot(beNil())
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,168 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import UIKit
+import Quick
+import Nimble
+
+@testable import Session
+
+class MessageCellLayoutCacheSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        var cache: MessageCellLayoutCache!
+        
+        func message(body: String = "Test", isTypingIndicator: Bool? = nil) -> MessageViewModel {
+            return MessageViewModel(
+                variant: .standardOutgoing,
+                body: body,
+                cellType: (isTypingIndicator == true ? .typingIndicator : .textOnlyMessage),
+                isTypingIndicator: isTypingIndicator
+            )
+        }
+        
+        func prepare(_ cellViewModels: [MessageViewModel], expandedReactionInteractionIds: Set<Int64> = []) {
+            // The layouts are calculated asynchronously when called on the main thread
+            DispatchQueue.global(qos: .userInitiated).sync {
+                cache.prepareLayouts(for: cellViewModels, expandedReactionInteractionIds: expandedReactionInteractionIds)
+            }
+        }
+        
+        describe("a MessageCellLayoutCache") {
+            beforeEach {
+                cache = MessageCellLayoutCache()
+                cache.update(tableWidth: 320)
+            }
+            
+            // MARK: - when preparing layouts
+            context("when preparing layouts") {
+                it("has no height for a message which hasn't been prepared") {
+                    expect(cache.estimatedHeight(for: message().id)).to(beNil())
+                }
+                
+                it("estimates the height of prepared messages") {
+                    prepare([message()])
+                    
+                    expect(cache.estimatedHeight(for: message().id)).to(beGreaterThan(0))
+                }
+                
+                it("estimates a larger height for longer content") {
+                    prepare([message()])
+                    let shortHeight: CGFloat? = cache.estimatedHeight(for: message().id)
+                    
+                    prepare([message(body: String(repeating: "Test ", count: 100))])
+                    
+                    expect(cache.estimatedHeight(for: message().id)).to(beGreaterThan(shortHeight ?? 0))
+                }
+                
+                it("doesn't store layouts for typing indicators") {
+                    prepare([message(isTypingIndicator: true)])
+                    
+                    expect(cache.estimatedHeight(for: MessageViewModel.typingIndicatorId)).to(beNil())
+                }
+                
+                it("doesn't calculate layouts before the table width is known") {
+                    cache = MessageCellLayoutCache()
+                    prepare([message()])
+                    
+                    expect(cache.estimatedHeight(for: message().id)).to(beNil())
+                }
+                
+                it("removes layouts for messages which are no longer in the data") {
+                    prepare([message()])
+                    prepare([])
+                    
+                    expect(cache.estimatedHeight(for: message().id)).to(beNil())
+                }
+            }
+            
+            // MARK: - when storing measured heights
+            context("when storing measured heights") {
+                it("uses the measured height instead of the estimate") {
+                    prepare([message()])
+                    cache.store(measuredHeight: 123, for: message(), showExpandedReactions: false)
+                    
+                    expect(cache.estimatedHeight(for: message().id)).to(equal(123))
+                }
+                
+                it("ignores measured heights for messages which haven't been prepared") {
+                    cache.store(measuredHeight: 123, for: message(), showExpandedReactions: false)
+                    
+                    expect(cache.estimatedHeight(for: message().id)).to(beNil())
+                }
+                
+                it("keeps the measured height when the content doesn't change") {
+                    prepare([message()])
+                    cache.store(measuredHeight: 123, for: message(), showExpandedReactions: false)
+                    prepare([message()])
+                    
+                    expect(cache.estimatedHeight(for: message().id)).to(equal(123))
+                }
+                
+                it("uses the measured height as the height of a cell with the same content") {
+                    prepare([message()])
+                    cache.store(measuredHeight: 123, for: message(), showExpandedReactions: false)
+                    
+                    expect(cache.height(for: message(), showExpandedReactions: false)).to(equal(123))
+                }
+                
+                it("has no height for a cell which hasn't been measured") {
+                    prepare([message()])
+                    
+                    expect(cache.height(for: message(), showExpandedReactions: false)).to(beNil())
+                }
+                
+                it("has no height for a cell whose content differs from the measured content") {
+                    prepare([message()])
+                    cache.store(measuredHeight: 123, for: message(), showExpandedReactions: false)
+                    
+                    expect(cache.height(for: message(body: "Updated"), showExpandedReactions: false)).to(beNil())
+                    expect(cache.height(for: message(), showExpandedReactions: true)).to(beNil())
+                }
+                
+                it("ignores measured heights for content which differs from the prepared content") {
+                    prepare([message(body: "Updated")])
+                    cache.store(measuredHeight: 123, for: message(), showExpandedReactions: false)
+                    
+                    expect(cache.height(for: message(body: "Updated"), showExpandedReactions: false)).to(beNil())
+                    expect(cache.estimatedHeight(for: message().id)).toNot(equal(123))
+                }
+                
+                it("discards the measured height when the content changes") {
+                    prepare([message()])
+                    cache.store(measuredHeight: 123, for: message(), showExpandedReactions: false)
+                    prepare([message(body: "Updated")])
+                    
+                    expect(cache.estimatedHeight(for: message().id)).toNot(equal(123))
+                    expect(cache.estimatedHeight(for: message().id)).toNot(beNil())
+                }
+            }
+            
+            // MARK: - when invalidating
+            context("when invalidating") {
+                it("removes the layouts when the table width changes") {
+                    prepare([message()])
+                    cache.store(measuredHeight: 123, for: message(), showExpandedReactions: false)
+                    cache.update(tableWidth: 480)
+                    
+                    expect(cache.estimatedHeight(for: message().id)).to(beNil())
+                }
+                
+                it("keeps the layouts when the table width doesn't change") {
+                    prepare([message()])
+                    cache.store(measuredHeight: 123, for: message(), showExpandedReactions: false)
+                    cache.update(tableWidth: 320)
+                    
+                    expect(cache.estimatedHeight(for: message().id)).to(equal(123))
+                }
+                
+                it("removes all of the layouts") {
+                    prepare([message()])
+                    cache.removeAll()
+                    
+                    expect(cache.estimatedHeight(for: message().id)).to(beNil())
+                }
+            }
+        }
+    }
+}
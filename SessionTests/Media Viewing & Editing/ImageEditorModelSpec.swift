@@ -0,0 +1,151 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import UIKit
+import Quick
+import Nimble
+import SignalUtilitiesKit
+
+class ImageEditorModelSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        let firstSample: ImageEditorSample = ImageEditorSample(x: 0.1, y: 0.1)
+        let secondSample: ImageEditorSample = ImageEditorSample(x: 0.2, y: 0.2)
+        let thirdSample: ImageEditorSample = ImageEditorSample(x: 0.3, y: 0.3)
+        var imagePath: String!
+        var model: ImageEditorModel!
+        
+        func strokeItem(samples: [ImageEditorSample]) -> ImageEditorStrokeItem {
+            return ImageEditorStrokeItem(
+                color: .red,
+                unitSamples: samples,
+                unitStrokeWidth: ImageEditorStrokeItem.defaultUnitStrokeWidth()
+            )
+        }
+        
+        func sampleCount(for itemId: String) -> Int? {
+            return (model.item(forId: itemId) as? ImageEditorStrokeItem)?.sampleCount
+        }
+        
+        /// Draw a complete stroke with the provided samples (one sample per touch)
+        @discardableResult func drawStroke(samples: [ImageEditorSample]) -> ImageEditorStrokeItem {
+            var item: ImageEditorStrokeItem = strokeItem(samples: Array(samples.prefix(1)))
+            model.beginStroke(item: item)
+            
+            samples.dropFirst().dropLast().forEach { sample in
+                item = item.appending(samples: [sample])
+                model.updateInProgressStroke(item: item)
+            }
+            
+            item = (samples.count > 1 ? item.appending(samples: Array(samples.suffix(1))) : item)
+            model.endStroke(item: item)
+            
+            return item
+        }
+        
+        describe("an ImageEditorModel") {
+            beforeEach {
+                imagePath = "\(NSTemporaryDirectory())ImageEditorModelSpec-\(UUID().uuidString).png"
+                
+                let image: UIImage = UIGraphicsImageRenderer(size: CGSize(width: 10, height: 10)).image { context in
+                    UIColor.white.setFill()
+                    context.fill(CGRect(x: 0, y: 0, width: 10, height: 10))
+                }
+                try! image.pngData()!.write(to: URL(fileURLWithPath: imagePath))
+                
+                model = try! ImageEditorModel(srcImagePath: imagePath)
+            }
+            
+            afterEach {
+                try? FileManager.default.removeItem(atPath: imagePath)
+            }
+            
+            // MARK: - when drawing a stroke
+            context("when drawing a stroke") {
+                it("records a single undo operation for the whole stroke") {
+                    let item: ImageEditorStrokeItem = strokeItem(samples: [firstSample])
+                    model.beginStroke(item: item)
+                    let operationId: String? = model.currentUndoOperationId()
+                    
+                    let updatedItem: ImageEditorStrokeItem = item.appending(samples: [secondSample])
+                    model.updateInProgressStroke(item: updatedItem)
+                    model.endStroke(item: updatedItem.appending(samples: [thirdSample]))
+                    
+                    expect(operationId).toNot(beNil())
+                    expect(model.currentUndoOperationId()).to(equal(operationId))
+                    expect(sampleCount(for: item.itemId)).to(equal(3))
+                }
+                
+                it("only marks the stroke as in progress until it ends") {
+                    let item: ImageEditorStrokeItem = strokeItem(samples: [firstSample])
+                    model.beginStroke(item: item)
+                    
+                    expect(model.isStrokeInProgress(itemId: item.itemId)).to(beTrue())
+                    
+                    model.endStroke(item: item.appending(samples: [secondSample]))
+                    
+                    expect(model.isStrokeInProgress(itemId: item.itemId)).to(beFalse())
+                }
+                
+                it("removes the whole stroke with a single undo") {
+                    drawStroke(samples: [firstSample, secondSample, thirdSample])
+                    model.undo()
+                    
+                    expect(model.itemCount()).to(equal(0))
+                    expect(model.canUndo()).to(beFalse())
+                }
+                
+                it("restores the finished stroke when redoing") {
+                    let item: ImageEditorStrokeItem = drawStroke(samples: [firstSample, secondSample, thirdSample])
+                    model.undo()
+                    model.redo()
+                    
+                    expect(sampleCount(for: item.itemId)).to(equal(3))
+                    expect(model.canRedo()).to(beFalse())
+                }
+                
+                it("doesn't change the earlier undo snapshots while the stroke is updated") {
+                    let firstItem: ImageEditorStrokeItem = drawStroke(samples: [firstSample, secondSample])
+                    let secondItem: ImageEditorStrokeItem = drawStroke(samples: [firstSample, secondSample, thirdSample])
+                    model.undo()
+                    
+                    expect(model.itemIds()).to(equal([firstItem.itemId]))
+                    expect(sampleCount(for: firstItem.itemId)).to(equal(2))
+                    expect(model.has(itemForId: secondItem.itemId)).to(beFalse())
+                }
+                
+                it("ends the in-progress stroke when undoing") {
+                    let item: ImageEditorStrokeItem = strokeItem(samples: [firstSample])
+                    model.beginStroke(item: item)
+                    model.updateInProgressStroke(item: item.appending(samples: [secondSample]))
+                    model.undo()
+                    
+                    expect(model.isStrokeInProgress(itemId: item.itemId)).to(beFalse())
+                    expect(model.itemCount()).to(equal(0))
+                }
+            }
+            
+            // MARK: - when appending samples to a stroke
+            context("when appending samples to a stroke") {
+                it("doesn't change the samples of the earlier versions") {
+                    let item: ImageEditorStrokeItem = strokeItem(samples: [firstSample])
+                    let updatedItem: ImageEditorStrokeItem = item.appending(samples: [secondSample])
+                    
+                    expect(item.unitSamples).to(equal([firstSample]))
+                    expect(updatedItem.unitSamples).to(equal([firstSample, secondSample]))
+                    expect(updatedItem.sharesSamples(with: item)).to(beTrue())
+                }
+                
+                it("copies the samples when appending to an older version") {
+                    let item: ImageEditorStrokeItem = strokeItem(samples: [firstSample])
+                    let updatedItem: ImageEditorStrokeItem = item.appending(samples: [secondSample])
+                    let branchedItem: ImageEditorStrokeItem = item.appending(samples: [thirdSample])
+                    
+                    expect(updatedItem.unitSamples).to(equal([firstSample, secondSample]))
+                    expect(branchedItem.unitSamples).to(equal([firstSample, thirdSample]))
+                    expect(branchedItem.sharesSamples(with: item)).to(beFalse())
+                }
+            }
+        }
+    }
+}
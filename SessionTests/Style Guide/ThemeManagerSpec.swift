@@ -0,0 +1,131 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import UIKit
+
+import Quick
+import Nimble
+
+@testable import SessionUIKit
+
+class ThemeManagerSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        var view: UIView!
+        
+        /// Register a closure for an object which is released before this function returns, returns the identifier the object
+        /// was registered under
+        func registerDeallocatedObject() -> ObjectIdentifier {
+            var identifier: ObjectIdentifier!
+            
+            autoreleasepool {
+                let deallocatedView: UIView = UIView()
+                identifier = ObjectIdentifier(deallocatedView)
+                ThemeManager.set(deallocatedView, info: ["test"]) { _ in }
+            }
+            
+            return identifier
+        }
+        
+        describe("a ThemeManager") {
+            beforeEach {
+                view = UIView()
+            }
+            
+            afterEach {
+                ThemeManager.remove(view, allWith: "test")
+                view = nil
+            }
+            
+            // MARK: - when registering an object
+            context("when registering an object") {
+                it("applies the theme immediately") {
+                    var callCount: Int = 0
+                    
+                    ThemeManager.set(view, info: ["test"]) { _ in callCount += 1 }
+                    
+                    expect(callCount).to(equal(1))
+                }
+                
+                it("replaces the closure when re-registered with the same info") {
+                    var firstCallCount: Int = 0
+                    var secondCallCount: Int = 0
+                    
+                    ThemeManager.set(view, info: ["test"]) { _ in firstCallCount += 1 }
+                    ThemeManager.set(view, info: ["test"]) { _ in secondCallCount += 1 }
+                    ThemeManager.existingApplier(for: view)?.apply(theme: .classicLight)
+                    
+                    expect(firstCallCount).to(equal(1))
+                    expect(secondCallCount).to(equal(2))
+                }
+                
+                it("keeps the closures registered with different info") {
+                    var firstCallCount: Int = 0
+                    var secondCallCount: Int = 0
+                    
+                    ThemeManager.set(view, info: ["test", "first"]) { _ in firstCallCount += 1 }
+                    ThemeManager.set(view, info: ["test", "second"]) { _ in secondCallCount += 1 }
+                    ThemeManager.existingApplier(for: view)?.apply(theme: .classicLight)
+                    
+                    expect(firstCallCount).to(equal(2))
+                    expect(secondCallCount).to(equal(2))
+                }
+                
+                it("reuses the same applier for the object") {
+                    ThemeManager.set(view, info: ["test", "first"]) { _ in }
+                    let applier: ThemeApplier? = ThemeManager.existingApplier(for: view)
+                    ThemeManager.set(view, info: ["test", "second"]) { _ in }
+                    
+                    expect(applier).toNot(beNil())
+                    expect(ThemeManager.existingApplier(for: view)).to(beIdenticalTo(applier))
+                }
+                
+                it("removes the entry once all of its closures are removed") {
+                    ThemeManager.set(view, info: ["test", "first"]) { _ in }
+                    ThemeManager.set(view, info: ["test", "second"]) { _ in }
+                    
+                    ThemeManager.remove(view, info: ["test", "first"])
+                    expect(ThemeManager.existingApplier(for: view)).toNot(beNil())
+                    
+                    ThemeManager.remove(view, info: ["test", "second"])
+                    expect(ThemeManager.existingApplier(for: view)).to(beNil())
+                    expect(ThemeManager.uiRegistry[ObjectIdentifier(view)]).to(beNil())
+                }
+            }
+            
+            // MARK: - when a registered object is deallocated
+            context("when a registered object is deallocated") {
+                it("removes its entry when sweeping") {
+                    let identifier: ObjectIdentifier = registerDeallocatedObject()
+                    
+                    expect(ThemeManager.uiRegistry[identifier]).toNot(beNil())
+                    expect(ThemeManager.uiRegistry[identifier]?.owner).to(beNil())
+                    
+                    ThemeManager.sweepRegistry()
+                    
+                    expect(ThemeManager.uiRegistry[identifier]).to(beNil())
+                }
+                
+                it("keeps the entries for objects which are still alive when sweeping") {
+                    ThemeManager.set(view, info: ["test"]) { _ in }
+                    _ = registerDeallocatedObject()
+                    
+                    ThemeManager.sweepRegistry()
+                    
+                    expect(ThemeManager.uiRegistry[ObjectIdentifier(view)]).toNot(beNil())
+                    expect(ThemeManager.existingApplier(for: view)).toNot(beNil())
+                }
+                
+                it("removes deallocated entries automatically once enough objects have been registered") {
+                    // Note: Since the registry sweeps every 'sweepInterval' registrations the deallocated entries should
+                    // never build up past that interval (a new object can be allocated at the address of a deallocated one
+                    // so we can't check a specific identifier here)
+                    (0..<(ThemeManager.sweepInterval * 2)).forEach { _ in _ = registerDeallocatedObject() }
+                    
+                    expect(ThemeManager.uiRegistry.values.filter { $0.owner == nil }.count)
+                        .to(beLessThan(ThemeManager.sweepInterval))
+                }
+            }
+        }
+    }
+}
@@ -24,11 +24,17 @@ public extension Setting.BoolKey {
 public enum ThemeManager {
     private static var hasSetInitialSystemTrait: Bool = false
     
-    /// **Note:** Using `weakToStrongObjects` means that the value types will continue to be maintained until the map table resizes
-    /// itself (ie. until a new UI element is registered to the table)
+    /// Each themed object has a single `ThemeApplier` which is stored against the `ObjectIdentifier` of the object, since the
+    /// registry only holds a weak reference to the object any entries whose object has been deallocated get swept periodically (and
+    /// whenever the theme changes)
     ///
-    /// Unfortunately if we don't do this the `ThemeApplier` is immediately deallocated and we can't use it to update the theme
-    private static var uiRegistry: NSMapTable<AnyObject, ThemeApplier> = NSMapTable.weakToStrongObjects()
+    /// **Note:** An `ObjectIdentifier` can be reused once the original object has been deallocated so we need to check the
+    /// `owner` of an entry matches before using it
+    internal private(set) static var uiRegistry: [ObjectIdentifier: RegistryEntry] = [:]
+    private static var registrationsSinceSweep: Int = 0
+    
+    /// The number of new registrations before we sweep the registry for deallocated objects
+    internal static let sweepInterval: Int = 500
     
     public static var currentTheme: Theme = {
         Storage.shared[.theme].defaulting(to: Theme.classicDark)
@@ -267,13 +273,7 @@ public enum ThemeManager {
     }
     
     public static func onThemeChange(observer: AnyObject, callback: @escaping (Theme, Theme.PrimaryColor) -> ()) {
-        ThemeManager.uiRegistry.setObject(
-            ThemeApplier(
-                existingApplier: ThemeManager.get(for: observer),
-                info: []
-            ) { theme in callback(theme, ThemeManager.primaryColor) },
-            forKey: observer
-        )
+        ThemeManager.set(observer, info: []) { theme in callback(theme, ThemeManager.primaryColor) }
     }
     
     private static func updateAllUI() {
@@ -281,8 +281,10 @@ public enum ThemeManager {
             return DispatchQueue.main.async { updateAllUI() }
         }
         
-        ThemeManager.uiRegistry.objectEnumerator()?.forEach { applier in
-            (applier as? ThemeApplier)?.apply(theme: currentTheme)
+        // Sweep the registry before applying the theme so we only apply it to objects which still exist
+        sweepRegistry()
+        ThemeManager.uiRegistry.values.forEach { entry in
+            entry.applier.apply(theme: currentTheme)
         }
         
         applyNavigationStyling()
@@ -299,20 +301,14 @@ public enum ThemeManager {
         keyPath: ReferenceWritableKeyPath<T, UIColor?>,
         to value: ThemeValue?
     ) {
-        ThemeManager.uiRegistry.setObject(
-            ThemeApplier(
-                existingApplier: ThemeManager.get(for: view),
-                info: [ keyPath ]
-            ) { [weak view] theme in
-                guard let value: ThemeValue = value else {
-                    view?[keyPath: keyPath] = nil
-                    return
-                }
-
-                view?[keyPath: keyPath] = ThemeManager.resolvedColor(theme.color(for: value))
-            },
-            forKey: view
-        )
+        ThemeManager.set(view, info: [keyPath]) { [weak view] theme in
+            guard let value: ThemeValue = value else {
+                view?[keyPath: keyPath] = nil
+                return
+            }
+            
+            view?[keyPath: keyPath] = ThemeManager.resolvedColor(theme.color(for: value))
+        }
     }
     
     internal static func remove<T: AnyObject>(
@@ -320,12 +316,7 @@ public enum ThemeManager {
         keyPath: ReferenceWritableKeyPath<T, UIColor?>
     ) {
         // Note: Need to explicitly remove (setting to 'nil' won't actually remove it)
-        guard let updatedApplier: ThemeApplier = ThemeManager.get(for: view)?.removing(allWith: keyPath) else {
-            ThemeManager.uiRegistry.removeObject(forKey: view)
-            return
-        }
-        
-        ThemeManager.uiRegistry.setObject(updatedApplier, forKey: view)
+        ThemeManager.remove(view, info: [keyPath])
     }
     
     internal static func set<T: AnyObject>(
@@ -333,38 +324,46 @@ public enum ThemeManager {
         keyPath: ReferenceWritableKeyPath<T, CGColor?>,
         to value: ThemeValue?
     ) {
-        ThemeManager.uiRegistry.setObject(
-            ThemeApplier(
-                existingApplier: ThemeManager.get(for: view),
-                info: [ keyPath ]
-            ) { [weak view] theme in
-                guard let value: ThemeValue = value else {
-                    view?[keyPath: keyPath] = nil
-                    return
-                }
-                
-                view?[keyPath: keyPath] = ThemeManager.resolvedColor(theme.color(for: value))?.cgColor
-            },
-            forKey: view
-        )
+        ThemeManager.set(view, info: [keyPath]) { [weak view] theme in
+            guard let value: ThemeValue = value else {
+                view?[keyPath: keyPath] = nil
+                return
+            }
+            
+            view?[keyPath: keyPath] = ThemeManager.resolvedColor(theme.color(for: value))?.cgColor
+        }
     }
     
     internal static func remove<T: AnyObject>(
         _ view: T,
         keyPath: ReferenceWritableKeyPath<T, CGColor?>
     ) {
-        ThemeManager.uiRegistry.setObject(
-            ThemeManager.get(for: view)?
-                .removing(allWith: keyPath),
-            forKey: view
-        )
+        ThemeManager.remove(view, info: [keyPath])
     }
     
-    internal static func set<T: AnyObject>(
-        _ view: T,
-        to applier: ThemeApplier?
+    /// Store the `applyTheme` closure against the `info` for the view (replacing any existing closure with the same `info`) and
+    /// immediately apply the current theme
+    internal static func set(
+        _ view: AnyObject,
+        info: [AnyHashable],
+        applyTheme: @escaping (Theme) -> ()
     ) {
-        ThemeManager.uiRegistry.setObject(applier, forKey: view)
+        ThemeManager.applier(for: view).set(info, applyTheme: applyTheme)
+    }
+    
+    internal static func remove(_ view: AnyObject, info: [AnyHashable]) {
+        guard let applier: ThemeApplier = ThemeManager.existingApplier(for: view) else { return }
+        
+        applier.remove(info)
+        removeIfEmpty(view, applier: applier)
+    }
+    
+    /// Remove any closures where the `info` contains the provided value (eg. the title color for all control states)
+    internal static func remove(_ view: AnyObject, allWith info: AnyHashable) {
+        guard let applier: ThemeApplier = ThemeManager.existingApplier(for: view) else { return }
+        
+        applier.removeAll(with: info)
+        removeIfEmpty(view, applier: applier)
     }
     
     /// Using a `UIColor(dynamicProvider:)` unfortunately doesn't seem to work properly for some controls (eg. UISwitch) so
@@ -374,92 +373,77 @@ public enum ThemeManager {
         return color?.resolvedColor(with: UITraitCollection())
     }
     
-    internal static func get(for view: AnyObject) -> ThemeApplier? {
-        return ThemeManager.uiRegistry.object(forKey: view)
-    }
-}
-
-// MARK: - ThemeApplier
-
-internal class ThemeApplier {
-    enum InfoKey: String {
-        case keyPath
-        case controlState
-    }
+    // MARK: - Registry
     
-    private let applyTheme: (Theme) -> ()
-    private let info: [AnyHashable]
-    private var otherAppliers: [ThemeApplier]?
+    internal struct RegistryEntry {
+        weak var owner: AnyObject?
+        let applier: ThemeApplier
+    }
     
-    init(
-        existingApplier: ThemeApplier?,
-        info: [AnyHashable],
-        applyTheme: @escaping (Theme) -> ()
-    ) {
-        self.applyTheme = applyTheme
-        self.info = info
-        
-        // Store any existing "appliers" (removing their 'otherApplier' references to prevent
-        // loops and excluding any which match the current "info" as they should be replaced
-        // by this applier)
-        self.otherAppliers = [existingApplier]
-            .appending(contentsOf: existingApplier?.otherAppliers)
-            .compactMap { $0?.clearingOtherAppliers() }
-            .filter { $0.info != info }
+    internal static func existingApplier(for view: AnyObject) -> ThemeApplier? {
+        guard
+            let entry: RegistryEntry = ThemeManager.uiRegistry[ObjectIdentifier(view)],
+            entry.owner === view
+        else { return nil }
         
-        // Automatically apply the theme immediately
-        self.apply(theme: ThemeManager.currentTheme, isInitialApplication: true)
+        return entry.applier
     }
     
-    // MARK: - Functions
-    
-    public func removing(allWith info: AnyHashable) -> ThemeApplier? {
-        let remainingAppliers: [ThemeApplier] = [self]
-            .appending(contentsOf: self.otherAppliers)
-            .filter { applier in !applier.info.contains(info) }
-        
-        guard !remainingAppliers.isEmpty else { return nil }
-        guard remainingAppliers.count != ((self.otherAppliers ?? []).count + 1) else { return self }
+    private static func applier(for view: AnyObject) -> ThemeApplier {
+        if let existingApplier: ThemeApplier = ThemeManager.existingApplier(for: view) {
+            return existingApplier
+        }
         
-        // Remove the 'otherAppliers' references on self
-        self.otherAppliers = nil
+        let applier: ThemeApplier = ThemeApplier()
+        ThemeManager.uiRegistry[ObjectIdentifier(view)] = RegistryEntry(owner: view, applier: applier)
+        ThemeManager.registrationsSinceSweep += 1
         
-        // Attach the 'otherAppliers' to the new first remaining applier (just in case self
-        // was removed)
-        let firstApplier: ThemeApplier? = remainingAppliers.first
-        firstApplier?.otherAppliers = Array(remainingAppliers.suffix(from: 1))
+        if ThemeManager.registrationsSinceSweep >= ThemeManager.sweepInterval {
+            sweepRegistry()
+        }
         
-        return firstApplier
+        return applier
     }
     
-    private func clearingOtherAppliers() -> ThemeApplier {
-        self.otherAppliers = nil
+    private static func removeIfEmpty(_ view: AnyObject, applier: ThemeApplier) {
+        guard applier.isEmpty else { return }
         
-        return self
+        ThemeManager.uiRegistry.removeValue(forKey: ObjectIdentifier(view))
     }
     
-    fileprivate func apply(theme: Theme, isInitialApplication: Bool = false) {
-        self.applyTheme(theme)
-        
-        // For the initial application of a ThemeApplier we don't want to apply the other
-        // appliers (they should have already been applied so doing so is redundant
-        guard !isInitialApplication else { return }
-        
-        // If there are otherAppliers stored against this one then trigger those as well
-        self.otherAppliers?.forEach { applier in
-            applier.applyTheme(theme)
-        }
+    internal static func sweepRegistry() {
+        ThemeManager.uiRegistry = ThemeManager.uiRegistry.filter { _, entry in entry.owner != nil }
+        ThemeManager.registrationsSinceSweep = 0
     }
 }
 
-// MARK: - Convenience Extensions
+// MARK: - ThemeApplier
 
-extension Array {
-    fileprivate func appending(contentsOf other: [Element]?) -> [Element] {
-        guard let other: [Element] = other else { return self }
+/// The `ThemeApplier` stores the closures which update each of the themed properties on a single object, keyed by the
+/// property (and any additional info, eg. the control state) so that re-theming a property replaces the existing closure
+internal class ThemeApplier {
+    private var slots: [[AnyHashable]: (Theme) -> ()] = [:]
+    
+    var isEmpty: Bool { slots.isEmpty }
+    
+    // MARK: - Functions
+    
+    func set(_ info: [AnyHashable], applyTheme: @escaping (Theme) -> ()) {
+        slots[info] = applyTheme
         
-        var updatedArray: [Element] = self
-        updatedArray.append(contentsOf: other)
-        return updatedArray
+        // Automatically apply the theme immediately
+        applyTheme(ThemeManager.currentTheme)
+    }
+    
+    func remove(_ info: [AnyHashable]) {
+        slots.removeValue(forKey: info)
+    }
+    
+    func removeAll(with info: AnyHashable) {
+        slots = slots.filter { slotInfo, _ in !slotInfo.contains(info) }
+    }
+    
+    func apply(theme: Theme) {
+        slots.values.forEach { applyTheme in applyTheme(theme) }
     }
 }
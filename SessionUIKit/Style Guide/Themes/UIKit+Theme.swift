@@ -259,37 +259,24 @@ public extension UIButton {
     func setThemeBackgroundColor(_ value: ThemeValue?, for state: UIControl.State) {
         let keyPath: KeyPath<UIButton, UIImage?> = \.imageView?.image
         
-        ThemeManager.set(
-            self,
-            to: ThemeApplier(
-                existingApplier: ThemeManager.get(for: self),
-                info: [
-                    keyPath,
-                    state.rawValue
-                ]
-            ) { [weak self] theme in
-                guard
-                    let value: ThemeValue = value,
-                    let color: UIColor = ThemeManager.resolvedColor(theme.color(for: value))
-                else {
-                    self?.setBackgroundImage(nil, for: state)
-                    return
-                }
-                
-                self?.setBackgroundImage(color.toImage(), for: state)
+        ThemeManager.set(self, info: [keyPath, state.rawValue]) { [weak self] theme in
+            guard
+                let value: ThemeValue = value,
+                let color: UIColor = ThemeManager.resolvedColor(theme.color(for: value))
+            else {
+                self?.setBackgroundImage(nil, for: state)
+                return
             }
-        )
+            
+            self?.setBackgroundImage(color.toImage(), for: state)
+        }
     }
     
     func setThemeBackgroundColorForced(_ newValue: ForcedThemeValue?, for state: UIControl.State) {
         let keyPath: KeyPath<UIButton, UIImage?> = \.imageView?.image
         
         // First we should clear out any dynamic setting
-        ThemeManager.set(
-            self,
-            to: ThemeManager.get(for: self)?
-                .removing(allWith: keyPath)
-        )
+        ThemeManager.remove(self, allWith: keyPath)
         
         switch newValue {
             case .color(let color): self.setBackgroundImage(color.toImage(), for: state)
@@ -316,37 +303,24 @@ public extension UIButton {
     func setThemeTitleColor(_ value: ThemeValue?, for state: UIControl.State) {
         let keyPath: KeyPath<UIButton, UIColor?> = \.titleLabel?.textColor
         
-        ThemeManager.set(
-            self,
-            to: ThemeApplier(
-                existingApplier: ThemeManager.get(for: self),
-                info: [
-                    keyPath,
-                    state.rawValue
-                ]
-            ) { [weak self] theme in
-                guard let value: ThemeValue = value else {
-                    self?.setTitleColor(nil, for: state)
-                    return
-                }
-                
-                self?.setTitleColor(
-                    ThemeManager.resolvedColor(theme.color(for: value)),
-                    for: state
-                )
+        ThemeManager.set(self, info: [keyPath, state.rawValue]) { [weak self] theme in
+            guard let value: ThemeValue = value else {
+                self?.setTitleColor(nil, for: state)
+                return
             }
-        )
+            
+            self?.setTitleColor(
+                ThemeManager.resolvedColor(theme.color(for: value)),
+                for: state
+            )
+        }
     }
     
     func setThemeTitleColorForced(_ newValue: ForcedThemeValue?, for state: UIControl.State) {
         let keyPath: KeyPath<UIButton, UIColor?> = \.titleLabel?.textColor
         
         // First we should clear out any dynamic setting
-        ThemeManager.set(
-            self,
-            to: ThemeManager.get(for: self)?
-                .removing(allWith: keyPath)
-        )
+        ThemeManager.remove(self, allWith: keyPath)
         
         switch newValue {
             case .color(let color): self.setTitleColor(color, for: state)
@@ -460,28 +434,22 @@ public extension GradientView {
             // First we should clear out any dynamic setting
             ThemeManager.remove(self, keyPath: \.backgroundColor)
             
-            ThemeManager.set(
-                self,
-                to: ThemeApplier(
-                    existingApplier: ThemeManager.get(for: self),
-                    info: [keyPath]
-                ) { [weak self] theme in
-                    // First we should remove any gradient that had been added
-                    self?.layer.sublayers?.first(where: { $0 is CAGradientLayer })?.removeFromSuperlayer()
-                    
-                    let maybeColors: [CGColor]? = newValue?.compactMap { theme.color(for: $0)?.cgColor }
-                    
-                    guard let colors: [CGColor] = maybeColors, colors.count == newValue?.count else {
-                        self?.backgroundColor = nil
-                        return
-                    }
-                    
-                    let layer: CAGradientLayer = CAGradientLayer()
-                    layer.frame = (self?.bounds ?? .zero)
-                    layer.colors = colors
-                    self?.layer.insertSublayer(layer, at: 0)
+            ThemeManager.set(self, info: [keyPath]) { [weak self] theme in
+                // First we should remove any gradient that had been added
+                self?.layer.sublayers?.first(where: { $0 is CAGradientLayer })?.removeFromSuperlayer()
+                
+                let maybeColors: [CGColor]? = newValue?.compactMap { theme.color(for: $0)?.cgColor }
+                
+                guard let colors: [CGColor] = maybeColors, colors.count == newValue?.count else {
+                    self?.backgroundColor = nil
+                    return
                 }
-            )
+                
+                let layer: CAGradientLayer = CAGradientLayer()
+                layer.frame = (self?.bounds ?? .zero)
+                layer.colors = colors
+                self?.layer.insertSublayer(layer, at: 0)
+            }
         }
         get { return nil }
     }
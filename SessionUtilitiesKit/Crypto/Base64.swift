@@ -0,0 +1,175 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+
+/// Standard (padded) base64 encoding and decoding which works directly on UTF-8 bytes using lookup tables, like `Hex` the core
+/// functions write into caller-provided buffers and validate the input in the same pass
+///
+/// **Note:** Decoding matches the default behaviour of `Data(base64Encoded:)` (ie. the input must be padded to a multiple of
+/// four characters and whitespace or other unknown characters result in a failure)
+public enum Base64 {
+    private static let invalidValue: UInt8 = 0xFF
+    private static let padding: UInt8 = UInt8(ascii: "=")
+    private static let encodingTable: [UInt8] = Array("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/".utf8)
+    private static let decodingTable: [UInt8] = {
+        var result: [UInt8] = [UInt8](repeating: invalidValue, count: 256)
+        encodingTable.enumerated().forEach { index, character in result[Int(character)] = UInt8(index) }
+        
+        return result
+    }()
+    
+    public static func encodedLength(for byteCount: Int) -> Int {
+        return (((byteCount + 2) / 3) * 4)
+    }
+    
+    /// The number of bytes the `characters` will decode to, or `nil` if the characters aren't correctly padded
+    public static func decodedLength(for characters: UnsafeRawBufferPointer) -> Int? {
+        guard characters.count % 4 == 0 else { return nil }
+        guard !characters.isEmpty else { return 0 }
+        
+        let paddingCount: Int = (
+            (characters[characters.count - 1] == padding ? 1 : 0) +
+            (characters[characters.count - 2] == padding ? 1 : 0)
+        )
+        
+        return (((characters.count / 4) * 3) - paddingCount)
+    }
+    
+    // MARK: - Encoding
+    
+    /// Encode `bytes` into `output`, returns `false` if `output` is smaller than `encodedLength(for: bytes.count)`
+    @discardableResult public static func encode(_ bytes: UnsafeRawBufferPointer, into output: UnsafeMutableRawBufferPointer) -> Bool {
+        guard output.count >= encodedLength(for: bytes.count) else { return false }
+        
+        encodingTable.withUnsafeBufferPointer { table in
+            let remainderCount: Int = (bytes.count % 3)
+            var inputIndex: Int = 0
+            var outputIndex: Int = 0
+            
+            while inputIndex < (bytes.count - remainderCount) {
+                let first: UInt8 = bytes[inputIndex]
+                let second: UInt8 = bytes[inputIndex + 1]
+                let third: UInt8 = bytes[inputIndex + 2]
+                
+                output[outputIndex] = table[Int(first >> 2)]
+                output[outputIndex + 1] = table[Int(((first & 0x03) << 4) | (second >> 4))]
+                output[outputIndex + 2] = table[Int(((second & 0x0F) << 2) | (third >> 6))]
+                output[outputIndex + 3] = table[Int(third & 0x3F)]
+                inputIndex += 3
+                outputIndex += 4
+            }
+            
+            switch remainderCount {
+                case 1:
+                    let first: UInt8 = bytes[inputIndex]
+                    
+                    output[outputIndex] = table[Int(first >> 2)]
+                    output[outputIndex + 1] = table[Int((first & 0x03) << 4)]
+                    output[outputIndex + 2] = padding
+                    output[outputIndex + 3] = padding
+                
+                case 2:
+                    let first: UInt8 = bytes[inputIndex]
+                    let second: UInt8 = bytes[inputIndex + 1]
+                    
+                    output[outputIndex] = table[Int(first >> 2)]
+                    output[outputIndex + 1] = table[Int(((first & 0x03) << 4) | (second >> 4))]
+                    output[outputIndex + 2] = table[Int((second & 0x0F) << 2)]
+                    output[outputIndex + 3] = padding
+                
+                default: break
+            }
+        }
+        
+        return true
+    }
+    
+    public static func encodedString<D: ContiguousBytes>(_ bytes: D) -> String {
+        return bytes.withUnsafeBytes { bytes in
+            let length: Int = encodedLength(for: bytes.count)
+            let characters: [UInt8] = Array(unsafeUninitializedCapacity: length) { buffer, initializedCount in
+                encode(bytes, into: UnsafeMutableRawBufferPointer(start: buffer.baseAddress, count: length))
+                initializedCount = length
+            }
+            
+            return String(decoding: characters, as: UTF8.self)
+        }
+    }
+    
+    // MARK: - Decoding
+    
+    /// Decode the base64 `characters` into `output` validating them in the same pass, returns `false` if any of the characters
+    /// are invalid or if `output` isn't exactly `decodedLength(for: characters)` bytes
+    ///
+    /// **Note:** The content of `output` is undefined when this returns `false`
+    public static func decode(_ characters: UnsafeRawBufferPointer, into output: UnsafeMutableRawBufferPointer) -> Bool {
+        guard let length: Int = decodedLength(for: characters), output.count == length else { return false }
+        guard !characters.isEmpty else { return true }
+        
+        return decodingTable.withUnsafeBufferPointer { table in
+            let paddingCount: Int = (((characters.count / 4) * 3) - length)
+            let fullQuadCount: Int = ((characters.count / 4) - (paddingCount > 0 ? 1 : 0))
+            var invalidBits: UInt8 = 0
+            var inputIndex: Int = 0
+            var outputIndex: Int = 0
+            
+            for _ in 0..<fullQuadCount {
+                let first: UInt8 = table[Int(characters[inputIndex])]
+                let second: UInt8 = table[Int(characters[inputIndex + 1])]
+                let third: UInt8 = table[Int(characters[inputIndex + 2])]
+                let fourth: UInt8 = table[Int(characters[inputIndex + 3])]
+                
+                // Valid values never have the upper bits set so collect them and check once at the end (avoids a branch
+                // per character)
+                invalidBits |= (first | second | third | fourth)
+                output[outputIndex] = ((first << 2) | (second >> 4))
+                output[outputIndex + 1] = ((second << 4) | (third >> 2))
+                output[outputIndex + 2] = ((third << 6) | fourth)
+                inputIndex += 4
+                outputIndex += 3
+            }
+            
+            if paddingCount > 0 {
+                let first: UInt8 = table[Int(characters[inputIndex])]
+                let second: UInt8 = table[Int(characters[inputIndex + 1])]
+                
+                invalidBits |= (first | second)
+                output[outputIndex] = ((first << 2) | (second >> 4))
+                
+                if paddingCount == 1 {
+                    let third: UInt8 = table[Int(characters[inputIndex + 2])]
+                    
+                    invalidBits |= third
+                    output[outputIndex + 1] = ((second << 4) | (third >> 2))
+                }
+            }
+            
+            return ((invalidBits & 0xC0) == 0)
+        }
+    }
+    
+    public static func decodedBytes<S: StringProtocol>(_ string: S) -> [UInt8]? {
+        return Hex.withUTF8Bytes(of: string.utf8) { characters in
+            guard let length: Int = decodedLength(for: characters) else { return nil }
+            
+            var isValid: Bool = false
+            let result: [UInt8] = Array(unsafeUninitializedCapacity: length) { buffer, initializedCount in
+                isValid = decode(characters, into: UnsafeMutableRawBufferPointer(start: buffer.baseAddress, count: length))
+                initializedCount = length
+            }
+            
+            return (isValid ? result : nil)
+        }
+    }
+    
+    public static func decodedData<S: StringProtocol>(_ string: S) -> Data? {
+        return Hex.withUTF8Bytes(of: string.utf8) { characters in
+            guard let length: Int = decodedLength(for: characters) else { return nil }
+            
+            var result: Data = Data(count: length)
+            let isValid: Bool = result.withUnsafeMutableBytes { decode(characters, into: $0) }
+            
+            return (isValid ? result : nil)
+        }
+    }
+}
@@ -1,8 +1,121 @@
 
+import Foundation
+
+/// Hex encoding and decoding which works directly on UTF-8 bytes using lookup tables (rather than going through `String`
+/// operations for each character), the core functions write into caller-provided buffers and validate the input in the same pass so
+/// fixed-size values (eg. keys) can be decoded without any intermediate allocations
+///
+/// **Note:** Encoding always produces lowercase hex, decoding accepts both lowercase and uppercase characters
 public enum Hex {
+    private static let invalidNibble: UInt8 = 0xFF
+    private static let encodingTable: [UInt8] = Array("0123456789abcdef".utf8)
+    private static let decodingTable: [UInt8] = (0...UInt8.max).map { character in
+        switch character {
+            case UInt8(ascii: "0")...UInt8(ascii: "9"): return (character - UInt8(ascii: "0"))
+            case UInt8(ascii: "a")...UInt8(ascii: "f"): return (character - UInt8(ascii: "a") + 10)
+            case UInt8(ascii: "A")...UInt8(ascii: "F"): return (character - UInt8(ascii: "A") + 10)
+            default: return invalidNibble
+        }
+    }
     
     public static func isValid(_ string: String) -> Bool {
-        let allowedCharacters = CharacterSet(charactersIn: "0123456789ABCDEF")
-        return string.uppercased().unicodeScalars.allSatisfy { allowedCharacters.contains($0) }
+        return decodingTable.withUnsafeBufferPointer { table in
+            string.utf8.allSatisfy { table[Int($0)] != invalidNibble }
+        }
+    }
+    
+    // MARK: - Encoding
+    
+    /// Encode `bytes` into `output`, returns `false` if `output` is smaller than `bytes.count * 2`
+    @discardableResult public static func encode(_ bytes: UnsafeRawBufferPointer, into output: UnsafeMutableRawBufferPointer) -> Bool {
+        guard output.count >= (bytes.count * 2) else { return false }
+        
+        encodingTable.withUnsafeBufferPointer { table in
+            var outputIndex: Int = 0
+            
+            for byte in bytes {
+                output[outputIndex] = table[Int(byte >> 4)]
+                output[outputIndex + 1] = table[Int(byte & 0x0F)]
+                outputIndex += 2
+            }
+        }
+        
+        return true
+    }
+    
+    public static func encodedString<D: ContiguousBytes>(_ bytes: D) -> String {
+        return bytes.withUnsafeBytes { bytes in
+            let characters: [UInt8] = Array(unsafeUninitializedCapacity: (bytes.count * 2)) { buffer, initializedCount in
+                encode(bytes, into: UnsafeMutableRawBufferPointer(start: buffer.baseAddress, count: (bytes.count * 2)))
+                initializedCount = (bytes.count * 2)
+            }
+            
+            return String(decoding: characters, as: UTF8.self)
+        }
+    }
+    
+    // MARK: - Decoding
+    
+    /// Decode the hex `characters` into `output` validating them in the same pass, returns `false` if any of the characters are
+    /// invalid or if `output` isn't exactly half the size of `characters`
+    ///
+    /// **Note:** The content of `output` is undefined when this returns `false`
+    public static func decode(_ characters: UnsafeRawBufferPointer, into output: UnsafeMutableRawBufferPointer) -> Bool {
+        guard characters.count % 2 == 0 && output.count == (characters.count / 2) else { return false }
+        
+        return decodingTable.withUnsafeBufferPointer { table in
+            var invalidBits: UInt8 = 0
+            
+            for outputIndex in 0..<output.count {
+                let high: UInt8 = table[Int(characters[outputIndex * 2])]
+                let low: UInt8 = table[Int(characters[(outputIndex * 2) + 1])]
+                
+                // Valid nibbles never have the upper bits set so collect them and check once at the end (avoids a branch
+                // per character)
+                invalidBits |= (high | low)
+                output[outputIndex] = ((high << 4) | (low & 0x0F))
+            }
+            
+            return ((invalidBits & 0xF0) == 0)
+        }
+    }
+    
+    /// Decode the hex `string` directly from it's UTF-8 storage into `output` (eg. to decode a key of a known size without
+    /// allocating), see `decode(_:into:)` for more information
+    public static func decode<S: StringProtocol>(_ string: S, into output: UnsafeMutableRawBufferPointer) -> Bool {
+        return withUTF8Bytes(of: string.utf8) { decode($0, into: output) }
+    }
+    
+    public static func decodedBytes<S: StringProtocol>(_ string: S) -> [UInt8]? {
+        return decodedBytes(string.utf8)
+    }
+    
+    public static func decodedBytes<C: Collection>(_ characters: C) -> [UInt8]? where C.Element == UInt8 {
+        return withUTF8Bytes(of: characters) { characters in
+            guard characters.count % 2 == 0 else { return nil }
+            
+            let byteCount: Int = (characters.count / 2)
+            var isValid: Bool = false
+            let result: [UInt8] = Array(unsafeUninitializedCapacity: byteCount) { buffer, initializedCount in
+                isValid = decode(characters, into: UnsafeMutableRawBufferPointer(start: buffer.baseAddress, count: byteCount))
+                initializedCount = byteCount
+            }
+            
+            return (isValid ? result : nil)
+        }
+    }
+    
+    // MARK: - Internal Functions
+    
+    /// Native strings (and arrays) are already stored contiguously so this only needs to copy the characters for bridged strings
+    internal static func withUTF8Bytes<C: Collection, R>(
+        of characters: C,
+        _ body: (UnsafeRawBufferPointer) -> R
+    ) -> R where C.Element == UInt8 {
+        if let result: R = characters.withContiguousStorageIfAvailable({ body(UnsafeRawBufferPointer($0)) }) {
+            return result
+        }
+        
+        return Array(characters).withUnsafeBytes { body($0) }
     }
 }
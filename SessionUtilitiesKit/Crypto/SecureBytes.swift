@@ -0,0 +1,42 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import Clibsodium
+
+/// A fixed-size buffer for holding secret values in memory
+///
+/// The buffer is allocated using `sodium_malloc` so it is page-locked (ie. it won't be swapped to disk) and surrounded by guard
+/// pages, the content is only readable from within `withUnsafeBytes` and is zeroed when the buffer is deallocated
+///
+/// **Note:** Creating a `SecureBytes` copies the provided value, the caller is responsible for zeroing the source if needed
+public final class SecureBytes {
+    public let count: Int
+    private let pointer: UnsafeMutableRawPointer
+    
+    // MARK: - Initialization
+    
+    public init?<C: Collection>(copying bytes: C) where C.Element == UInt8 {
+        guard sodium_init() >= 0, !bytes.isEmpty, let pointer: UnsafeMutableRawPointer = sodium_malloc(bytes.count) else {
+            return nil
+        }
+        
+        self.count = bytes.count
+        self.pointer = pointer
+        
+        let buffer: UnsafeMutableRawBufferPointer = UnsafeMutableRawBufferPointer(start: pointer, count: bytes.count)
+        _ = buffer.copyBytes(from: bytes)
+        sodium_mprotect_readonly(pointer)
+    }
+    
+    deinit {
+        // Note: 'sodium_free' zeroes the memory before releasing it
+        sodium_free(pointer)
+    }
+    
+    // MARK: - Functions
+    
+    /// Provides access to the secret value without copying it, the pointer must not escape the closure
+    public func withUnsafeBytes<R>(_ body: (UnsafeRawBufferPointer) throws -> R) rethrows -> R {
+        return try body(UnsafeRawBufferPointer(start: pointer, count: count))
+    }
+}
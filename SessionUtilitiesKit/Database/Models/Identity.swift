@@ -85,47 +85,93 @@ public extension Identity {
     
     static func fetchUserPublicKey(_ db: Database? = nil) -> Data? {
         guard let db: Database = db else {
+            if let cachedKeys: IdentityKeyCache.Keys = IdentityKeyCache.shared.cachedKeys {
+                return cachedKeys.x25519PublicKey.map { Data($0) }
+            }
+            
             return Storage.shared.read { db in fetchUserPublicKey(db) }
         }
         
-        return try? Identity.fetchOne(db, id: .x25519PublicKey)?.data
+        return IdentityKeyCache.shared.keys(db).x25519PublicKey.map { Data($0) }
     }
     
     static func fetchUserPrivateKey(_ db: Database? = nil) -> Data? {
         guard let db: Database = db else {
+            if let cachedKeys: IdentityKeyCache.Keys = IdentityKeyCache.shared.cachedKeys {
+                return cachedKeys.x25519SecretKey?.withUnsafeBytes { Data($0) }
+            }
+            
             return Storage.shared.read { db in fetchUserPrivateKey(db) }
         }
         
-        return try? Identity.fetchOne(db, id: .x25519PrivateKey)?.data
+        return IdentityKeyCache.shared.keys(db).x25519SecretKey?.withUnsafeBytes { Data($0) }
     }
     
     static func fetchUserKeyPair(_ db: Database? = nil) -> Box.KeyPair? {
         guard let db: Database = db else {
+            if let cachedKeys: IdentityKeyCache.Keys = IdentityKeyCache.shared.cachedKeys {
+                return keyPair(publicKey: cachedKeys.x25519PublicKey, secretKey: cachedKeys.x25519SecretKey)
+            }
+            
             return Storage.shared.read { db in fetchUserKeyPair(db) }
         }
-        guard
-            let publicKey: Data = fetchUserPublicKey(db),
-            let privateKey: Data = fetchUserPrivateKey(db)
-        else { return nil }
         
-        return Box.KeyPair(
-            publicKey: publicKey.bytes,
-            secretKey: privateKey.bytes
-        )
+        let keys: IdentityKeyCache.Keys = IdentityKeyCache.shared.keys(db)
+        
+        return keyPair(publicKey: keys.x25519PublicKey, secretKey: keys.x25519SecretKey)
     }
     
     static func fetchUserEd25519KeyPair(_ db: Database? = nil) -> Box.KeyPair? {
         guard let db: Database = db else {
+            if let cachedKeys: IdentityKeyCache.Keys = IdentityKeyCache.shared.cachedKeys {
+                return keyPair(publicKey: cachedKeys.ed25519PublicKey, secretKey: cachedKeys.ed25519SecretKey)
+            }
+            
             return Storage.shared.read { db in fetchUserEd25519KeyPair(db) }
         }
-        guard
-            let publicKey: Data = try? Identity.fetchOne(db, id: .ed25519PublicKey)?.data,
-            let secretKey: Data = try? Identity.fetchOne(db, id: .ed25519SecretKey)?.data
-        else { return nil }
+        
+        let keys: IdentityKeyCache.Keys = IdentityKeyCache.shared.keys(db)
+        
+        return keyPair(publicKey: keys.ed25519PublicKey, secretKey: keys.ed25519SecretKey)
+    }
+    
+    static func fetchUserEd25519PublicKey(_ db: Database? = nil) -> Bytes? {
+        return keys(db)?.ed25519PublicKey
+    }
+    
+    /// Provides access to the users x25519 secret key without copying it out of the `IdentityKeyCache`, the pointer must not
+    /// escape the closure
+    static func withUserX25519SecretKey<R>(
+        _ db: Database? = nil,
+        _ body: (UnsafeRawBufferPointer) throws -> R
+    ) rethrows -> R? {
+        return try keys(db)?.x25519SecretKey?.withUnsafeBytes(body)
+    }
+    
+    /// Provides access to the users ed25519 secret key without copying it out of the `IdentityKeyCache`, the pointer must not
+    /// escape the closure
+    static func withUserEd25519SecretKey<R>(
+        _ db: Database? = nil,
+        _ body: (UnsafeRawBufferPointer) throws -> R
+    ) rethrows -> R? {
+        return try keys(db)?.ed25519SecretKey?.withUnsafeBytes(body)
+    }
+    
+    private static func keys(_ db: Database?) -> IdentityKeyCache.Keys? {
+        return (
+            db.map { IdentityKeyCache.shared.keys($0) } ??
+            IdentityKeyCache.shared.cachedKeys ??
+            Storage.shared.read { db in IdentityKeyCache.shared.keys(db) }
+        )
+    }
+    
+    /// **Note:** `Box.KeyPair` stores the secret key as `[UInt8]` so this needs to copy it out of the `SecureBytes`
+    private static func keyPair(publicKey: Bytes?, secretKey: SecureBytes?) -> Box.KeyPair? {
+        guard let publicKey: Bytes = publicKey, let secretKey: SecureBytes = secretKey else { return nil }
         
         return Box.KeyPair(
-            publicKey: publicKey.bytes,
-            secretKey: secretKey.bytes
+            publicKey: publicKey,
+            secretKey: secretKey.withUnsafeBytes { Array($0) }
         )
     }
     
@@ -106,6 +106,10 @@ public struct Job: Codable, Equatable, Hashable, Identifiable, FetchableRecord,
         /// This is a job that runs once whenever the user leaves a group to send a group leaving message, remove group
         /// record and group member record
         case groupLeaving
+        
+        /// This is a job that runs once whenever interactions are inserted with deferred search indexing enabled to add
+        /// them to the search index in batches
+        case searchIndexing
     }
     
     public enum Behaviour: Int, Codable, DatabaseValueConvertible, CaseIterable {
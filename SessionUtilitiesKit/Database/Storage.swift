@@ -10,7 +10,8 @@ open class Storage {
     private static let dbFileName: String = "Session.sqlite"
     private static let keychainService: String = "TSKeyChainService"
     private static let dbCipherKeySpecKey: String = "GRDBDatabaseCipherKeySpec"
-    private static let kSQLCipherKeySpecLength: Int32 = 48
+    internal static let kSQLCipherKeySpecLength: Int32 = 48
+    private static let maximumReaderCount: Int = 10
     
     private static var sharedDatabaseDirectoryPath: String { "\(OWSFileSystem.appSharedDataDirectoryPath())/database" }
     private static var databasePath: String { "\(Storage.sharedDatabaseDirectoryPath)/\(Storage.dbFileName)" }
@@ -24,6 +25,14 @@ open class Storage {
     }
     
     public static let shared: Storage = Storage()
+    
+    /// The number of reader connections which `prewarmConnections` opens by default
+    public static let defaultPrewarmReaderCount: Int = 3
+    
+    /// The longest time a prewarming read holds on to its connection waiting for the other prewarming reads to start, this only
+    /// needs to cover the other reads being dispatched so is kept short to avoid tying up the readers during launch
+    private static let prewarmReaderHoldTimeout: DispatchTimeInterval = .milliseconds(50)
+    
     public private(set) var isValid: Bool = false
     public private(set) var hasCompletedMigrations: Bool = false
     public static let defaultPublisherScheduler: ValueObservationScheduler = .async(onQueue: .main)
@@ -31,6 +40,12 @@ open class Storage {
     fileprivate var dbWriter: DatabaseWriter?
     private var migrator: DatabaseMigrator?
     private var migrationProgressUpdater: Atomic<((String, CGFloat) -> ())>?
+    private let hasCompletedFirstQuery: Atomic<Bool> = Atomic(false)
+    
+    /// The passphrase the database is encrypted with and the function used to store the key spec of an imported database (these
+    /// can be replaced for unit testing)
+    internal var databasePassphrase: () throws -> Data = { try Storage.rawKeySpecPassphrase() }
+    internal var storeDatabaseKeySpec: (Data) throws -> () = { keySpec in try Storage.setDatabaseCipherKeySpec(keySpec) }
     
     // MARK: - Initialization
     
@@ -43,10 +58,17 @@ open class Storage {
         OWSFileSystem.ensureDirectoryExists(Storage.sharedDatabaseDirectoryPath)
         OWSFileSystem.protectFileOrFolder(atPath: Storage.sharedDatabaseDirectoryPath)
         
+        // Any cached identity keys may belong to a different database
+        IdentityKeyCache.shared.invalidate()
+        
         // If a custom writer was provided then use that (for unit testing)
         guard customWriter == nil else {
             dbWriter = customWriter
             isValid = true
+            customWriter?.add(
+                transactionObserver: IdentityKeyCache.Observer(cache: .shared),
+                extent: .databaseLifetime
+            )
             perform(migrations: (customMigrations ?? []), async: false, onProgressUpdate: nil, onComplete: { _, _ in })
             return
         }
@@ -61,29 +83,13 @@ open class Storage {
         
         // Configure the database and create the DatabasePool for interacting with the database
         var config = Configuration()
-        config.maximumReaderCount = 10  // Increase the max read connection limit - Default is 5
+        config.maximumReaderCount = Storage.maximumReaderCount  // Increase the max read connection limit - Default is 5
         config.observesSuspensionNotifications = true // Minimise `0xDEAD10CC` exceptions
         config.prepareDatabase { db in
-            var keySpec: Data = Storage.getOrGenerateDatabaseKeySpec()
+            var keySpec: Data = try Storage.rawKeySpecPassphrase()
             defer { keySpec.resetBytes(in: 0..<keySpec.count) } // Reset content immediately after use
             
-            // Use a raw key spec, where the 96 hexadecimal digits are provided
-            // (i.e. 64 hex for the 256 bit key, followed by 32 hex for the 128 bit salt)
-            // using explicit BLOB syntax, e.g.:
-            //
-            // x'98483C6EB40B6C31A448C22A66DED3B5E5E8D5119CAC8327B655C8B5C483648101010101010101010101010101010101'
-            keySpec = try (keySpec.toHexString().data(using: .utf8) ?? { throw StorageError.invalidKeySpec }())
-            keySpec.insert(contentsOf: [120, 39], at: 0)    // "x'" prefix
-            keySpec.append(39)                              // "'" suffix
-            
-            try db.usePassphrase(keySpec)
-            
-            // According to the SQLCipher docs iOS needs the 'cipher_plaintext_header_size' value set to at least
-            // 32 as iOS extends special privileges to the database and needs this header to be in plaintext
-            // to determine the file type
-            //
-            // For more info see: https://www.zetetic.net/sqlcipher/sqlcipher-api/#cipher_plaintext_header_size
-            try db.execute(sql: "PRAGMA cipher_plaintext_header_size = 32")
+            try Storage.prepareEncryptedDatabase(db, passphrase: keySpec)
         }
         
         // Create the DatabasePool to allow us to connect to the database and mark the storage as valid
@@ -93,6 +99,11 @@ open class Storage {
                 configuration: config
             )
             isValid = true
+            dbWriter?.add(
+                transactionObserver: IdentityKeyCache.Observer(cache: .shared),
+                extent: .databaseLifetime
+            )
+            LaunchTiming.record(.storageCreated)
         }
         catch {}
     }
@@ -223,6 +234,45 @@ open class Storage {
     
     // MARK: - Security
     
+    /// Returns the database key spec formatted as a raw key passphrase
+    private static func rawKeySpecPassphrase() throws -> Data {
+        var keySpec: Data = Storage.getOrGenerateDatabaseKeySpec()
+        defer { keySpec.resetBytes(in: 0..<keySpec.count) } // Reset content immediately after use
+        
+        return try rawKeySpecPassphrase(for: keySpec)
+    }
+    
+    /// Returns the provided key spec formatted as a raw key passphrase
+    internal static func rawKeySpecPassphrase(for keySpec: Data) throws -> Data {
+        // Use a raw key spec, where the 96 hexadecimal digits are provided
+        // (i.e. 64 hex for the 256 bit key, followed by 32 hex for the 128 bit salt)
+        // using explicit BLOB syntax, e.g.:
+        //
+        // x'98483C6EB40B6C31A448C22A66DED3B5E5E8D5119CAC8327B655C8B5C483648101010101010101010101010101010101'
+        var passphrase: Data = try (keySpec.toHexString().data(using: .utf8) ?? { throw StorageError.invalidKeySpec }())
+        passphrase.insert(contentsOf: [120, 39], at: 0)     // "x'" prefix
+        passphrase.append(39)                               // "'" suffix
+        
+        return passphrase
+    }
+    
+    internal static func prepareEncryptedDatabase(_ db: Database, passphrase: Data) throws {
+        try db.usePassphrase(passphrase)
+        
+        // According to the SQLCipher docs iOS needs the 'cipher_plaintext_header_size' value set to at least
+        // 32 as iOS extends special privileges to the database and needs this header to be in plaintext
+        // to determine the file type
+        //
+        // For more info see: https://www.zetetic.net/sqlcipher/sqlcipher-api/#cipher_plaintext_header_size
+        try db.execute(sql: "PRAGMA cipher_plaintext_header_size = 32")
+    }
+    
+    private static func setDatabaseCipherKeySpec(_ keySpec: Data) throws {
+        guard keySpec.count == kSQLCipherKeySpecLength else { throw StorageError.invalidKeySpec }
+        
+        try SSKDefaultKeychainStorage.shared.set(data: keySpec, service: keychainService, key: dbCipherKeySpecKey)
+    }
+    
     private static func getDatabaseCipherKeySpec() throws -> Data {
         return try SSKDefaultKeychainStorage.shared.data(forService: keychainService, key: dbCipherKeySpecKey)
     }
@@ -292,6 +342,7 @@ open class Storage {
         Storage.shared.isValid = false
         Storage.shared.hasCompletedMigrations = false
         Storage.shared.dbWriter = nil
+        IdentityKeyCache.shared.invalidate()
         
         self.deleteDatabaseFiles()
         try? self.deleteDbKeys()
@@ -307,11 +358,158 @@ open class Storage {
         try SSKDefaultKeychainStorage.shared.remove(service: keychainService, key: dbCipherKeySpecKey)
     }
     
+    // MARK: - Export & Import
+    
+    /// The number of pages copied in each step of an export (at the default page size this is 1MB per step)
+    public static let exportPagesPerStep: Int32 = 256
+    
+    /// The amount of time the export waits between steps so it doesn't monopolise the disk while the writer is active
+    public static let exportStepInterval: TimeInterval = 0.002
+    
+    /// The maximum proportion of the time spent copying which the export can spend waiting between steps
+    public static let exportMaxYieldRatio: Double = 0.1
+    
+    /// Creates a consistent copy of the database at `path` which is encrypted with `passphrase` instead of the device-specific key
+    ///
+    /// **Note:** The copy is made using the SQLite online backup API from a read-only connection so, since the database is in WAL
+    /// mode, writes can continue while the export is in progress; SQLCipher can only copy pages between databases which share a
+    /// key so the copy is created with the current key and then re-keyed once the copy has completed
+    ///
+    /// The backup holds a single read transaction for the duration of the copy (releasing it between steps would cause the backup
+    /// to restart whenever the database is written to) and while it's open the WAL can't be checkpointed, in order to bound the WAL
+    /// growth the time spent yielding to the writer between steps is limited to `exportMaxYieldRatio` of the time spent copying
+    /// and a passive checkpoint is run once the copy completes so the WAL can be reused
+    public func exportDatabase(
+        to path: String,
+        passphrase: Data,
+        progress: ((_ completedPageCount: Int, _ totalPageCount: Int) -> ())? = nil
+    ) throws {
+        guard isValid, let dbWriter: DatabaseWriter = dbWriter else { throw StorageError.databaseInvalid }
+        
+        OWSFileSystem.deleteFileIfExists(path)
+        
+        let databasePassphrase: () throws -> Data = self.databasePassphrase
+        var config = Configuration()
+        config.prepareDatabase { db in
+            var keySpec: Data = try databasePassphrase()
+            defer { keySpec.resetBytes(in: 0..<keySpec.count) } // Reset content immediately after use
+            
+            try Storage.prepareEncryptedDatabase(db, passphrase: keySpec)
+        }
+        
+        do {
+            let destination: DatabaseQueue = try DatabaseQueue(path: path, configuration: config)
+            
+            let startTime: TimeInterval = Date().timeIntervalSince1970
+            var totalYieldDuration: TimeInterval = 0
+            
+            try dbWriter.backup(to: destination, pagesPerStep: Storage.exportPagesPerStep) { backupProgress in
+                progress?(backupProgress.completedPageCount, backupProgress.totalPageCount)
+                
+                guard !backupProgress.isCompleted else { return }
+                
+                let copyDuration: TimeInterval = ((Date().timeIntervalSince1970 - startTime) - totalYieldDuration)
+                
+                guard (totalYieldDuration + Storage.exportStepInterval) <= (copyDuration * Storage.exportMaxYieldRatio) else {
+                    return
+                }
+                
+                Thread.sleep(forTimeInterval: Storage.exportStepInterval)
+                totalYieldDuration += Storage.exportStepInterval
+            }
+            try destination.writeWithoutTransaction { db in try db.changePassphrase(passphrase) }
+            try destination.close()
+        }
+        catch {
+            OWSFileSystem.deleteFileIfExists(path)
+            throw error
+        }
+        
+        try? dbWriter.writeWithoutTransaction { db in _ = try db.checkpoint(.passive) }
+    }
+    
+    /// Replaces the current database with an exported copy, re-keying it to a newly generated device-specific key
+    ///
+    /// **Note:** The copy is re-keyed before anything else is changed, then the current database is closed and atomically replaced
+    /// by the copy and the new key is only stored once the replacement has succeeded (if storing the key fails the original
+    /// database is restored), this closes the current database so the app needs to be restarted once it completes and the copy
+    /// at `path` is consumed by this function
+    public func importDatabase(from path: String, passphrase: Data) throws {
+        guard FileManager.default.fileExists(atPath: path) else { throw StorageError.objectNotFound }
+        guard isValid, let dbWriter: DatabaseWriter = dbWriter else { throw StorageError.databaseInvalid }
+        
+        let databasePath: String = dbWriter.path
+        let databaseUrl: URL = URL(fileURLWithPath: databasePath)
+        
+        // Ensure the copy can be decrypted and re-key it to a new key which is only held in memory until the
+        // database has been replaced
+        var keySpec: Data = Randomness.generateRandomBytes(Storage.kSQLCipherKeySpecLength)
+        var keySpecPassphrase: Data = try Storage.rawKeySpecPassphrase(for: keySpec)
+        defer {
+            // Reset content immediately after use
+            keySpec.resetBytes(in: 0..<keySpec.count)
+            keySpecPassphrase.resetBytes(in: 0..<keySpecPassphrase.count)
+        }
+        
+        var config = Configuration()
+        config.prepareDatabase { db in try Storage.prepareEncryptedDatabase(db, passphrase: passphrase) }
+        
+        let importedDatabase: DatabaseQueue = try DatabaseQueue(path: path, configuration: config)
+        try importedDatabase.read { db in _ = try Int.fetchOne(db, sql: "SELECT COUNT(*) FROM sqlite_master") }
+        try importedDatabase.writeWithoutTransaction { db in try db.changePassphrase(keySpecPassphrase) }
+        try importedDatabase.close()
+        
+        // Close the current database (closing the last connection checkpoints the WAL so the '-wal' and '-shm' files
+        // can be removed, they would otherwise be applied to the imported database)
+        isValid = false
+        hasCompletedMigrations = false
+        
+        do { try dbWriter.close() }
+        catch {
+            isValid = true
+            throw error
+        }
+        
+        self.dbWriter = nil
+        IdentityKeyCache.shared.invalidate()
+        OWSFileSystem.deleteFileIfExists("\(databasePath)-wal")
+        OWSFileSystem.deleteFileIfExists("\(databasePath)-shm")
+        
+        // Atomically replace the database (keeping the original until the new key has been stored)
+        let backupItemName: String = "\(databaseUrl.lastPathComponent).backup"
+        let backupUrl: URL = databaseUrl.deletingLastPathComponent().appendingPathComponent(backupItemName)
+        
+        if FileManager.default.fileExists(atPath: databasePath) {
+            _ = try FileManager.default.replaceItemAt(
+                databaseUrl,
+                withItemAt: URL(fileURLWithPath: path),
+                backupItemName: backupItemName,
+                options: [.withoutDeletingBackupItem]
+            )
+        }
+        else {
+            try FileManager.default.moveItem(atPath: path, toPath: databasePath)
+        }
+        
+        do { try storeDatabaseKeySpec(keySpec) }
+        catch {
+            if FileManager.default.fileExists(atPath: backupUrl.path) {
+                _ = try? FileManager.default.replaceItemAt(databaseUrl, withItemAt: backupUrl)
+            }
+            throw error
+        }
+        
+        OWSFileSystem.deleteFileIfExists(backupUrl.path)
+        OWSFileSystem.protectFileOrFolder(atPath: databasePath)
+    }
+    
     // MARK: - Functions
     
     @discardableResult public final func write<T>(updates: (Database) throws -> T?) -> T? {
         guard isValid, let dbWriter: DatabaseWriter = dbWriter else { return nil }
         
+        defer { recordFirstQueryIfNeeded() }
+        
         return try? dbWriter.write(updates)
     }
     
@@ -333,9 +531,79 @@ open class Storage {
     @discardableResult public final func read<T>(_ value: (Database) throws -> T?) -> T? {
         guard isValid, let dbWriter: DatabaseWriter = dbWriter else { return nil }
         
+        defer { recordFirstQueryIfNeeded() }
+        
         return try? dbWriter.read(value)
     }
     
+    private func recordFirstQueryIfNeeded() {
+        let isFirstQuery: Bool = hasCompletedFirstQuery.mutate { hasCompletedFirstQuery -> Bool in
+            guard !hasCompletedFirstQuery else { return false }
+            
+            hasCompletedFirstQuery = true
+            return true
+        }
+        
+        guard isFirstQuery else { return }
+        
+        LaunchTiming.record(.firstQuery)
+    }
+    
+    // MARK: - Connection Prewarming
+    
+    /// Each connection needs to apply the SQLCipher key and configure itself when it is opened, since the `DatabasePool` opens
+    /// connections lazily this cost would otherwise be paid (in sequence) by whichever threads first query the database during
+    /// launch, this function opens the writer and `readerCount` reader connections in parallel on background threads instead
+    ///
+    /// **Note:** The `DatabasePool` only opens a new reader when all of the existing readers are busy so each read holds on to
+    /// its connection until all of the reads have started (or `prewarmReaderHoldTimeout` elapses)
+    public func prewarmConnections(readerCount: Int = Storage.defaultPrewarmReaderCount) {
+        guard isValid, let dbWriter: DatabaseWriter = dbWriter else { return }
+        
+        let startTime: Date = Date()
+        let queue: DispatchQueue = DispatchQueue(
+            label: "Storage.prewarmConnections",
+            qos: .userInitiated,
+            attributes: .concurrent
+        )
+        let prewarmGroup: DispatchGroup = DispatchGroup()
+        let readersStartedGroup: DispatchGroup = DispatchGroup()
+        let targetReaderCount: Int = max(0, min(readerCount, Storage.maximumReaderCount))
+        
+        prewarmGroup.enter()
+        queue.async {
+            // Note: The first statement on a connection is what triggers the key to be applied
+            try? dbWriter.writeWithoutTransaction { db in
+                _ = try Int.fetchOne(db, sql: "SELECT COUNT(*) FROM sqlite_master")
+            }
+            prewarmGroup.leave()
+        }
+        
+        (0..<targetReaderCount).forEach { _ in readersStartedGroup.enter() }
+        (0..<targetReaderCount).forEach { _ in
+            prewarmGroup.enter()
+            queue.async {
+                var hasStarted: Bool = false
+                
+                try? dbWriter.read { db in
+                    _ = try Int.fetchOne(db, sql: "SELECT COUNT(*) FROM sqlite_master")
+                    
+                    hasStarted = true
+                    readersStartedGroup.leave()
+                    _ = readersStartedGroup.wait(timeout: .now() + Storage.prewarmReaderHoldTimeout)
+                }
+                
+                if !hasStarted { readersStartedGroup.leave() }
+                prewarmGroup.leave()
+            }
+        }
+        
+        prewarmGroup.notify(queue: queue) {
+            SNLog("[Storage] Prewarmed writer and \(targetReaderCount) reader connection(s) in \(Int(Date().timeIntervalSince(startTime) * 1000))ms")
+            LaunchTiming.record(.connectionsPrewarmed)
+        }
+    }
+    
     /// Rever to the `ValueObservation.start` method for full documentation
     ///
     /// - parameter observation: The observation to start
@@ -0,0 +1,173 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import Sodium
+
+/// The user's identity keys are needed when sending, receiving and signing almost every message so rather than querying the
+/// `identity` table each time they are loaded once and kept in memory, the secret keys are stored in `SecureBytes` so they
+/// are page-locked and zeroed when the cache is invalidated
+///
+/// The cache is invalidated whenever the `identity` table changes (eg. when restoring or re-keying) as well as when all storage
+/// is reset, values are only cached once a complete set of keys exists (ie. after the user has registered)
+///
+/// **Note:** The cache is only populated from the writer connection, a reader connection's transaction may have started before
+/// an identity change was committed (and the cache invalidated) so the keys it loads could be stale by the time they get cached,
+/// while a transaction which modifies the `identity` table is in progress nothing will be cached either (the keys it loads may be
+/// rolled back)
+public final class IdentityKeyCache {
+    public static let shared: IdentityKeyCache = IdentityKeyCache()
+    
+    public struct Keys {
+        public let x25519PublicKey: Bytes?
+        public let x25519SecretKey: SecureBytes?
+        public let ed25519PublicKey: Bytes?
+        public let ed25519SecretKey: SecureBytes?
+        
+        var isComplete: Bool {
+            x25519PublicKey != nil &&
+            x25519SecretKey != nil &&
+            ed25519PublicKey != nil &&
+            ed25519SecretKey != nil
+        }
+    }
+    
+    private struct State {
+        /// This gets incremented whenever the cache is invalidated so a load which started before the invalidation doesn't
+        /// replace the cleared value
+        var generation: Int = 0
+        var isChanging: Bool = false
+        var keys: Keys?
+    }
+    
+    private let state: Atomic<State> = Atomic(State())
+    
+    /// The cached keys (if they have been loaded)
+    public var cachedKeys: Keys? { state.wrappedValue.keys }
+    
+    // MARK: - Initialization
+    
+    internal init() {}
+    
+    // MARK: - Functions
+    
+    /// Retrieve the keys, loading them if needed (they will only be cached if `db` is the writer connection)
+    public func keys(_ db: Database) -> Keys {
+        let currentState: State = state.wrappedValue
+        
+        if let keys: Keys = currentState.keys { return keys }
+        
+        let keys: Keys = IdentityKeyCache.fetchKeys(db)
+        
+        guard keys.isComplete && !currentState.isChanging && !db.configuration.readonly else { return keys }
+        
+        state.mutate { state in
+            guard state.generation == currentState.generation && !state.isChanging else { return }
+            
+            state.keys = keys
+        }
+        
+        return keys
+    }
+    
+    public func invalidate() {
+        state.mutate { state in
+            state.generation += 1
+            state.keys = nil
+        }
+    }
+    
+    // MARK: - Internal Functions
+    
+    fileprivate func identityWillChange() {
+        state.mutate { state in
+            state.generation += 1
+            state.isChanging = true
+            state.keys = nil
+        }
+    }
+    
+    fileprivate func identityChangeCompleted() {
+        state.mutate { state in
+            state.generation += 1
+            state.isChanging = false
+            state.keys = nil
+        }
+    }
+    
+    /// Fetch all of the keys in a single query, the secret keys are copied directly from the SQLite buffers into `SecureBytes`
+    /// to avoid leaving copies in transient `Data` values
+    private static func fetchKeys(_ db: Database) -> Keys {
+        var x25519PublicKey: Bytes?
+        var x25519SecretKey: SecureBytes?
+        var ed25519PublicKey: Bytes?
+        var ed25519SecretKey: SecureBytes?
+        
+        let maybeCursor: RowCursor? = try? Identity
+            .select(.variant, .data)
+            .filter(ids: [.x25519PublicKey, .x25519PrivateKey, .ed25519PublicKey, .ed25519SecretKey])
+            .asRequest(of: Row.self)
+            .fetchCursor(db)
+        
+        while let row: Row = try? maybeCursor?.next() {
+            guard
+                let variant: Identity.Variant = row[Identity.Columns.variant],
+                let data: Data = row.dataNoCopy(named: Identity.Columns.data.name)
+            else { continue }
+            
+            switch variant {
+                case .x25519PublicKey: x25519PublicKey = Array(data)
+                case .x25519PrivateKey: x25519SecretKey = SecureBytes(copying: data)
+                case .ed25519PublicKey: ed25519PublicKey = Array(data)
+                case .ed25519SecretKey: ed25519SecretKey = SecureBytes(copying: data)
+                case .seed: break
+            }
+        }
+        
+        return Keys(
+            x25519PublicKey: x25519PublicKey,
+            x25519SecretKey: x25519SecretKey,
+            ed25519PublicKey: ed25519PublicKey,
+            ed25519SecretKey: ed25519SecretKey
+        )
+    }
+}
+
+// MARK: - IdentityKeyCache.Observer
+
+internal extension IdentityKeyCache {
+    /// Invalidates the cache when the `identity` table is changed through the database it is attached to
+    final class Observer: TransactionObserver {
+        private let cache: IdentityKeyCache
+        private var hasChanges: Bool = false
+        
+        init(cache: IdentityKeyCache) {
+            self.cache = cache
+        }
+        
+        func observes(eventsOfKind eventKind: DatabaseEventKind) -> Bool {
+            return (eventKind.tableName == Identity.databaseTableName)
+        }
+        
+        func databaseDidChange(with event: DatabaseEvent) {
+            guard !hasChanges else { return }
+            
+            hasChanges = true
+            cache.identityWillChange()
+        }
+        
+        func databaseDidCommit(_ db: Database) {
+            guard hasChanges else { return }
+            
+            hasChanges = false
+            cache.identityChangeCompleted()
+        }
+        
+        func databaseDidRollback(_ db: Database) {
+            guard hasChanges else { return }
+            
+            hasChanges = false
+            cache.identityChangeCompleted()
+        }
+    }
+}
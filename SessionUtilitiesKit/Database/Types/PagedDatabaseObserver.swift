@@ -81,7 +81,9 @@ public class PagedDatabaseObserver<ObservedTable, T>: TransactionObserver where
             .reduce(into: [:]) { (prev: inout [String: Set<String>], next: PagedData.ObservedChanges) in
                 guard !next.columns.isEmpty else { return }
                 
-                prev[next.databaseTableName] = next.columns.asSet()
+                // Multiple observed changes can reference the same table (eg. an associated record observing a
+                // table the paged type also observes) so combine the columns
+                prev[next.databaseTableName] = (prev[next.databaseTableName] ?? []).union(next.columns)
             }
         self.observedDeletes = allObservedChanges
             .filter { $0.events.contains(.delete) }
@@ -1234,6 +1236,13 @@ public class AssociatedRecord<T, PagedType>: ErasedAssociatedRecord where T: Fet
     public let observedChanges: [PagedData.ObservedChanges]
     public let joinToPagedType: SQL
     
+    /// Whether cached rows which no longer match the `dataQuery` when they change should be removed
+    ///
+    /// **Note:** This should only be enabled when a changed row can stop being associated to the paged data (eg. a quote
+    /// which no longer references an interaction with an attachment), otherwise a changed row which doesn't match the query
+    /// will just be ignored
+    public let removesUnmatchedRows: Bool
+    
     fileprivate let dataCache: Atomic<DataCache<T>> = Atomic(DataCache())
     fileprivate let dataQuery: (SQL?) -> AdaptedFetchRequest<SQLRequest<T>>
     fileprivate let associateData: (DataCache<T>, DataCache<PagedType>) -> DataCache<PagedType>
@@ -1245,12 +1254,14 @@ public class AssociatedRecord<T, PagedType>: ErasedAssociatedRecord where T: Fet
         observedChanges: [PagedData.ObservedChanges],
         dataQuery: @escaping (SQL?) -> AdaptedFetchRequest<SQLRequest<T>>,
         joinToPagedType: SQL,
+        removesUnmatchedRows: Bool = false,
         associateData: @escaping (DataCache<T>, DataCache<PagedType>) -> DataCache<PagedType>
     ) {
         self.databaseTableName = trackedAgainst.databaseTableName
         self.observedChanges = observedChanges
         self.dataQuery = dataQuery
         self.joinToPagedType = joinToPagedType
+        self.removesUnmatchedRows = removesUnmatchedRows
         self.associateData = associateData
     }
     
@@ -1259,6 +1270,7 @@ public class AssociatedRecord<T, PagedType>: ErasedAssociatedRecord where T: Fet
         observedChanges: [PagedData.ObservedChanges],
         dataQuery: @escaping (SQL?) -> SQLRequest<T>,
         joinToPagedType: SQL,
+        removesUnmatchedRows: Bool = false,
         associateData: @escaping (DataCache<T>, DataCache<PagedType>) -> DataCache<PagedType>
     ) {
         self.init(
@@ -1268,6 +1280,7 @@ public class AssociatedRecord<T, PagedType>: ErasedAssociatedRecord where T: Fet
                 dataQuery(additionalFilters).adapted { _ in ScopeAdapter([:]) }
             },
             joinToPagedType: joinToPagedType,
+            removesUnmatchedRows: removesUnmatchedRows,
             associateData: associateData
         )
     }
@@ -1291,7 +1304,38 @@ public class AssociatedRecord<T, PagedType>: ErasedAssociatedRecord where T: Fet
         let relevantChanges: Set<PagedData.TrackedChange> = changes
             .filter { $0.tableName == databaseTableName }
         
-        guard !relevantChanges.isEmpty else { return false }
+        // Changes to other tables this type observes (eg. tables the associated data is built from) are mapped to the
+        // rows of this type through the paged type so they get re-fetched as well
+        let relatedRowIdsToQuery: [Int64] = observedChanges
+            .filter { $0.databaseTableName != databaseTableName }
+            .reduce(into: []) { result, observedChange in
+                let relatedRowIds: [Int64] = changes
+                    .filter { $0.tableName == observedChange.databaseTableName && $0.kind != .delete }
+                    .map { $0.rowId }
+                
+                guard
+                    !relatedRowIds.isEmpty,
+                    let relatedJoinToPagedType: SQL = observedChange.joinToPagedType
+                else { return }
+                
+                result.append(
+                    contentsOf: PagedData.associatedRowIds(
+                        db,
+                        tableName: databaseTableName,
+                        pagedTableName: pagedTableName,
+                        pagedTypeRowIds: PagedData.pagedRowIdsForRelatedRowIds(
+                            db,
+                            tableName: observedChange.databaseTableName,
+                            pagedTableName: pagedTableName,
+                            relatedRowIds: relatedRowIds,
+                            joinToPagedType: relatedJoinToPagedType
+                        ),
+                        joinToPagedType: joinToPagedType
+                    )
+                )
+            }
+        
+        guard !relevantChanges.isEmpty || !relatedRowIdsToQuery.isEmpty else { return false }
         
         // First remove any items which have been deleted
         let oldCount: Int = self.dataCache.wrappedValue.count
@@ -1309,7 +1353,13 @@ public class AssociatedRecord<T, PagedType>: ErasedAssociatedRecord where T: Fet
             .filter { $0.kind != .delete }
             .map { $0.rowId }
         
-        guard !rowIdsToQuery.isEmpty else { return (oldCount != countAfterDeletions) }
+        guard !rowIdsToQuery.isEmpty else {
+            return updateCache(
+                db,
+                rowIds: Array(relatedRowIdsToQuery.asSet()),
+                hasOtherChanges: (oldCount != countAfterDeletions)
+            )
+        }
         
         // Fetch the indexes of the rowIds so we can determine whether they should be added to the screen
         let pagedRowIds: [Int64] = PagedData.pagedRowIdsForRelatedRowIds(
@@ -1359,7 +1409,7 @@ public class AssociatedRecord<T, PagedType>: ErasedAssociatedRecord where T: Fet
         // Attempt to update the cache with the `validRowIds` array
         return updateCache(
             db,
-            rowIds: rowIdsToQuery,
+            rowIds: Array(rowIdsToQuery.appending(contentsOf: relatedRowIdsToQuery).asSet()),
             hasOtherChanges: (oldCount != countAfterDeletions)
         )
     }
@@ -1374,9 +1424,21 @@ public class AssociatedRecord<T, PagedType>: ErasedAssociatedRecord where T: Fet
             .fetchAll(db))
             .defaulting(to: [])
         
+        // Any cached rows which no longer match the query (eg. a quote which no longer references an interaction
+        // with an attachment) are no longer associated so need to be removed
+        let updatedRowIds: Set<Int64> = updatedItems.map { $0.rowId }.asSet()
+        let unmatchedRowIds: [Int64] = rowIds.filter { !updatedRowIds.contains($0) }
+        let oldCount: Int = dataCache.wrappedValue.count
+        
+        if removesUnmatchedRows && !unmatchedRowIds.isEmpty {
+            dataCache.mutate { $0 = $0.deleting(rowIds: unmatchedRowIds) }
+        }
+        
+        let hasDeletions: Bool = (dataCache.wrappedValue.count != oldCount)
+        
         // If the inserted/updated rows we irrelevant (eg. associated to another thread, a quote or a link
         // preview) then trigger the update callback (if there were deletions) and stop here
-        guard !updatedItems.isEmpty else { return hasOtherChanges }
+        guard !updatedItems.isEmpty else { return (hasOtherChanges || hasDeletions) }
         
         // Process the upserted data (assume at least one value changed)
         dataCache.mutate { $0 = $0.upserting(items: updatedItems) }
@@ -0,0 +1,389 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+import Sodium
+
+/// A `StorageArchive` is a directory containing an encrypted copy of the database (see `Storage.exportDatabase`) along with
+/// an encrypted copy of any additional directories (eg. attachments) and a manifest describing the content
+///
+/// Files are encrypted in fixed size chunks using XChaCha20-Poly1305 with a key derived from the archive passphrase (using
+/// Argon2), each chunk is authenticated against the path of the file, it's index and whether it's the final chunk so chunks can't
+/// be reordered, truncated or swapped between files
+///
+/// **Note:** Files are streamed in chunks rather than loaded into memory, and an import which is interrupted can be resumed
+/// by calling `importArchive` again as any files which were already fully imported will be skipped and partially imported files
+/// will be continued from the last complete chunk
+public enum StorageArchive {
+    public static let manifestFileName: String = "manifest.json"
+    public static let databaseFileName: String = "database.sqlite"
+    public static let filesDirectoryName: String = "files"
+    
+    private static let currentVersion: Int = 2
+    private static let chunkSize: Int = (1024 * 1024)
+    private static let partialFileExtension: String = "import-partial"
+    
+    public struct Manifest: Codable {
+        public struct FileInfo: Codable {
+            /// The name of the directory this file belongs to (eg. "Attachments")
+            public let directory: String
+            
+            /// The path of the file relative to it's directory
+            public let relativePath: String
+            
+            /// The size of the unencrypted file
+            public let size: UInt64
+        }
+        
+        public let version: Int
+        public let createdTimestampMs: Int64
+        public let databaseSize: UInt64
+        
+        /// The salt used to derive the key the files are encrypted with
+        public let fileKeySalt: Data
+        
+        /// The size of the unencrypted chunks the files were split into
+        public let chunkSize: Int
+        public let files: [FileInfo]
+    }
+    
+    public enum Progress {
+        case database(completedPageCount: Int, totalPageCount: Int)
+        case files(completedBytes: UInt64, totalBytes: UInt64)
+    }
+    
+    // MARK: - Export
+    
+    /// Export the database and the contents of the provided `directories` (a mapping of a name to the directory path) into an
+    /// archive at `path`
+    @discardableResult public static func export(
+        to path: String,
+        passphrase: Data,
+        directories: [String: String],
+        using storage: Storage = Storage.shared,
+        progress: ((Progress) -> ())? = nil
+    ) throws -> Manifest {
+        let sodium: Sodium = Sodium()
+        let filesPath: String = "\(path)/\(filesDirectoryName)"
+        let databasePath: String = "\(path)/\(databaseFileName)"
+        try FileManager.default.createDirectory(atPath: filesPath, withIntermediateDirectories: true)
+        
+        try storage.exportDatabase(to: databasePath, passphrase: passphrase) { completedPageCount, totalPageCount in
+            progress?(.database(completedPageCount: completedPageCount, totalPageCount: totalPageCount))
+        }
+        
+        // Stream the files into the archive
+        let fileKeySalt: Bytes = sodium.randomBytes.buf(length: sodium.pwHash.SaltBytes) ?? []
+        var fileKey: Bytes = try self.fileKey(for: passphrase, salt: fileKeySalt, using: sodium)
+        defer { sodium.utils.zero(&fileKey) }
+        
+        let files: [Manifest.FileInfo] = directories
+            .sorted(by: { lhs, rhs in lhs.key < rhs.key })
+            .flatMap { name, directoryPath in fileInfo(in: directoryPath, named: name) }
+        let totalBytes: UInt64 = files.reduce(0) { result, next in result + next.size }
+        var completedBytes: UInt64 = 0
+        
+        try files.forEach { file in
+            try encryptFile(
+                from: "\(directories[file.directory] ?? "")/\(file.relativePath)",
+                to: "\(filesPath)/\(file.directory)/\(file.relativePath)",
+                file: file,
+                key: fileKey,
+                using: sodium
+            ) { bytesEncrypted in
+                completedBytes += bytesEncrypted
+                progress?(.files(completedBytes: completedBytes, totalBytes: totalBytes))
+            }
+        }
+        
+        // Write the manifest last so an archive without one can be identified as incomplete
+        let manifest: Manifest = Manifest(
+            version: currentVersion,
+            createdTimestampMs: Int64(floor(Date().timeIntervalSince1970 * 1000)),
+            databaseSize: (OWSFileSystem.fileSize(ofPath: databasePath)?.uint64Value ?? 0),
+            fileKeySalt: Data(fileKeySalt),
+            chunkSize: chunkSize,
+            files: files
+        )
+        try JSONEncoder().encode(manifest).write(to: URL(fileURLWithPath: "\(path)/\(manifestFileName)"))
+        
+        return manifest
+    }
+    
+    // MARK: - Import
+    
+    /// Import an archive created by `export` decrypting the files into the provided `directories` (a mapping of a name to the
+    /// directory path) and then replacing the current database with the one from the archive
+    ///
+    /// **Note:** The manifest and passphrase are validated before anything is written and the database is imported last so if
+    /// this is interrupted it can be called again to resume the import, once it completes the app needs to be restarted (see
+    /// `Storage.importDatabase`)
+    public static func importArchive(
+        from path: String,
+        passphrase: Data,
+        directories: [String: String],
+        using storage: Storage = Storage.shared,
+        progress: ((Progress) -> ())? = nil
+    ) throws {
+        let sodium: Sodium = Sodium()
+        let manifestData: Data = try Data(contentsOf: URL(fileURLWithPath: "\(path)/\(manifestFileName)"))
+        let manifest: Manifest = try JSONDecoder().decode(Manifest.self, from: manifestData)
+        
+        guard
+            manifest.version == currentVersion,
+            manifest.chunkSize > 0,
+            manifest.fileKeySalt.count == sodium.pwHash.SaltBytes,
+            manifest.files.allSatisfy({ isValid($0) })
+        else { throw StorageError.decodingFailed }
+        
+        // Ensure the passphrase can decrypt the archive database before making any changes
+        var config = Configuration()
+        config.readonly = true
+        config.prepareDatabase { db in try Storage.prepareEncryptedDatabase(db, passphrase: passphrase) }
+        
+        let archiveDatabase: DatabaseQueue = try DatabaseQueue(path: "\(path)/\(databaseFileName)", configuration: config)
+        try archiveDatabase.read { db in _ = try Int.fetchOne(db, sql: "SELECT COUNT(*) FROM sqlite_master") }
+        try archiveDatabase.close()
+        
+        var fileKey: Bytes = try self.fileKey(for: passphrase, salt: Bytes(manifest.fileKeySalt), using: sodium)
+        defer { sodium.utils.zero(&fileKey) }
+        
+        let totalBytes: UInt64 = manifest.files.reduce(0) { result, next in result + next.size }
+        var completedBytes: UInt64 = 0
+        
+        try manifest.files.forEach { file in
+            guard let directoryPath: String = directories[file.directory] else {
+                completedBytes += file.size
+                return
+            }
+            
+            let destinationPath: String = "\(directoryPath)/\(file.relativePath)"
+            
+            try decryptFile(
+                from: "\(path)/\(filesDirectoryName)/\(file.directory)/\(file.relativePath)",
+                to: destinationPath,
+                file: file,
+                chunkSize: manifest.chunkSize,
+                key: fileKey,
+                using: sodium
+            ) { bytesDecrypted in
+                completedBytes += bytesDecrypted
+                progress?(.files(completedBytes: completedBytes, totalBytes: totalBytes))
+            }
+            OWSFileSystem.protectFileOrFolder(atPath: destinationPath)
+        }
+        
+        // Stage a fresh copy of the database alongside the archive (rather than consuming the archive itself) so the
+        // import can be retried if it fails (a staged copy left by a previous attempt may have already been re-keyed so
+        // it can't be reused)
+        let stagedDatabasePath: String = "\(path)/\(databaseFileName).import"
+        OWSFileSystem.deleteFileIfExists(stagedDatabasePath)
+        try FileManager.default.copyItem(atPath: "\(path)/\(databaseFileName)", toPath: stagedDatabasePath)
+        
+        try storage.importDatabase(from: stagedDatabasePath, passphrase: passphrase)
+    }
+    
+    // MARK: - Internal Functions
+    
+    private static func fileInfo(in directoryPath: String, named name: String) -> [Manifest.FileInfo] {
+        let directoryUrl: URL = URL(fileURLWithPath: directoryPath).standardizedFileURL
+        let enumerator: FileManager.DirectoryEnumerator? = FileManager.default.enumerator(
+            at: directoryUrl,
+            includingPropertiesForKeys: [.isRegularFileKey, .fileSizeKey]
+        )
+        
+        return (enumerator?.allObjects as? [URL] ?? [])
+            .compactMap { url -> Manifest.FileInfo? in
+                guard
+                    let values: URLResourceValues = try? url.resourceValues(forKeys: [.isRegularFileKey, .fileSizeKey]),
+                    values.isRegularFile == true
+                else { return nil }
+                
+                return Manifest.FileInfo(
+                    directory: name,
+                    relativePath: String(url.standardizedFileURL.path.dropFirst(directoryUrl.path.count + 1)),
+                    size: UInt64(values.fileSize ?? 0)
+                )
+            }
+            .sorted(by: { lhs, rhs in lhs.relativePath < rhs.relativePath })
+    }
+    
+    /// A file is only valid if it's directory is a single path component and it's relative path only contains plain path
+    /// components (so it can't be absolute or escape it's directory)
+    internal static func isValid(_ file: Manifest.FileInfo) -> Bool {
+        let isValidComponent: (Substring) -> Bool = { component in
+            !component.isEmpty &&
+            component != "." &&
+            component != ".." &&
+            !component.contains("\0") &&
+            !component.hasSuffix(".\(partialFileExtension)")
+        }
+        
+        return (
+            isValidComponent(Substring(file.directory)) &&
+            !file.directory.contains("/") &&
+            file.relativePath
+                .split(separator: "/", omittingEmptySubsequences: false)
+                .allSatisfy(isValidComponent)
+        )
+    }
+    
+    private static func fileKey(for passphrase: Data, salt: Bytes, using sodium: Sodium) throws -> Bytes {
+        guard
+            let key: Bytes = sodium.pwHash.hash(
+                outputLength: sodium.aead.xchacha20poly1305ietf.KeyBytes,
+                passwd: Bytes(passphrase),
+                salt: salt,
+                opsLimit: sodium.pwHash.OpsLimitInteractive,
+                memLimit: sodium.pwHash.MemLimitInteractive,
+                alg: .Argon2ID13
+            )
+        else { throw StorageError.invalidKeySpec }
+        
+        return key
+    }
+    
+    private static func additionalData(for file: Manifest.FileInfo, chunkIndex: UInt64, isFinal: Bool) -> Bytes {
+        return Bytes("\(file.directory)/\(file.relativePath):\(chunkIndex):\(isFinal ? 1 : 0)".utf8)
+    }
+    
+    /// Encrypt a file in chunks, each chunk is written as the nonce followed by the authenticated ciphertext (a file is always
+    /// written as at least one chunk so an empty file still has an authenticated final chunk)
+    private static func encryptFile(
+        from sourcePath: String,
+        to destinationPath: String,
+        file: Manifest.FileInfo,
+        key: Bytes,
+        using sodium: Sodium,
+        onChunkEncrypted: (UInt64) -> ()
+    ) throws {
+        try FileManager.default.createDirectory(
+            atPath: URL(fileURLWithPath: destinationPath).deletingLastPathComponent().path,
+            withIntermediateDirectories: true
+        )
+        OWSFileSystem.deleteFileIfExists(destinationPath)
+        
+        guard OWSFileSystem.ensureFileExists(destinationPath) else { throw StorageError.failedToSave }
+        
+        let source: FileHandle = try FileHandle(forReadingFrom: URL(fileURLWithPath: sourcePath))
+        let destination: FileHandle = try FileHandle(forWritingTo: URL(fileURLWithPath: destinationPath))
+        defer {
+            source.closeFile()
+            destination.closeFile()
+        }
+        
+        var remainingBytes: UInt64 = file.size
+        var chunkIndex: UInt64 = 0
+        var hasMoreData: Bool = true
+        
+        while hasMoreData {
+            try autoreleasepool {
+                let chunk: Data = source.readData(ofLength: Int(min(UInt64(chunkSize), remainingBytes)))
+                remainingBytes -= UInt64(chunk.count)
+                hasMoreData = (remainingBytes > 0 && !chunk.isEmpty)
+                
+                guard
+                    let result = sodium.aead.xchacha20poly1305ietf.encrypt(
+                        message: Bytes(chunk),
+                        secretKey: key,
+                        additionalData: additionalData(for: file, chunkIndex: chunkIndex, isFinal: !hasMoreData)
+                    )
+                else { throw StorageError.failedToSave }
+                
+                destination.write(Data(result.nonce + result.authenticatedCipherText))
+                chunkIndex += 1
+                onChunkEncrypted(UInt64(chunk.count))
+            }
+        }
+        
+        destination.synchronizeFile()
+        
+        // If the file changed size while it was being exported then the archive would be invalid
+        guard remainingBytes == 0 else { throw StorageError.failedToSave }
+    }
+    
+    /// Decrypt a file in chunks into a partial file which is moved to the destination once the final chunk has been decrypted,
+    /// if a partial file already exists then the decryption will resume from the last complete chunk
+    ///
+    /// **Note:** A destination which already exists with the expected size is assumed to have been imported by a previous
+    /// attempt (the destination is only ever written once it's content has been fully authenticated)
+    internal static func decryptFile(
+        from sourcePath: String,
+        to destinationPath: String,
+        file: Manifest.FileInfo,
+        chunkSize: Int,
+        key: Bytes,
+        using sodium: Sodium,
+        onChunkDecrypted: (UInt64) -> ()
+    ) throws {
+        let partialPath: String = "\(destinationPath).\(partialFileExtension)"
+        
+        guard
+            !FileManager.default.fileExists(atPath: destinationPath) ||
+            FileManager.default.fileExists(atPath: partialPath) ||
+            (OWSFileSystem.fileSize(ofPath: destinationPath)?.uint64Value ?? 0) != file.size
+        else {
+            onChunkDecrypted(file.size)
+            return
+        }
+        
+        let overhead: UInt64 = UInt64(sodium.aead.xchacha20poly1305ietf.NonceBytes + sodium.aead.xchacha20poly1305ietf.ABytes)
+        let totalChunkCount: UInt64 = max(1, (file.size + UInt64(chunkSize) - 1) / UInt64(chunkSize))
+        
+        // Only resume from complete chunks (anything after the last complete chunk gets discarded)
+        let existingSize: UInt64 = (OWSFileSystem.fileSize(ofPath: partialPath)?.uint64Value ?? 0)
+        let completedChunkCount: UInt64 = min(existingSize / UInt64(chunkSize), totalChunkCount - 1)
+        
+        try FileManager.default.createDirectory(
+            atPath: URL(fileURLWithPath: destinationPath).deletingLastPathComponent().path,
+            withIntermediateDirectories: true
+        )
+        
+        guard OWSFileSystem.ensureFileExists(partialPath) else { throw StorageError.failedToSave }
+        
+        let source: FileHandle = try FileHandle(forReadingFrom: URL(fileURLWithPath: sourcePath))
+        let destination: FileHandle = try FileHandle(forWritingTo: URL(fileURLWithPath: partialPath))
+        defer {
+            source.closeFile()
+            destination.closeFile()
+        }
+        
+        destination.truncateFile(atOffset: completedChunkCount * UInt64(chunkSize))
+        source.seek(toFileOffset: completedChunkCount * (UInt64(chunkSize) + overhead))
+        onChunkDecrypted(completedChunkCount * UInt64(chunkSize))
+        
+        try (completedChunkCount..<totalChunkCount).forEach { chunkIndex in
+            try autoreleasepool {
+                let isFinal: Bool = (chunkIndex == totalChunkCount - 1)
+                let expectedChunkSize: UInt64 = (isFinal ?
+                    (file.size - (chunkIndex * UInt64(chunkSize))) :
+                    UInt64(chunkSize)
+                )
+                let encryptedChunk: Bytes = Bytes(source.readData(ofLength: Int(expectedChunkSize + overhead)))
+                let nonceBytes: Int = sodium.aead.xchacha20poly1305ietf.NonceBytes
+                
+                guard
+                    encryptedChunk.count == Int(expectedChunkSize + overhead),
+                    let chunk: Bytes = sodium.aead.xchacha20poly1305ietf.decrypt(
+                        authenticatedCipherText: Bytes(encryptedChunk[nonceBytes...]),
+                        secretKey: key,
+                        nonce: Bytes(encryptedChunk[0..<nonceBytes]),
+                        additionalData: additionalData(for: file, chunkIndex: chunkIndex, isFinal: isFinal)
+                    )
+                else { throw StorageError.decodingFailed }
+                
+                destination.write(Data(chunk))
+                onChunkDecrypted(UInt64(chunk.count))
+            }
+        }
+        
+        destination.synchronizeFile()
+        
+        guard (OWSFileSystem.fileSize(ofPath: partialPath)?.uint64Value ?? 0) == file.size else {
+            throw StorageError.failedToSave
+        }
+        
+        OWSFileSystem.deleteFileIfExists(destinationPath)
+        try FileManager.default.moveItem(atPath: partialPath, toPath: destinationPath)
+    }
+}
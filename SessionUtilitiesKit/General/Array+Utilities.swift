@@ -56,6 +56,14 @@ public extension Array {
     func grouped<Key: Hashable>(by keyForValue: (Element) throws -> Key) -> [Key: [Element]] {
         return ((try? Dictionary(grouping: self, by: keyForValue)) ?? [:])
     }
+    
+    func chunked(by chunkSize: Int) -> [[Element]] {
+        let chunkSize: Int = Swift.max(1, chunkSize)
+        
+        return stride(from: 0, to: count, by: chunkSize).map {
+            Array(self[$0..<Swift.min($0 + chunkSize, count)])
+        }
+    }
 }
 
 public extension Array where Element: Hashable {
@@ -0,0 +1,299 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import UIKit
+
+/// The `CacheGovernor` enforces a single memory budget across the in-memory caches in the app, caches register themselves with a
+/// priority and report the byte cost of their entries and when the entries get accessed, when the total cost exceeds the budget (or
+/// a memory pressure signal is received) the governor picks entries to evict across all of the registered caches based on their
+/// cost, how recently they were accessed and the priority of their cache
+///
+/// **Note:** Recency is tracked with a logical clock (rather than dates) so eviction decisions only depend on the order of the
+/// operations, eviction callbacks are called synchronously on the calling thread after the governor's state has been updated so
+/// caches must not call back into the governor from within them
+public final class CacheGovernor {
+    public static let shared: CacheGovernor = CacheGovernor(
+        budget: (50 * 1024 * 1024),
+        observeMemoryPressure: true
+    )
+    
+    public enum Priority: Int {
+        case low
+        case medium
+        case high
+        
+        /// Entries in higher priority caches are treated as this many times cheaper to keep
+        var weight: Double {
+            switch self {
+                case .low: return 1
+                case .medium: return 4
+                case .high: return 16
+            }
+        }
+    }
+    
+    public enum Pressure {
+        case background
+        case warning
+        case critical
+        
+        /// The fraction of the budget the caches get trimmed to when this pressure is received
+        var targetBudgetFraction: Double {
+            switch self {
+                case .background: return 0.75
+                case .warning: return 0.5
+                case .critical: return 0.2
+            }
+        }
+    }
+    
+    public struct Metrics: Equatable {
+        public let budget: Int
+        public let totalCost: Int
+        public let entryCount: Int
+        public let costByCache: [String: Int]
+        public let evictionCount: Int
+        public let evictedCost: Int
+        public let pressureEventCount: Int
+    }
+    
+    private struct EntryKey: Hashable {
+        let cacheIdentifier: String
+        let key: AnyHashable
+    }
+    
+    private struct Entry {
+        let cost: Int
+        let lastAccess: UInt64
+    }
+    
+    private struct Registration {
+        let priority: Priority
+        let evict: ([AnyHashable]) -> Void
+    }
+    
+    private struct State {
+        var registrations: [String: Registration] = [:]
+        var entries: [EntryKey: Entry] = [:]
+        var costByCache: [String: Int] = [:]
+        var totalCost: Int = 0
+        var clock: UInt64 = 0
+        var evictionCount: Int = 0
+        var evictedCost: Int = 0
+        var pressureEventCount: Int = 0
+        
+        mutating func tick() -> UInt64 {
+            clock += 1
+            return clock
+        }
+        
+        mutating func remove(_ entryKey: EntryKey) -> Entry? {
+            guard let entry: Entry = entries.removeValue(forKey: entryKey) else { return nil }
+            
+            totalCost -= entry.cost
+            costByCache[entryKey.cacheIdentifier] = ((costByCache[entryKey.cacheIdentifier] ?? 0) - entry.cost)
+            return entry
+        }
+    }
+    
+    /// When the budget is exceeded by an insertion the caches are trimmed to this fraction of the budget so the eviction work is
+    /// amortised across a number of insertions rather than happening for every insertion once the budget is reached
+    private static let insertionTrimFraction: Double = 0.9
+    
+    public let budget: Int
+    private let state: Atomic<State> = Atomic(State())
+    private var memoryPressureSource: DispatchSourceMemoryPressure?
+    
+    public var metrics: Metrics {
+        let state: State = self.state.wrappedValue
+        
+        return Metrics(
+            budget: budget,
+            totalCost: state.totalCost,
+            entryCount: state.entries.count,
+            costByCache: state.costByCache,
+            evictionCount: state.evictionCount,
+            evictedCost: state.evictedCost,
+            pressureEventCount: state.pressureEventCount
+        )
+    }
+    
+    // MARK: - Initialization
+    
+    public init(budget: Int, observeMemoryPressure: Bool = false) {
+        self.budget = budget
+        
+        guard observeMemoryPressure else { return }
+        
+        NotificationCenter.default.addObserver(
+            self,
+            selector: #selector(didReceiveMemoryWarning),
+            name: UIApplication.didReceiveMemoryWarningNotification,
+            object: nil
+        )
+        NotificationCenter.default.addObserver(
+            self,
+            selector: #selector(didEnterBackground),
+            name: .OWSApplicationDidEnterBackground,
+            object: nil
+        )
+        
+        let memoryPressureSource: DispatchSourceMemoryPressure = DispatchSource.makeMemoryPressureSource(
+            eventMask: [.warning, .critical],
+            queue: DispatchQueue.global(qos: .utility)
+        )
+        memoryPressureSource.setEventHandler { [weak self, weak memoryPressureSource] in
+            guard let event: DispatchSource.MemoryPressureEvent = memoryPressureSource?.data else { return }
+            
+            self?.handle(event.contains(.critical) ? .critical : .warning)
+        }
+        memoryPressureSource.resume()
+        self.memoryPressureSource = memoryPressureSource
+    }
+    
+    deinit {
+        NotificationCenter.default.removeObserver(self)
+        memoryPressureSource?.cancel()
+    }
+    
+    // MARK: - Registration
+    
+    /// Register a cache with the governor, the `evict` closure will be called with the keys of the entries which should be
+    /// removed from the cache
+    ///
+    /// **Note:** The `identifier` must be unique, registering a cache with an existing identifier replaces the existing cache
+    public func register(_ identifier: String, priority: Priority, evict: @escaping ([AnyHashable]) -> Void) {
+        state.mutate { state in
+            state.registrations[identifier] = Registration(priority: priority, evict: evict)
+            state.costByCache[identifier] = (state.costByCache[identifier] ?? 0)
+        }
+    }
+    
+    /// Remove a cache and all of it's entries from the governor (this won't call the cache's `evict` closure)
+    public func unregister(_ identifier: String) {
+        state.mutate { state in
+            state.registrations[identifier] = nil
+            removeEntries(for: identifier, from: &state)
+            state.costByCache[identifier] = nil
+        }
+    }
+    
+    // MARK: - Entries
+    
+    /// Record that an entry was added to (or updated within) a cache, this may result in entries being evicted from any of the
+    /// registered caches (including the entry being added if it's cost alone exceeds the budget)
+    public func recordInsertion(in identifier: String, key: AnyHashable, cost: Int) {
+        let evictions: [(Registration, [AnyHashable])] = state.mutate { state in
+            guard state.registrations[identifier] != nil else { return [] }
+            
+            let entryKey: EntryKey = EntryKey(cacheIdentifier: identifier, key: key)
+            let cost: Int = max(0, cost)
+            _ = state.remove(entryKey)
+            state.entries[entryKey] = Entry(cost: cost, lastAccess: state.tick())
+            state.totalCost += cost
+            state.costByCache[identifier] = ((state.costByCache[identifier] ?? 0) + cost)
+            
+            guard state.totalCost > budget else { return [] }
+            
+            return evict(
+                from: &state,
+                toCost: Int(Double(budget) * CacheGovernor.insertionTrimFraction)
+            )
+        }
+        
+        performEvictions(evictions)
+    }
+    
+    /// Record that an entry in a cache was accessed, this makes it less likely to be evicted
+    public func recordAccess(in identifier: String, key: AnyHashable) {
+        state.mutate { state in
+            let entryKey: EntryKey = EntryKey(cacheIdentifier: identifier, key: key)
+            
+            guard let entry: Entry = state.entries[entryKey] else { return }
+            
+            state.entries[entryKey] = Entry(cost: entry.cost, lastAccess: state.tick())
+        }
+    }
+    
+    /// Record that a cache removed an entry itself
+    public func recordRemoval(in identifier: String, key: AnyHashable) {
+        state.mutate { state in
+            _ = state.remove(EntryKey(cacheIdentifier: identifier, key: key))
+        }
+    }
+    
+    /// Record that a cache removed all of it's entries itself
+    public func recordRemoveAll(in identifier: String) {
+        state.mutate { state in removeEntries(for: identifier, from: &state) }
+    }
+    
+    // MARK: - Memory Pressure
+    
+    /// Evict entries until the total cost is within the fraction of the budget for the `pressure`
+    public func handle(_ pressure: Pressure) {
+        let evictions: [(Registration, [AnyHashable])] = state.mutate { state in
+            state.pressureEventCount += 1
+            
+            return evict(from: &state, toCost: Int(Double(budget) * pressure.targetBudgetFraction))
+        }
+        let evictedEntryCount: Int = evictions.reduce(0) { result, next in result + next.1.count }
+        
+        SNLog("[CacheGovernor] Evicted \(evictedEntryCount) entries due to \(pressure) memory pressure.")
+        performEvictions(evictions)
+    }
+    
+    @objc private func didReceiveMemoryWarning() {
+        handle(.warning)
+    }
+    
+    @objc private func didEnterBackground() {
+        handle(.background)
+    }
+    
+    // MARK: - Internal Functions
+    
+    private func removeEntries(for identifier: String, from state: inout State) {
+        state.entries.keys
+            .filter { $0.cacheIdentifier == identifier }
+            .forEach { _ = state.remove($0) }
+    }
+    
+    /// Evict entries until the total cost is no more than `targetCost`, entries are scored by their cost multiplied by the time
+    /// since they were last accessed (divided by their cache's priority weight) and the highest scores are evicted first
+    private func evict(from state: inout State, toCost targetCost: Int) -> [(Registration, [AnyHashable])] {
+        guard state.totalCost > targetCost else { return [] }
+        
+        let clock: UInt64 = state.clock
+        let registrations: [String: Registration] = state.registrations
+        let candidates: [(key: EntryKey, score: Double, lastAccess: UInt64)] = state.entries
+            .map { entryKey, entry in
+                let age: Double = Double(clock - entry.lastAccess + 1)
+                let weight: Double = (registrations[entryKey.cacheIdentifier]?.priority.weight ?? 1)
+                
+                return (entryKey, ((Double(entry.cost) * age) / weight), entry.lastAccess)
+            }
+            .sorted { lhs, rhs in
+                // The last access values are unique so use them to break ties (ensures the order is deterministic)
+                guard lhs.score != rhs.score else { return lhs.lastAccess < rhs.lastAccess }
+                
+                return lhs.score > rhs.score
+            }
+        var evictedKeys: [String: [AnyHashable]] = [:]
+        
+        for candidate in candidates {
+            guard state.totalCost > targetCost else { break }
+            guard let entry: Entry = state.remove(candidate.key) else { continue }
+            
+            state.evictionCount += 1
+            state.evictedCost += entry.cost
+            evictedKeys[candidate.key.cacheIdentifier, default: []].append(candidate.key.key)
+        }
+        
+        return evictedKeys
+            .sorted { lhs, rhs in lhs.key < rhs.key }
+            .compactMap { identifier, keys in registrations[identifier].map { ($0, keys) } }
+    }
+    
+    private func performEvictions(_ evictions: [(Registration, [AnyHashable])]) {
+        evictions.forEach { registration, keys in registration.evict(keys) }
+    }
+}
@@ -3,72 +3,106 @@
 //
 
 // A simple LRU cache bounded by the number of entries.
+//
+// The cache is registered with a `CacheGovernor` which evicts entries (rather than
+// clearing the whole cache) when the global cache budget is exceeded or a memory
+// warning is received.
 public class LRUCache<KeyType: Hashable & Equatable, ValueType> {
 
-    private var cacheMap: [KeyType: ValueType] = [:]
-    private var cacheOrder: [KeyType] = []
+    private struct State {
+        var cacheMap: [KeyType: ValueType] = [:]
+        var cacheOrder: [KeyType] = []
+    }
+
+    private let state: Atomic<State> = Atomic(State())
     private let maxSize: Int
+    private let identifier: String
+    private let cost: (ValueType) -> Int
+    private let governor: CacheGovernor
 
-    @objc
-    public init(maxSize: Int) {
+    /// - parameter identifier: A unique identifier for the cache (used for the `CacheGovernor` metrics)
+    /// - parameter cost: The approximate number of bytes a value uses in memory
+    public init(
+        maxSize: Int,
+        identifier: String,
+        priority: CacheGovernor.Priority = .medium,
+        governor: CacheGovernor = .shared,
+        cost: @escaping (ValueType) -> Int
+    ) {
         self.maxSize = maxSize
+        self.identifier = identifier
+        self.cost = cost
+        self.governor = governor
 
-        NotificationCenter.default.addObserver(self,
-                                               selector: #selector(didReceiveMemoryWarning),
-                                               name: UIApplication.didReceiveMemoryWarningNotification,
-                                               object: nil)
-        NotificationCenter.default.addObserver(self,
-                                               selector: #selector(didEnterBackground),
-                                               name: NSNotification.Name.OWSApplicationDidEnterBackground,
-                                               object: nil)
+        governor.register(identifier, priority: priority) { [weak self] keys in
+            self?.state.mutate { state in
+                keys.compactMap { $0.base as? KeyType }.forEach { key in
+                    state.cacheMap.removeValue(forKey: key)
+                    state.cacheOrder = state.cacheOrder.filter { $0 != key }
+                }
+            }
+        }
     }
 
     deinit {
-        NotificationCenter.default.removeObserver(self)
+        governor.unregister(identifier)
     }
 
-    @objc func didEnterBackground() {
-        clear()
+    private func updateCacheOrder(key: KeyType, in state: inout State) {
+        state.cacheOrder = state.cacheOrder.filter { $0 != key }
+        state.cacheOrder.append(key)
     }
 
-    @objc func didReceiveMemoryWarning() {
-        clear()
-    }
+    public func get(key: KeyType) -> ValueType? {
+        let maybeValue: ValueType? = state.mutate { state in
+            guard let value = state.cacheMap[key] else {
+                // Miss
+                return nil
+            }
 
-    private func updateCacheOrder(key: KeyType) {
-        cacheOrder = cacheOrder.filter { $0 != key }
-        cacheOrder.append(key)
-    }
+            // Hit
+            updateCacheOrder(key: key, in: &state)
 
-    public func get(key: KeyType) -> ValueType? {
-        guard let value = cacheMap[key] else {
-            // Miss
-            return nil
+            return value
         }
 
-        // Hit
-        updateCacheOrder(key: key)
+        if maybeValue != nil {
+            governor.recordAccess(in: identifier, key: key)
+        }
 
-        return value
+        return maybeValue
     }
 
     public func set(key: KeyType, value: ValueType) {
-        cacheMap[key] = value
+        let staleKeys: [KeyType] = state.mutate { state in
+            var staleKeys: [KeyType] = []
+            state.cacheMap[key] = value
+
+            updateCacheOrder(key: key, in: &state)
 
-        updateCacheOrder(key: key)
+            while state.cacheOrder.count > maxSize {
+                guard let staleKey = state.cacheOrder.first else { break }
 
-        while cacheOrder.count > maxSize {
-            guard let staleKey = cacheOrder.first else {
-                return
+                state.cacheOrder.removeFirst()
+                state.cacheMap.removeValue(forKey: staleKey)
+                staleKeys.append(staleKey)
             }
-            cacheOrder.removeFirst()
-            cacheMap.removeValue(forKey: staleKey)
+
+            return staleKeys
         }
+
+        staleKeys.forEach { governor.recordRemoval(in: identifier, key: $0) }
+
+        // Note: This needs to happen after updating the state as the governor may evict
+        // entries from this cache synchronously
+        governor.recordInsertion(in: identifier, key: key, cost: cost(value))
     }
 
-    @objc
     public func clear() {
-        cacheMap.removeAll()
-        cacheOrder.removeAll()
+        state.mutate { state in
+            state.cacheMap.removeAll()
+            state.cacheOrder.removeAll()
+        }
+        governor.recordRemoveAll(in: identifier)
     }
 }
@@ -0,0 +1,57 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+
+/// Logs how long each phase of the launch process takes relative to the start of the launch so regressions in startup time (in the
+/// app as well as the extensions) can be identified from the logs
+///
+/// **Note:** Each phase is only logged the first time it is recorded and nothing is logged until `start` has been called (so the
+/// unit tests won't log anything)
+public enum LaunchTiming {
+    public enum Phase: String {
+        case storageCreated = "storage created"
+        case firstQuery = "first query completed"
+        case connectionsPrewarmed = "connections prewarmed"
+        case environmentSetup = "environment setup completed"
+        case migrationsCompleted = "migrations completed"
+    }
+    
+    private struct State {
+        var context: String?
+        var startTime: Date?
+        var recordedPhases: Set<Phase> = []
+    }
+    
+    private static let state: Atomic<State> = Atomic(State())
+    
+    // MARK: - Functions
+    
+    /// Start timing the launch, this should be called as early as possible in the launch process
+    ///
+    /// - parameter context: A label for the process being launched (eg. "App" or "NotificationServiceExtension")
+    public static func start(_ context: String) {
+        state.mutate { state in
+            guard state.startTime == nil else { return }
+            
+            state.context = context
+            state.startTime = Date()
+        }
+    }
+    
+    public static func record(_ phase: Phase) {
+        let maybeLogInfo: (context: String, duration: TimeInterval)? = state.mutate { state in
+            guard
+                let context: String = state.context,
+                let startTime: Date = state.startTime,
+                !state.recordedPhases.contains(phase)
+            else { return nil }
+            
+            state.recordedPhases.insert(phase)
+            return (context, Date().timeIntervalSince(startTime))
+        }
+        
+        guard let logInfo: (context: String, duration: TimeInterval) = maybeLogInfo else { return }
+        
+        SNLog("[Launch] \(logInfo.context) \(phase.rawValue) after \(Int(logInfo.duration * 1000))ms")
+    }
+}
@@ -4,7 +4,12 @@ import Foundation
 import Sodium
 import Curve25519Kit
 
-public struct SessionId {
+/// A `SessionId` keeps the raw bytes of the public key alongside the hex string so comparing and hashing ids doesn't need to go
+/// through string comparisons
+///
+/// **Note:** Equality and hashing use the decoded bytes so ids which only differ by the case of their hex string are equal, the
+/// `publicKey` and `hexString` values keep the casing of the string the id was created from
+public struct SessionId: Hashable {
     public enum Prefix: String, CaseIterable {
         case standard = "05"    // Used for identified users, open groups, etc.
         case blinded = "15"     // Used for authentication and participants in open groups with blinding enabled
@@ -24,10 +29,25 @@ public struct SessionId {
             
             self = targetPrefix
         }
+        
+        public init?(byte: UInt8) {
+            guard let targetPrefix: Prefix = Prefix.allCases.first(where: { $0.byte == byte }) else { return nil }
+            
+            self = targetPrefix
+        }
+        
+        public var byte: UInt8 {
+            switch self {
+                case .standard: return 0x05
+                case .blinded: return 0x15
+                case .unblinded: return 0x00
+            }
+        }
     }
     
     public let prefix: Prefix
     public let publicKey: String
+    public let publicKeyBytes: Bytes
     
     public var hexString: String {
         return prefix.rawValue + publicKey
@@ -41,10 +61,25 @@ public struct SessionId {
         
         self.prefix = targetPrefix
         self.publicKey = idString.substring(from: 2)
+        
+        // Note: 'Prefix(from:)' only succeeds for valid hex so decoding the key can't fail here
+        self.publicKeyBytes = (Hex.decodedBytes(idString.utf8.dropFirst(2)) ?? [])
     }
     
     public init(_ type: Prefix, publicKey: Bytes) {
         self.prefix = type
-        self.publicKey = publicKey.map { String(format: "%02hhx", $0) }.joined()
+        self.publicKey = Hex.encodedString(publicKey)
+        self.publicKeyBytes = publicKey
+    }
+    
+    // MARK: - Hashable
+    
+    public static func == (lhs: SessionId, rhs: SessionId) -> Bool {
+        return (lhs.prefix == rhs.prefix && lhs.publicKeyBytes == rhs.publicKeyBytes)
+    }
+    
+    public func hash(into hasher: inout Hasher) {
+        hasher.combine(prefix)
+        hasher.combine(publicKeyBytes)
     }
 }
@@ -43,3 +43,52 @@ extension Sign {
         return x25519SecretKey
     }
 }
+    
+    /// Signs a message with a secret key which is provided as a pointer (eg. from `SecureBytes`) so the secret key doesn't need
+    /// to be copied into a `[UInt8]`
+    public func signature(message: [UInt8], secretKey: UnsafeRawBufferPointer) -> [UInt8]? {
+        guard
+            secretKey.count == SecretKeyBytes,
+            let secretKeyPtr: UnsafePointer<UInt8> = secretKey.bindMemory(to: UInt8.self).baseAddress
+        else { return nil }
+        
+        var signature: [UInt8] = [UInt8](repeating: 0, count: self.Bytes)
+        
+        guard crypto_sign_detached(&signature, nil, message, UInt64(message.count), secretKeyPtr) == 0 else {
+            return nil
+        }
+        
+        return signature
+    }
+}
+
+extension Box {
+    /// Opens a sealed box with a secret key which is provided as a pointer (eg. from `SecureBytes`) so the secret key doesn't
+    /// need to be copied into a `[UInt8]`
+    public func open(
+        anonymousCipherText: Bytes,
+        recipientPublicKey: PublicKey,
+        recipientSecretKey: UnsafeRawBufferPointer
+    ) -> Bytes? {
+        guard
+            recipientPublicKey.count == PublicKeyBytes,
+            recipientSecretKey.count == SecretKeyBytes,
+            anonymousCipherText.count >= SealBytes,
+            let secretKeyPtr: UnsafePointer<UInt8> = recipientSecretKey.bindMemory(to: UInt8.self).baseAddress
+        else { return nil }
+        
+        var message: Bytes = Bytes(repeating: 0, count: (anonymousCipherText.count - SealBytes))
+        
+        guard
+            crypto_box_seal_open(
+                &message,
+                anonymousCipherText,
+                UInt64(anonymousCipherText.count),
+                recipientPublicKey,
+                secretKeyPtr
+            ) == 0
+        else { return nil }
+        
+        return message
+    }
+}
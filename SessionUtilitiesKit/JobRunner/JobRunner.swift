@@ -90,6 +90,13 @@ public final class JobRunner {
                 jobVariants.remove(.attachmentDownload)
             ].compactMap { $0 }
         )
+        let searchIndexingQueue: JobQueue = JobQueue(
+            type: .searchIndexing,
+            qos: .background,
+            jobVariants: [
+                jobVariants.remove(.searchIndexing)
+            ].compactMap { $0 }
+        )
         let generalQueue: JobQueue = JobQueue(
             type: .general(number: 0),
             qos: .utility,
@@ -100,6 +107,7 @@ public final class JobRunner {
             messageSendQueue,
             messageReceiveQueue,
             attachmentDownloadQueue,
+            searchIndexingQueue,
             generalQueue
         ].reduce(into: [:]) { prev, next in
             next.jobVariants.forEach { variant in
@@ -408,6 +416,7 @@ private final class JobQueue {
         case messageSend
         case messageReceive
         case attachmentDownload
+        case searchIndexing
         
         var name: String {
             switch self {
@@ -416,6 +425,7 @@ private final class JobQueue {
                 case .messageSend: return "MessageSend"
                 case .messageReceive: return "MessageReceive"
                 case .attachmentDownload: return "AttachmentDownload"
+                case .searchIndexing: return "SearchIndexing"
             }
         }
     }
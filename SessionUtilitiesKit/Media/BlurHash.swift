@@ -0,0 +1,364 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import UIKit
+import ImageIO
+import Accelerate
+
+/// A `BlurHash` is a compact (generally 20-30 character) representation of the colours in an image which can be sent alongside
+/// visual media and rendered as a blurred preview while the attachment is downloading (see https://blurha.sh for the format)
+///
+/// The image is represented by the coefficients of a small number of cosine components for each colour channel, since the basis
+/// functions are separable both the encode and decode are performed as a pair of matrix multiplications per channel using `vDSP`
+///
+/// **Note:** Encoding works on a downscaled copy of the image so is cheap enough to run on every outgoing attachment and
+/// decoding should be done at a small size (see `maxDecodeDimension`) with the result scaled up by the image view
+public enum BlurHash {
+    public static let defaultComponents: (x: Int, y: Int) = (4, 3)
+    public static let maxDecodeDimension: Int = 32
+    
+    private static let maxComponents: Int = 9
+    
+    /// The length of a hash with the maximum number of components, anything longer can't be valid
+    public static let maxLength: Int = (4 + (2 * maxComponents * maxComponents))
+    private static let encodeDimension: Int = 32
+    private static let base83Characters: [Character] = Array(
+        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz#$%*+,-.:;=?@[]^_{|}~"
+    )
+    private static let base83Values: [Character: Int] = base83Characters
+        .enumerated()
+        .reduce(into: [:]) { result, next in result[next.element] = next.offset }
+    
+    /// Lookup table for converting an 8-bit sRGB value to a linear value
+    private static let sRGBToLinearTable: [Float] = (0..<256).map { value in
+        let normalisedValue: Float = (Float(value) / 255)
+        
+        return (normalisedValue <= 0.04045 ?
+            (normalisedValue / 12.92) :
+            powf((normalisedValue + 0.055) / 1.055, 2.4)
+        )
+    }
+    
+    /// Lookup table for converting a linear value (quantised to `linearToSRGBTableSize` steps) to an 8-bit sRGB value
+    private static let linearToSRGBTableSize: Int = 4096
+    private static let linearToSRGBTable: [UInt8] = (0..<linearToSRGBTableSize).map { index in
+        let value: Float = (Float(index) / Float(linearToSRGBTableSize - 1))
+        let sRGBValue: Float = (value <= 0.0031308 ?
+            (value * 12.92) :
+            ((1.055 * powf(value, 1 / 2.4)) - 0.055)
+        )
+        
+        return UInt8(max(0, min(255, Int((sRGBValue * 255) + 0.5))))
+    }
+    
+    // MARK: - Encoding
+    
+    /// Generate a `BlurHash` for the image at the provided path
+    ///
+    /// **Note:** ImageIO is used to create a small thumbnail of the image so the full image never needs to be decoded
+    public static func encode(imageAtPath path: String, components: (x: Int, y: Int) = defaultComponents) -> String? {
+        guard let source: CGImageSource = CGImageSourceCreateWithURL(URL(fileURLWithPath: path) as CFURL, nil) else {
+            return nil
+        }
+        
+        let options: [CFString: Any] = [
+            kCGImageSourceCreateThumbnailFromImageAlways: true,
+            kCGImageSourceCreateThumbnailWithTransform: true,
+            kCGImageSourceShouldCacheImmediately: true,
+            kCGImageSourceThumbnailMaxPixelSize: encodeDimension
+        ]
+        
+        guard let thumbnail: CGImage = CGImageSourceCreateThumbnailAtIndex(source, 0, options as CFDictionary) else {
+            return nil
+        }
+        
+        return encode(image: thumbnail, components: components)
+    }
+    
+    /// Generate a `BlurHash` for the provided image
+    public static func encode(image: CGImage, components: (x: Int, y: Int) = defaultComponents) -> String? {
+        guard
+            (1...maxComponents).contains(components.x),
+            (1...maxComponents).contains(components.y),
+            image.width > 0,
+            image.height > 0
+        else { return nil }
+        
+        // Draw the image into a small RGBA buffer (the blurhash doesn't contain enough detail to benefit from
+        // any more pixels than this)
+        let scale: CGFloat = min(1, (CGFloat(encodeDimension) / CGFloat(max(image.width, image.height))))
+        let width: Int = max(1, Int((CGFloat(image.width) * scale).rounded()))
+        let height: Int = max(1, Int((CGFloat(image.height) * scale).rounded()))
+        var pixels: [UInt8] = [UInt8](repeating: 0, count: (width * height * 4))
+        let didDraw: Bool = pixels.withUnsafeMutableBytes { buffer -> Bool in
+            guard
+                let context: CGContext = CGContext(
+                    data: buffer.baseAddress,
+                    width: width,
+                    height: height,
+                    bitsPerComponent: 8,
+                    bytesPerRow: (width * 4),
+                    space: CGColorSpaceCreateDeviceRGB(),
+                    bitmapInfo: CGImageAlphaInfo.noneSkipLast.rawValue
+                )
+            else { return false }
+            
+            context.interpolationQuality = .medium
+            context.draw(image, in: CGRect(x: 0, y: 0, width: width, height: height))
+            return true
+        }
+        
+        guard didDraw else { return nil }
+        
+        // Split the pixels into linear colour channels (each a row-major 'height x width' matrix)
+        let pixelCount: Int = (width * height)
+        var channels: [[Float]] = [[Float]](repeating: [Float](repeating: 0, count: pixelCount), count: 3)
+        
+        for index in 0..<pixelCount {
+            channels[0][index] = sRGBToLinearTable[Int(pixels[(index * 4)])]
+            channels[1][index] = sRGBToLinearTable[Int(pixels[(index * 4) + 1])]
+            channels[2][index] = sRGBToLinearTable[Int(pixels[(index * 4) + 2])]
+        }
+        
+        // The factors for each channel are 'By · L · Bx' where 'Bx' is a 'width x components.x' matrix and 'By'
+        // is a 'components.y x height' matrix of the cosine basis functions
+        let basisX: [Float] = basis(rows: width, columns: components.x, length: width, isTransposed: false)
+        let basisY: [Float] = basis(rows: components.y, columns: height, length: height, isTransposed: true)
+        let componentCount: Int = (components.x * components.y)
+        let factors: [[Float]] = channels.map { channel -> [Float] in
+            var intermediate: [Float] = [Float](repeating: 0, count: (height * components.x))
+            var result: [Float] = [Float](repeating: 0, count: componentCount)
+            vDSP_mmul(
+                channel, 1,
+                basisX, 1,
+                &intermediate, 1,
+                vDSP_Length(height), vDSP_Length(components.x), vDSP_Length(width)
+            )
+            vDSP_mmul(
+                basisY, 1,
+                intermediate, 1,
+                &result, 1,
+                vDSP_Length(components.y), vDSP_Length(components.x), vDSP_Length(height)
+            )
+            
+            // Normalise the factors (the DC component is the average colour so has half the scale of the others)
+            var normalisationScale: Float = (2 / Float(pixelCount))
+            var normalisedResult: [Float] = [Float](repeating: 0, count: componentCount)
+            vDSP_vsmul(result, 1, &normalisationScale, &normalisedResult, 1, vDSP_Length(componentCount))
+            normalisedResult[0] *= 0.5
+            
+            return normalisedResult
+        }
+        
+        // Build the hash
+        var hash: String = ""
+        encodeBase83((components.x - 1) + ((components.y - 1) * 9), length: 1, into: &hash)
+        
+        let maximumValue: Float
+        
+        if componentCount > 1 {
+            let actualMaximumValue: Float = factors
+                .map { channel in channel.dropFirst().map { abs($0) }.max() ?? 0 }
+                .max()
+                .defaulting(to: 0)
+            let quantisedMaximumValue: Int = max(0, min(82, Int(floorf((actualMaximumValue * 166) - 0.5))))
+            maximumValue = (Float(quantisedMaximumValue + 1) / 166)
+            encodeBase83(quantisedMaximumValue, length: 1, into: &hash)
+        }
+        else {
+            maximumValue = 1
+            encodeBase83(0, length: 1, into: &hash)
+        }
+        
+        encodeBase83(
+            (Int(linearToSRGB(factors[0][0])) << 16) +
+            (Int(linearToSRGB(factors[1][0])) << 8) +
+            Int(linearToSRGB(factors[2][0])),
+            length: 4,
+            into: &hash
+        )
+        
+        for index in 1..<componentCount {
+            let quantised: [Int] = factors.map { channel in
+                max(0, min(18, Int(floorf((signedPow(channel[index] / maximumValue, 0.5) * 9) + 9.5))))
+            }
+            
+            encodeBase83((quantised[0] * 19 * 19) + (quantised[1] * 19) + quantised[2], length: 2, into: &hash)
+        }
+        
+        return hash
+    }
+    
+    // MARK: - Decoding
+    
+    /// Returns `true` if the provided value is a well formed `BlurHash`
+    public static func isValid(_ blurHash: String) -> Bool {
+        // Check the length first to avoid processing excessively large values
+        guard blurHash.utf8.count <= maxLength else { return false }
+        
+        return (components(for: Array(blurHash)) != nil)
+    }
+    
+    /// The size a `BlurHash` should be decoded at for media with the provided dimensions
+    public static func decodeSize(for mediaSize: CGSize?) -> CGSize {
+        guard let mediaSize: CGSize = mediaSize, mediaSize.width > 0, mediaSize.height > 0 else {
+            return CGSize(width: maxDecodeDimension, height: maxDecodeDimension)
+        }
+        
+        let scale: CGFloat = (CGFloat(maxDecodeDimension) / max(mediaSize.width, mediaSize.height))
+        
+        return CGSize(
+            width: max(1, (mediaSize.width * scale).rounded()),
+            height: max(1, (mediaSize.height * scale).rounded())
+        )
+    }
+    
+    /// Decode a `BlurHash` into an image of the provided size
+    ///
+    /// **Note:** The `punch` value can be used to increase or decrease the contrast of the result
+    public static func decode(_ blurHash: String, size: CGSize, punch: Float = 1) -> UIImage? {
+        let characters: [Character] = Array(blurHash)
+        let width: Int = Int(size.width)
+        let height: Int = Int(size.height)
+        
+        guard
+            width > 0,
+            height > 0,
+            let components: (x: Int, y: Int) = components(for: characters),
+            let quantisedMaximumValue: Int = decodeBase83(characters[1...1])
+        else { return nil }
+        
+        let componentCount: Int = (components.x * components.y)
+        let maximumValue: Float = ((Float(quantisedMaximumValue + 1) / 166) * punch)
+        
+        // Extract the factors for each channel (each a row-major 'components.y x components.x' matrix)
+        var factors: [[Float]] = [[Float]](repeating: [Float](repeating: 0, count: componentCount), count: 3)
+        
+        guard let dcValue: Int = decodeBase83(characters[2..<6]) else { return nil }
+        
+        factors[0][0] = sRGBToLinearTable[(dcValue >> 16) & 255]
+        factors[1][0] = sRGBToLinearTable[(dcValue >> 8) & 255]
+        factors[2][0] = sRGBToLinearTable[dcValue & 255]
+        
+        for index in 1..<componentCount {
+            let startIndex: Int = (4 + (index * 2))
+            
+            guard let acValue: Int = decodeBase83(characters[startIndex..<(startIndex + 2)]) else { return nil }
+            
+            factors[0][index] = (signedPow(Float((acValue / (19 * 19)) - 9) / 9, 2) * maximumValue)
+            factors[1][index] = (signedPow(Float(((acValue / 19) % 19) - 9) / 9, 2) * maximumValue)
+            factors[2][index] = (signedPow(Float((acValue % 19) - 9) / 9, 2) * maximumValue)
+        }
+        
+        // The pixels for each channel are 'By · C · Bx' where 'Bx' is a 'components.x x width' matrix and 'By'
+        // is a 'height x components.y' matrix of the cosine basis functions
+        let basisX: [Float] = basis(rows: components.x, columns: width, length: width, isTransposed: true)
+        let basisY: [Float] = basis(rows: height, columns: components.y, length: height, isTransposed: false)
+        let pixelCount: Int = (width * height)
+        let channels: [[Float]] = factors.map { channel -> [Float] in
+            var intermediate: [Float] = [Float](repeating: 0, count: (components.y * width))
+            var result: [Float] = [Float](repeating: 0, count: pixelCount)
+            vDSP_mmul(
+                channel, 1,
+                basisX, 1,
+                &intermediate, 1,
+                vDSP_Length(components.y), vDSP_Length(width), vDSP_Length(components.x)
+            )
+            vDSP_mmul(
+                basisY, 1,
+                intermediate, 1,
+                &result, 1,
+                vDSP_Length(height), vDSP_Length(width), vDSP_Length(components.y)
+            )
+            
+            return result
+        }
+        
+        var pixels: [UInt8] = [UInt8](repeating: 255, count: (pixelCount * 4))
+        
+        for index in 0..<pixelCount {
+            pixels[(index * 4)] = linearToSRGB(channels[0][index])
+            pixels[(index * 4) + 1] = linearToSRGB(channels[1][index])
+            pixels[(index * 4) + 2] = linearToSRGB(channels[2][index])
+        }
+        
+        guard
+            let provider: CGDataProvider = CGDataProvider(data: Data(pixels) as CFData),
+            let image: CGImage = CGImage(
+                width: width,
+                height: height,
+                bitsPerComponent: 8,
+                bitsPerPixel: 32,
+                bytesPerRow: (width * 4),
+                space: CGColorSpaceCreateDeviceRGB(),
+                bitmapInfo: CGBitmapInfo(rawValue: CGImageAlphaInfo.noneSkipLast.rawValue),
+                provider: provider,
+                decode: nil,
+                shouldInterpolate: true,
+                intent: .defaultIntent
+            )
+        else { return nil }
+        
+        return UIImage(cgImage: image)
+    }
+    
+    // MARK: - Internal Functions
+    
+    /// Generate a row-major matrix of the cosine basis values `cos(π * component * position / length)`, when `isTransposed`
+    /// is `false` the rows are positions and the columns are components, otherwise the rows are components
+    private static func basis(rows: Int, columns: Int, length: Int, isTransposed: Bool) -> [Float] {
+        var result: [Float] = [Float](repeating: 0, count: (rows * columns))
+        
+        for row in 0..<rows {
+            for column in 0..<columns {
+                let position: Int = (isTransposed ? column : row)
+                let component: Int = (isTransposed ? row : column)
+                
+                result[(row * columns) + column] = cosf((Float.pi * Float(component * position)) / Float(length))
+            }
+        }
+        
+        return result
+    }
+    
+    private static func components(for characters: [Character]) -> (x: Int, y: Int)? {
+        guard
+            characters.count >= 6,
+            let sizeFlag: Int = decodeBase83(characters[0...0])
+        else { return nil }
+        
+        let components: (x: Int, y: Int) = (((sizeFlag % 9) + 1), ((sizeFlag / 9) + 1))
+        
+        guard
+            components.y <= maxComponents,
+            characters.count == (4 + (2 * components.x * components.y)),
+            characters.allSatisfy({ base83Values[$0] != nil })
+        else { return nil }
+        
+        return components
+    }
+    
+    private static func linearToSRGB(_ value: Float) -> UInt8 {
+        let index: Int = Int((max(0, min(1, value)) * Float(linearToSRGBTableSize - 1)) + 0.5)
+        
+        return linearToSRGBTable[index]
+    }
+    
+    private static func signedPow(_ value: Float, _ exponent: Float) -> Float {
+        return copysignf(powf(abs(value), exponent), value)
+    }
+    
+    private static func encodeBase83(_ value: Int, length: Int, into result: inout String) {
+        for index in 1...length {
+            let digit: Int = ((value / Int(pow(83, Double(length - index)))) % 83)
+            result.append(base83Characters[digit])
+        }
+    }
+    
+    private static func decodeBase83(_ characters: ArraySlice<Character>) -> Int? {
+        return characters.reduce(Int?(0)) { result, character in
+            guard let result: Int = result, let value: Int = base83Values[character] else { return nil }
+            
+            return ((result * 83) + value)
+        }
+    }
+}
@@ -317,12 +317,30 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (BOOL)writeToPath:(NSString *)dstFilePath
 {
-    NSError *error;
-    BOOL success = [[NSFileManager defaultManager] copyItemAtPath:self.filePath toPath:dstFilePath error:&error];
-    if (!success || error) {
-        return NO;
-    } else {
-        return YES;
+    @synchronized(self)
+    {
+        // If we own the file (eg. a recording or export in the temporary directory) then it would be
+        // deleted once this data source is released, so move it rather than copying the content and
+        // point this data source at the new location instead
+        if (self.shouldDeleteOnDeallocation) {
+            NSError *moveError;
+            BOOL didMove =
+                [[NSFileManager defaultManager] moveItemAtPath:self.filePath toPath:dstFilePath error:&moveError];
+
+            if (didMove && !moveError) {
+                self.filePath = dstFilePath;
+                self.shouldDeleteOnDeallocation = NO;
+                return YES;
+            }
+        }
+
+        NSError *error;
+        BOOL success = [[NSFileManager defaultManager] copyItemAtPath:self.filePath toPath:dstFilePath error:&error];
+        if (!success || error) {
+            return NO;
+        } else {
+            return YES;
+        }
     }
 }
 
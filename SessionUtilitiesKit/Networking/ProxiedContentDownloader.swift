@@ -4,6 +4,7 @@
 
 import Foundation
 import ObjectiveC
+import CryptoSwift
 
 // Stills should be loaded before full GIFs.
 public enum ProxiedContentRequestPriority {
@@ -51,8 +52,11 @@ public class ProxiedContentAssetSegment: NSObject {
     public let index: UInt
     public let segmentStart: UInt
     public let segmentLength: UInt
-    // The amount of the segment that is overlap.  
+    // The amount of the segment that is overlap.
     // The overlap lies in the _first_ n bytes of the segment data.
+    //
+    // The overlapping bytes are identical to those of the previous
+    // segment so they can safely be written to the file again.
     public let redundantLength: UInt
 
     // This state should only be accessed on the main thread.
@@ -60,9 +64,8 @@ public class ProxiedContentAssetSegment: NSObject {
 
     // This state is accessed off the main thread.
     //
-    // * During downloads it will be accessed on the task delegate queue.
-    // * After downloads it will be accessed on a worker queue. 
-    private var segmentData = Data()
+    // During downloads it will be accessed on the task delegate queue.
+    private var bytesReceived: UInt = 0
 
     // This state should only be accessed on the main thread.
     public weak var task: URLSessionDataTask?
@@ -78,35 +81,24 @@ public class ProxiedContentAssetSegment: NSObject {
     }
 
     public func totalDataSize() -> UInt {
-        return UInt(segmentData.count)
+        return bytesReceived
     }
 
-    public func append(data: Data) {
+    // Writes the data directly into the asset file at the segment's offset.
+    //
+    // Returns false if the data couldn't be written.
+    public func append(data: Data, to assetRequest: ProxiedContentAssetRequest) -> Bool {
         guard state == .downloading else {
-            return
+            return true
         }
-
-        segmentData.append(data)
-    }
-
-    public func mergeData(assetData: inout Data) -> Bool {
-        guard state == .complete else {
+        guard bytesReceived + UInt(data.count) <= segmentLength else {
             return false
         }
-        guard UInt(segmentData.count) == segmentLength else {
+        guard assetRequest.write(data: data, atOffset: segmentStart + bytesReceived) else {
             return false
         }
 
-        // In some cases the last two segments will overlap.
-        // In that case, we only want to append the non-overlapping
-        // tail of the segment data.
-        let bytesToIgnore = Int(redundantLength)
-        if bytesToIgnore > 0 {
-            let subdata = segmentData.subdata(in: bytesToIgnore..<Int(segmentLength))
-            assetData.append(subdata)
-        } else {
-            assetData.append(segmentData)
-        }
+        bytesReceived += UInt(data.count)
         return true
     }
 }
@@ -144,11 +136,24 @@ public class ProxiedContentAssetRequest: NSObject {
     
     var shouldIgnoreSignalProxy = false
     var wasCancelled = false
-    // This property is an internal implementation detail of the download process.
-    var assetFilePath: String?
+
+    // The descriptor of the (preallocated) file which segments are written to.
+    //
+    // This state is accessed off the main thread so is guarded by a lock.
+    private let fileDescriptor = Atomic<Int32?>(nil)
 
     // This state should only be accessed on the main thread.
     private var segments = [ProxiedContentAssetSegment]()
+    // Segments are moved out of this list as they start downloading so the
+    // next segment can be found without scanning every segment; it's
+    // stored in reverse order so that segments are popped in order.
+    private var waitingSegments = [ProxiedContentAssetSegment]()
+    private var downloadingSegmentCount: UInt = 0
+    public private(set) var completedSegmentIndexes = Set<UInt>()
+    public private(set) var initialSegmentLength: UInt = 0
+    // The ETag or Last-Modified date of the version of the asset being
+    // downloaded; this is set before any segments are requested.
+    public fileprivate(set) var validator: String?
     public var state: ProxiedContentAssetRequestState = .waiting
     public var contentLength: Int = 0 {
         didSet {
@@ -192,26 +197,24 @@ public class ProxiedContentAssetRequest: NSObject {
         return contentLength
     }
 
-    fileprivate func createSegments(withInitialData initialData: Data) {
+    // The segment layout is determined by the content length and the length
+    // of the initial segment so a resumed download will produce the same
+    // segments as the original one.
+    fileprivate func createSegments(initialSegmentLength: UInt, completedSegmentIndexes: Set<UInt>) {
         let segmentLength = segmentSize()
         guard segmentLength > 0 else {
             return
         }
         let contentLength = UInt(self.contentLength)
+        self.initialSegmentLength = initialSegmentLength
 
         // Make the initial segment.
-        let assetSegment = ProxiedContentAssetSegment(index: 0,
-                                                      segmentStart: 0,
-                                                      segmentLength: UInt(initialData.count),
-                                                      redundantLength: 0)
-        // "Download" the initial segment using the initialData.
-        assetSegment.state = .downloading
-        assetSegment.append(data: initialData)
-        // Mark the initial segment as complete.
-        assetSegment.state = .complete
-        segments.append(assetSegment)
-
-        var nextSegmentStart = UInt(initialData.count)
+        segments.append(ProxiedContentAssetSegment(index: 0,
+                                                   segmentStart: 0,
+                                                   segmentLength: initialSegmentLength,
+                                                   redundantLength: 0))
+
+        var nextSegmentStart = initialSegmentLength
         var index: UInt = 1
         while nextSegmentStart < contentLength {
             var segmentStart: UInt = nextSegmentStart
@@ -230,78 +233,110 @@ public class ProxiedContentAssetRequest: NSObject {
             nextSegmentStart = segmentStart + segmentLength
             index += 1
         }
-    }
 
-    private func firstSegmentWithState(state: ProxiedContentAssetSegmentState) -> ProxiedContentAssetSegment? {
         for segment in segments {
-            guard segment.state != .failed else {
-                continue
-            }
-            if segment.state == state {
-                return segment
+            if completedSegmentIndexes.contains(segment.index) {
+                segment.state = .complete
+                self.completedSegmentIndexes.insert(segment.index)
+            } else {
+                waitingSegments.append(segment)
             }
         }
-        return nil
+        waitingSegments.reverse()
     }
 
     public func firstWaitingSegment() -> ProxiedContentAssetSegment? {
-        return firstSegmentWithState(state: .waiting)
+        return waitingSegments.last
     }
 
     public func downloadingSegmentsCount() -> UInt {
-        var result: UInt = 0
-        for segment in segments {
-            guard segment.state != .failed else {
-                continue
-            }
-            if segment.state == .downloading {
-                result += 1
-            }
-        }
-        return result
+        return downloadingSegmentCount
     }
 
     public func areAllSegmentsComplete() -> Bool {
-        for segment in segments {
-            guard segment.state == .complete else {
-                return false
-            }
+        return !segments.isEmpty && completedSegmentIndexes.count == segments.count
+    }
+
+    fileprivate func popWaitingSegment() -> ProxiedContentAssetSegment? {
+        guard let segment = waitingSegments.popLast() else {
+            return nil
         }
-        return true
+
+        segment.state = .downloading
+        downloadingSegmentCount += 1
+        return segment
     }
 
-    public func writeAssetToFile(downloadFolderPath: String) -> ProxiedContentAsset? {
+    fileprivate func segmentDidComplete(_ segment: ProxiedContentAssetSegment) {
+        guard segment.state == .downloading else {
+            return
+        }
 
-        var assetData = Data()
-        for segment in segments {
-            guard segment.state == .complete else {
-                return nil
-            }
-            guard segment.totalDataSize() > 0 else {
-                return nil
-            }
-            guard segment.mergeData(assetData: &assetData) else {
-                return nil
-            }
+        segment.state = .complete
+        downloadingSegmentCount -= 1
+        completedSegmentIndexes.insert(segment.index)
+    }
+
+    fileprivate func segmentDidFail(_ segment: ProxiedContentAssetSegment) {
+        if segment.state == .downloading {
+            downloadingSegmentCount -= 1
         }
+        segment.state = .failed
+    }
 
-        guard assetData.count == contentLength else {
-            return nil
+    // MARK: File
+
+    fileprivate func openFile(atPath filePath: String) -> Bool {
+        let descriptor = open(filePath, O_WRONLY)
+        guard descriptor >= 0 else {
+            return false
         }
 
-        guard assetData.count > 0 else {
-            return nil
+        fileDescriptor.mutate { fileDescriptor in
+            if let oldDescriptor = fileDescriptor {
+                close(oldDescriptor)
+            }
+            fileDescriptor = descriptor
         }
+        return true
+    }
 
-        let fileExtension = assetDescription.fileExtension
-        let fileName = (NSUUID().uuidString as NSString).appendingPathExtension(fileExtension)!
-        let filePath = (downloadFolderPath as NSString).appendingPathComponent(fileName)
-        do {
-            try assetData.write(to: NSURL.fileURL(withPath: filePath), options: .atomicWrite)
-            let asset = ProxiedContentAsset(assetDescription: assetDescription, filePath: filePath)
-            return asset
-        } catch {
-            return nil
+    // Segments may be written concurrently so we use pwrite (which doesn't
+    // depend on the file offset) and hold the lock so the file can't be
+    // closed mid-write.
+    fileprivate func write(data: Data, atOffset offset: UInt) -> Bool {
+        return fileDescriptor.mutate { fileDescriptor -> Bool in
+            guard let fileDescriptor = fileDescriptor else {
+                return false
+            }
+
+            return data.withUnsafeBytes { buffer -> Bool in
+                guard let baseAddress = buffer.baseAddress else {
+                    return true
+                }
+
+                var bytesWritten = 0
+                while bytesWritten < buffer.count {
+                    let result = pwrite(fileDescriptor,
+                                        baseAddress + bytesWritten,
+                                        buffer.count - bytesWritten,
+                                        off_t(offset) + off_t(bytesWritten))
+                    guard result > 0 else {
+                        return false
+                    }
+                    bytesWritten += result
+                }
+                return true
+            }
+        }
+    }
+
+    fileprivate func closeFile() {
+        fileDescriptor.mutate { fileDescriptor in
+            if let descriptor = fileDescriptor {
+                close(descriptor)
+            }
+            fileDescriptor = nil
         }
     }
 
@@ -313,6 +348,7 @@ public class ProxiedContentAssetRequest: NSObject {
             segment.task?.cancel()
             segment.task = nil
         }
+        closeFile()
 
         // Don't call the callbacks if the request is cancelled.
         clearCallbacks()
@@ -342,9 +378,9 @@ public class ProxiedContentAssetRequest: NSObject {
 
 // Represents a downloaded asset.
 //
-// The blob on disk is cleaned up when this instance is deallocated,
-// so consumers of this resource should retain a strong reference to
-// this instance as long as they are using the asset.
+// The blob on disk is owned by the ProxiedContentCache, assets which were
+// loaded from the cache are pinned for as long as they exist so their file
+// won't be evicted while it may still be displayed.
 @objc
 public class ProxiedContentAsset: NSObject {
 
@@ -354,24 +390,455 @@ public class ProxiedContentAsset: NSObject {
     @objc
     public let filePath: String
 
+    // The cache which has pinned the file, if any.
+    private let cache: ProxiedContentCache?
+
     init(assetDescription: ProxiedContentAssetDescription,
-         filePath: String) {
+         filePath: String,
+         pinnedIn cache: ProxiedContentCache? = nil) {
         self.assetDescription = assetDescription
         self.filePath = filePath
+        self.cache = cache
     }
 
     deinit {
-        // Clean up on the asset on disk.
-        let filePathCopy = filePath
-        DispatchQueue.global().async {
+        cache?.unpin(assetDescription: assetDescription)
+    }
+}
+
+// MARK: -
+
+// A size-bounded cache of downloaded assets which persists across launches.
+//
+// Assets are stored in the caches directory (so iOS can purge them if the
+// device is low on storage) and are named using a hash of their url so the
+// urls themselves are never written to disk. The content length of a
+// completed asset is included in its file name and is used to validate
+// the file before it's used.
+//
+// Partially downloaded assets are preallocated to their full length and
+// stored alongside a record of which segments have completed (and the
+// ETag or Last-Modified date of the version being downloaded) so that the
+// download can be resumed.
+//
+// The index of completed assets is kept in memory behind a lock so lookups
+// never need to wait for file operations on the queue.
+public class ProxiedContentCache: NSObject {
+
+    struct PartialDownload: Codable {
+        let contentLength: Int
+        let initialSegmentLength: UInt
+        // The ETag or Last-Modified date of the asset, this is used to
+        // ensure every segment comes from the same version of the asset.
+        let validator: String?
+        var completedSegmentIndexes: Set<UInt>
+    }
+
+    private struct Entry {
+        let filePath: String
+        let size: Int
+        var lastAccessDate: Date
+    }
+
+    private struct State {
+        var entries = [String: Entry]()
+        var totalSize: Int = 0
+        // The number of assets which currently reference each file.
+        var pinCounts = [String: Int]()
+    }
+
+    // Animated GIFs will usually be less than 3 MB.
+    static let defaultMaxCacheSize: Int = 100 * 1024 * 1024
+    private static let maxPartialDownloadAge: TimeInterval = 24 * 60 * 60
+    private static let partialRecordExtension = "partial"
+
+    private let assetsFolderPath: String
+    private let partialFolderPath: String
+    private let maxCacheSize: Int
+    // When the cache is trimmed it's trimmed below the max size so we
+    // don't need to trim after every download.
+    private let trimmedCacheSize: Int
+
+    // File operations are performed on the queue.
+    private let queue = DispatchQueue(label: "ProxiedContentCache.queue", qos: .userInitiated)
+    private let state = Atomic(State())
+
+    init(folderPath: String, maxCacheSize: Int = ProxiedContentCache.defaultMaxCacheSize) {
+        self.assetsFolderPath = (folderPath as NSString).appendingPathComponent("assets")
+        self.partialFolderPath = (folderPath as NSString).appendingPathComponent("partial")
+        self.maxCacheSize = maxCacheSize
+        self.trimmedCacheSize = (maxCacheSize / 5) * 4
+
+        super.init()
+
+        queue.async {
+            OWSFileSystem.ensureDirectoryExists(self.assetsFolderPath)
+            OWSFileSystem.ensureDirectoryExists(self.partialFolderPath)
+
+            // Don't back up ProxiedContent downloads.
+            OWSFileSystem.protectFileOrFolder(atPath: folderPath)
+
+            self.loadEntries()
+        }
+    }
+
+    // MARK: Completed Assets
+
+    // Returns the asset if it has been completely downloaded, the returned
+    // asset pins the file until it's deallocated.
+    //
+    // This is safe to call from the main thread.
+    public func asset(for assetDescription: ProxiedContentAssetDescription) -> ProxiedContentAsset? {
+        let key = ProxiedContentCache.key(for: assetDescription)
+        let now = Date()
+        let maybeEntry: Entry? = state.mutate { state in
+            guard let entry = state.entries[key] else {
+                return nil
+            }
+
+            state.entries[key]?.lastAccessDate = now
+            state.pinCounts[key, default: 0] += 1
+            return entry
+        }
+
+        guard let entry = maybeEntry else {
+            return nil
+        }
+
+        // Ensure the file hasn't been removed (eg. if iOS purged the caches directory).
+        guard OWSFileSystem.fileSize(ofPath: entry.filePath)?.intValue == entry.size else {
+            unpin(assetDescription: assetDescription)
+            queue.async { self.removeEntry(forKey: key, filePath: entry.filePath) }
+            return nil
+        }
+
+        updateModificationDate(now, ofFileAtPath: entry.filePath)
+        return ProxiedContentAsset(assetDescription: assetDescription, filePath: entry.filePath, pinnedIn: self)
+    }
+
+    func unpin(assetDescription: ProxiedContentAssetDescription) {
+        let key = ProxiedContentCache.key(for: assetDescription)
+        let shouldTrim: Bool = state.mutate { state in
+            let pinCount = ((state.pinCounts[key] ?? 0) - 1)
+            state.pinCounts[key] = (pinCount > 0 ? pinCount : nil)
+
+            // Files may have been kept while they were pinned.
+            return (pinCount <= 0 && state.totalSize > maxCacheSize)
+        }
+
+        if shouldTrim {
+            queue.async { self.trimIfNecessary() }
+        }
+    }
+
+    // MARK: Partial Downloads
+
+    // Returns the partially downloaded file for the asset along with its record
+    // if the file is still valid.
+    //
+    // Downloads without a validator can't be resumed as there is no way to
+    // know whether the asset has changed since they were started.
+    func partialDownload(for assetDescription: ProxiedContentAssetDescription) -> (filePath: String, record: PartialDownload)? {
+        let key = ProxiedContentCache.key(for: assetDescription)
+
+        return queue.sync {
+            let filePath = partialFilePath(forKey: key, fileExtension: assetDescription.fileExtension)
+
+            guard
+                let record = readRecord(forKey: key),
+                record.validator != nil,
+                OWSFileSystem.fileSize(ofPath: filePath)?.intValue == record.contentLength
+            else {
+                removePartialDownload(forKey: key, fileExtension: assetDescription.fileExtension)
+                return nil
+            }
+
+            return (filePath, record)
+        }
+    }
+
+    // Creates a file preallocated to the content length of the asset so
+    // segments can be written directly to their offsets.
+    //
+    // If another request is already downloading the same version of the
+    // asset then its record is returned so this request can continue with
+    // the same segment layout (rather than discarding the completed segments).
+    func prepareDownload(for assetDescription: ProxiedContentAssetDescription,
+                         contentLength: Int,
+                         initialSegmentLength: UInt,
+                         validator: String?) -> (filePath: String, record: PartialDownload)? {
+        let key = ProxiedContentCache.key(for: assetDescription)
+
+        return queue.sync {
+            let filePath = partialFilePath(forKey: key, fileExtension: assetDescription.fileExtension)
+            let hasValidFile = (OWSFileSystem.fileSize(ofPath: filePath)?.intValue == contentLength)
+
+            if hasValidFile,
+                let existingRecord = readRecord(forKey: key),
+                existingRecord.contentLength == contentLength,
+                existingRecord.validator == validator {
+                return (filePath, existingRecord)
+            }
+
+            // The bytes of a different version of the asset can't be reused.
+            guard FileManager.default.createFile(atPath: filePath, contents: nil) else {
+                return nil
+            }
+            guard truncate(filePath, off_t(contentLength)) == 0 else {
+                OWSFileSystem.deleteFileIfExists(filePath)
+                return nil
+            }
+
+            let record = PartialDownload(contentLength: contentLength,
+                                         initialSegmentLength: initialSegmentLength,
+                                         validator: validator,
+                                         completedSegmentIndexes: [])
+            guard writeRecord(record, forKey: key) else {
+                return nil
+            }
+            return (filePath, record)
+        }
+    }
+
+    // Records the segments which have been written to the partially downloaded file.
+    func updatePartialDownload(for assetDescription: ProxiedContentAssetDescription,
+                               initialSegmentLength: UInt,
+                               validator: String?,
+                               completedSegmentIndexes: Set<UInt>) {
+        let key = ProxiedContentCache.key(for: assetDescription)
+
+        queue.async {
+            guard
+                var record = self.readRecord(forKey: key),
+                record.initialSegmentLength == initialSegmentLength,
+                record.validator == validator
+            else {
+                // The download was restarted by another request for a
+                // different version of the asset.
+                return
+            }
+
+            record.completedSegmentIndexes.formUnion(completedSegmentIndexes)
+            self.writeRecord(record, forKey: key)
+        }
+    }
+
+    // Discards a partially downloaded file (eg. if the asset has changed).
+    func removePartialDownload(for assetDescription: ProxiedContentAssetDescription) {
+        let key = ProxiedContentCache.key(for: assetDescription)
+
+        queue.async {
+            self.removePartialDownload(forKey: key, fileExtension: assetDescription.fileExtension)
+        }
+    }
+
+    // Moves a partially downloaded file into the cache once it's complete.
+    func completeDownload(for assetDescription: ProxiedContentAssetDescription, contentLength: Int) -> ProxiedContentAsset? {
+        let key = ProxiedContentCache.key(for: assetDescription)
+
+        // The asset is pinned before the queue is released so it can't be evicted before it's returned.
+        let filePath: String? = queue.sync {
+            // Another request for the same asset may have already completed it.
+            let existingFilePath: String? = state.mutate { state in
+                guard let entry = state.entries[key], entry.size == contentLength else {
+                    return nil
+                }
+
+                state.entries[key]?.lastAccessDate = Date()
+                state.pinCounts[key, default: 0] += 1
+                return entry.filePath
+            }
+            if let existingFilePath = existingFilePath {
+                return existingFilePath
+            }
+
+            let partialFilePath = self.partialFilePath(forKey: key, fileExtension: assetDescription.fileExtension)
+            guard contentLength > 0, OWSFileSystem.fileSize(ofPath: partialFilePath)?.intValue == contentLength else {
+                return nil
+            }
+
+            let fileName = ("\(key)-\(contentLength)" as NSString).appendingPathExtension(assetDescription.fileExtension)!
+            let filePath = (assetsFolderPath as NSString).appendingPathComponent(fileName)
             do {
-                let fileManager = FileManager.default
-                try fileManager.removeItem(atPath: filePathCopy)
+                OWSFileSystem.deleteFileIfExists(filePath)
+                try FileManager.default.moveItem(atPath: partialFilePath, toPath: filePath)
             } catch {
+                return nil
+            }
+            OWSFileSystem.deleteFileIfExists(partialRecordPath(forKey: key))
+
+            // Replace any previous version of the asset.
+            if let oldEntry = state.wrappedValue.entries[key] {
+                removeEntry(forKey: key, filePath: oldEntry.filePath)
+            }
+            state.mutate { state in
+                state.entries[key] = Entry(filePath: filePath, size: contentLength, lastAccessDate: Date())
+                state.totalSize += contentLength
+                state.pinCounts[key, default: 0] += 1
+            }
+            trimIfNecessary()
+            return filePath
+        }
+
+        return filePath.map { ProxiedContentAsset(assetDescription: assetDescription, filePath: $0, pinnedIn: self) }
+    }
+
+    // MARK: Internal
+
+    private static func key(for assetDescription: ProxiedContentAssetDescription) -> String {
+        return Data((assetDescription.url.absoluteString ?? "").utf8).sha256().toHexString()
+    }
 
+    private func partialFilePath(forKey key: String, fileExtension: String) -> String {
+        return (partialFolderPath as NSString).appendingPathComponent((key as NSString).appendingPathExtension(fileExtension)!)
+    }
+
+    private func partialRecordPath(forKey key: String) -> String {
+        return (partialFolderPath as NSString).appendingPathComponent((key as NSString).appendingPathExtension(ProxiedContentCache.partialRecordExtension)!)
+    }
+
+    private func readRecord(forKey key: String) -> PartialDownload? {
+        guard let data = try? Data(contentsOf: URL(fileURLWithPath: partialRecordPath(forKey: key))) else {
+            return nil
+        }
+
+        return try? JSONDecoder().decode(PartialDownload.self, from: data)
+    }
+
+    @discardableResult
+    private func writeRecord(_ record: PartialDownload, forKey key: String) -> Bool {
+        do {
+            try JSONEncoder().encode(record).write(to: URL(fileURLWithPath: partialRecordPath(forKey: key)), options: .atomic)
+            return true
+        } catch {
+            return false
+        }
+    }
+
+    private func removePartialDownload(forKey key: String, fileExtension: String) {
+        OWSFileSystem.deleteFileIfExists(partialFilePath(forKey: key, fileExtension: fileExtension))
+        OWSFileSystem.deleteFileIfExists(partialRecordPath(forKey: key))
+    }
+
+    // The modification date is used to restore the access order on launch.
+    private func updateModificationDate(_ date: Date, ofFileAtPath filePath: String) {
+        queue.async {
+            try? FileManager.default.setAttributes([.modificationDate: date], ofItemAtPath: filePath)
+        }
+    }
+
+    // This should only be called on the queue.
+    private func removeEntry(forKey key: String, filePath: String) {
+        let didRemove: Bool = state.mutate { state in
+            // The entry may have been replaced by a newer version of the asset.
+            guard let entry = state.entries[key], entry.filePath == filePath else {
+                return false
             }
+
+            state.entries[key] = nil
+            state.totalSize -= entry.size
+            return true
+        }
+
+        if didRemove {
+            OWSFileSystem.deleteFileIfExists(filePath)
         }
     }
+
+    // This should only be called on the queue.
+    private func loadEntries() {
+        let fileManager = FileManager.default
+        let resourceKeys: [URLResourceKey] = [.fileSizeKey, .contentModificationDateKey]
+
+        let assetUrls = (try? fileManager.contentsOfDirectory(at: URL(fileURLWithPath: assetsFolderPath),
+                                                             includingPropertiesForKeys: resourceKeys)) ?? []
+        var loadedEntries = [String: Entry]()
+        for url in assetUrls {
+            // File names have the form "<key>-<content length>.<extension>".
+            let components = url.deletingPathExtension().lastPathComponent.components(separatedBy: "-")
+            guard
+                components.count == 2,
+                let contentLength = Int(components[1]),
+                let values = try? url.resourceValues(forKeys: Set(resourceKeys)),
+                values.fileSize == contentLength
+            else {
+                // Discard any files which are truncated or unrecognised.
+                try? fileManager.removeItem(at: url)
+                continue
+            }
+
+            let entry = Entry(filePath: url.path,
+                              size: contentLength,
+                              lastAccessDate: (values.contentModificationDate ?? Date()))
+
+            // Only keep the most recently used version of an asset.
+            if let otherEntry = loadedEntries[components[0]] {
+                guard otherEntry.lastAccessDate < entry.lastAccessDate else {
+                    try? fileManager.removeItem(at: url)
+                    continue
+                }
+
+                OWSFileSystem.deleteFileIfExists(otherEntry.filePath)
+            }
+            loadedEntries[components[0]] = entry
+        }
+
+        state.mutate { state in
+            // Any assets downloaded while loading take priority.
+            loadedEntries.forEach { key, entry in
+                guard state.entries[key] == nil else {
+                    return
+                }
+
+                state.entries[key] = entry
+                state.totalSize += entry.size
+            }
+        }
+
+        // Discard any partial downloads which are unlikely to be resumed.
+        let partialUrls = (try? fileManager.contentsOfDirectory(at: URL(fileURLWithPath: partialFolderPath),
+                                                               includingPropertiesForKeys: resourceKeys)) ?? []
+        let cutoffDate = Date().addingTimeInterval(-ProxiedContentCache.maxPartialDownloadAge)
+        for url in partialUrls {
+            let modificationDate = (try? url.resourceValues(forKeys: [.contentModificationDateKey]))?.contentModificationDate
+
+            if (modificationDate ?? .distantPast) < cutoffDate {
+                try? fileManager.removeItem(at: url)
+            }
+        }
+
+        trimIfNecessary()
+    }
+
+    // Evicts the least recently used assets once the cache exceeds its max size,
+    // pinned assets may still be displayed so they are never evicted.
+    //
+    // This should only be called on the queue.
+    private func trimIfNecessary() {
+        let evictedEntries: [Entry] = state.mutate { state in
+            guard state.totalSize > maxCacheSize else {
+                return []
+            }
+
+            var evictedEntries = [Entry]()
+            let sortedEntries = state.entries.sorted { lhs, rhs in lhs.value.lastAccessDate < rhs.value.lastAccessDate }
+            for (key, entry) in sortedEntries {
+                guard state.totalSize > trimmedCacheSize else {
+                    break
+                }
+                guard state.pinCounts[key] == nil else {
+                    continue
+                }
+
+                state.entries[key] = nil
+                state.totalSize -= entry.size
+                evictedEntries.append(entry)
+            }
+            return evictedEntries
+        }
+
+        evictedEntries.forEach { OWSFileSystem.deleteFileIfExists($0.filePath) }
+    }
 }
 
 // MARK: -
@@ -411,15 +878,18 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
 
     private let downloadFolderName: String
 
-    private var downloadFolderPath: String?
+    private let cache: ProxiedContentCache
 
     // Force usage as a singleton
     public required init(downloadFolderName: String) {
         self.downloadFolderName = downloadFolderName
+        self.cache = ProxiedContentCache(
+            folderPath: (OWSFileSystem.cachesDirectoryPath() as NSString).appendingPathComponent(downloadFolderName)
+        )
 
         super.init()
 
-        ensureDownloadFolder()
+        removeLegacyDownloadFolder()
     }
 
     deinit {
@@ -453,14 +923,6 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
         return session
     }()
 
-    // 100 entries of which at least half will probably be stills.
-    // Actual animated GIFs will usually be less than 3 MB so the
-    // max size of the cache on disk should be ~150 MB.  Bear in mind
-    // that assets are not always deleted on disk as soon as they are
-    // evacuated from the cache; if a cache consumer (e.g. view) is
-    // still using the asset, the asset won't be deleted on disk until
-    // it is no longer in use.
-    private var assetMap = LRUCache<NSURL, ProxiedContentAsset>(maxSize: 100)
     // TODO: We could use a proper queue, e.g. implemented with a linked
     // list.
     private var assetRequestQueue = [ProxiedContentAssetRequest]()
@@ -474,7 +936,7 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
                              success:@escaping ((ProxiedContentAssetRequest?, ProxiedContentAsset) -> Void),
                              failure:@escaping ((ProxiedContentAssetRequest) -> Void),
                              shouldIgnoreSignalProxy: Bool = false) -> ProxiedContentAssetRequest? {
-        if let asset = assetMap.get(key: assetDescription.url) {
+        if let asset = cache.asset(for: assetDescription) {
             // Synchronous cache hit.
             success(nil, asset)
             return nil
@@ -504,7 +966,13 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
 
     private func segmentRequestDidSucceed(assetRequest: ProxiedContentAssetRequest, assetSegment: ProxiedContentAssetSegment) {
         DispatchQueue.main.async {
-            assetSegment.state = .complete
+            assetRequest.segmentDidComplete(assetSegment)
+
+            // Record the progress so the download can be resumed if it's interrupted.
+            self.cache.updatePartialDownload(for: assetRequest.assetDescription,
+                                             initialSegmentLength: assetRequest.initialSegmentLength,
+                                             validator: assetRequest.validator,
+                                             completedSegmentIndexes: assetRequest.completedSegmentIndexes)
 
             if !self.tryToCompleteRequest(assetRequest: assetRequest) {
                 self.processRequestQueueSync()
@@ -519,15 +987,14 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
         }
 
         // If the asset request has completed all of its segments,
-        // try to write the asset to file.
+        // the file is complete and can be moved into the cache.
         assetRequest.state = .complete
+        assetRequest.closeFile()
 
-        // Move write off main thread.
+        // Move file operations off main thread.
         DispatchQueue.global().async {
-            guard let downloadFolderPath = self.downloadFolderPath else {
-                return
-            }
-            guard let asset = assetRequest.writeAssetToFile(downloadFolderPath: downloadFolderPath) else {
+            guard let asset = self.cache.completeDownload(for: assetRequest.assetDescription,
+                                                          contentLength: assetRequest.contentLength) else {
                 self.segmentRequestDidFail(assetRequest: assetRequest)
                 return
             }
@@ -538,7 +1005,6 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
 
     private func assetRequestDidSucceed(assetRequest: ProxiedContentAssetRequest, asset: ProxiedContentAsset) {
         DispatchQueue.main.async {
-            self.assetMap.set(key: assetRequest.assetDescription.url, value: asset)
             self.removeAssetRequestFromQueue(assetRequest: assetRequest)
             assetRequest.requestDidSucceed(asset: asset)
         }
@@ -547,7 +1013,7 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
     private func segmentRequestDidFail(assetRequest: ProxiedContentAssetRequest, assetSegment: ProxiedContentAssetSegment? = nil) {
         DispatchQueue.main.async {
             if let assetSegment = assetSegment {
-                assetSegment.state = .failed
+                assetRequest.segmentDidFail(assetSegment)
 
                 // TODO: If we wanted to implement segment retry, we'd do so here.
                 //       For now, we just fail the entire asset request.
@@ -560,6 +1026,9 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
     private func assetRequestDidFail(assetRequest: ProxiedContentAssetRequest) {
 
         DispatchQueue.main.async {
+            // Any completed segments remain in the partially downloaded
+            // file so a later request can resume from them.
+            assetRequest.closeFile()
             self.removeAssetRequestFromQueue(assetRequest: assetRequest)
             assetRequest.requestDidFail()
         }
@@ -602,7 +1071,7 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
             return
         }
 
-        if let asset = assetMap.get(key: assetRequest.assetDescription.url) {
+        if let asset = cache.asset(for: assetRequest.assetDescription) {
             // Deferred cache hit, avoids re-downloading assets that were
             // downloaded while this request was queued.
 
@@ -611,6 +1080,23 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
             return
         }
 
+        if assetRequest.state == .waiting,
+            let partialDownload = cache.partialDownload(for: assetRequest.assetDescription),
+            assetRequest.openFile(atPath: partialDownload.filePath) {
+            // Resume a previous download of this asset; we already know the
+            // content length so there is no need to request it.
+            assetRequest.contentLength = partialDownload.record.contentLength
+            assetRequest.validator = partialDownload.record.validator
+            assetRequest.createSegments(initialSegmentLength: partialDownload.record.initialSegmentLength,
+                                        completedSegmentIndexes: partialDownload.record.completedSegmentIndexes)
+            assetRequest.state = .active
+
+            if !tryToCompleteRequest(assetRequest: assetRequest) {
+                processRequestQueueSync()
+            }
+            return
+        }
+
         if assetRequest.state == .waiting {
             // If asset request hasn't yet determined the resource size,
             // try to do so now, by requesting a small initial segment.
@@ -647,16 +1133,20 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
         } else {
             // Start a download task.
 
-            guard let assetSegment = assetRequest.firstWaitingSegment() else {
+            guard let assetSegment = assetRequest.popWaitingSegment() else {
                 print("queued asset request does not have a waiting segment.")
                 return
             }
-            assetSegment.state = .downloading
 
             var request = URLRequest(url: assetRequest.assetDescription.url as URL)
             request.httpShouldUsePipelining = true
             let rangeHeaderValue = "bytes=\(assetSegment.segmentStart)-\(assetSegment.segmentStart + assetSegment.segmentLength - 1)"
             request.addValue(rangeHeaderValue, forHTTPHeaderField: "Range")
+            // Only return the range if the asset hasn't changed since the
+            // other segments were downloaded.
+            if let validator = assetRequest.validator {
+                request.addValue(validator, forHTTPHeaderField: "If-Range")
+            }
 
             guard ContentProxy.configureProxiedRequest(request: &request) else {
                 assetRequest.state = .failed
@@ -731,16 +1221,45 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
             self.assetRequestDidFail(assetRequest: assetRequest)
             return
         }
-        guard contentLength > 0 else {
+        guard contentLength > 0, data.count <= contentLength else {
             print("Asset size response has invalid content length.")
             assetRequest.state = .failed
             self.assetRequestDidFail(assetRequest: assetRequest)
             return
         }
 
+        // Write the initial segment into a file preallocated to the full
+        // content length; the remaining segments will be written directly
+        // into this file at their offsets.
+        //
+        // If another request is already downloading the same version of
+        // the asset then we continue with its segment layout, the bytes
+        // of the initial segment will be identical so can be written anyway.
+        let validator = ProxiedContentDownloader.validator(for: httpResponse)
+        guard let (filePath, record) = cache.prepareDownload(for: assetRequest.assetDescription,
+                                                             contentLength: contentLength,
+                                                             initialSegmentLength: UInt(data.count),
+                                                             validator: validator),
+            assetRequest.openFile(atPath: filePath),
+            assetRequest.write(data: data, atOffset: 0) else {
+            print("Couldn't create file for asset.")
+            assetRequest.state = .failed
+            self.assetRequestDidFail(assetRequest: assetRequest)
+            return
+        }
+        let initialSegmentLength = record.initialSegmentLength
+        let completedSegmentIndexes = record.completedSegmentIndexes
+            .union(UInt(data.count) >= initialSegmentLength ? [0] : [])
+        cache.updatePartialDownload(for: assetRequest.assetDescription,
+                                    initialSegmentLength: initialSegmentLength,
+                                    validator: validator,
+                                    completedSegmentIndexes: completedSegmentIndexes)
+
         DispatchQueue.main.async {
             assetRequest.contentLength = contentLength
-            assetRequest.createSegments(withInitialData: data)
+            assetRequest.validator = validator
+            assetRequest.createSegments(initialSegmentLength: initialSegmentLength,
+                                        completedSegmentIndexes: completedSegmentIndexes)
             assetRequest.state = .active
 
             if !self.tryToCompleteRequest(assetRequest: assetRequest) {
@@ -749,6 +1268,24 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
         }
     }
 
+    // Returns the strong ETag or Last-Modified date of the response, these
+    // can be used to determine whether the asset has changed.
+    fileprivate static func validator(for response: HTTPURLResponse) -> String? {
+        var headers = [String: String]()
+        for (key, value) in response.allHeaderFields {
+            guard let key = key as? String, let value = value as? String else {
+                continue
+            }
+            headers[key.lowercased()] = value
+        }
+
+        // Weak ETags can't be used with "If-Range".
+        if let etag = headers["etag"], !etag.hasPrefix("W/") {
+            return etag
+        }
+        return headers["last-modified"]
+    }
+
     // Return the first asset request for which we either:
     //
     // * Need to download the content length.
@@ -806,6 +1343,19 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
 
     @nonobjc
     public func urlSession(_ session: URLSession, dataTask: URLSessionDataTask, didReceive response: URLResponse, completionHandler: @escaping (URLSession.ResponseDisposition) -> Void) {
+        let assetRequest = dataTask.assetRequest
+
+        // If the asset has changed the server will return the whole asset
+        // (or a different validator) in which case the segments which have
+        // already been downloaded can't be used.
+        if let httpResponse = response as? HTTPURLResponse,
+            (200..<300).contains(httpResponse.statusCode),
+            (httpResponse.statusCode != 206 || ProxiedContentDownloader.validator(for: httpResponse) != assetRequest.validator) {
+            completionHandler(.cancel)
+            cache.removePartialDownload(for: assetRequest.assetDescription)
+            segmentRequestDidFail(assetRequest: assetRequest, assetSegment: dataTask.assetSegment)
+            return
+        }
 
         completionHandler(.allow)
     }
@@ -818,7 +1368,11 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
             segmentRequestDidFail(assetRequest: assetRequest, assetSegment: assetSegment)
             return
         }
-        assetSegment.append(data: data)
+        guard assetSegment.append(data: data, to: assetRequest) else {
+            dataTask.cancel()
+            segmentRequestDidFail(assetRequest: assetRequest, assetSegment: assetSegment)
+            return
+        }
     }
 
     public func urlSession(_ session: URLSession, dataTask: URLSessionDataTask, willCacheResponse proposedResponse: CachedURLResponse, completionHandler: @escaping (CachedURLResponse?) -> Void) {
@@ -857,34 +1411,15 @@ open class ProxiedContentDownloader: NSObject, URLSessionTaskDelegate, URLSessio
         segmentRequestDidSucceed(assetRequest: assetRequest, assetSegment: assetSegment)
     }
 
-    // MARK: Temp Directory
-
-    public func ensureDownloadFolder() {
-        // We write assets to the temporary directory so that iOS can clean them up.
-        // We try to eagerly clean up these assets when they are no longer in use.
-
-        let tempDirPath = OWSTemporaryDirectory()
-        let dirPath = (tempDirPath as NSString).appendingPathComponent(downloadFolderName)
-        do {
-            let fileManager = FileManager.default
+    // MARK: Legacy Directory
 
-            // Try to delete existing folder if necessary.
-            if fileManager.fileExists(atPath: dirPath) {
-                try fileManager.removeItem(atPath: dirPath)
-                downloadFolderPath = dirPath
-            }
-            // Try to create folder if necessary.
-            if !fileManager.fileExists(atPath: dirPath) {
-                try fileManager.createDirectory(atPath: dirPath,
-                                                withIntermediateDirectories: true,
-                                                attributes: nil)
-                downloadFolderPath = dirPath
-            }
+    // Assets used to be written to the temporary directory and deleted
+    // after use; clean up any which were left behind.
+    private func removeLegacyDownloadFolder() {
+        let dirPath = (OWSTemporaryDirectory() as NSString).appendingPathComponent(downloadFolderName)
 
-            // Don't back up ProxiedContent downloads.
-            OWSFileSystem.protectFileOrFolder(atPath: dirPath)
-        } catch {
-            downloadFolderPath = tempDirPath
+        DispatchQueue.global(qos: .utility).async {
+            OWSFileSystem.deleteFileIfExists(dirPath)
         }
     }
 }
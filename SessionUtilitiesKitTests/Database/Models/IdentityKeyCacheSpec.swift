@@ -0,0 +1,183 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+
+import Quick
+import Nimble
+
+@testable import SessionUtilitiesKit
+
+class IdentityKeyCacheSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        var cache: IdentityKeyCache!
+        var databaseQueue: DatabaseQueue!
+        var mockStorage: Storage!
+        
+        describe("an IdentityKeyCache") {
+            beforeEach {
+                databaseQueue = try! DatabaseQueue()
+                cache = IdentityKeyCache()
+                databaseQueue.add(transactionObserver: IdentityKeyCache.Observer(cache: cache), extent: .databaseLifetime)
+                
+                mockStorage = Storage(
+                    customWriter: databaseQueue,
+                    customMigrations: [
+                        SNUtilitiesKit.migrations()
+                    ]
+                )
+            }
+            
+            func storeKeys(_ suffix: String) {
+                mockStorage.write { db in
+                    try Identity(variant: .x25519PublicKey, data: "x25519Public\(suffix)".data(using: .utf8)!).save(db)
+                    try Identity(variant: .x25519PrivateKey, data: "x25519Secret\(suffix)".data(using: .utf8)!).save(db)
+                    try Identity(variant: .ed25519PublicKey, data: "ed25519Public\(suffix)".data(using: .utf8)!).save(db)
+                    try Identity(variant: .ed25519SecretKey, data: "ed25519Secret\(suffix)".data(using: .utf8)!).save(db)
+                }
+            }
+            
+            func secretBytes(_ secureBytes: SecureBytes?) -> [UInt8]? {
+                return secureBytes?.withUnsafeBytes { Array($0) }
+            }
+            
+            // MARK: - when loading
+            context("when loading") {
+                it("loads and caches a complete set of keys") {
+                    storeKeys("1")
+                    
+                    let keys: IdentityKeyCache.Keys? = mockStorage.read { db in cache.keys(db) }
+                    
+                    expect(keys?.x25519PublicKey).to(equal(Array("x25519Public1".utf8)))
+                    expect(secretBytes(keys?.x25519SecretKey)).to(equal(Array("x25519Secret1".utf8)))
+                    expect(keys?.ed25519PublicKey).to(equal(Array("ed25519Public1".utf8)))
+                    expect(secretBytes(keys?.ed25519SecretKey)).to(equal(Array("ed25519Secret1".utf8)))
+                    expect(cache.cachedKeys).toNot(beNil())
+                }
+                
+                it("does not cache an incomplete set of keys") {
+                    mockStorage.write { db in
+                        try Identity(variant: .x25519PublicKey, data: "Test1".data(using: .utf8)!).insert(db)
+                    }
+                    
+                    let keys: IdentityKeyCache.Keys? = mockStorage.read { db in cache.keys(db) }
+                    
+                    expect(keys?.x25519PublicKey).to(equal(Array("Test1".utf8)))
+                    expect(keys?.x25519SecretKey).to(beNil())
+                    expect(cache.cachedKeys).to(beNil())
+                }
+                
+                it("only caches keys loaded from the writer connection") {
+                    let databasePath: String = URL(fileURLWithPath: NSTemporaryDirectory())
+                        .appendingPathComponent("IdentityKeyCacheSpec-\(UUID().uuidString).sqlite")
+                        .path
+                    let databasePool: DatabasePool = try! DatabasePool(path: databasePath)
+                    databasePool.add(transactionObserver: IdentityKeyCache.Observer(cache: cache), extent: .databaseLifetime)
+                    mockStorage = Storage(
+                        customWriter: databasePool,
+                        customMigrations: [
+                            SNUtilitiesKit.migrations()
+                        ]
+                    )
+                    storeKeys("1")
+                    
+                    let readerKeys: IdentityKeyCache.Keys? = try? databasePool.read { db in cache.keys(db) }
+                    
+                    expect(readerKeys?.x25519PublicKey).to(equal(Array("x25519Public1".utf8)))
+                    expect(cache.cachedKeys).to(beNil())
+                    
+                    _ = try? databasePool.write { db in cache.keys(db) }
+                    
+                    expect(cache.cachedKeys?.x25519PublicKey).to(equal(Array("x25519Public1".utf8)))
+                    
+                    try? databasePool.close()
+                    try? FileManager.default.removeItem(atPath: databasePath)
+                }
+            }
+            
+            // MARK: - when invalidating
+            context("when invalidating") {
+                beforeEach {
+                    storeKeys("1")
+                    mockStorage.read { db in _ = cache.keys(db) }
+                }
+                
+                it("clears the cache when explicitly invalidated") {
+                    cache.invalidate()
+                    
+                    expect(cache.cachedKeys).to(beNil())
+                }
+                
+                it("clears the cache when the identity changes") {
+                    storeKeys("2")
+                    
+                    expect(cache.cachedKeys).to(beNil())
+                    expect(mockStorage.read { db in cache.keys(db) }?.x25519PublicKey)
+                        .to(equal(Array("x25519Public2".utf8)))
+                }
+                
+                it("clears the cache when the identity is deleted") {
+                    mockStorage.write { db in _ = try Identity.deleteAll(db) }
+                    
+                    expect(cache.cachedKeys).to(beNil())
+                    expect(mockStorage.read { db in cache.keys(db) }?.x25519PublicKey).to(beNil())
+                }
+                
+                it("does not cache keys while the identity is being changed") {
+                    mockStorage.write { db in
+                        try Identity(variant: .x25519PublicKey, data: "x25519Public2".data(using: .utf8)!).save(db)
+                        
+                        expect(cache.keys(db).x25519PublicKey).to(equal(Array("x25519Public2".utf8)))
+                        expect(cache.cachedKeys).to(beNil())
+                    }
+                }
+                
+                it("clears the cache when a change is rolled back") {
+                    try? databaseQueue.write { db in
+                        try Identity(variant: .x25519PublicKey, data: "x25519Public2".data(using: .utf8)!).save(db)
+                        
+                        throw StorageError.generic
+                    }
+                    
+                    expect(cache.cachedKeys).to(beNil())
+                    expect(mockStorage.read { db in cache.keys(db) }?.x25519PublicKey)
+                        .to(equal(Array("x25519Public1".utf8)))
+                }
+            }
+            
+            // MARK: - when accessed concurrently
+            context("when accessed concurrently") {
+                it("only returns complete sets of keys which were stored") {
+                    storeKeys("0")
+                    
+                    let validPublicKeys: Set<[UInt8]> = Set((0..<5).map { Array("x25519Public\($0)".utf8) })
+                    let results: Atomic<[[UInt8]?]> = Atomic([])
+                    
+                    DispatchQueue.concurrentPerform(iterations: 100) { index in
+                        switch index % 20 {
+                            case 0: storeKeys("\(index / 20)")
+                            case 1: cache.invalidate()
+                            default:
+                                let publicKey: [UInt8]? = (cache.cachedKeys ?? mockStorage.read { db in cache.keys(db) })?
+                                    .x25519PublicKey
+                                results.mutate { $0.append(publicKey) }
+                        }
+                    }
+                    
+                    expect(results.wrappedValue.count).to(equal(90))
+                    expect(results.wrappedValue.allSatisfy { $0.map { validPublicKeys.contains($0) } == true })
+                        .to(beTrue())
+                    
+                    // Once everything has completed the cache should match the database
+                    let finalPublicKey: [UInt8]? = mockStorage.read { db in
+                        try Identity.fetchOne(db, id: .x25519PublicKey)?.data.bytes
+                    }
+                    
+                    expect(mockStorage.read { db in cache.keys(db) }?.x25519PublicKey).to(equal(finalPublicKey))
+                }
+            }
+        }
+    }
+}
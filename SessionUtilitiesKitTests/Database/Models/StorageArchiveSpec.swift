@@ -0,0 +1,227 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+
+import Quick
+import Nimble
+
+@testable import SessionUtilitiesKit
+
+class StorageArchiveSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        let archivePassphrase: Data = "TestArchivePassphrase".data(using: .utf8)!
+        let largeFileData: Data = Data((0..<(1024 * 1024 * 5 / 2)).map { UInt8($0 % 251) })
+        var testDirectory: String!
+        var liveDatabasePath: String!
+        var livePassphrase: Data!
+        var storedKeySpec: Data?
+        var mockStorage: Storage!
+        
+        func databaseQueue(at path: String, passphrase: Data) throws -> DatabaseQueue {
+            var config = Configuration()
+            config.prepareDatabase { db in try Storage.prepareEncryptedDatabase(db, passphrase: passphrase) }
+            
+            return try DatabaseQueue(path: path, configuration: config)
+        }
+        
+        func fetchIdentityValues(at path: String, passphrase: Data) throws -> [String] {
+            let database: DatabaseQueue = try databaseQueue(at: path, passphrase: passphrase)
+            defer { try? database.close() }
+            
+            return try database.read { db in
+                try Identity.fetchAll(db).map { String(data: $0.data, encoding: .utf8) ?? "" }.sorted()
+            }
+        }
+        
+        func fileData(_ path: String) -> Data? {
+            return FileManager.default.contents(atPath: path)
+        }
+        
+        describe("a StorageArchive") {
+            beforeEach {
+                testDirectory = "\(NSTemporaryDirectory())StorageArchiveSpec-\(UUID().uuidString)"
+                liveDatabasePath = "\(testDirectory!)/live/database.sqlite"
+                livePassphrase = try! Storage.rawKeySpecPassphrase(
+                    for: Randomness.generateRandomBytes(Storage.kSQLCipherKeySpecLength)
+                )
+                storedKeySpec = nil
+                
+                try! FileManager.default.createDirectory(atPath: "\(testDirectory!)/live", withIntermediateDirectories: true)
+                try! FileManager.default.createDirectory(
+                    atPath: "\(testDirectory!)/attachments/nested",
+                    withIntermediateDirectories: true
+                )
+                try! "Test".data(using: .utf8)!.write(to: URL(fileURLWithPath: "\(testDirectory!)/attachments/a.txt"))
+                try! Data().write(to: URL(fileURLWithPath: "\(testDirectory!)/attachments/empty"))
+                try! largeFileData.write(to: URL(fileURLWithPath: "\(testDirectory!)/attachments/nested/b.bin"))
+                
+                mockStorage = Storage(
+                    customWriter: try! databaseQueue(at: liveDatabasePath, passphrase: livePassphrase),
+                    customMigrations: [
+                        SNUtilitiesKit.migrations()
+                    ]
+                )
+                mockStorage.databasePassphrase = { livePassphrase }
+                mockStorage.storeDatabaseKeySpec = { keySpec in storedKeySpec = keySpec }
+                mockStorage.write { db in
+                    try Identity(variant: .x25519PublicKey, data: "Exported".data(using: .utf8)!).insert(db)
+                }
+            }
+            
+            afterEach {
+                try? FileManager.default.removeItem(atPath: testDirectory)
+            }
+            
+            func export() {
+                try! StorageArchive.export(
+                    to: "\(testDirectory!)/archive",
+                    passphrase: archivePassphrase,
+                    directories: ["Attachments": "\(testDirectory!)/attachments"],
+                    using: mockStorage
+                )
+                
+                // Change the live database so we can tell whether it was replaced
+                mockStorage.write { db in
+                    try Identity(variant: .x25519PrivateKey, data: "NotExported".data(using: .utf8)!).insert(db)
+                }
+            }
+            
+            func importArchive(passphrase: Data = archivePassphrase) throws {
+                try StorageArchive.importArchive(
+                    from: "\(testDirectory!)/archive",
+                    passphrase: passphrase,
+                    directories: ["Attachments": "\(testDirectory!)/restored"],
+                    using: mockStorage
+                )
+            }
+            
+            // MARK: - when exporting
+            context("when exporting") {
+                it("encrypts the files") {
+                    export()
+                    
+                    let archivedData: Data? = fileData("\(testDirectory!)/archive/files/Attachments/nested/b.bin")
+                    
+                    expect(archivedData).toNot(beNil())
+                    expect(archivedData).toNot(equal(largeFileData))
+                    expect(archivedData?.range(of: largeFileData.prefix(64))).to(beNil())
+                    expect(fileData("\(testDirectory!)/archive/files/Attachments/a.txt")).toNot(equal("Test".data(using: .utf8)))
+                }
+                
+                it("encrypts the database with the archive passphrase") {
+                    export()
+                    
+                    expect {
+                        try fetchIdentityValues(at: "\(testDirectory!)/archive/database.sqlite", passphrase: archivePassphrase)
+                    }.to(equal(["Exported"]))
+                    expect {
+                        try fetchIdentityValues(at: "\(testDirectory!)/archive/database.sqlite", passphrase: livePassphrase)
+                    }.to(throwError())
+                }
+            }
+            
+            // MARK: - when importing
+            context("when importing") {
+                beforeEach {
+                    export()
+                }
+                
+                it("restores the files and the database") {
+                    expect { try importArchive() }.toNot(throwError())
+                    
+                    expect(fileData("\(testDirectory!)/restored/a.txt")).to(equal("Test".data(using: .utf8)))
+                    expect(fileData("\(testDirectory!)/restored/empty")).to(equal(Data()))
+                    expect(fileData("\(testDirectory!)/restored/nested/b.bin")).to(equal(largeFileData))
+                    expect(storedKeySpec?.count).to(equal(Int(Storage.kSQLCipherKeySpecLength)))
+                    expect {
+                        try fetchIdentityValues(
+                            at: liveDatabasePath,
+                            passphrase: try Storage.rawKeySpecPassphrase(for: storedKeySpec ?? Data())
+                        )
+                    }.to(equal(["Exported"]))
+                    expect(FileManager.default.fileExists(atPath: "\(liveDatabasePath!).backup")).to(beFalse())
+                    expect(FileManager.default.fileExists(atPath: "\(testDirectory!)/archive/database.sqlite.import"))
+                        .to(beFalse())
+                    expect(mockStorage.isValid).to(beFalse())
+                }
+                
+                it("does not write anything when the passphrase is wrong") {
+                    expect { try importArchive(passphrase: "Wrong".data(using: .utf8)!) }.to(throwError())
+                    
+                    expect(FileManager.default.fileExists(atPath: "\(testDirectory!)/restored")).to(beFalse())
+                    expect(storedKeySpec).to(beNil())
+                    expect(mockStorage.isValid).to(beTrue())
+                    expect(try? fetchIdentityValues(at: liveDatabasePath, passphrase: livePassphrase))
+                        .to(equal(["Exported", "NotExported"]))
+                }
+                
+                it("rejects a manifest containing a path outside of it's directory") {
+                    let manifestUrl: URL = URL(fileURLWithPath: "\(testDirectory!)/archive/\(StorageArchive.manifestFileName)")
+                    let manifest: StorageArchive.Manifest = try! JSONDecoder().decode(
+                        StorageArchive.Manifest.self,
+                        from: Data(contentsOf: manifestUrl)
+                    )
+                    let updatedManifest: StorageArchive.Manifest = StorageArchive.Manifest(
+                        version: manifest.version,
+                        createdTimestampMs: manifest.createdTimestampMs,
+                        databaseSize: manifest.databaseSize,
+                        fileKeySalt: manifest.fileKeySalt,
+                        chunkSize: manifest.chunkSize,
+                        files: manifest.files + [
+                            StorageArchive.Manifest.FileInfo(directory: "Attachments", relativePath: "../escaped", size: 4)
+                        ]
+                    )
+                    try! JSONEncoder().encode(updatedManifest).write(to: manifestUrl)
+                    
+                    expect { try importArchive() }.to(throwError(StorageError.decodingFailed))
+                    expect(FileManager.default.fileExists(atPath: "\(testDirectory!)/restored")).to(beFalse())
+                    expect(FileManager.default.fileExists(atPath: "\(testDirectory!)/escaped")).to(beFalse())
+                    expect(storedKeySpec).to(beNil())
+                }
+                
+                it("resumes a partially imported file from the last complete chunk") {
+                    let partialPath: String = "\(testDirectory!)/restored/nested/b.bin.import-partial"
+                    try! FileManager.default.createDirectory(
+                        atPath: "\(testDirectory!)/restored/nested",
+                        withIntermediateDirectories: true
+                    )
+                    try! (largeFileData.prefix(1024 * 1024) + Data(repeating: 0, count: 100))
+                        .write(to: URL(fileURLWithPath: partialPath))
+                    
+                    expect { try importArchive() }.toNot(throwError())
+                    
+                    expect(fileData("\(testDirectory!)/restored/nested/b.bin")).to(equal(largeFileData))
+                    expect(FileManager.default.fileExists(atPath: partialPath)).to(beFalse())
+                }
+                
+                it("replaces a staged database left by a previous attempt") {
+                    // A previous attempt could have already re-keyed the staged database
+                    let stagedPath: String = "\(testDirectory!)/archive/database.sqlite.import"
+                    try! FileManager.default.copyItem(atPath: "\(testDirectory!)/archive/database.sqlite", toPath: stagedPath)
+                    try! databaseQueue(at: stagedPath, passphrase: archivePassphrase)
+                        .writeWithoutTransaction { db in try db.changePassphrase("OtherPassphrase") }
+                    
+                    expect { try importArchive() }.toNot(throwError())
+                    expect {
+                        try fetchIdentityValues(
+                            at: liveDatabasePath,
+                            passphrase: try Storage.rawKeySpecPassphrase(for: storedKeySpec ?? Data())
+                        )
+                    }.to(equal(["Exported"]))
+                }
+                
+                it("keeps the existing database if the new key can't be stored") {
+                    mockStorage.storeDatabaseKeySpec = { _ in throw StorageError.invalidKeySpec }
+                    
+                    expect { try importArchive() }.to(throwError(StorageError.invalidKeySpec))
+                    expect(try? fetchIdentityValues(at: liveDatabasePath, passphrase: livePassphrase))
+                        .to(equal(["Exported", "NotExported"]))
+                    expect(FileManager.default.fileExists(atPath: "\(liveDatabasePath!).backup")).to(beFalse())
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,134 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+import GRDB
+
+import Quick
+import Nimble
+
+@testable import SessionUtilitiesKit
+
+class StorageExportSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        let exportPassphrase: Data = "TestExportPassphrase".data(using: .utf8)!
+        let rowCount: Int = 2048
+        let rowData: Data = Data((0..<4096).map { UInt8($0 % 251) })
+        var testDirectory: String!
+        var exportPath: String!
+        var livePassphrase: Data!
+        var mockStorage: Storage!
+        
+        func encryptedConfiguration(passphrase: Data) -> Configuration {
+            var config = Configuration()
+            config.prepareDatabase { db in try Storage.prepareEncryptedDatabase(db, passphrase: passphrase) }
+            
+            return config
+        }
+        
+        /// Run an export in the background while writing to the database, returns the longest time a write took to complete while
+        /// the export was running and the number of writes
+        func exportWhileWriting() -> (maxWriteLatency: TimeInterval, writeCount: Int) {
+            let isExporting: Atomic<Bool> = Atomic(true)
+            var maxWriteLatency: TimeInterval = 0
+            var writeCount: Int = 0
+            
+            DispatchQueue.global(qos: .userInitiated).async {
+                try? mockStorage.exportDatabase(to: exportPath, passphrase: exportPassphrase)
+                isExporting.mutate { $0 = false }
+            }
+            
+            repeat {
+                let startTime: TimeInterval = Date().timeIntervalSince1970
+                mockStorage.write { db in
+                    try db.execute(sql: "INSERT INTO exportTest (data) VALUES (?)", arguments: [rowData])
+                }
+                maxWriteLatency = max(maxWriteLatency, (Date().timeIntervalSince1970 - startTime))
+                writeCount += 1
+            } while isExporting.wrappedValue
+            
+            return (maxWriteLatency, writeCount)
+        }
+        
+        describe("a Storage export") {
+            beforeEach {
+                testDirectory = "\(NSTemporaryDirectory())StorageExportSpec-\(UUID().uuidString)"
+                exportPath = "\(testDirectory!)/export.sqlite"
+                livePassphrase = try! Storage.rawKeySpecPassphrase(
+                    for: Randomness.generateRandomBytes(Storage.kSQLCipherKeySpecLength)
+                )
+                
+                try! FileManager.default.createDirectory(atPath: testDirectory, withIntermediateDirectories: true)
+                
+                // Note: A pool is used so the export reads from a separate connection to the writer like it does in the app
+                mockStorage = Storage(
+                    customWriter: try! DatabasePool(
+                        path: "\(testDirectory!)/database.sqlite",
+                        configuration: encryptedConfiguration(passphrase: livePassphrase)
+                    ),
+                    customMigrations: [
+                        SNUtilitiesKit.migrations()
+                    ]
+                )
+                mockStorage.databasePassphrase = { livePassphrase }
+                mockStorage.write { db in
+                    try db.execute(sql: "CREATE TABLE exportTest (id INTEGER PRIMARY KEY, data BLOB)")
+                    
+                    try (0..<rowCount).forEach { _ in
+                        try db.execute(sql: "INSERT INTO exportTest (data) VALUES (?)", arguments: [rowData])
+                    }
+                }
+            }
+            
+            afterEach {
+                try? FileManager.default.removeItem(atPath: testDirectory)
+            }
+            
+            // MARK: - when exporting
+            context("when exporting") {
+                it("copies the database in multiple steps") {
+                    var progressValues: [(completed: Int, total: Int)] = []
+                    
+                    try? mockStorage.exportDatabase(to: exportPath, passphrase: exportPassphrase) { completed, total in
+                        progressValues.append((completed, total))
+                    }
+                    
+                    expect(progressValues.count).to(beGreaterThan(1))
+                    expect(progressValues.last?.completed).to(equal(progressValues.last?.total))
+                    expect {
+                        try DatabaseQueue(path: exportPath, configuration: encryptedConfiguration(passphrase: exportPassphrase))
+                            .read { db in try Int.fetchOne(db, sql: "SELECT COUNT(*) FROM exportTest") }
+                    }.to(equal(rowCount))
+                }
+                
+                it("copies the database at a reasonable rate") {
+                    let databaseSize: Double = Double(rowCount * rowData.count)
+                    let startTime: TimeInterval = Date().timeIntervalSince1970
+                    try? mockStorage.exportDatabase(to: exportPath, passphrase: exportPassphrase)
+                    let duration: TimeInterval = (Date().timeIntervalSince1970 - startTime)
+                    
+                    // Note: This is a very conservative throughput (in bytes per second) so it only fails if the export
+                    // is stalling, the yielding between steps should add at most 'exportMaxYieldRatio' to the duration
+                    expect(databaseSize / duration).to(beGreaterThan(1024 * 1024))
+                }
+                
+                it("doesn't block the writer while copying") {
+                    let result: (maxWriteLatency: TimeInterval, writeCount: Int) = exportWhileWriting()
+                    
+                    expect(result.writeCount).to(beGreaterThan(0))
+                    expect(result.maxWriteLatency).to(beLessThan(0.25))
+                }
+                
+                it("includes the data from before the export started") {
+                    _ = exportWhileWriting()
+                    
+                    expect {
+                        try DatabaseQueue(path: exportPath, configuration: encryptedConfiguration(passphrase: exportPassphrase))
+                            .read { db in try Int.fetchOne(db, sql: "SELECT COUNT(*) FROM exportTest") }
+                    }.to(beGreaterThanOrEqualTo(rowCount))
+                }
+            }
+        }
+    }
+}
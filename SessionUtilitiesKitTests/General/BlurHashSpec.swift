@@ -0,0 +1,121 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import UIKit
+
+import Quick
+import Nimble
+
+@testable import SessionUtilitiesKit
+
+class BlurHashSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        describe("a BlurHash") {
+            // MARK: - when validating
+            context("when validating") {
+                it("succeeds for a well formed hash") {
+                    expect(BlurHash.isValid("LEHV6nWB2yk8pyo0adR*.7kCMdnj")).to(beTrue())
+                }
+                
+                it("fails when too short") {
+                    expect(BlurHash.isValid("LEHV6")).to(beFalse())
+                }
+                
+                it("fails when the length doesn't match the number of components") {
+                    expect(BlurHash.isValid("LEHV6nWB2yk8pyo0adR*.7kCMdn")).to(beFalse())
+                }
+                
+                it("fails when it contains invalid characters") {
+                    expect(BlurHash.isValid("LEHV6nWB2yk8pyo0adR*.7kCMd\"j")).to(beFalse())
+                }
+                
+                it("fails when longer than the maximum length") {
+                    expect(BlurHash.isValid("~" + String(repeating: "0", count: BlurHash.maxLength))).to(beFalse())
+                }
+            }
+            
+            // MARK: - when encoding
+            context("when encoding") {
+                it("includes the requested number of components") {
+                    let image: CGImage? = BlurHashSpec.image(red: 10, green: 200, blue: 90)
+                    let hash: String? = image.flatMap { BlurHash.encode(image: $0, components: (5, 2)) }
+                    
+                    expect(hash?.count).to(equal(4 + (2 * 5 * 2)))
+                    expect(hash?.first).to(equal("D"))
+                }
+                
+                it("encodes the average colour") {
+                    let hash: String? = BlurHashSpec.image(red: 255, green: 0, blue: 0)
+                        .flatMap { BlurHash.encode(image: $0) }
+                    
+                    // 0xFF0000 in base83
+                    expect(hash.map { String(Array($0)[2..<6]) }).to(equal("TI:j"))
+                }
+                
+                it("fails with an invalid number of components") {
+                    let image: CGImage? = BlurHashSpec.image(red: 0, green: 0, blue: 0)
+                    
+                    expect(image).toNot(beNil())
+                    expect(image.flatMap { BlurHash.encode(image: $0, components: (0, 3)) }).to(beNil())
+                    expect(image.flatMap { BlurHash.encode(image: $0, components: (4, 10)) }).to(beNil())
+                }
+            }
+            
+            // MARK: - when decoding
+            context("when decoding") {
+                it("produces an image of the requested size") {
+                    let image: UIImage? = BlurHash.decode("LEHV6nWB2yk8pyo0adR*.7kCMdnj", size: CGSize(width: 32, height: 24))
+                    
+                    expect(image?.cgImage?.width).to(equal(32))
+                    expect(image?.cgImage?.height).to(equal(24))
+                }
+                
+                it("fails for an invalid hash") {
+                    expect(BlurHash.decode("LEHV6nWB2yk8", size: CGSize(width: 32, height: 32))).to(beNil())
+                }
+                
+                it("round trips the content of an image") {
+                    let hash: String? = BlurHashSpec.image(red: 30, green: 60, blue: 200)
+                        .flatMap { BlurHash.encode(image: $0) }
+                    let decodedImage: CGImage? = hash
+                        .flatMap { BlurHash.decode($0, size: CGSize(width: 32, height: 32)) }?
+                        .cgImage
+                    let decodedHash: String? = decodedImage.flatMap { BlurHash.encode(image: $0) }
+                    
+                    expect(hash).toNot(beNil())
+                    expect(decodedHash).to(equal(hash))
+                }
+                
+                it("preserves the aspect ratio of the media") {
+                    expect(BlurHash.decodeSize(for: CGSize(width: 1000, height: 500)))
+                        .to(equal(CGSize(width: 32, height: 16)))
+                    expect(BlurHash.decodeSize(for: nil))
+                        .to(equal(CGSize(width: 32, height: 32)))
+                }
+            }
+        }
+    }
+    
+    // MARK: - Convenience
+    
+    private static func image(red: UInt8, green: UInt8, blue: UInt8, size: Int = 16) -> CGImage? {
+        let pixels: [UInt8] = (0..<(size * size)).flatMap { _ in [red, green, blue, 255] }
+        
+        guard let provider: CGDataProvider = CGDataProvider(data: Data(pixels) as CFData) else { return nil }
+        
+        return CGImage(
+            width: size,
+            height: size,
+            bitsPerComponent: 8,
+            bitsPerPixel: 32,
+            bytesPerRow: (size * 4),
+            space: CGColorSpaceCreateDeviceRGB(),
+            bitmapInfo: CGBitmapInfo(rawValue: CGImageAlphaInfo.noneSkipLast.rawValue),
+            provider: provider,
+            decode: nil,
+            shouldInterpolate: false,
+            intent: .defaultIntent
+        )
+    }
+}
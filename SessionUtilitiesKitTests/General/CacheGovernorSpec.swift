@@ -0,0 +1,247 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+
+import Quick
+import Nimble
+
+@testable import SessionUtilitiesKit
+
+class CacheGovernorSpec: QuickSpec {
+    /// A seeded random number generator so the simulation performs the same operations every run
+    struct SplitMix64: RandomNumberGenerator {
+        var state: UInt64
+        
+        mutating func next() -> UInt64 {
+            state &+= 0x9E3779B97F4A7C15
+            var result: UInt64 = state
+            result = (result ^ (result >> 30)) &* 0xBF58476D1CE4E5B9
+            result = (result ^ (result >> 27)) &* 0x94D049BB133111EB
+            
+            return (result ^ (result >> 31))
+        }
+    }
+    
+    /// A cache which stores the cost of it's entries so the governor's bookkeeping can be checked against it
+    class TestCache {
+        let identifier: String
+        var entries: [Int: Int] = [:]
+        var evictions: [String] = []
+        
+        init(identifier: String, priority: CacheGovernor.Priority, governor: CacheGovernor) {
+            self.identifier = identifier
+            
+            governor.register(identifier, priority: priority) { [weak self] keys in
+                keys.compactMap { $0.base as? Int }.forEach { key in
+                    self?.entries[key] = nil
+                    self?.evictions.append("\(identifier).\(key)")
+                }
+            }
+        }
+        
+        var totalCost: Int { entries.values.reduce(0, +) }
+    }
+    
+    struct SimulationResult: Equatable {
+        let metrics: CacheGovernor.Metrics
+        let evictions: [String]
+        let costByCache: [String: Int]
+    }
+    
+    // MARK: - Spec
+    
+    override func spec() {
+        let budget: Int = (1024 * 1024)
+        var governor: CacheGovernor!
+        
+        describe("a CacheGovernor") {
+            beforeEach {
+                governor = CacheGovernor(budget: budget)
+            }
+            
+            // MARK: - when recording entries
+            context("when recording entries") {
+                var cache: TestCache!
+                
+                beforeEach {
+                    cache = TestCache(identifier: "cache", priority: .medium, governor: governor)
+                }
+                
+                it("tracks the cost of the entries") {
+                    governor.recordInsertion(in: "cache", key: 1, cost: 100)
+                    governor.recordInsertion(in: "cache", key: 2, cost: 200)
+                    governor.recordInsertion(in: "cache", key: 1, cost: 50)
+                    
+                    expect(governor.metrics.totalCost).to(equal(250))
+                    expect(governor.metrics.entryCount).to(equal(2))
+                    expect(governor.metrics.costByCache).to(equal(["cache": 250]))
+                }
+                
+                it("stops tracking removed entries") {
+                    governor.recordInsertion(in: "cache", key: 1, cost: 100)
+                    governor.recordInsertion(in: "cache", key: 2, cost: 200)
+                    governor.recordRemoval(in: "cache", key: 1)
+                    
+                    expect(governor.metrics.totalCost).to(equal(200))
+                    
+                    governor.recordRemoveAll(in: "cache")
+                    
+                    expect(governor.metrics.totalCost).to(equal(0))
+                    expect(governor.metrics.entryCount).to(equal(0))
+                }
+                
+                it("ignores entries for unregistered caches") {
+                    governor.recordInsertion(in: "otherCache", key: 1, cost: 100)
+                    
+                    expect(governor.metrics.totalCost).to(equal(0))
+                }
+                
+                it("stops tracking the entries of a cache when it is unregistered") {
+                    governor.recordInsertion(in: "cache", key: 1, cost: 100)
+                    governor.unregister("cache")
+                    
+                    expect(governor.metrics.totalCost).to(equal(0))
+                    expect(governor.metrics.costByCache).to(equal([:]))
+                    expect(cache.evictions).to(beEmpty())
+                }
+                
+                it("evicts the least recently accessed entries when the budget is exceeded") {
+                    (0..<4).forEach { key in
+                        cache.entries[key] = (budget / 4)
+                        governor.recordInsertion(in: "cache", key: key, cost: (budget / 4))
+                    }
+                    governor.recordAccess(in: "cache", key: 0)
+                    
+                    cache.entries[4] = (budget / 4)
+                    governor.recordInsertion(in: "cache", key: 4, cost: (budget / 4))
+                    
+                    expect(cache.evictions).to(equal(["cache.1", "cache.2"]))
+                    expect(governor.metrics.totalCost).to(beLessThanOrEqualTo(budget))
+                }
+                
+                it("evicts an entry which is larger than the budget") {
+                    cache.entries[1] = (budget + 1)
+                    governor.recordInsertion(in: "cache", key: 1, cost: (budget + 1))
+                    
+                    expect(cache.evictions).to(equal(["cache.1"]))
+                    expect(governor.metrics.totalCost).to(equal(0))
+                }
+            }
+            
+            // MARK: - when receiving memory pressure
+            context("when receiving memory pressure") {
+                var lowPriorityCache: TestCache!
+                var highPriorityCache: TestCache!
+                
+                beforeEach {
+                    lowPriorityCache = TestCache(identifier: "low", priority: .low, governor: governor)
+                    highPriorityCache = TestCache(identifier: "high", priority: .high, governor: governor)
+                    
+                    (0..<8).forEach { key in
+                        lowPriorityCache.entries[key] = (budget / 16)
+                        governor.recordInsertion(in: "low", key: key, cost: (budget / 16))
+                        highPriorityCache.entries[key] = (budget / 16)
+                        governor.recordInsertion(in: "high", key: key, cost: (budget / 16))
+                    }
+                }
+                
+                it("trims the caches rather than clearing them") {
+                    governor.handle(.warning)
+                    
+                    expect(governor.metrics.totalCost).to(beLessThanOrEqualTo(budget / 2))
+                    expect(governor.metrics.entryCount).to(beGreaterThan(0))
+                    expect(governor.metrics.pressureEventCount).to(equal(1))
+                }
+                
+                it("evicts from lower priority caches first") {
+                    governor.handle(.warning)
+                    
+                    expect(highPriorityCache.entries.count).to(equal(8))
+                    expect(lowPriorityCache.entries).to(beEmpty())
+                }
+                
+                it("trims further for critical pressure") {
+                    governor.handle(.critical)
+                    
+                    expect(governor.metrics.totalCost).to(beLessThanOrEqualTo(Int(Double(budget) * 0.2)))
+                    expect(highPriorityCache.entries.count).to(beGreaterThan(0))
+                }
+                
+                it("keeps most of the entries when entering the background") {
+                    governor.handle(.background)
+                    
+                    expect(governor.metrics.totalCost).to(beLessThanOrEqualTo(Int(Double(budget) * 0.75)))
+                    expect(highPriorityCache.entries.count).to(equal(8))
+                }
+            }
+            
+            // MARK: - when simulating app usage
+            context("when simulating app usage") {
+                func simulate(seed: UInt64) -> SimulationResult {
+                    var generator: SplitMix64 = SplitMix64(state: seed)
+                    let governor: CacheGovernor = CacheGovernor(budget: budget)
+                    let caches: [TestCache] = [
+                        TestCache(identifier: "avatars", priority: .high, governor: governor),
+                        TestCache(identifier: "linkPreviews", priority: .medium, governor: governor),
+                        TestCache(identifier: "assets", priority: .low, governor: governor)
+                    ]
+                    
+                    for step in 0..<5000 {
+                        let cache: TestCache = caches[Int.random(in: 0..<caches.count, using: &generator)]
+                        let key: Int = Int.random(in: 0..<200, using: &generator)
+                        
+                        switch Int.random(in: 0..<10, using: &generator) {
+                            case 0..<4:
+                                let cost: Int = Int.random(in: 1...(64 * 1024), using: &generator)
+                                cache.entries[key] = cost
+                                governor.recordInsertion(in: cache.identifier, key: key, cost: cost)
+                            
+                            case 4..<9:
+                                guard cache.entries[key] != nil else { break }
+                                
+                                governor.recordAccess(in: cache.identifier, key: key)
+                            
+                            default:
+                                cache.entries[key] = nil
+                                governor.recordRemoval(in: cache.identifier, key: key)
+                        }
+                        
+                        if step % 1000 == 999 {
+                            governor.handle(.warning)
+                            expect(governor.metrics.totalCost).to(beLessThanOrEqualTo(budget / 2))
+                        }
+                        
+                        // The governor's bookkeeping should always match the caches and stay within the budget
+                        expect(governor.metrics.totalCost).to(beLessThanOrEqualTo(budget))
+                        expect(governor.metrics.totalCost).to(equal(caches.map { $0.totalCost }.reduce(0, +)))
+                    }
+                    
+                    return SimulationResult(
+                        metrics: governor.metrics,
+                        evictions: caches.flatMap { $0.evictions },
+                        costByCache: Dictionary(uniqueKeysWithValues: caches.map { ($0.identifier, $0.totalCost) })
+                    )
+                }
+                
+                it("stays within the budget and matches the caches") {
+                    let result: SimulationResult = simulate(seed: 1234)
+                    
+                    expect(result.metrics.costByCache).to(equal(result.costByCache))
+                    expect(result.metrics.evictionCount).to(equal(result.evictions.count))
+                    expect(result.metrics.evictionCount).to(beGreaterThan(0))
+                    expect(result.metrics.pressureEventCount).to(equal(5))
+                }
+                
+                it("favours the higher priority caches") {
+                    let result: SimulationResult = simulate(seed: 1234)
+                    
+                    expect(result.costByCache["avatars"]).to(beGreaterThan(result.costByCache["assets"] ?? 0))
+                }
+                
+                it("produces the same evictions for the same operations") {
+                    expect(simulate(seed: 5678)).to(equal(simulate(seed: 5678)))
+                }
+            }
+        }
+    }
+}
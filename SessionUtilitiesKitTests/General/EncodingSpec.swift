@@ -0,0 +1,101 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+
+import Quick
+import Nimble
+
+@testable import SessionUtilitiesKit
+
+class EncodingSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        let testData: [[UInt8]] = (0..<50).map { length in (0..<length).map { _ in UInt8.random(in: 0...UInt8.max) } }
+        
+        // MARK: - Hex
+        describe("Hex") {
+            it("encodes to lowercase hex") {
+                expect(Hex.encodedString([0x00, 0x01, 0xAB, 0xFF])).to(equal("0001abff"))
+                expect(Hex.encodedString(Data())).to(equal(""))
+            }
+            
+            it("matches the String(format:) encoding") {
+                testData.forEach { bytes in
+                    expect(Hex.encodedString(bytes)).to(equal(bytes.map { String(format: "%02x", $0) }.joined()))
+                }
+            }
+            
+            it("decodes both lowercase and uppercase hex") {
+                expect(Hex.decodedBytes("0001abff")).to(equal([0x00, 0x01, 0xAB, 0xFF]))
+                expect(Hex.decodedBytes("0001ABFF")).to(equal([0x00, 0x01, 0xAB, 0xFF]))
+                expect(Hex.decodedBytes("")).to(equal([]))
+            }
+            
+            it("round trips arbitrary data") {
+                testData.forEach { bytes in
+                    expect(Hex.decodedBytes(Hex.encodedString(bytes))).to(equal(bytes))
+                }
+            }
+            
+            it("fails to decode invalid hex") {
+                expect(Hex.decodedBytes("abc")).to(beNil())
+                expect(Hex.decodedBytes("0g")).to(beNil())
+                expect(Hex.decodedBytes("0 ")).to(beNil())
+                expect(Hex.decodedBytes("ab\u{00e9}")).to(beNil())
+            }
+            
+            it("decodes into a caller-provided buffer") {
+                var output: [UInt8] = [UInt8](repeating: 0, count: 2)
+                let result: Bool = output.withUnsafeMutableBytes { Hex.decode("abcd", into: $0) }
+                
+                expect(result).to(beTrue())
+                expect(output).to(equal([0xAB, 0xCD]))
+            }
+            
+            it("fails to decode into a buffer of the wrong size") {
+                var output: [UInt8] = [UInt8](repeating: 0, count: 3)
+                let result: Bool = output.withUnsafeMutableBytes { Hex.decode("abcd", into: $0) }
+                
+                expect(result).to(beFalse())
+            }
+            
+            it("validates hex strings") {
+                expect(Hex.isValid("0123456789abcdefABCDEF")).to(beTrue())
+                expect(Hex.isValid("0x12")).to(beFalse())
+            }
+        }
+        
+        // MARK: - Base64
+        describe("Base64") {
+            it("matches the Foundation encoding") {
+                testData.forEach { bytes in
+                    expect(Base64.encodedString(bytes)).to(equal(Data(bytes).base64EncodedString()))
+                }
+            }
+            
+            it("round trips arbitrary data") {
+                testData.forEach { bytes in
+                    expect(Base64.decodedData(Data(bytes).base64EncodedString())).to(equal(Data(bytes)))
+                    expect(Base64.decodedBytes(Base64.encodedString(bytes))).to(equal(bytes))
+                }
+            }
+            
+            it("fails to decode invalid base64") {
+                ["A", "AB", "ABC", "A===", "A=A=", "AB C", "AB==AB==", "=AAA", "AA=A", "AB\nC"].forEach { string in
+                    expect(Base64.decodedData(string)).to(beNil())
+                }
+            }
+            
+            it("decodes into a caller-provided buffer") {
+                var output: [UInt8] = [UInt8](repeating: 0, count: 3)
+                let result: Bool = Array("TWFu".utf8).withUnsafeBytes { characters in
+                    output.withUnsafeMutableBytes { Base64.decode(characters, into: $0) }
+                }
+                
+                expect(result).to(beTrue())
+                expect(output).to(equal(Array("Man".utf8)))
+            }
+        }
+    }
+}
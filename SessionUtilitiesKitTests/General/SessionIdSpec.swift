@@ -40,6 +40,24 @@ class SessionIdSpec: QuickSpec {
                 }
             }
             
+            it("decodes the public key bytes") {
+                let sessionId: SessionId? = SessionId(from: "05\(TestConstants.publicKey)")
+                
+                expect(sessionId?.publicKeyBytes).to(equal(Data(hex: TestConstants.publicKey).bytes))
+            }
+            
+            it("is equal regardless of the hex string case") {
+                expect(SessionId(from: "05\(TestConstants.publicKey)"))
+                    .to(equal(SessionId(from: "05\(TestConstants.publicKey.uppercased())")))
+                expect(SessionId(from: "05\(TestConstants.publicKey)"))
+                    .toNot(equal(SessionId(from: "15\(TestConstants.publicKey)")))
+            }
+            
+            it("keeps the casing of the id string") {
+                expect(SessionId(from: "05\(TestConstants.publicKey.uppercased())")?.hexString)
+                    .to(equal("05\(TestConstants.publicKey.uppercased())"))
+            }
+            
             it("generates the correct hex string") {
                 expect(SessionId(.unblinded, publicKey: Data(hex: TestConstants.publicKey).bytes).hexString)
                     .to(equal("0088672ccb97f40bb57238989226cf429b575ba355443f47bc76c5ab144a96c65b"))
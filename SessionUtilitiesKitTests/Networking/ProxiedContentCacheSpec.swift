@@ -0,0 +1,191 @@
+// Copyright © 2023 Rangeproof Pty Ltd. All rights reserved.
+
+import Foundation
+
+import Quick
+import Nimble
+
+@testable import SessionUtilitiesKit
+
+class ProxiedContentCacheSpec: QuickSpec {
+    // MARK: - Spec
+    
+    override func spec() {
+        let assetDescription1: ProxiedContentAssetDescription! = ProxiedContentAssetDescription(
+            url: NSURL(string: "https://www.example.com/test1.gif")!
+        )
+        let assetDescription2: ProxiedContentAssetDescription! = ProxiedContentAssetDescription(
+            url: NSURL(string: "https://www.example.com/test2.gif")!
+        )
+        var folderPath: String!
+        var cache: ProxiedContentCache!
+        
+        func download(
+            _ assetDescription: ProxiedContentAssetDescription,
+            contentLength: Int = 60,
+            validator: String? = "\"TestETag\""
+        ) -> ProxiedContentAsset? {
+            _ = cache.prepareDownload(
+                for: assetDescription,
+                contentLength: contentLength,
+                initialSegmentLength: 10,
+                validator: validator
+            )
+            
+            return cache.completeDownload(for: assetDescription, contentLength: contentLength)
+        }
+        
+        describe("a ProxiedContentCache") {
+            beforeEach {
+                folderPath = (NSTemporaryDirectory() as NSString).appendingPathComponent(UUID().uuidString)
+                cache = ProxiedContentCache(folderPath: folderPath, maxCacheSize: 100)
+            }
+            
+            afterEach {
+                cache = nil
+                try? FileManager.default.removeItem(atPath: folderPath)
+            }
+            
+            // MARK: - when retrieving assets
+            context("when retrieving assets") {
+                it("returns a completed asset") {
+                    _ = download(assetDescription1)
+                    
+                    let asset: ProxiedContentAsset? = cache.asset(for: assetDescription1)
+                    expect(asset).toNot(beNil())
+                    expect(asset.map { FileManager.default.fileExists(atPath: $0.filePath) }).to(beTrue())
+                }
+                
+                it("returns nothing for an asset which hasn't been downloaded") {
+                    expect(cache.asset(for: assetDescription1)).to(beNil())
+                }
+                
+                it("returns nothing if the file was removed") {
+                    let filePath: String? = download(assetDescription1)?.filePath
+                    try? FileManager.default.removeItem(atPath: filePath ?? "")
+                    
+                    expect(cache.asset(for: assetDescription1)).to(beNil())
+                }
+                
+                it("loads the completed assets from disk") {
+                    _ = download(assetDescription1)
+                    cache = ProxiedContentCache(folderPath: folderPath, maxCacheSize: 100)
+                    
+                    expect(cache.asset(for: assetDescription1)).toEventuallyNot(beNil())
+                }
+            }
+            
+            // MARK: - when trimming
+            context("when trimming") {
+                it("evicts the least recently used assets") {
+                    _ = download(assetDescription1)
+                    _ = download(assetDescription2)
+                    
+                    expect(cache.asset(for: assetDescription1)).toEventually(beNil())
+                    expect(cache.asset(for: assetDescription2)).toNot(beNil())
+                }
+                
+                it("doesn't evict assets which are in use") {
+                    let asset: ProxiedContentAsset? = download(assetDescription1)
+                    _ = download(assetDescription2)
+                    
+                    expect(cache.asset(for: assetDescription2)).toEventually(beNil())
+                    expect(asset.map { FileManager.default.fileExists(atPath: $0.filePath) }).to(beTrue())
+                    expect(cache.asset(for: assetDescription1)).toNot(beNil())
+                }
+            }
+            
+            // MARK: - when downloading
+            context("when downloading") {
+                it("keeps the progress of another download of the same asset") {
+                    _ = cache.prepareDownload(
+                        for: assetDescription1,
+                        contentLength: 60,
+                        initialSegmentLength: 10,
+                        validator: "\"TestETag\""
+                    )
+                    cache.updatePartialDownload(
+                        for: assetDescription1,
+                        initialSegmentLength: 10,
+                        validator: "\"TestETag\"",
+                        completedSegmentIndexes: [0, 1]
+                    )
+                    
+                    let result = cache.prepareDownload(
+                        for: assetDescription1,
+                        contentLength: 60,
+                        initialSegmentLength: 20,
+                        validator: "\"TestETag\""
+                    )
+                    expect(result?.record.initialSegmentLength).to(equal(10))
+                    expect(result?.record.completedSegmentIndexes).to(equal([0, 1]))
+                }
+                
+                it("restarts the download if the asset has changed") {
+                    _ = cache.prepareDownload(
+                        for: assetDescription1,
+                        contentLength: 60,
+                        initialSegmentLength: 10,
+                        validator: "\"TestETag\""
+                    )
+                    cache.updatePartialDownload(
+                        for: assetDescription1,
+                        initialSegmentLength: 10,
+                        validator: "\"TestETag\"",
+                        completedSegmentIndexes: [0, 1]
+                    )
+                    
+                    let result = cache.prepareDownload(
+                        for: assetDescription1,
+                        contentLength: 60,
+                        initialSegmentLength: 20,
+                        validator: "\"TestETag2\""
+                    )
+                    expect(result?.record.initialSegmentLength).to(equal(20))
+                    expect(result?.record.validator).to(equal("\"TestETag2\""))
+                    expect(result?.record.completedSegmentIndexes).to(beEmpty())
+                }
+                
+                it("ignores progress for a different version of the asset") {
+                    _ = cache.prepareDownload(
+                        for: assetDescription1,
+                        contentLength: 60,
+                        initialSegmentLength: 10,
+                        validator: "\"TestETag\""
+                    )
+                    cache.updatePartialDownload(
+                        for: assetDescription1,
+                        initialSegmentLength: 10,
+                        validator: "\"TestETag2\"",
+                        completedSegmentIndexes: [0, 1]
+                    )
+                    
+                    expect(cache.partialDownload(for: assetDescription1)?.record.completedSegmentIndexes)
+                        .to(beEmpty())
+                }
+                
+                it("resumes a download with a validator") {
+                    _ = cache.prepareDownload(
+                        for: assetDescription1,
+                        contentLength: 60,
+                        initialSegmentLength: 10,
+                        validator: "\"TestETag\""
+                    )
+                    
+                    expect(cache.partialDownload(for: assetDescription1)?.record.validator).to(equal("\"TestETag\""))
+                }
+                
+                it("doesn't resume a download without a validator") {
+                    _ = cache.prepareDownload(
+                        for: assetDescription1,
+                        contentLength: 60,
+                        initialSegmentLength: 10,
+                        validator: nil
+                    )
+                    
+                    expect(cache.partialDownload(for: assetDescription1)).to(beNil())
+                }
+            }
+        }
+    }
+}
@@ -158,7 +158,6 @@ public class ImageEditorBrushViewController: OWSViewController {
             updateNavigationBar()
         }
     }
-    private var currentStrokeSamples = [ImageEditorStrokeItem.StrokeSample]()
 
     @objc
     public func handleBrushGesture(_ gestureRecognizer: ImageEditorPanGestureRecognizer) {
@@ -169,8 +168,9 @@ public class ImageEditorBrushViewController: OWSViewController {
                 self.model.remove(item: stroke)
             }
             self.currentStroke = nil
-            self.currentStrokeSamples.removeAll()
         }
+        // The samples which haven't been added to the current stroke yet.
+        var newSamples = [ImageEditorStrokeItem.StrokeSample]()
         let tryToAppendStrokeSample = { (locationInView: CGPoint) in
             let view = self.canvasView.gestureReferenceView
             let viewBounds = view.bounds
@@ -179,12 +179,12 @@ public class ImageEditorBrushViewController: OWSViewController {
                                                                     model: self.model,
                                                                     transform: self.model.currentTransform())
 
-            if let prevSample = self.currentStrokeSamples.last,
+            if let prevSample = (newSamples.last ?? self.currentStroke?.lastUnitSample),
                 prevSample == newSample {
                 // Ignore duplicate samples.
                 return
             }
-            self.currentStrokeSamples.append(newSample)
+            newSamples.append(newSample)
         }
 
         let strokeColor = paletteView.selectedValue.color
@@ -203,8 +203,8 @@ public class ImageEditorBrushViewController: OWSViewController {
             let locationInView = gestureRecognizer.location(in: canvasView.gestureReferenceView)
             tryToAppendStrokeSample(locationInView)
 
-            let stroke = ImageEditorStrokeItem(color: strokeColor, unitSamples: currentStrokeSamples, unitStrokeWidth: unitStrokeWidth)
-            model.append(item: stroke)
+            let stroke = ImageEditorStrokeItem(color: strokeColor, unitSamples: newSamples, unitStrokeWidth: unitStrokeWidth)
+            model.beginStroke(item: stroke)
             currentStroke = stroke
 
         case .changed, .ended:
@@ -219,13 +219,13 @@ public class ImageEditorBrushViewController: OWSViewController {
 
             // Model items are immutable; we _replace_ the
             // stroke item rather than modify it.
-            let stroke = ImageEditorStrokeItem(itemId: lastStroke.itemId, color: strokeColor, unitSamples: currentStrokeSamples, unitStrokeWidth: unitStrokeWidth)
-            model.replace(item: stroke, suppressUndo: true)
+            let stroke = lastStroke.appending(samples: newSamples)
 
             if gestureRecognizer.state == .ended {
+                model.endStroke(item: stroke)
                 currentStroke = nil
-                currentStrokeSamples.removeAll()
             } else {
+                model.updateInProgressStroke(item: stroke)
                 currentStroke = stroke
             }
         default:
@@ -20,6 +20,218 @@ public class EditorTextLayer: CATextLayer {
 
 // MARK: -
 
+// Strokes are rendered incrementally while they are being drawn.
+//
+// The path is split into "chunks" of segments, each rendered by
+// its own shape layer. Chunks other than the last are never
+// modified again, so appending samples only re-renders the
+// segments of the last chunk rather than the whole stroke.
+public class EditorStrokeLayer: CALayer {
+    private static let segmentsPerChunk: Int = 64
+
+    let itemId: String
+    let imageFrame: CGRect
+
+    private let strokeWidth: CGFloat
+    private let color: UIColor
+    private var activeChunkLayer: CAShapeLayer?
+    private var activeChunkPath = CGMutablePath()
+    private var activeChunkSegmentCount: Int = 0
+    private var finalSegmentCount: Int = 0
+    private var renderedItem: ImageEditorStrokeItem?
+
+    public override var contentsScale: CGFloat {
+        didSet {
+            sublayers?.forEach { $0.contentsScale = contentsScale }
+        }
+    }
+
+    public init(item: ImageEditorStrokeItem,
+                strokeWidth: CGFloat,
+                imageFrame: CGRect,
+                viewSize: CGSize) {
+        self.itemId = item.itemId
+        self.imageFrame = imageFrame
+        self.strokeWidth = strokeWidth
+        self.color = item.color
+
+        super.init()
+
+        self.frame = CGRect(origin: .zero, size: viewSize)
+        update(item: item)
+    }
+
+    @available(*, unavailable, message: "use other init() instead.")
+    required public init?(coder aDecoder: NSCoder) {
+        notImplemented()
+    }
+
+    // Returns true if the item is a newer version of the
+    // stroke this layer has rendered.
+    public func canUpdate(item: ImageEditorStrokeItem, imageFrame: CGRect) -> Bool {
+        guard let renderedItem = renderedItem else {
+            return false
+        }
+        return (
+            renderedItem.sharesSamples(with: item) &&
+            item.sampleCount >= renderedItem.sampleCount &&
+            item.unitStrokeWidth == renderedItem.unitStrokeWidth &&
+            item.color == color &&
+            imageFrame == self.imageFrame
+        )
+    }
+
+    public func update(item: ImageEditorStrokeItem) {
+        let geometry = StrokeGeometry(item: item, imageFrame: imageFrame)
+        let sampleCount = geometry.sampleCount
+        guard sampleCount > 0 else {
+            // Not an error; the stroke doesn't have enough samples to render yet.
+            return
+        }
+
+        if activeChunkPath.isEmpty {
+            activeChunkPath.move(to: geometry.smoothedPoint(at: 0))
+        }
+
+        // Append the segments which can no longer change to the
+        // active chunk, starting a new chunk when it is full.
+        let targetFinalSegmentCount = max(0, sampleCount - 1 - StrokeGeometry.provisionalSegmentCount)
+        while finalSegmentCount < targetFinalSegmentCount {
+            finalSegmentCount += 1
+            geometry.addSegment(endingAt: finalSegmentCount, to: activeChunkPath)
+            activeChunkSegmentCount += 1
+
+            if activeChunkSegmentCount >= EditorStrokeLayer.segmentsPerChunk {
+                chunkLayer().path = activeChunkPath
+                activeChunkLayer = nil
+                activeChunkPath = CGMutablePath()
+                activeChunkPath.move(to: geometry.smoothedPoint(at: finalSegmentCount))
+                activeChunkSegmentCount = 0
+            }
+        }
+
+        // The provisional segments are rebuilt for each update.
+        let path = activeChunkPath.mutableCopy() ?? CGMutablePath()
+        if sampleCount == 1 {
+            path.addLine(to: geometry.smoothedPoint(at: 0))
+        }
+        for index in (finalSegmentCount + 1)..<sampleCount {
+            geometry.addSegment(endingAt: index, to: path)
+        }
+        chunkLayer().path = path
+
+        renderedItem = item
+    }
+
+    private func chunkLayer() -> CAShapeLayer {
+        if let activeChunkLayer = activeChunkLayer {
+            return activeChunkLayer
+        }
+
+        let shapeLayer = CAShapeLayer()
+        shapeLayer.lineWidth = strokeWidth
+        shapeLayer.themeStrokeColorForced = .color(color)
+        shapeLayer.frame = bounds
+        shapeLayer.contentsScale = contentsScale
+        shapeLayer.themeFillColor = nil
+        shapeLayer.lineCap = CAShapeLayerLineCap.round
+        shapeLayer.lineJoin = CAShapeLayerLineJoin.round
+        addSublayer(shapeLayer)
+
+        activeChunkLayer = shapeLayer
+        return shapeLayer
+    }
+}
+
+// MARK: -
+
+// Stroke samples are specified in "image unit" coordinates, but
+// need to be rendered in "canvas" coordinates.  The imageFrame
+// is the bounds of the image specified in "canvas" coordinates,
+// so to transform we can simply convert from image frame units.
+//
+// Each segment only depends on the samples around it, so the
+// segments of a stroke can be built individually.
+private struct StrokeGeometry {
+    // Smoothing a sample depends on the sample after it, and each
+    // segment depends on the smoothed points on either side of it,
+    // so the last segments of a stroke change when samples are
+    // appended.
+    static let provisionalSegmentCount: Int = 2
+
+    // This factor controls how much we're smoothing.
+    //
+    // * 0.0 = No smoothing.
+    //
+    // TODO: Tune this variable once we have stroke input.
+    private static let controlPointFactor: CGFloat = 0.25
+
+    private static let smoothingAlpha: CGFloat = 0.1
+
+    let item: ImageEditorStrokeItem
+    let imageFrame: CGRect
+
+    var sampleCount: Int {
+        return item.sampleCount
+    }
+
+    private func point(at index: Int) -> CGPoint {
+        return item.unitSample(at: index).fromUnitCoordinates(viewBounds: imageFrame)
+    }
+
+    // We apply more than one kind of smoothing.
+    //
+    // This (simple) smoothing reduces jitter from the touch sensor.
+    func smoothedPoint(at index: Int) -> CGPoint {
+        guard index > 0, index < sampleCount - 1 else {
+            // First or last sample.
+            return point(at: index)
+        }
+
+        // Middle samples.
+        let alpha = StrokeGeometry.smoothingAlpha
+        return CGPointAdd(CGPointScale(point(at: index), 1.0 - 2.0 * alpha),
+                          CGPointAdd(CGPointScale(point(at: index - 1), alpha),
+                                     CGPointScale(point(at: index + 1), alpha)))
+    }
+
+    private func forwardVector(at index: Int) -> CGPoint {
+        if sampleCount <= 1 {
+            // Skip forward vectors.
+            return .zero
+        } else if index == 0 {
+            // First sample.
+            return CGPointSubtract(smoothedPoint(at: index + 1), smoothedPoint(at: index))
+        } else if index == sampleCount - 1 {
+            // Last sample.
+            return CGPointSubtract(smoothedPoint(at: index), smoothedPoint(at: index - 1))
+        }
+
+        // Middle samples.
+        let point = smoothedPoint(at: index)
+        let previousPointForwardVector = CGPointSubtract(point, smoothedPoint(at: index - 1))
+        let nextPointForwardVector = CGPointSubtract(smoothedPoint(at: index + 1), point)
+        return CGPointScale(CGPointAdd(previousPointForwardVector, nextPointForwardVector), 0.5)
+    }
+
+    // We apply more than one kind of smoothing.
+    // This smoothing avoids rendering "angled segments"
+    // by drawing the stroke as a series of curves.
+    // We use bezier curves and infer the control points
+    // from the "next" and "prev" points.
+    func addSegment(endingAt index: Int, to path: CGMutablePath) {
+        let previousPoint = smoothedPoint(at: index - 1)
+        let point = smoothedPoint(at: index)
+        let controlPointFactor = StrokeGeometry.controlPointFactor
+        let controlPoint1 = CGPointAdd(previousPoint, CGPointScale(forwardVector(at: index - 1), +controlPointFactor))
+        let controlPoint2 = CGPointAdd(point, CGPointScale(forwardVector(at: index), -controlPointFactor))
+        // We're using Cubic curves.
+        path.addCurve(to: point, control1: controlPoint1, control2: controlPoint2)
+    }
+}
+
+// MARK: -
+
 // A view for previewing an image editor model.
 @objc
 public class ImageEditorCanvasView: UIView {
@@ -208,6 +420,7 @@ public class ImageEditorCanvasView: UIView {
 
                 contentView.layer.addSublayer(layer)
                 contentLayerMap[item.itemId] = layer
+                updateRasterization(forLayer: layer, transform: transform)
             }
         }
 
@@ -227,6 +440,29 @@ public class ImageEditorCanvasView: UIView {
         CATransaction.begin()
         CATransaction.setDisableActions(true)
 
+        let viewSize = clipView.bounds.size
+        let transform = model.currentTransform()
+
+        // Strokes which are being drawn only need to render
+        // their new samples.
+        let changedItemIds = changedItemIds.filter { itemId in
+            guard viewSize.width > 0,
+                viewSize.height > 0,
+                let strokeLayer = contentLayerMap[itemId] as? EditorStrokeLayer,
+                let strokeItem = model.item(forId: itemId) as? ImageEditorStrokeItem else {
+                    return true
+            }
+
+            let imageFrame = ImageEditorCanvasView.imageFrame(forViewSize: viewSize, imageSize: model.srcImageSizePixels, transform: transform)
+            guard strokeLayer.canUpdate(item: strokeItem, imageFrame: imageFrame) else {
+                return true
+            }
+
+            strokeLayer.update(item: strokeItem)
+            updateRasterization(forLayer: strokeLayer, transform: transform)
+            return false
+        }
+
         // Remove all changed items.
         for itemId in changedItemIds {
             if let layer = contentLayerMap[itemId] {
@@ -235,8 +471,6 @@ public class ImageEditorCanvasView: UIView {
             contentLayerMap.removeValue(forKey: itemId)
         }
 
-        let viewSize = clipView.bounds.size
-        let transform = model.currentTransform()
         if viewSize.width > 0,
             viewSize.height > 0 {
 
@@ -261,12 +495,25 @@ public class ImageEditorCanvasView: UIView {
 
                 contentView.layer.addSublayer(layer)
                 contentLayerMap[item.itemId] = layer
+                updateRasterization(forLayer: layer, transform: transform)
             }
         }
 
         CATransaction.commit()
     }
 
+    // Finished strokes are rasterized so that they don't need to
+    // be re-rendered from their paths when the canvas changes.
+    private func updateRasterization(forLayer layer: CALayer, transform: ImageEditorTransform) {
+        guard let strokeLayer = layer as? EditorStrokeLayer else {
+            return
+        }
+
+        let isComplete = !model.isStrokeInProgress(itemId: strokeLayer.itemId)
+        strokeLayer.shouldRasterize = isComplete
+        strokeLayer.rasterizationScale = UIScreen.main.scale * transform.scaling
+    }
+
     private func applyTransform() {
         let viewSize = clipView.bounds.size
         contentView.layer.setAffineTransform(model.currentTransform().affineTransform(viewSize: viewSize))
@@ -387,93 +634,19 @@ public class ImageEditorCanvasView: UIView {
 
         let strokeWidth = ImageEditorStrokeItem.strokeWidth(forUnitStrokeWidth: item.unitStrokeWidth,
                                                             dstSize: viewSize)
-        let unitSamples = item.unitSamples
-        guard unitSamples.count > 0 else {
+        guard item.sampleCount > 0 else {
             // Not an error; the stroke doesn't have enough samples to render yet.
             return nil
         }
 
-        let shapeLayer = CAShapeLayer()
-        shapeLayer.lineWidth = strokeWidth
-        shapeLayer.themeStrokeColorForced = .color(item.color)
-        shapeLayer.frame = CGRect(origin: .zero, size: viewSize)
-
-        // Stroke samples are specified in "image unit" coordinates, but
-        // need to be rendered in "canvas" coordinates.  The imageFrame
-        // is the bounds of the image specified in "canvas" coordinates,
-        // so to transform we can simply convert from image frame units.
         let imageFrame = ImageEditorCanvasView.imageFrame(forViewSize: viewSize, imageSize: model.srcImageSizePixels, transform: transform)
-        let transformSampleToPoint = { (unitSample: CGPoint) -> CGPoint in
-            return unitSample.fromUnitCoordinates(viewBounds: imageFrame)
-        }
-
-        // Use bezier curves to smooth stroke.
-        let bezierPath = UIBezierPath()
+        let strokeLayer = EditorStrokeLayer(item: item,
+                                            strokeWidth: strokeWidth,
+                                            imageFrame: imageFrame,
+                                            viewSize: viewSize)
+        strokeLayer.zPosition = zPositionForItem(item: item, model: model, zPositionBase: brushLayerZ)
 
-        let points = applySmoothing(to: unitSamples.map { (unitSample) in
-            transformSampleToPoint(unitSample)
-        })
-        var previousForwardVector = CGPoint.zero
-        for index in 0..<points.count {
-            let point = points[index]
-
-            let forwardVector: CGPoint
-            if points.count <= 1 {
-                // Skip forward vectors.
-                forwardVector = .zero
-            } else if index == 0 {
-                // First sample.
-                let nextPoint = points[index + 1]
-                forwardVector = CGPointSubtract(nextPoint, point)
-            } else if index == points.count - 1 {
-                // Last sample.
-                let previousPoint = points[index - 1]
-                forwardVector = CGPointSubtract(point, previousPoint)
-            } else {
-                // Middle samples.
-                let previousPoint = points[index - 1]
-                let previousPointForwardVector = CGPointSubtract(point, previousPoint)
-                let nextPoint = points[index + 1]
-                let nextPointForwardVector = CGPointSubtract(nextPoint, point)
-                forwardVector = CGPointScale(CGPointAdd(previousPointForwardVector, nextPointForwardVector), 0.5)
-            }
-
-            if index == 0 {
-                // First sample.
-                bezierPath.move(to: point)
-
-                if points.count == 1 {
-                    bezierPath.addLine(to: point)
-                }
-            } else {
-                let previousPoint = points[index - 1]
-                // We apply more than one kind of smoothing.
-                // This smoothing avoids rendering "angled segments"
-                // by drawing the stroke as a series of curves.
-                // We use bezier curves and infer the control points
-                // from the "next" and "prev" points.
-                //
-                // This factor controls how much we're smoothing.
-                //
-                // * 0.0 = No smoothing.
-                //
-                // TODO: Tune this variable once we have stroke input.
-                let controlPointFactor: CGFloat = 0.25
-                let controlPoint1 = CGPointAdd(previousPoint, CGPointScale(previousForwardVector, +controlPointFactor))
-                let controlPoint2 = CGPointAdd(point, CGPointScale(forwardVector, -controlPointFactor))
-                // We're using Cubic curves.
-                bezierPath.addCurve(to: point, controlPoint1: controlPoint1, controlPoint2: controlPoint2)
-            }
-            previousForwardVector = forwardVector
-        }
-
-        shapeLayer.path = bezierPath.cgPath
-        shapeLayer.themeFillColor = nil
-        shapeLayer.lineCap = CAShapeLayerLineCap.round
-        shapeLayer.lineJoin = CAShapeLayerLineJoin.round
-        shapeLayer.zPosition = zPositionForItem(item: item, model: model, zPositionBase: brushLayerZ)
-
-        return shapeLayer
+        return strokeLayer
     }
 
     private class func zPositionForItem(item: ImageEditorItem,
@@ -555,38 +728,6 @@ public class ImageEditorCanvasView: UIView {
         return layer
     }
 
-    // We apply more than one kind of smoothing.
-    //
-    // This (simple) smoothing reduces jitter from the touch sensor.
-    private class func applySmoothing(to points: [CGPoint]) -> [CGPoint] {
-        AssertIsOnMainThread()
-
-        var result = [CGPoint]()
-
-        for index in 0..<points.count {
-            let point = points[index]
-
-            if index == 0 {
-                // First sample.
-                result.append(point)
-            } else if index == points.count - 1 {
-                // Last sample.
-                result.append(point)
-            } else {
-                // Middle samples.
-                let lastPoint = points[index - 1]
-                let nextPoint = points[index + 1]
-                let alpha: CGFloat = 0.1
-                let smoothedPoint = CGPointAdd(CGPointScale(point, 1.0 - 2.0 * alpha),
-                                               CGPointAdd(CGPointScale(lastPoint, alpha),
-                                                          CGPointScale(nextPoint, alpha)))
-                result.append(smoothedPoint)
-            }
-        }
-
-        return result
-    }
-
     // MARK: - Actions
 
     // Returns nil on error.
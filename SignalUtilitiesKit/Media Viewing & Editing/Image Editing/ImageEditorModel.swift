@@ -59,6 +59,11 @@ public class ImageEditorModel: NSObject {
     private var undoStack = [ImageEditorOperation]()
     private var redoStack = [ImageEditorOperation]()
 
+    // The contents created when the in-progress stroke began;
+    // see updateInProgressStroke(item:).
+    private var inProgressStrokeContents: ImageEditorContents?
+    private var inProgressStrokeItemId: String?
+
     // We don't want to allow editing of images if:
     //
     // * They are invalid.
@@ -187,6 +192,8 @@ public class ImageEditorModel: NSObject {
             return
         }
 
+        endInProgressStroke()
+
         let redoOperation = ImageEditorOperation(contents: contents)
         redoStack.append(redoOperation)
 
@@ -204,6 +211,8 @@ public class ImageEditorModel: NSObject {
             return
         }
 
+        endInProgressStroke()
+
         let undoOperation = ImageEditorOperation(contents: contents)
         undoStack.append(undoOperation)
 
@@ -243,6 +252,68 @@ public class ImageEditorModel: NSObject {
         }, changedItemIds: [item.itemId])
     }
 
+    // MARK: - Strokes
+
+    // Strokes are updated for every touch sample.  Rather than
+    // snapshotting the contents for each sample, the whole stroke
+    // is a single undo operation (recorded when the stroke begins).
+    @objc
+    public func beginStroke(item: ImageEditorStrokeItem) {
+        performAction({ (oldContents) in
+            let newContents = oldContents.clone()
+            newContents.append(item: item)
+
+            // This needs to be set before observers are notified.
+            self.inProgressStrokeContents = newContents
+            self.inProgressStrokeItemId = item.itemId
+            return newContents
+        }, changedItemIds: [item.itemId])
+    }
+
+    // The contents created by beginStroke(item:) aren't referenced
+    // by any undo/redo operation until the stroke ends, so we can
+    // update the stroke in place rather than cloning the contents.
+    @objc
+    public func updateInProgressStroke(item: ImageEditorStrokeItem) {
+        guard updateInProgressStrokeContents(item: item) else {
+            return
+        }
+
+        fireModelDidChange(changedItemIds: [item.itemId])
+    }
+
+    @objc
+    public func endStroke(item: ImageEditorStrokeItem) {
+        guard updateInProgressStrokeContents(item: item) else {
+            return
+        }
+
+        endInProgressStroke()
+        fireModelDidChange(changedItemIds: [item.itemId])
+    }
+
+    @objc
+    public func isStrokeInProgress(itemId: String) -> Bool {
+        return inProgressStrokeItemId == itemId
+    }
+
+    private func updateInProgressStrokeContents(item: ImageEditorStrokeItem) -> Bool {
+        guard let inProgressStrokeContents = inProgressStrokeContents,
+            inProgressStrokeContents === contents,
+            inProgressStrokeItemId == item.itemId else {
+                owsFailDebug("Stroke is not in progress.")
+                return false
+        }
+
+        inProgressStrokeContents.replace(item: item)
+        return true
+    }
+
+    private func endInProgressStroke() {
+        inProgressStrokeContents = nil
+        inProgressStrokeItemId = nil
+    }
+
     @objc
     public func replace(transform: ImageEditorTransform) {
         self.transform = transform
@@ -284,6 +355,8 @@ public class ImageEditorModel: NSObject {
     private func performAction(_ action: (ImageEditorContents) -> ImageEditorContents,
                                changedItemIds: [String]?,
                                suppressUndo: Bool = false) {
+        endInProgressStroke()
+
         if !suppressUndo {
             let undoOperation = ImageEditorOperation(contents: contents)
             undoStack.append(undoOperation)
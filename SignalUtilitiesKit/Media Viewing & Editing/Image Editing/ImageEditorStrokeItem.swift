@@ -13,8 +13,35 @@ public class ImageEditorStrokeItem: ImageEditorItem {
 
     public typealias StrokeSample = ImageEditorSample
 
+    // The samples of a stroke are stored in a buffer which is
+    // shared by each version of the item created while the
+    // stroke is being drawn; each version only "sees" the first
+    // sampleCount samples so appending samples to the buffer
+    // doesn't affect the older (immutable) versions.
+    private class SampleBuffer {
+        var samples: [StrokeSample]
+
+        init(samples: [StrokeSample]) {
+            self.samples = samples
+        }
+    }
+
+    private let sampleBuffer: SampleBuffer
+
+    @objc
+    public let sampleCount: Int
+
     @objc
-    public let unitSamples: [StrokeSample]
+    public var unitSamples: [StrokeSample] {
+        return Array(sampleBuffer.samples[0..<sampleCount])
+    }
+
+    public var lastUnitSample: StrokeSample? {
+        guard sampleCount > 0 else {
+            return nil
+        }
+        return sampleBuffer.samples[sampleCount - 1]
+    }
 
     // Expressed as a "Unit" value as a fraction of
     // min(width, height) of the destination viewport.
@@ -26,7 +53,8 @@ public class ImageEditorStrokeItem: ImageEditorItem {
                 unitSamples: [StrokeSample],
                 unitStrokeWidth: CGFloat) {
         self.color = color
-        self.unitSamples = unitSamples
+        self.sampleBuffer = SampleBuffer(samples: unitSamples)
+        self.sampleCount = unitSamples.count
         self.unitStrokeWidth = unitStrokeWidth
 
         super.init(itemType: .stroke)
@@ -38,12 +66,61 @@ public class ImageEditorStrokeItem: ImageEditorItem {
                 unitSamples: [StrokeSample],
                 unitStrokeWidth: CGFloat) {
         self.color = color
-        self.unitSamples = unitSamples
+        self.sampleBuffer = SampleBuffer(samples: unitSamples)
+        self.sampleCount = unitSamples.count
         self.unitStrokeWidth = unitStrokeWidth
 
         super.init(itemId: itemId, itemType: .stroke)
     }
 
+    private init(itemId: String,
+                 color: UIColor,
+                 sampleBuffer: SampleBuffer,
+                 sampleCount: Int,
+                 unitStrokeWidth: CGFloat) {
+        self.color = color
+        self.sampleBuffer = sampleBuffer
+        self.sampleCount = sampleCount
+        self.unitStrokeWidth = unitStrokeWidth
+
+        super.init(itemId: itemId, itemType: .stroke)
+    }
+
+    public func unitSample(at index: Int) -> StrokeSample {
+        return sampleBuffer.samples[index]
+    }
+
+    // Returns true if both items are versions of the same
+    // in-progress stroke, in which case the samples of
+    // the shorter item are a prefix of the longer one.
+    public func sharesSamples(with other: ImageEditorStrokeItem) -> Bool {
+        return sampleBuffer === other.sampleBuffer
+    }
+
+    // Model items are immutable; rather than modifying a stroke
+    // while it is drawn we create a new version of the item.
+    //
+    // This is O(samples.count) when appending to the latest
+    // version of the stroke as the sample buffer is shared.
+    public func appending(samples: [StrokeSample]) -> ImageEditorStrokeItem {
+        guard sampleBuffer.samples.count == sampleCount else {
+            // A newer version of this stroke has already appended
+            // samples, so we need to copy the samples.
+            return ImageEditorStrokeItem(itemId: itemId,
+                                         color: color,
+                                         unitSamples: unitSamples + samples,
+                                         unitStrokeWidth: unitStrokeWidth)
+        }
+
+        sampleBuffer.samples.append(contentsOf: samples)
+
+        return ImageEditorStrokeItem(itemId: itemId,
+                                     color: color,
+                                     sampleBuffer: sampleBuffer,
+                                     sampleCount: sampleBuffer.samples.count,
+                                     unitStrokeWidth: unitStrokeWidth)
+    }
+
     @objc
     public class func defaultUnitStrokeWidth() -> CGFloat {
         return 0.02
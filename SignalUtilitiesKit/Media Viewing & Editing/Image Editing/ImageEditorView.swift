@@ -374,7 +374,6 @@ public class ImageEditorView: UIView {
 
     // These properties are non-empty while drawing a stroke.
     private var currentStroke: ImageEditorStrokeItem?
-    private var currentStrokeSamples = [ImageEditorStrokeItem.StrokeSample]()
 
     @objc
     public func handleBrushGesture(_ gestureRecognizer: UIGestureRecognizer) {
@@ -385,8 +384,9 @@ public class ImageEditorView: UIView {
                 self.model.remove(item: stroke)
             }
             self.currentStroke = nil
-            self.currentStrokeSamples.removeAll()
         }
+        // The samples which haven't been added to the current stroke yet.
+        var newSamples = [ImageEditorStrokeItem.StrokeSample]()
         let tryToAppendStrokeSample = {
             let view = self.canvasView.gestureReferenceView
             let viewBounds = view.bounds
@@ -396,12 +396,12 @@ public class ImageEditorView: UIView {
                                                               model: self.model,
                                                               transform: self.model.currentTransform())
 
-            if let prevSample = self.currentStrokeSamples.last,
+            if let prevSample = (newSamples.last ?? self.currentStroke?.lastUnitSample),
                 prevSample == newSample {
                 // Ignore duplicate samples.
                 return
             }
-            self.currentStrokeSamples.append(newSample)
+            newSamples.append(newSample)
         }
 
         let strokeColor = currentColor.color
@@ -414,8 +414,8 @@ public class ImageEditorView: UIView {
 
             tryToAppendStrokeSample()
 
-            let stroke = ImageEditorStrokeItem(color: strokeColor, unitSamples: currentStrokeSamples, unitStrokeWidth: unitStrokeWidth)
-            model.append(item: stroke)
+            let stroke = ImageEditorStrokeItem(color: strokeColor, unitSamples: newSamples, unitStrokeWidth: unitStrokeWidth)
+            model.beginStroke(item: stroke)
             currentStroke = stroke
 
         case .changed, .ended:
@@ -429,13 +429,13 @@ public class ImageEditorView: UIView {
 
             // Model items are immutable; we _replace_ the
             // stroke item rather than modify it.
-            let stroke = ImageEditorStrokeItem(itemId: lastStroke.itemId, color: strokeColor, unitSamples: currentStrokeSamples, unitStrokeWidth: unitStrokeWidth)
-            model.replace(item: stroke, suppressUndo: true)
+            let stroke = lastStroke.appending(samples: newSamples)
 
             if gestureRecognizer.state == .ended {
+                model.endStroke(item: stroke)
                 currentStroke = nil
-                currentStrokeSamples.removeAll()
             } else {
+                model.updateInProgressStroke(item: stroke)
                 currentStroke = stroke
             }
         default:
@@ -10,6 +10,7 @@ public enum AppSetup {
     private static var hasRun: Bool = false
     
     public static func setupEnvironment(
+        prewarmReaderCount: Int = Storage.defaultPrewarmReaderCount,
         appSpecificBlock: @escaping () -> (),
         migrationProgressChanged: ((CGFloat, TimeInterval) -> ())? = nil,
         migrationsCompletion: @escaping (Result<Database, Error>, Bool) -> ()
@@ -20,6 +21,13 @@ public enum AppSetup {
         
         var backgroundTask: OWSBackgroundTask? = OWSBackgroundTask(labelStr: #function)
         
+        // Open the database connections in parallel with the rest of the setup so the first queries don't need to wait for
+        // the connections to be opened (if this is the first access of 'Storage.shared' it also avoids creating the
+        // 'DatabasePool' on the main thread)
+        DispatchQueue.global(qos: .userInitiated).async {
+            Storage.shared.prewarmConnections(readerCount: prewarmReaderCount)
+        }
+        
         DispatchQueue.global(qos: .userInitiated).async {
             // Order matters here.
             //
@@ -43,6 +51,7 @@ public enum AppSetup {
                 windowManager: OWSWindowManager(default: ())
             )
             appSpecificBlock()
+            LaunchTiming.record(.environmentSetup)
             
             /// `performMainSetup` **MUST** run before `perform(migrations:)`
             Configuration.performMainSetup()
@@ -74,6 +83,8 @@ public enum AppSetup {
             ],
             onProgressUpdate: migrationProgressChanged,
             onComplete: { result, needsConfigSync in
+                LaunchTiming.record(.migrationsCompleted)
+                
                 DispatchQueue.main.async {
                     migrationsCompletion(result, needsConfigSync)
                     
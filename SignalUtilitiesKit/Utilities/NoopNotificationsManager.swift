@@ -7,7 +7,7 @@ import SessionMessagingKit
 public class NoopNotificationsManager: NotificationsProtocol {
     public init() {}
     
-    public func notifyUser(_ db: Database, for interaction: Interaction, in thread: SessionThread) {
+    public func notifyUser(for batch: NotificationBatch) {
         owsFailDebug("")
     }
     